@@ -0,0 +1,117 @@
+/**
+ * bench.cpp
+ *
+ * Allocation counting and the JSON report
+ */
+
+#include "bench.h"
+#include <ArduinoJson.h>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+// ==================== ALLOCATION COUNTING ====================
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint32_t> allocationCount(0);
+static std::atomic<uint32_t> allocatedBytes(0);
+
+static inline void countAllocation(size_t size) {
+    if (!counting.load(std::memory_order_relaxed)) return;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void startCountingAllocations() {
+    allocationCount.store(0);
+    allocatedBytes.store(0);
+    counting.store(true);
+}
+
+AllocationCounts stopCountingAllocations() {
+    counting.store(false);
+    AllocationCounts counts;
+    counts.allocations = allocationCount.load();
+    counts.bytes = allocatedBytes.load();
+    return counts;
+}
+
+// Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    countAllocation(size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    countAllocation(count * size);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    countAllocation(size);
+    return __real_realloc(pointer, size);
+}
+
+}  // extern "C"
+
+#ifdef NATIVE_BUILD
+// On Linux operator new lives in the shared libstdc++, whose malloc calls
+// are not wrapped; on the S3 it is linked statically and already counted
+void* operator new(size_t size) {
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer) abort();
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+#endif
+
+// ==================== REPORT ====================
+
+void BenchRunner::report(Print& out) const {
+    DynamicJsonDocument doc(1024 + count * 192);
+    doc["target"] = ESP.getChipModel();
+    doc["cpu_mhz"] = ESP.getCpuFreqMHz();
+    doc["compiler"] = __VERSION__;
+#ifdef ARDUINOJSON_VERSION
+    doc["arduinojson"] = ARDUINOJSON_VERSION;
+#endif
+
+    JsonArray benchmarks = doc.createNestedArray("benchmarks");
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult& result = results[i];
+        JsonObject entry = benchmarks.createNestedObject();
+        entry["name"] = result.name;
+        entry["iterations"] = result.iterations;
+        entry["ns_per_op"] = serialized(String(result.nsPerOp, 1));
+        entry["bytes_per_op"] = serialized(String(result.bytesPerOp, 1));
+        entry["allocs_per_op"] = serialized(String(result.allocationsPerOp, 2));
+    }
+
+    serializeJson(doc, out);
+    out.println();
+}
@@ -0,0 +1,102 @@
+/**
+ * bench.h
+ *
+ * Benchmark harness for the firmware hot paths ([env:bench] on Linux,
+ * [env:bench-esp32] on the S3). Each benchmark runs until it has taken
+ * BENCH_MIN_RUN_US, timed with esp_timer; heap use is counted by wrapping
+ * malloc/calloc/realloc at link time (-Wl,--wrap in platformio.ini).
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define BENCH_MIN_RUN_US 200000
+#define BENCH_WARMUP_OPS 16
+#define BENCH_MAX_RESULTS 32
+
+// ==================== ALLOCATION COUNTING ====================
+
+struct AllocationCounts {
+    uint32_t allocations;  // malloc, calloc, realloc and operator new calls
+    uint32_t bytes;        // Bytes requested by them
+};
+
+/**
+ * Zero the counters and count allocations from now on
+ */
+void startCountingAllocations();
+
+/**
+ * Stop counting
+ * @return Allocations since startCountingAllocations()
+ */
+AllocationCounts stopCountingAllocations();
+
+/**
+ * Keep the compiler from dropping a result that is otherwise unused
+ */
+template <typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// ==================== RUNNER ====================
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;
+    double nsPerOp;
+    double bytesPerOp;
+    double allocationsPerOp;
+};
+
+class BenchRunner {
+public:
+    /**
+     * Time op() and record ns, bytes and allocations per call
+     */
+    template <typename Op>
+    void run(const char* name, Op op) {
+        if (count == BENCH_MAX_RESULTS) return;
+
+        for (int i = 0; i < BENCH_WARMUP_OPS; i++) op();  // Lazy statics, caches
+
+        uint32_t iterations = BENCH_WARMUP_OPS;
+        int64_t elapsedUs;
+        AllocationCounts allocations;
+        while (true) {
+            startCountingAllocations();
+            int64_t start = esp_timer_get_time();
+            for (uint32_t i = 0; i < iterations; i++) op();
+            elapsedUs = esp_timer_get_time() - start;
+            allocations = stopCountingAllocations();
+
+            if (elapsedUs >= BENCH_MIN_RUN_US || iterations >= (1UL << 28)) break;
+            // Aim 20% past the minimum to avoid another round
+            uint64_t next = elapsedUs > 0 ? (uint64_t)iterations * BENCH_MIN_RUN_US * 6 / 5 / elapsedUs + 1
+                                          : (uint64_t)iterations * 16;
+            iterations = (uint32_t)min(next, (uint64_t)iterations * 16);
+        }
+
+        BenchResult& result = results[count++];
+        result.name = name;
+        result.iterations = iterations;
+        result.nsPerOp = elapsedUs * 1000.0 / iterations;
+        result.bytesPerOp = (double)allocations.bytes / iterations;
+        result.allocationsPerOp = (double)allocations.allocations / iterations;
+    }
+
+    /**
+     * Write all results as one line of JSON (see tools/bench_compare.py)
+     */
+    void report(Print& out) const;
+
+private:
+    BenchResult results[BENCH_MAX_RESULTS];
+    size_t count = 0;
+};
+
+#endif // BENCH_H
@@ -0,0 +1,204 @@
+/**
+ * bench_main.cpp
+ *
+ * Hot-path benchmarks; prints one JSON line with ns, bytes and allocations
+ * per operation:
+ *
+ *   pio run -e bench && .pio/build/bench/program > bench.json
+ *   pio run -e bench-esp32 -t upload -t monitor
+ *   python tools/bench_compare.py baseline.json bench.json
+ */
+
+#include "bench.h"
+#include "config.h"
+#include "onem2m.h"
+#include "audio_sensor.h"
+#include "led_actuator.h"
+#include "mmwave_sensor.h"
+#include "report_policy.h"
+#include <math.h>
+
+// ==================== INPUTS ====================
+
+static const char BINARY_SWITCH_NOTIFICATION[] =
+    "{\"m2m:sgn\":{\"nev\":{\"rep\":{\"cod:binSh\":{\"rn\":\"binarySwitch\",\"ty\":28,"
+    "\"ri\":\"id-7b1d\",\"pi\":\"id-52ac\",\"ct\":\"20250101T080000,000000\",\"lt\":\"20250101T081500,000000\","
+    "\"st\":4,\"cnd\":\"org.onem2m.common.moduleclass.binarySwitch\",\"state\":true}},\"net\":1},"
+    "\"sur\":\"/room-mn-cse/moodMonitorAE/Room01/Desk01/lamp/binarySwitch/subLampSwitch\"}}";
+
+static const char COLOR_NOTIFICATION[] =
+    "{\"m2m:sgn\":{\"nev\":{\"rep\":{\"cod:color\":{\"rn\":\"color\",\"ty\":28,"
+    "\"ri\":\"id-9f30\",\"pi\":\"id-52ac\",\"ct\":\"20250101T080000,000000\",\"lt\":\"20250101T081500,000000\","
+    "\"st\":7,\"cnd\":\"org.onem2m.common.moduleclass.colour\",\"red\":255,\"green\":120,\"blue\":40}},\"net\":1},"
+    "\"sur\":\"/room-mn-cse/moodMonitorAE/Room01/Desk01/lamp/color/subLampColor\"}}";
+
+static const char VERIFICATION_NOTIFICATION[] =
+    "{\"m2m:sgn\":{\"vrq\":true,\"sur\":\"/room-mn-cse/moodMonitorAE/Room01/Desk01/lamp/binarySwitch/subLampSwitch\","
+    "\"cr\":\"CMoodMonitor\"}}";
+
+// WRITE_PARAMS ACK behind the ON/OFF text the sensor emits in normal mode
+static const uint8_t RADAR_ACK_STREAM[] = {
+    'O', 'F', 'F', '\r', '\n',
+    0xFD, 0xFC, 0xFB, 0xFA, 0x04, 0x00, 0x07, 0x01, 0x00, 0x00, 0x04, 0x03, 0x02, 0x01
+};
+
+static int32_t audioBlock[I2S_READ_LEN];
+
+// 1 kHz at -30 dBFS, as the INMP441 delivers it (24 bits, left-aligned)
+static void fillAudioBlock() {
+    for (size_t i = 0; i < I2S_READ_LEN; i++) {
+        double sample = 0.0316 * 8388607.0 * sin(2.0 * M_PI * 1000.0 * i / SAMPLE_RATE);
+        audioBlock[i] = (int32_t)sample * 256;
+    }
+}
+
+// ==================== BENCHMARKS ====================
+
+// As OneM2MClient::request() serializes the body into the connection's arena
+static void serializePayload(const JsonDocument& doc) {
+    static char body[ONEM2M_ARENA_SIZE];
+    benchKeep(serializeJson(doc, body, sizeof(body)));
+}
+
+static void benchPayloads(BenchRunner& runner) {
+    runner.run("payload/lux", [] {
+        StaticJsonDocument<256> doc;
+        buildLuxPayload(doc, 412.5f);
+        serializePayload(doc);
+    });
+    runner.run("payload/lux_replayed", [] {
+        StaticJsonDocument<256> doc;
+        buildLuxPayload(doc, 412.5f, "20250101T081500");
+        serializePayload(doc);
+    });
+    runner.run("payload/audio", [] {
+        StaticJsonDocument<256> doc;
+        buildAudioPayload(doc, 47.3f);
+        serializePayload(doc);
+    });
+    runner.run("payload/occupancy", [] {
+        StaticJsonDocument<256> doc;
+        buildOccupancyPayload(doc, true);
+        serializePayload(doc);
+    });
+    runner.run("payload/occupancy_stats", [] {
+        OccupancyStats stats = {300, 214, 2, 1260, 0, true};
+        StaticJsonDocument<256> doc;
+        buildOccupancyStatsPayload(doc, stats);
+        serializePayload(doc);
+    });
+    runner.run("payload/lamp_switch", [] {
+        StaticJsonDocument<256> doc;
+        buildLampSwitchPayload(doc, true);
+        serializePayload(doc);
+    });
+}
+
+static void benchNotifications(BenchRunner& runner) {
+    // handleNotification() receives the body as a String from the WebServer
+    static String binarySwitch = BINARY_SWITCH_NOTIFICATION;
+    static String color = COLOR_NOTIFICATION;
+    static String verification = VERIFICATION_NOTIFICATION;
+
+    runner.run("notification/binary_switch", [] {
+        StaticJsonDocument<1024> doc;
+        LampNotification notification;
+        benchKeep(parseNotification(binarySwitch, doc, notification));
+        benchKeep(notification);
+    });
+    runner.run("notification/color", [] {
+        StaticJsonDocument<1024> doc;
+        LampNotification notification;
+        benchKeep(parseNotification(color, doc, notification));
+        benchKeep(notification);
+    });
+    runner.run("notification/verification", [] {
+        StaticJsonDocument<1024> doc;
+        LampNotification notification;
+        benchKeep(parseNotification(verification, doc, notification));
+        benchKeep(notification);
+    });
+}
+
+static void benchAudio(BenchRunner& runner) {
+    fillAudioBlock();
+    runner.run("audio/level_db", [] {
+        benchKeep(audioLevelFromSamples(audioBlock, I2S_READ_LEN));
+    });
+}
+
+static void benchRadar(BenchRunner& runner) {
+    runner.run("radar/ack_parse", [] {
+        RadarAckParser parser(RADAR_CMD_WRITE_PARAMS);
+        RadarAckResult result = RadarAckResult::Pending;
+        for (size_t i = 0; i < sizeof(RADAR_ACK_STREAM) && result == RadarAckResult::Pending; i++) {
+            result = parser.feed(RADAR_ACK_STREAM[i]);
+        }
+        benchKeep(result);
+    });
+
+    // Runtime configuration as applyRadarConfig() writes it
+    static volatile uint32_t sensitivity = 40;
+    runner.run("radar/gate_frame", [] {
+        RadarParam params[MMWAVE_GATE_COUNT];
+        for (uint16_t gate = 0; gate < MMWAVE_GATE_COUNT; gate++) {
+            params[gate] = {(uint16_t)(RADAR_PARAM_TRIGGER_THRESHOLD + gate), sensitivity};
+        }
+        auto frame = radarParamFrame(RADAR_CMD_WRITE_PARAMS, params);
+        benchKeep(frame);
+    });
+}
+
+static void benchPaths(BenchRunner& runner) {
+    runner.run("paths/initialize", [] {
+        OneM2MPaths paths;
+        paths.initialize(CSE_HOST, CSE_PORT, CSE_NAME, AE_NAME, ROOM_CONTAINER, DESK_CONTAINER, LUX_DEVICE_NAME);
+        benchKeep(paths);
+    });
+
+    onem2mPaths.initialize(CSE_HOST, CSE_PORT, CSE_NAME, AE_NAME, ROOM_CONTAINER, DESK_CONTAINER, LUX_DEVICE_NAME);
+    // As in updateAudioValue() and OneM2MClient::request()
+    runner.run("paths/child", [] {
+        String audioPath = onem2mPaths.DESK_PATH + "/" + String(AUDIO_DEVICE_NAME);
+        benchKeep(audioPath);
+    });
+    static char arenaBuffer[ONEM2M_ARENA_SIZE];
+    static RequestArena arena(arenaBuffer, sizeof(arenaBuffer));
+    runner.run("paths/request_url", [] {
+        String audioPath = onem2mPaths.DESK_PATH + "/" + String(AUDIO_DEVICE_NAME);
+        benchKeep(arena.format("%s%s", onem2mPaths.BASE_URL.c_str(), audioPath.c_str()));
+        arena.reset();
+    });
+}
+
+static void runBenchmarks() {
+    static BenchRunner runner;
+    benchPayloads(runner);
+    benchNotifications(runner);
+    benchAudio(runner);
+    benchRadar(runner);
+    benchPaths(runner);
+    runner.report(Serial);
+}
+
+#ifdef NATIVE_CUSTOM_MAIN
+
+int main() {
+    runBenchmarks();
+    return 0;
+}
+
+#else
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);  // Let the monitor attach
+    Serial.println("Running benchmarks");
+    runBenchmarks();
+}
+
+void loop() {
+    delay(1000);
+}
+
+#endif // NATIVE_CUSTOM_MAIN
@@ -9,8 +9,6 @@
 
 #include <Arduino.h>
 #include <driver/i2s.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
 
 // ==================== AUDIO SENSOR CONFIGURATION ====================
 // Optimal pins for ESP32-S3 I2S (HSPI group, no conflicts)
@@ -26,18 +24,28 @@
 
 
 // ==================== STATE STRUCT ====================
+// Current level is published through the sensor snapshot; this state is
+// owned by the sensor scheduler task
 struct AudioSensorState {
-  double currentLevel;
   double lastReportedLevel;
   bool initialized;
-  SemaphoreHandle_t mutex;
 };
 
 extern AudioSensorState audioState;
 
 // ==================== FUNCTIONS ====================
 bool initAudioSensor();
-bool startAudioSensorTask();
+
+/**
+ * Sound level of one I2S block
+ * @param samples INMP441 words (24-bit, left-aligned in 32 bits)
+ * @param count Number of samples
+ * @return dB SPL, 0 for silence or an empty block
+ */
+double audioLevelFromSamples(const int32_t* samples, size_t count);
+
+void audioSensorJob();
+bool scheduleAudioSensorJob();
 float getLastReportedAudioLevel();
 void setLastReportedAudioLevel(float level);
 
@@ -0,0 +1,20 @@
+/**
+ * battery_mode.h
+ *
+ * Deep-sleep duty cycle for battery-powered desks (BATTERY_MODE). Each wake
+ * samples lux and occupancy into RTC memory; every BATTERY_UPLINK_EVERY
+ * wakes the radio comes up once and the batch is sent with dgt timestamps.
+ */
+
+#ifndef BATTERY_MODE_H
+#define BATTERY_MODE_H
+
+#include <Arduino.h>
+
+/**
+ * Run one wake: sample, uplink if due, arm the timer and OT2 wake sources
+ * and enter deep sleep. Does not return.
+ */
+void runBatteryWakeCycle();
+
+#endif // BATTERY_MODE_H
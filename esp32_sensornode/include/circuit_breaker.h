@@ -0,0 +1,102 @@
+/**
+ * circuit_breaker.h
+ *
+ * Failure handling shared by all users of one CSE connection pool. The
+ * breaker opens after a run of failed requests and fails further ones
+ * immediately instead of letting each wait for its timeout; after a
+ * jittered open time that doubles on every failed probe, one request is
+ * let through to test the CSE. The retry budget caps retries per window
+ * so a recovering CSE is not met by every caller's backlog at once.
+ */
+
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <Arduino.h>
+
+// Ordered by severity: the metrics report the worst state since the last report
+enum BreakerState : uint8_t {
+    BREAKER_CLOSED,
+    BREAKER_HALF_OPEN,  // One probe request in flight
+    BREAKER_OPEN
+};
+
+/**
+ * Random delay between half of ms and ms ("equal jitter"), so nodes that
+ * failed together do not retry together
+ */
+uint32_t jitteredDelay(uint32_t ms);
+
+/**
+ * Jittered exponential backoff
+ * @param attempt 0 for the first retry
+ * @return jitteredDelay(min(maxMs, baseMs * 2^attempt))
+ */
+uint32_t backoffDelay(uint32_t baseMs, uint32_t maxMs, uint8_t attempt);
+
+class CircuitBreaker {
+public:
+    /**
+     * @param threshold Consecutive failures that open the breaker
+     * @param baseOpenMs Open time after the first trip
+     * @param maxOpenMs Open time cap while probes keep failing
+     */
+    CircuitBreaker(uint8_t threshold, uint32_t baseOpenMs, uint32_t maxOpenMs)
+        : threshold(threshold), baseOpenMs(baseOpenMs), maxOpenMs(maxOpenMs) {}
+
+    /**
+     * Ask before sending; an allowed request must report its outcome
+     * @return false to fail fast: open, or half-open with the probe out
+     */
+    bool allowRequest();
+
+    /**
+     * A reply came back (any status below 500)
+     */
+    void recordSuccess();
+
+    /**
+     * Transport error or 5xx
+     */
+    void recordFailure();
+
+    BreakerState state() const;
+
+    /**
+     * @return ms until allowRequest() would let a probe through, 0 if closed
+     */
+    uint32_t msUntilProbe() const;
+
+private:
+    bool enter(BreakerState next);  // Caller holds mux; true if the state changed
+
+    const uint8_t threshold;
+    const uint32_t baseOpenMs;
+    const uint32_t maxOpenMs;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    BreakerState current = BREAKER_CLOSED;
+    uint8_t failures = 0;     // Consecutive, while closed
+    uint8_t trips = 0;        // Opens since the last close
+    unsigned long openedAt = 0;
+    uint32_t openMs = 0;
+};
+
+class RetryBudget {
+public:
+    RetryBudget(uint16_t retries, uint32_t windowMs) : limit(retries), windowMs(windowMs) {}
+
+    /**
+     * Take one retry from the current window
+     * @return false if the window's retries are used up
+     */
+    bool tryAcquire();
+
+private:
+    const uint16_t limit;
+    const uint32_t windowMs;
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    uint16_t used = 0;
+    unsigned long windowStart = 0;
+};
+
+#endif // CIRCUIT_BREAKER_H
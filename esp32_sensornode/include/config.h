@@ -14,29 +14,100 @@
 #define ROOM_CONTAINER "Room01"
 #define DESK_CONTAINER "Desk01"
 
+// HTTPS to the CSE (ACME's useTLS). Needs include/cse_credentials.h from
+// scripts/generate-certificates.sh: CA, and the node's certificate for mTLS
+#define CSE_USE_TLS false
+#define CSE_TLS_SERVER_NAME "room-mn-cse"  // CN/DNS name in the CSE certificate; CSE_HOST may be an IP
+
 // Device names
 #define LUX_DEVICE_NAME "luxSensor"
 #define AUDIO_DEVICE_NAME "acousticSensor"
 #define OCCUPANCY_DEVICE_NAME "occupancySensor"
+#define AUDIO_SUMMARY_NAME "acousticSummary"
 
 // Update intervals (ms)
 #define LUX_UPDATE_INTERVAL 10000
 #define AUDIO_UPDATE_INTERVAL 10000
 #define OCCUPANCY_UPDATE_INTERVAL 10000
+#define OCCUPANCY_STATS_INTERVAL 300000  // Dwell-time statistics window
+#define SENSOR_SUMMARY_INTERVAL 300000   // Count/min/max/mean/stddev window for lux, audio, occupancy
+#define SENSOR_CHANGE_REPORTS true       // false: lux and audio go out once per summary window only
 
 // Thresholds
 #define LUX_THRESHOLD 1.0f
 #define AUDIO_THRESHOLD 2.0f  // dB change threshold
 
+// Payload precision: values are rounded to these steps and sent with only
+// their decimals (lux 412, louds 52.3)
+#define LUX_QUANTUM 1.0f
+#define AUDIO_QUANTUM 0.1f    // dB
+#define OCCUPANCY_SHARE_QUANTUM 0.01f  // Occupied share of samples in the summary
+
 // Occupancy automation
 #define SYNC_OCCUPANCY_TO_LAMP true  // Set to false to disable automatic lamp control
 
+// mmWave radar (S3KM1110) defaults, runtime-settable via the occupancy FlexContainer.
+// The gate and unmanned duration are stored in the radar's flash: they are
+// only written at power-on with RADAR_WRITE_DEFAULTS, otherwise the radar
+// keeps its stored values until the CSE sets them
+#define RADAR_WRITE_DEFAULTS false
+#define RADAR_MAX_DISTANCE_GATE 12
+#define RADAR_UNMANNED_DURATION 30  // seconds
+#define RADAR_ENGINEERING_MODE false
+
 // I2C pins (VEML7700)
 #define I2C_SDA_PIN 8
 #define I2C_SCL_PIN 9
 
-// FreeRTOS
-#define LUX_TASK_STACK_SIZE 4096
-#define LUX_TASK_PRIORITY 1
+// FreeRTOS task core/priority/stack plan lives in task_plan.cpp
+
+// Sensor job deadlines (ms after due time, includes the oneM2M update)
+#define LUX_JOB_DEADLINE 2000
+#define AUDIO_JOB_DEADLINE 2000
+#define OCCUPANCY_JOB_DEADLINE 2000
+#define SCHEDULER_STATS_INTERVAL 60000
+#define TASK_PROFILE_INTERVAL 60000  // Per-task CPU share and latency report
+
+// Provisioning
+#define PROVISION_MAX_ATTEMPTS 3      // Per resource, on timeouts and 5xx
+#define PROVISION_RETRY_BASE_MS 250   // Doubled after each failed attempt, jittered
+#define PROVISION_RETRY_MAX_MS 4000
+#define NOTIFICATION_SERVER_TIMEOUT 5000
+
+// Background connectivity (sensors run before WiFi/CSE are up)
+#define WIFI_CONNECT_TIMEOUT 15000
+#define CONNECT_BACKOFF_MIN_MS 1000    // Doubled after each failed attempt
+#define CONNECT_BACKOFF_MAX_MS 60000
+#define NTP_SERVER "pool.ntp.org"      // Timestamps (dgt) for buffered readings
+#define CLOCK_SYNC_TIMEOUT 5000
+#define READING_BUFFER_CAPACITY 128    // Readings kept while offline, oldest dropped
+#define READING_REPLAY_INTERVAL_MS 5000 // Least wait between replays while the CSE fails
+
+// Power management (opt-in low-power profile for battery-powered desks)
+#define LOW_POWER_PROFILE false
+#define PM_MAX_CPU_FREQ_MHZ 160
+#define PM_MIN_CPU_FREQ_MHZ 40
+#define WIFI_LISTEN_INTERVAL 3         // Beacon intervals between modem wakes, use a multiple of the AP's DTIM
+#define PM_SAMPLE_ALIGN_MS 10000       // Job start times snap to this grid so one wake serves all sensors
+
+// WiFi connection manager
+#define WIFI_FAST_CONNECT_TIMEOUT 3000   // Cached BSSID/channel before a full scan
+#define WIFI_REUSE_DHCP_LEASE false      // Configure the cached lease as static IP (needs a reservation)
+#define WIFI_RSSI_SAMPLE_INTERVAL 10000
+#define WIFI_REPORT_INTERVAL 300000      // diag:wifi record
+
+// Battery mode: deep sleep between samples, readings batched in RTC memory.
+// Lux and occupancy only; audio, the lamp and subscriptions are not run.
+#define BATTERY_MODE false
+#define BATTERY_WAKE_INTERVAL 60000      // Timer wake (ms); OT2 edges also wake
+#define BATTERY_UPLINK_EVERY 15          // Wakes per uplink
+#define BATTERY_BATCH_CAPACITY 64        // Samples kept in RTC memory, oldest dropped
+#define BATTERY_UPLINK_TIMEOUT 10000     // WiFi budget per uplink before giving up
+#define BATTERY_DELTA_BATCH false        // Uplink the batch as one delta-encoded contentInstance
+#define VEML_SETTLE_MS 120               // First integration after power-on (100 ms IT)
+
+// Binary event trace, dumped with GET /trace on the notification server
+#define TRACE_ENABLED false
+#define TRACE_BUFFER_EVENTS 2048         // 8 bytes each, power of two
 
 #endif
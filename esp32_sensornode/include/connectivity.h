@@ -0,0 +1,73 @@
+/**
+ * connectivity.h
+ *
+ * Background WiFi/CSE bring-up. Sensors start sampling at boot; this task
+ * connects, provisions and then flushes readings buffered while offline.
+ * It stays behind to publish what the sensor jobs queue and to replay
+ * readings buffered during later CSE outages.
+ */
+
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// ==================== BOOT TIMELINE ====================
+
+enum BootPhase {
+    BOOT_SENSORS_STARTED,
+    BOOT_FIRST_SAMPLE,
+    BOOT_WIFI_CONNECTED,
+    BOOT_CLOCK_SYNCED,
+    BOOT_CSE_REACHABLE,
+    BOOT_PROVISIONED,
+    BOOT_BUFFER_FLUSHED,
+    BOOT_PHASE_COUNT
+};
+
+/**
+ * Record the time of a boot phase (first call per phase wins)
+ * @param phase Phase that just completed
+ */
+void markBootPhase(BootPhase phase);
+
+// ==================== CONNECTIVITY ====================
+
+/**
+ * Start the background connectivity task
+ * @return true if the task was created
+ */
+bool startConnectivity();
+
+/**
+ * @return true once the resource tree exists on the CSE
+ */
+bool isCloudReady();
+
+/**
+ * Wake the connectivity task to publish queued readings and summaries;
+ * while the CSE fails it waits for the breaker's next probe instead.
+ * Safe to call from any task
+ */
+void requestReadingReplay();
+
+/**
+ * Format a wall-clock time as a oneM2M timestamp (UTC, basic ISO 8601)
+ * @param t Seconds since the epoch
+ * @param out Output buffer, at least 16 bytes
+ * @param len Size of out
+ * @return true if formatted
+ */
+bool formatTimestamp(time_t t, char* out, size_t len);
+
+/**
+ * Format the wall-clock time of a sample as a oneM2M timestamp
+ * @param sampleMs millis() when the sample was taken
+ * @param out Output buffer, at least 16 bytes
+ * @param len Size of out
+ * @return false if the clock has not been synchronized
+ */
+bool formatSampleTime(unsigned long sampleMs, char* out, size_t len);
+
+#endif // CONNECTIVITY_H
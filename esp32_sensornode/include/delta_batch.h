@@ -0,0 +1,78 @@
+/**
+ * delta_batch.h
+ *
+ * Compact binary form of a battery mode batch (BATTERY_DELTA_BATCH). Each
+ * sample keeps only its change from the one before, as varints, so a
+ * batch of one-minute samples takes two or three bytes per sample instead
+ * of a FlexContainer update request per change. It is posted base64 as
+ * one contentInstance of the desk's batches container and decoded with
+ * tools/delta_batch.py.
+ *
+ * Version 1 (varints are LEB128, signed values zigzag encoded):
+ *
+ *   u8      version
+ *   varint  lux quantum in thousandths of a lux
+ *   varint  time of the first sample (epoch s)
+ *   per sample:
+ *     varint  zigzag(interval - previous interval) << 2 | occupied << 1 | has lux
+ *     varint  zigzag(lux steps - previous lux steps), only with lux
+ *
+ * The interval is seconds since the previous sample (0 for the first, so
+ * regular wakes encode as 0); lux steps are lux / quantum, rounded.
+ */
+
+#ifndef DELTA_BATCH_H
+#define DELTA_BATCH_H
+
+#include <Arduino.h>
+
+#define DELTA_BATCH_VERSION 1
+#define DELTA_BATCH_CONTAINER "batches"
+#define DELTA_BATCH_CONTENT_FORMAT "application/x-mio-delta:1"  // :1 = base64 (oneM2M cnf)
+
+class DeltaBatchEncoder {
+public:
+    /**
+     * @param buffer Receives the encoded batch
+     * @param luxQuantum Lux step, e.g. LUX_QUANTUM
+     */
+    DeltaBatchEncoder(uint8_t* buffer, size_t capacity, float luxQuantum);
+
+    /**
+     * Append a sample; samples go in time order
+     * @param lux NAN if the sensor had no reading; infinite or out-of-range
+     *            values are sent as no reading too
+     * @return false if it does not fit (the batch stays as it was)
+     */
+    bool add(uint32_t time, float lux, bool occupied);
+
+    size_t length() const { return used; }
+    size_t count() const { return samples; }
+
+private:
+    bool putVarint(uint64_t value);
+
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used = 0;
+    size_t samples = 0;
+    float luxQuantum;
+    uint32_t lastTime = 0;
+    int64_t lastInterval = 0;
+    int32_t lastLuxSteps = 0;
+};
+
+/**
+ * Base64 (RFC 4648, padded), NUL-terminated
+ * @return Characters written without the NUL, 0 if capacity is too small
+ */
+size_t base64Encode(const uint8_t* data, size_t length, char* out, size_t capacity);
+
+/**
+ * @return Buffer size base64Encode() needs for length bytes, with the NUL
+ */
+constexpr size_t base64Capacity(size_t length) {
+    return (length + 2) / 3 * 4 + 1;
+}
+
+#endif // DELTA_BATCH_H
@@ -0,0 +1,24 @@
+/**
+ * diagnostics.h
+ *
+ * Diagnostics records published as contentInstances of the desk's
+ * "diagnostics" container (created by provisioning)
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define DIAGNOSTICS_CONTAINER "diagnostics"
+
+/**
+ * Publish one diagnostics record
+ * @param kind Record kind, added as "diag:<kind>" label
+ * @param record JSON record stored as the instance content
+ * @return true if the contentInstance was created
+ */
+bool publishDiagnostics(const char* kind, const JsonDocument& record);
+
+#endif // DIAGNOSTICS_H
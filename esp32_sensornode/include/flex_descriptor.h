@@ -0,0 +1,211 @@
+/**
+ * flex_descriptor.h
+ *
+ * Table-driven FlexContainer serialization. Module class descriptors are
+ * generated from the .fcp files into mio_descriptors.h; the templates here
+ * check every written attribute against its descriptor at compile time.
+ *
+ *   JsonObject lux = doc.createNestedObject(MioLuxSensor::TYPE);
+ *   writeFlex<MioLuxSensor>(lux, flexField<MioLuxSensor::lux>(412.5f));
+ */
+
+#ifndef FLEX_DESCRIPTOR_H
+#define FLEX_DESCRIPTOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <type_traits>
+
+// ==================== DESCRIPTORS ====================
+
+enum class FlexType : uint8_t {
+    None,
+    Boolean,
+    Integer,
+    NonNegInteger,
+    Float,
+    String,
+    Timestamp,
+    List
+};
+
+struct FlexAttribute {
+    const char* sname;
+    FlexType type;
+    FlexType listType;  // Element type for FlexType::List
+    bool mandatory;     // car "1"
+};
+
+// ==================== FIELDS ====================
+
+/**
+ * Attribute value tagged with its descriptor index
+ */
+template <unsigned A, typename V>
+struct FlexField {
+    V value;
+};
+
+template <unsigned A, typename V>
+constexpr FlexField<A, V> flexField(V value) {
+    return FlexField<A, V>{value};
+}
+
+/**
+ * Non-owning view of a list attribute's elements
+ */
+template <typename T>
+struct FlexList {
+    const T* items;
+    size_t count;
+};
+
+template <typename T, size_t N>
+constexpr FlexList<T> flexList(const T (&items)[N]) {
+    return FlexList<T>{items, N};
+}
+
+/**
+ * Float rounded to a multiple of its quantum, written with only the
+ * decimals the quantum has: 412 for 1 lux, 52.3 for 0.1 dB instead of
+ * the float's 9 significant digits (412.2999878)
+ */
+struct FlexQuantized {
+    int32_t scaled;    // Value in units of 10^-decimals
+    uint8_t decimals;
+};
+
+/**
+ * @param quantum Step, e.g. 1.0 or 0.1; at most 6 decimals are kept
+ * @return 0 for NaN; values beyond int32 (infinity included) are clamped
+ *         to the largest multiple of the step that fits
+ */
+inline FlexQuantized flexQuantize(float value, float quantum) {
+    uint8_t decimals = 0;  // 1 -> 0, 0.1 -> 1, 0.25 -> 2
+    double scale = 1;
+    while (decimals < 6 && fabs(quantum * scale - round(quantum * scale)) > 1e-3) {
+        decimals++;
+        scale *= 10;
+    }
+    // lround() is undefined for NaN and out-of-range results
+    double scaledQuantum = quantum * scale;
+    long step = (scaledQuantum >= 1 && scaledQuantum <= INT32_MAX) ? lround(scaledQuantum) : 1;
+    double steps = isnan(value) ? 0 : value * scale / step;
+    double limit = (double)(INT32_MAX / step);
+    steps = steps > limit ? limit : (steps < -limit ? -limit : steps);
+    return FlexQuantized{(int32_t)(lround(steps) * step), decimals};
+}
+
+// ==================== TYPE CHECKS ====================
+
+template <typename V>
+constexpr bool flexScalarAccepts(FlexType type) {
+    typedef typename std::decay<V>::type T;
+    return type == FlexType::Boolean ? std::is_same<T, bool>::value
+         : type == FlexType::Integer || type == FlexType::NonNegInteger
+               ? std::is_integral<T>::value && !std::is_same<T, bool>::value
+         : type == FlexType::Float
+               ? std::is_arithmetic<T>::value && !std::is_same<T, bool>::value
+         : type == FlexType::String || type == FlexType::Timestamp
+               ? std::is_convertible<T, const char*>::value || std::is_same<T, ::String>::value
+         : false;
+}
+
+template <typename V>
+struct FlexValueTraits {
+    static constexpr bool accepts(FlexType type, FlexType) {
+        return flexScalarAccepts<V>(type);
+    }
+};
+
+template <>
+struct FlexValueTraits<FlexQuantized> {
+    static constexpr bool accepts(FlexType type, FlexType) {
+        return type == FlexType::Float;
+    }
+};
+
+template <typename T>
+struct FlexValueTraits<FlexList<T>> {
+    static constexpr bool accepts(FlexType type, FlexType listType) {
+        return type == FlexType::List && flexScalarAccepts<T>(listType);
+    }
+};
+
+// ==================== WRITERS ====================
+
+template <typename V>
+inline void writeFlexValue(JsonObject flex, const char* sname, const V& value) {
+    flex[sname] = value;
+}
+
+inline void writeFlexValue(JsonObject flex, const char* sname, const FlexQuantized& value) {
+    if (value.decimals == 0) {
+        flex[sname] = value.scaled;
+        return;
+    }
+    // The nearest double to the decimal prints back as that decimal
+    double divisor = 1;
+    for (uint8_t i = 0; i < value.decimals; i++) divisor *= 10;
+    flex[sname] = value.scaled / divisor;
+}
+
+template <typename T>
+inline void writeFlexValue(JsonObject flex, const char* sname, const FlexList<T>& list) {
+    JsonArray items = flex.createNestedArray(sname);
+    for (size_t i = 0; i < list.count; i++) {
+        items.add(list.items[i]);
+    }
+}
+
+/**
+ * Short name of a descriptor attribute
+ */
+template <typename D, unsigned A>
+constexpr const char* flexName() {
+    static_assert(A < D::ATTRIBUTE_COUNT, "attribute not defined for this module class");
+    return D::ATTRIBUTES[A].sname;
+}
+
+template <typename D, unsigned A, typename V>
+inline void writeFlexField(JsonObject flex, const FlexField<A, V>& field) {
+    static_assert(A < D::ATTRIBUTE_COUNT, "attribute not defined for this module class");
+    static_assert(FlexValueTraits<V>::accepts(D::ATTRIBUTES[A].type, D::ATTRIBUTES[A].listType),
+                  "value type does not match the .fcp datatype");
+    writeFlexValue(flex, D::ATTRIBUTES[A].sname, field.value);
+}
+
+/**
+ * Write attributes into a FlexContainer object
+ * @param flex Object created under D::TYPE
+ * @param fields flexField<D::attr>(value) for each attribute
+ */
+template <typename D, typename... Fields>
+inline void writeFlex(JsonObject flex, const Fields&... fields) {
+    (writeFlexField<D>(flex, fields), ...);
+}
+
+/**
+ * Start a FlexContainer create payload with rn and cnd from the descriptor
+ * @return Object to fill with writeFlex, acpi, lbl
+ */
+template <typename D>
+inline JsonObject beginFlexCreate(JsonDocument& doc, const char* resourceName) {
+    JsonObject flex = doc.createNestedObject(D::TYPE);
+    flex["rn"] = resourceName;
+    flex["cnd"] = D::CND;
+    return flex;
+}
+
+/**
+ * Add the announced attribute list (aa) of D
+ */
+template <typename D>
+inline void writeFlexAnnouncedAttributes(JsonObject flex) {
+    JsonArray aa = flex.createNestedArray("aa");
+    for (size_t i = 0; i < D::ANNOUNCED_COUNT; i++) {
+        aa.add(D::ATTRIBUTES[D::ANNOUNCED[i]].sname);
+    }
+}
+
+#endif // FLEX_DESCRIPTOR_H
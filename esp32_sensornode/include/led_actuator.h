@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include <ArduinoJson.h>
 
 #define NEOPIXEL_PIN 38
 #define NUMPIXELS 1
@@ -11,13 +12,40 @@
 
 bool initLEDActuator();
 bool startLEDActuatorTasks();
-void setupLEDSubscriptions();
 
-bool createLampDevice();
-bool createBinarySwitch();
-bool createColor();
+/**
+ * Wait until the notification server listens and notificationURL is set
+ * @param timeoutMs Maximum time to wait
+ * @return true if the server is ready
+ */
+bool waitForNotificationServer(uint32_t timeoutMs);
+
+// ==================== NOTIFICATIONS ====================
+
+/**
+ * What a oneM2M notification to the node asks for
+ */
+struct LampNotification {
+    bool verification;  // Subscription verification request (vrq)
+    bool hasPower;
+    bool power;
+    bool hasColor;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    JsonObject radar;   // mio:occSr representation inside doc, null if absent
+};
+
+/**
+ * Parse a notification body without acting on it
+ * @param body Request body
+ * @param doc Document holding the parsed body (and notification.radar)
+ * @param notification Output
+ * @return false if the body is not valid JSON
+ */
+bool parseNotification(const String& body, JsonDocument& doc, LampNotification& notification);
 
 extern WebServer* notificationServer;
-extern String notificationURL;
+extern String notificationURL;  // Valid once the notification server is ready
 
 #endif
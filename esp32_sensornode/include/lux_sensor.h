@@ -12,11 +12,11 @@
 
 // ==================== LUX SENSOR STATE ====================
 
+// Current reading is published through the sensor snapshot; this state is
+// owned by the sensor scheduler task
 struct LuxSensorState {
-    float currentLux;
     float lastReportedLux;
     bool initialized;
-    SemaphoreHandle_t mutex;
 };
 
 // Global lux sensor state
@@ -25,11 +25,17 @@ extern LuxSensorState luxState;
 // ==================== LUX SENSOR FUNCTIONS ====================
 
 /**
- * Initialize the VEML7700 sensor
+ * Initialize the VEML7700 sensor; safe to call again after
+ * shutdownLuxSensor() or a deep-sleep wake
  * @return true if initialization succeeded
  */
 bool initLuxSensor();
 
+/**
+ * Put the VEML7700 into shutdown (~0.5 uA) until the next initLuxSensor()
+ */
+void shutdownLuxSensor();
+
 /**
  * Read current lux value from sensor
  * @param luxValue Output parameter for lux reading
@@ -38,29 +44,28 @@ bool initLuxSensor();
 bool readLuxValue(float& luxValue);
 
 /**
- * Get the last reported lux value (thread-safe)
+ * Get the last reported lux value
  * @return Last lux value reported to OneM2M
  */
 float getLastReportedLux();
 
 /**
- * Update the last reported lux value (thread-safe)
+ * Update the last reported lux value
  * @param luxValue New lux value to store
  */
 void setLastReportedLux(float luxValue);
 
-// ==================== FREERTOS TASK ====================
+// ==================== SCHEDULED JOB ====================
 
 /**
- * FreeRTOS task for reading lux sensor and updating OneM2M
- * @param pvParameters Task parameters (unused)
+ * One acquisition cycle: read lux sensor and update OneM2M on change
  */
-void LuxSensorTask(void* pvParameters);
+void luxSensorJob();
 
 /**
- * Start the lux sensor FreeRTOS task
- * @return true if task created successfully
+ * Register the lux sensor job with the sensor scheduler
+ * @return true if job registered successfully
  */
-bool startLuxSensorTask();
+bool scheduleLuxSensorJob();
 
 #endif // LUX_SENSOR_H
@@ -0,0 +1,105 @@
+/**
+ * metrics.h
+ *
+ * Fixed registry of counters, gauges and histograms for the hot paths.
+ * Updates are single atomic operations and safe from any task; the
+ * profiler publishes a snapshot to the desk's "metrics" FlexContainer
+ * (mio:nodMs).
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+#define METRICS_CONTAINER "metrics"
+#define METRIC_MAX_BUCKETS 10  // Including the overflow bucket
+
+enum MetricKind : uint8_t {
+    METRIC_COUNTER,    // Monotonic since boot
+    METRIC_MAX_GAUGE,  // Highest value since the last report
+    METRIC_HISTOGRAM   // Bucket counts since the last report
+};
+
+enum MetricId : uint8_t {
+    METRIC_HTTP_REQUESTS,
+    METRIC_HTTP_TRANSPORT_ERRORS,  // No status code (connect, timeout)
+    METRIC_HTTP_CLIENT_ERRORS,     // 4xx
+    METRIC_HTTP_SERVER_ERRORS,     // 5xx
+    METRIC_HTTP_LATENCY_MS,
+    METRIC_POOL_WAIT_MS,           // Waiting for a free keep-alive connection
+    METRIC_READING_BUFFER_DEPTH,
+    METRIC_LUX_READ_US,
+    METRIC_AUDIO_READ_US,
+    METRIC_BREAKER_STATE,          // Worst BreakerState since the last report
+    METRIC_BREAKER_OPENS,
+    METRIC_BREAKER_CLOSES,
+    METRIC_FAST_FAILS,             // Requests refused while the breaker was open
+    METRIC_RETRIES_DENIED,         // Retries refused by the retry budget
+    METRIC_TLS_FULL_HANDSHAKES,
+    METRIC_TLS_RESUMED_HANDSHAKES, // Abbreviated: the CSE took the cached session
+    METRIC_TLS_HANDSHAKE_FAILURES,
+    METRIC_TLS_HANDSHAKE_MS,
+    METRIC_COUNT
+};
+
+struct MetricDefinition {
+    const char* name;
+    MetricKind kind;
+    const uint32_t* bounds;  // Histogram bucket upper bounds, ascending
+    uint8_t boundCount;      // Buckets = boundCount + 1 (overflow)
+};
+
+extern const MetricDefinition METRICS[METRIC_COUNT];
+
+struct HistogramSnapshot {
+    uint32_t buckets[METRIC_MAX_BUCKETS];
+    uint8_t bucketCount;
+    uint32_t count;
+    uint32_t max;
+};
+
+/**
+ * Add to a counter
+ */
+void metricIncrement(MetricId id, uint32_t amount = 1);
+
+/**
+ * Raise a max gauge (queue depth, wait time)
+ */
+void metricRaise(MetricId id, uint32_t value);
+
+/**
+ * Record one histogram observation
+ */
+void metricObserve(MetricId id, uint32_t value);
+
+/**
+ * @return Counter value, or current max without resetting it
+ */
+uint32_t metricValue(MetricId id);
+
+/**
+ * Read and reset a max gauge
+ */
+uint32_t takeMetricMax(MetricId id);
+
+/**
+ * Read and reset a histogram
+ */
+HistogramSnapshot takeHistogram(MetricId id);
+
+/**
+ * Upper bound of the bucket holding quantile q (0..1); the max for the
+ * overflow bucket
+ */
+uint32_t histogramQuantile(const HistogramSnapshot& snapshot, const uint32_t* bounds, float q);
+
+/**
+ * PUT the current metrics and heap state to <desk>/metrics and start a
+ * new histogram window
+ * @return true if the update succeeded
+ */
+bool publishMetrics();
+
+#endif // METRICS_H
@@ -0,0 +1,164 @@
+/**
+ * mio_descriptors.h
+ *
+ * GENERATED by tools/gen_descriptors.py from mio_sensors.fcp, cod_subset.fcp - do not edit.
+ * One descriptor per FlexContainer module class; announced attribute
+ * lists come from the matching ...Annc class.
+ */
+
+#ifndef MIO_DESCRIPTORS_H
+#define MIO_DESCRIPTORS_H
+
+#include "flex_descriptor.h"
+
+// CRC-32 of the descriptors below; part of the provisioning manifest hash,
+// so a changed attribute or announced list reprovisions the node
+#define MIO_DESCRIPTORS_HASH 0x99D70324u
+
+// mioOccupancySensor (mio:occSr)
+struct MioOccupancySensor {
+    static constexpr const char* TYPE = "mio:occSr";
+    static constexpr const char* CND = "org.fhtwmio.common.moduleclass.mioOccupancySensor";
+    enum Attribute : uint8_t { dgt, occ, ocs, ses, lgs, tlp, ivl, mxg, sen, udr, eng, smc, smn, smx, sav, ssd, siv, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "dgt", FlexType::Timestamp, FlexType::None, false },
+        { "occ", FlexType::Boolean, FlexType::None, true },
+        { "ocs", FlexType::NonNegInteger, FlexType::None, false },
+        { "ses", FlexType::NonNegInteger, FlexType::None, false },
+        { "lgs", FlexType::NonNegInteger, FlexType::None, false },
+        { "tlp", FlexType::NonNegInteger, FlexType::None, false },
+        { "ivl", FlexType::NonNegInteger, FlexType::None, false },
+        { "mxg", FlexType::NonNegInteger, FlexType::None, false },
+        { "sen", FlexType::List, FlexType::NonNegInteger, false },
+        { "udr", FlexType::NonNegInteger, FlexType::None, false },
+        { "eng", FlexType::Boolean, FlexType::None, false },
+        { "smc", FlexType::NonNegInteger, FlexType::None, false },
+        { "smn", FlexType::Float, FlexType::None, false },
+        { "smx", FlexType::Float, FlexType::None, false },
+        { "sav", FlexType::Float, FlexType::None, false },
+        { "ssd", FlexType::Float, FlexType::None, false },
+        { "siv", FlexType::NonNegInteger, FlexType::None, false },
+    };
+    static constexpr uint8_t ANNOUNCED[] = { dgt, occ, ocs, ses, lgs, tlp, ivl, smc, smn, smx, sav, ssd, siv };
+    static constexpr size_t ANNOUNCED_COUNT = 13;
+};
+
+// mioLuxSensor (mio:luxSr)
+struct MioLuxSensor {
+    static constexpr const char* TYPE = "mio:luxSr";
+    static constexpr const char* CND = "org.fhtwmio.common.moduleclass.mioLuxSensor";
+    enum Attribute : uint8_t { dgt, lux, smc, smn, smx, sav, ssd, siv, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "dgt", FlexType::Timestamp, FlexType::None, false },
+        { "lux", FlexType::Float, FlexType::None, true },
+        { "smc", FlexType::NonNegInteger, FlexType::None, false },
+        { "smn", FlexType::Float, FlexType::None, false },
+        { "smx", FlexType::Float, FlexType::None, false },
+        { "sav", FlexType::Float, FlexType::None, false },
+        { "ssd", FlexType::Float, FlexType::None, false },
+        { "siv", FlexType::NonNegInteger, FlexType::None, false },
+    };
+    static constexpr uint8_t ANNOUNCED[] = { dgt, lux, smc, smn, smx, sav, ssd, siv };
+    static constexpr size_t ANNOUNCED_COUNT = 8;
+};
+
+// mioAcousticSummary (mio:acoSm)
+struct MioAcousticSummary {
+    static constexpr const char* TYPE = "mio:acoSm";
+    static constexpr const char* CND = "org.fhtwmio.common.moduleclass.mioAcousticSummary";
+    enum Attribute : uint8_t { dgt, smc, smn, smx, sav, ssd, siv, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "dgt", FlexType::Timestamp, FlexType::None, false },
+        { "smc", FlexType::NonNegInteger, FlexType::None, false },
+        { "smn", FlexType::Float, FlexType::None, false },
+        { "smx", FlexType::Float, FlexType::None, false },
+        { "sav", FlexType::Float, FlexType::None, false },
+        { "ssd", FlexType::Float, FlexType::None, false },
+        { "siv", FlexType::NonNegInteger, FlexType::None, false },
+    };
+    static constexpr uint8_t ANNOUNCED[] = { dgt, smc, smn, smx, sav, ssd, siv };
+    static constexpr size_t ANNOUNCED_COUNT = 7;
+};
+
+// mioNodeMetrics (mio:nodMs)
+struct MioNodeMetrics {
+    static constexpr const char* TYPE = "mio:nodMs";
+    static constexpr const char* CND = "org.fhtwmio.common.moduleclass.mioNodeMetrics";
+    enum Attribute : uint8_t { dgt, upt, ivl, hpf, hpm, hlb, rqc, rqt, rq4, rq5, l50, l90, l99, lmx, lhs, pwm, rbd, lxr, adr, bks, bko, bkc, ffc, rtd, tlf, tlr, tle, th9, thx, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "dgt", FlexType::Timestamp, FlexType::None, false },
+        { "upt", FlexType::NonNegInteger, FlexType::None, false },
+        { "ivl", FlexType::NonNegInteger, FlexType::None, false },
+        { "hpf", FlexType::NonNegInteger, FlexType::None, false },
+        { "hpm", FlexType::NonNegInteger, FlexType::None, false },
+        { "hlb", FlexType::NonNegInteger, FlexType::None, false },
+        { "rqc", FlexType::NonNegInteger, FlexType::None, false },
+        { "rqt", FlexType::NonNegInteger, FlexType::None, false },
+        { "rq4", FlexType::NonNegInteger, FlexType::None, false },
+        { "rq5", FlexType::NonNegInteger, FlexType::None, false },
+        { "l50", FlexType::NonNegInteger, FlexType::None, false },
+        { "l90", FlexType::NonNegInteger, FlexType::None, false },
+        { "l99", FlexType::NonNegInteger, FlexType::None, false },
+        { "lmx", FlexType::NonNegInteger, FlexType::None, false },
+        { "lhs", FlexType::List, FlexType::NonNegInteger, false },
+        { "pwm", FlexType::NonNegInteger, FlexType::None, false },
+        { "rbd", FlexType::NonNegInteger, FlexType::None, false },
+        { "lxr", FlexType::NonNegInteger, FlexType::None, false },
+        { "adr", FlexType::NonNegInteger, FlexType::None, false },
+        { "bks", FlexType::NonNegInteger, FlexType::None, false },
+        { "bko", FlexType::NonNegInteger, FlexType::None, false },
+        { "bkc", FlexType::NonNegInteger, FlexType::None, false },
+        { "ffc", FlexType::NonNegInteger, FlexType::None, false },
+        { "rtd", FlexType::NonNegInteger, FlexType::None, false },
+        { "tlf", FlexType::NonNegInteger, FlexType::None, false },
+        { "tlr", FlexType::NonNegInteger, FlexType::None, false },
+        { "tle", FlexType::NonNegInteger, FlexType::None, false },
+        { "th9", FlexType::NonNegInteger, FlexType::None, false },
+        { "thx", FlexType::NonNegInteger, FlexType::None, false },
+    };
+    static constexpr uint8_t ANNOUNCED[] = { dgt, upt, hpm, hlb, rqc, rqt, rq5, l90, lmx, bks };
+    static constexpr size_t ANNOUNCED_COUNT = 10;
+};
+
+// acousticSensor (cod:acoSr)
+struct AcousticSensor {
+    static constexpr const char* TYPE = "cod:acoSr";
+    static constexpr const char* CND = "org.onem2m.common.moduleclass.acousticSensor";
+    enum Attribute : uint8_t { louds, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "louds", FlexType::Float, FlexType::None, true },
+    };
+    static constexpr uint8_t ANNOUNCED[] = { louds };
+    static constexpr size_t ANNOUNCED_COUNT = 1;
+};
+
+// binarySwitch (cod:binSh)
+struct BinarySwitch {
+    static constexpr const char* TYPE = "cod:binSh";
+    static constexpr const char* CND = "org.onem2m.common.moduleclass.binarySwitch";
+    enum Attribute : uint8_t { state, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "state", FlexType::Boolean, FlexType::None, true },
+    };
+};
+
+// colour (cod:color)
+struct Colour {
+    static constexpr const char* TYPE = "cod:color";
+    static constexpr const char* CND = "org.onem2m.common.moduleclass.colour";
+    enum Attribute : uint8_t { red, green, blue, ATTRIBUTE_COUNT };
+    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {
+        { "red", FlexType::NonNegInteger, FlexType::None, true },
+        { "green", FlexType::NonNegInteger, FlexType::None, true },
+        { "blue", FlexType::NonNegInteger, FlexType::None, true },
+    };
+};
+
+// deviceLight (cod:devLt)
+struct DeviceLight {
+    static constexpr const char* TYPE = "cod:devLt";
+    static constexpr const char* CND = "org.onem2m.common.device.deviceLight";
+    enum Attribute : uint8_t { ATTRIBUTE_COUNT };
+};
+
+#endif // MIO_DESCRIPTORS_H
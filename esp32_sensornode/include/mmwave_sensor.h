@@ -28,4 +28,158 @@
 // Communication: UART (115200 baud) + GPIO OUT
 // Protocol: Hexadecimal, little-endian format
 
+// ==================== COMMAND PROTOCOL ====================
+// Frame: FD FC FB FA | length (2) | command (2) | value (length - 2) | 04 03 02 01
+// ACK:   same framing, command | 0x0100, followed by a 2-byte status (0 = OK)
+
+#define MMWAVE_GATE_COUNT        16
+#define MMWAVE_ACK_TIMEOUT_MS    200
+#define MMWAVE_ENABLE_ATTEMPTS   2      // The first command after power-on may go unanswered
+#define MMWAVE_MAX_THRESHOLD     100    // Per-gate trigger threshold range 0..100
+
+enum RadarCommand : uint16_t {
+    RADAR_CMD_WRITE_PARAMS   = 0x0007,
+    RADAR_CMD_WRITE_SYSTEM   = 0x0012,
+    RADAR_CMD_DISABLE_CONFIG = 0x00FE,
+    RADAR_CMD_ENABLE_CONFIG  = 0x00FF,
+};
+
+enum RadarParamId : uint16_t {
+    RADAR_PARAM_MIN_GATE          = 0x0000,
+    RADAR_PARAM_MAX_GATE          = 0x0001,
+    RADAR_PARAM_UNMANNED_DURATION = 0x0004,  // Seconds until "no presence"
+    RADAR_PARAM_TRIGGER_THRESHOLD = 0x0010,  // + gate index
+    RADAR_PARAM_HOLD_THRESHOLD    = 0x0020,  // + gate index
+};
+
+#define RADAR_SYSTEM_MODE        0x0000
+#define RADAR_MODE_ENGINEERING   0x00000000  // Per-gate energy frames
+#define RADAR_MODE_REPORT        0x00000004
+#define RADAR_MODE_NORMAL        0x00000064  // ON/OFF presence output
+
+struct RadarParam {
+    uint16_t id;
+    uint32_t value;
+};
+
+template <size_t N>
+struct RadarFrame {
+    uint8_t bytes[N];
+    uint16_t command;
+
+    static constexpr size_t size() { return N; }
+};
+
+constexpr size_t radarFrameSize(size_t valueBytes) {
+    return 4 + 2 + 2 + valueBytes + 4;
+}
+
+namespace radar_detail {
+
+template <size_t N>
+constexpr void putHeader(RadarFrame<N>& frame, uint16_t command) {
+    frame.command = command;
+    frame.bytes[0] = 0xFD; frame.bytes[1] = 0xFC; frame.bytes[2] = 0xFB; frame.bytes[3] = 0xFA;
+    frame.bytes[4] = (N - 12 + 2) & 0xFF;
+    frame.bytes[5] = ((N - 12 + 2) >> 8) & 0xFF;
+    frame.bytes[6] = command & 0xFF;
+    frame.bytes[7] = (command >> 8) & 0xFF;
+    frame.bytes[N - 4] = 0x04; frame.bytes[N - 3] = 0x03; frame.bytes[N - 2] = 0x02; frame.bytes[N - 1] = 0x01;
+}
+
+template <size_t N>
+constexpr void putParam(RadarFrame<N>& frame, size_t offset, const RadarParam& param) {
+    frame.bytes[offset + 0] = param.id & 0xFF;
+    frame.bytes[offset + 1] = (param.id >> 8) & 0xFF;
+    frame.bytes[offset + 2] = param.value & 0xFF;
+    frame.bytes[offset + 3] = (param.value >> 8) & 0xFF;
+    frame.bytes[offset + 4] = (param.value >> 16) & 0xFF;
+    frame.bytes[offset + 5] = (param.value >> 24) & 0xFF;
+}
+
+}  // namespace radar_detail
+
+/**
+ * Build a frame writing one or more (id, value) parameters
+ * Usable in constant expressions for fixed configurations
+ */
+template <size_t P>
+constexpr RadarFrame<radarFrameSize(6 * P)> radarParamFrame(uint16_t command, const RadarParam (&params)[P]) {
+    RadarFrame<radarFrameSize(6 * P)> frame{};
+    radar_detail::putHeader(frame, command);
+    for (size_t i = 0; i < P; i++) {
+        radar_detail::putParam(frame, 8 + 6 * i, params[i]);
+    }
+    return frame;
+}
+
+constexpr RadarFrame<radarFrameSize(6)> radarParamFrame(uint16_t command, uint16_t id, uint32_t value) {
+    RadarFrame<radarFrameSize(6)> frame{};
+    radar_detail::putHeader(frame, command);
+    radar_detail::putParam(frame, 8, RadarParam{id, value});
+    return frame;
+}
+
+constexpr RadarFrame<radarFrameSize(2)> radarEnableConfigFrame() {
+    RadarFrame<radarFrameSize(2)> frame{};
+    radar_detail::putHeader(frame, RADAR_CMD_ENABLE_CONFIG);
+    frame.bytes[8] = 0x01;
+    frame.bytes[9] = 0x00;
+    return frame;
+}
+
+constexpr RadarFrame<radarFrameSize(0)> radarDisableConfigFrame() {
+    RadarFrame<radarFrameSize(0)> frame{};
+    radar_detail::putHeader(frame, RADAR_CMD_DISABLE_CONFIG);
+    return frame;
+}
+
+constexpr RadarFrame<radarFrameSize(6)> radarSystemModeFrame(uint32_t mode) {
+    return radarParamFrame(RADAR_CMD_WRITE_SYSTEM, RADAR_SYSTEM_MODE, mode);
+}
+
+// ==================== ACK PARSING ====================
+
+enum class RadarAckResult {
+    Pending,
+    Ok,
+    Rejected,
+    Timeout
+};
+
+/**
+ * Incremental ACK frame parser; skips any bytes preceding a frame header
+ * (e.g. ON/OFF text the sensor emits in normal mode)
+ */
+class RadarAckParser {
+public:
+    explicit RadarAckParser(uint16_t command) : expected(command | 0x0100) {}
+
+    RadarAckResult feed(uint8_t byte);
+
+private:
+    uint16_t expected;
+    uint8_t buffer[64];
+    size_t received = 0;
+    size_t frameLength = 0;
+};
+
+/**
+ * Send a command frame and wait for its ACK
+ * @param serial UART connected to the sensor
+ * @param bytes Encoded frame
+ * @param length Frame length
+ * @param command Command word contained in the frame
+ * @param timeoutMs Maximum time to wait for the ACK
+ * @return Ok, Rejected (non-zero status) or Timeout
+ */
+RadarAckResult radarTransact(HardwareSerial& serial, const uint8_t* bytes, size_t length,
+                             uint16_t command, uint32_t timeoutMs = MMWAVE_ACK_TIMEOUT_MS);
+
+template <size_t N>
+RadarAckResult radarTransact(HardwareSerial& serial, const RadarFrame<N>& frame,
+                             uint32_t timeoutMs = MMWAVE_ACK_TIMEOUT_MS) {
+    return radarTransact(serial, frame.bytes, N, frame.command, timeoutMs);
+}
+
 #endif // MMWAVE_SENSOR_H
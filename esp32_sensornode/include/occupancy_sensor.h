@@ -4,6 +4,9 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <ArduinoJson.h>
+#include "mmwave_sensor.h"
+#include "report_policy.h"
 
 // ==================== PIN DEFINITIONS ====================
 // mmWave sensor pins for ESP32-S3
@@ -11,9 +14,65 @@
 #define RADAR_RX_PIN        18   // ESP32 RX <- Sensor TX
 #define RADAR_TX_PIN        17   // ESP32 TX -> Sensor RX
 
+// ==================== RADAR CONFIGURATION ====================
+// Mirrored by the mxg/sen/udr/eng attributes of the occupancy FlexContainer
+struct RadarConfig {
+    uint8_t maxDistanceGate;                      // 0..MMWAVE_GATE_COUNT-1
+    uint16_t unmannedDurationSeconds;
+    bool engineeringMode;
+    bool hasMaxDistanceGate;                      // Keep the radar's stored values until set
+    bool hasUnmannedDuration;
+    bool hasGateSensitivity;
+    uint16_t gateSensitivity[MMWAVE_GATE_COUNT];  // Trigger threshold 0..MMWAVE_MAX_THRESHOLD, lower = more sensitive
+};
+
+// Writable FlexContainer attributes the node subscribes to
+#define RADAR_CONFIG_ATTRIBUTE_COUNT 4
+extern const char* const RADAR_CONFIG_ATTRIBUTES[RADAR_CONFIG_ATTRIBUTE_COUNT];
+
 // ==================== FUNCTIONS ====================
+
+/**
+ * Initialize the radar UART and OT2 input. Safe to call again; the radar
+ * configuration is attempted once per power-on, acknowledged or not
+ * (remembered in RTC memory across deep sleep)
+ * @return true if the sensor is usable
+ */
 bool initOccupancySensor();
-bool startOccupancySensorTask();
+void occupancySensorJob();
+bool scheduleOccupancySensorJob();
 bool getOccupancyDetected();
 
+/**
+ * Write a configuration to the S3KM1110 and wait for every ACK. Only the
+ * parameters whose has* flag is set are written; the system mode is
+ * always sent, even after a failed parameter write
+ * @param config Configuration to apply
+ * @return true if all commands were acknowledged
+ */
+bool applyRadarConfig(const RadarConfig& config);
+
+/**
+ * Get the configuration last applied to the sensor
+ */
+RadarConfig getRadarConfig();
+
+/**
+ * Queue radar attributes from a mio:occSr notification representation.
+ * The UART exchange takes too long for the notification handler, so the
+ * occupancy job applies the queued configuration on its next run
+ * @param occSensor Representation containing any of mxg, sen, udr, eng
+ * @return true if queued, false if a value is missing its type or out of
+ *         range (nothing is queued)
+ */
+bool queueRadarConfigFromJson(JsonObject occSensor);
+
+/**
+ * Apply the configuration queued by queueRadarConfigFromJson(), if any;
+ * called by the occupancy job
+ * @return true if nothing was queued or the sensor accepted the
+ *         (possibly unchanged) configuration
+ */
+bool applyQueuedRadarConfig();
+
 #endif // OCCUPANCY_SENSOR_H
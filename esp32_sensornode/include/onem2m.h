@@ -10,13 +10,55 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <atomic>
+#include "circuit_breaker.h"
+#include "mio_descriptors.h"
+#include "request_arena.h"
+#include "tls_client.h"
+
+struct OccupancyStats;
+struct WindowSummary;
 
 // ==================== ONEM2M RESOURCE TYPES ====================
 
 #define ONEM2M_RT_CONTAINER 3
+#define ONEM2M_RT_CONTENT_INSTANCE 4
 #define ONEM2M_RT_FLEXCONTAINER 28
 #define ONEM2M_RT_SUBSCRIPTION 23
 
+// Persistent keep-alive connections shared by all tasks
+#define ONEM2M_POOL_SIZE 3
+
+// Per-connection request arena: URL plus the largest body (provisioning
+// creates, diagnostics records); larger requests fall back to the heap
+#define ONEM2M_ARENA_SIZE 1536
+
+// Reply header and body read timeout
+#define ONEM2M_TIMEOUT_MS 5000
+
+// Requests written ahead of their replies on one connection. Replies of
+// that many requests must fit the S3's TCP receive window (5744 bytes)
+#define ONEM2M_PIPELINE_DEPTH 4
+#define ONEM2M_PIPELINE_MAX_DEPTH 8
+
+// Batch entry status when the entry it depends on failed
+#define ONEM2M_STATUS_SKIPPED (-100)
+
+// Circuit breaker: open after this many transport errors or 5xx in a row,
+// for a jittered time doubling from BASE to MAX while probes fail
+#define ONEM2M_BREAKER_THRESHOLD 3
+#define ONEM2M_BREAKER_BASE_MS 2000
+#define ONEM2M_BREAKER_MAX_MS 120000
+
+// Status of a request refused while the breaker is open
+#define ONEM2M_STATUS_BREAKER_OPEN (-101)
+
+// Retries allowed per window, shared by every caller of the client
+#define ONEM2M_RETRY_BUDGET 10
+#define ONEM2M_RETRY_WINDOW_MS 60000
+
 // ==================== ONEM2M PATHS ====================
 
 class OneM2MPaths {
@@ -29,53 +71,244 @@ public:
     String DEVICE_PATH;
 
     void initialize(const char* host, int port, const char* cseName,
-                   const char* aeName, const char* roomName, const char* deskName, const char* deviceName);
+                   const char* aeName, const char* roomName, const char* deskName, const char* deviceName,
+                   bool tls = false);
 };
 
 // Global instance
 extern OneM2MPaths onem2mPaths;
 
+// ==================== RESPONSE SINKS ====================
+
+/**
+ * Receives a reply body while it is read from the connection, so only
+ * what the caller keeps takes RAM. Passing no sink discards the body.
+ */
+class ResponseSink {
+public:
+    virtual ~ResponseSink() {}
+
+    /**
+     * Read as much of the body as needed; the client drains the rest
+     * @param body The body alone: framing removed, ends with the reply
+     * @return false if the body is not usable
+     */
+    virtual bool consume(Stream& body) = 0;
+};
+
+/**
+ * Keeps the first capacity - 1 bytes of the body, NUL-terminated
+ */
+class BufferSink : public ResponseSink {
+public:
+    BufferSink(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {}
+
+    bool consume(Stream& body) override;
+
+    size_t length() const { return used; }
+    bool truncated() const { return overflow; }
+
+private:
+    char* buffer;
+    size_t capacity;
+    size_t used = 0;
+    bool overflow = false;
+};
+
+/**
+ * Parses the body as it arrives and keeps only the fields the filter
+ * marks true, e.g. {"m2m:cin": {"ri": true, "ct": true}}
+ */
+class JsonFilterSink : public ResponseSink {
+public:
+    JsonFilterSink(JsonDocument& doc, const JsonDocument& filter) : doc(doc), filter(filter) {}
+
+    bool consume(Stream& body) override;
+
+    DeserializationError error() const { return result; }
+
+private:
+    JsonDocument& doc;
+    const JsonDocument& filter;
+    DeserializationError result;
+};
+
+// ==================== ONEM2M CLIENT ====================
+
+/**
+ * One request of a pipelined batch
+ */
+struct OneM2MBatchEntry {
+    const char* method;
+    const String* path;
+    const JsonDocument* body;    // nullptr for none
+    int resourceType;
+    ResponseSink* response;      // nullptr discards the reply
+    int dependsOn;               // Earlier entry that must succeed first (2xx or 409), -1 for none
+    int statusCode;              // Out: HTTP status, -1 transport error, ONEM2M_STATUS_SKIPPED
+};
+
+struct PooledConnection;
+
+/**
+ * Pool of keep-alive connections to one CSE. Requests borrow a free
+ * connection, so up to `size` run in parallel. The node uses a single
+ * client; the fleet simulator creates one per virtual node.
+ */
+class OneM2MClient {
+public:
+    explicit OneM2MClient(uint8_t size = ONEM2M_POOL_SIZE) : poolSize(size) {}
+
+    /**
+     * Create the connections; safe to call again
+     * @param tls Credentials to speak HTTPS to the CSE (BASE_URL https://),
+     *            nullptr for plain HTTP
+     * @return true if the pool is ready
+     */
+    bool begin(const TlsCredentials* tls = nullptr);
+
+    /**
+     * Send one request on a free connection, waiting for one if needed.
+     * The URL and the serialized body live in the connection's arena.
+     * While the circuit breaker is open it returns at once with
+     * ONEM2M_STATUS_BREAKER_OPEN.
+     * @param baseUrl Scheme, host and port (OneM2MPaths::BASE_URL)
+     * @param path Resource path
+     * @param body Request body, nullptr for none
+     * @param response Receives the reply body; nullptr reads and drops it
+     * @return true if an HTTP response was received and the sink accepted it
+     */
+    bool request(const char* method, const String& baseUrl, const String& path, const JsonDocument* body,
+                 int resourceType, ResponseSink* response, int& statusCode);
+
+    /**
+     * Send a batch on one connection, writing up to the pipeline depth of
+     * requests ahead of their replies. Entries go out in batch order; one
+     * with dependsOn is held back until that entry's reply is in (and
+     * skipped if it failed), and later independent entries may pass it.
+     * If the connection breaks, the entries still unanswered are sent in
+     * lockstep with request(); a CSE that closes the connection or stops
+     * answering mid-pipeline gets lockstep from then on.
+     * @return true if every entry received a reply
+     */
+    bool pipeline(const String& baseUrl, OneM2MBatchEntry* entries, size_t count);
+
+    /**
+     * Requests in flight per connection, 1 for lockstep
+     */
+    void setPipelineDepth(uint8_t depth);
+
+    /**
+     * @return false once the CSE has refused pipelined requests
+     */
+    bool pipeliningEnabled() const { return pipelining; }
+
+    /**
+     * Take a retry from the shared retry budget; call before resending
+     * @return false if retries are used up for this window
+     */
+    bool retryAllowed() { return retries.tryAcquire(); }
+
+    const CircuitBreaker& circuitBreaker() const { return breaker; }
+
+    /**
+     * @return Most arena bytes any request has used
+     */
+    size_t arenaHighWater() const;
+
+    /**
+     * @return Requests whose URL or body did not fit the arena
+     */
+    uint32_t arenaOverflows() const;
+
+private:
+    uint8_t poolSize;
+    uint8_t pipelineDepth = ONEM2M_PIPELINE_DEPTH;
+    std::atomic<bool> pipelining{true};
+    CircuitBreaker breaker{ONEM2M_BREAKER_THRESHOLD, ONEM2M_BREAKER_BASE_MS, ONEM2M_BREAKER_MAX_MS};
+    RetryBudget retries{ONEM2M_RETRY_BUDGET, ONEM2M_RETRY_WINDOW_MS};
+    PooledConnection* connections = nullptr;
+    QueueHandle_t freeConnections = NULL;
+    TlsContext* tlsContext = nullptr;  // Shared by the connections: one session cache per CSE
+};
+
 // ==================== ONEM2M HTTP FUNCTIONS ====================
 
 /**
- * Generate unique request ID for OneM2M requests
+ * Create the connection pool; call once before the first request
+ * @return true if the pool is ready
+ */
+bool initOneM2MClient();
+
+/**
+ * Whether a reply carries a body (RFC 9112 section 6.3). Replies to HEAD
+ * and 1xx, 204 and 304 replies end with their header whatever
+ * Content-Length says; any other reply without Content-Length or chunked
+ * framing runs to connection close.
  */
-String generateRequestId();
+bool replyHasBody(const char* method, int statusCode);
 
 /**
  * Perform a generic OneM2M HTTP request
  * @param method HTTP method (GET, POST, DELETE, PUT)
  * @param path Resource path (relative to BASE_URL)
- * @param payload JSON payload (for POST/PUT)
+ * @param body JSON body (for POST/PUT), nullptr for none
  * @param resourceType OneM2M resource type (ty parameter)
- * @param response Output parameter for response body
+ * @param response Sink for the response body; nullptr discards it
  * @param statusCode Output parameter for HTTP status code
- * @return true if request succeeded (HTTP response received)
+ * @return true if request succeeded (HTTP response received, sink accepted it)
+ */
+bool oneM2MRequest(const char* method, const String& path, const JsonDocument* body,
+                   int resourceType, ResponseSink* response, int& statusCode);
+
+/**
+ * Send a batch pipelined on one pooled connection
+ * (OneM2MClient::pipeline())
+ * @return true if every entry received a reply
+ */
+bool oneM2MPipeline(OneM2MBatchEntry* entries, size_t count);
+
+/**
+ * @return false once the CSE has refused pipelined requests
+ */
+bool oneM2MPipeliningEnabled();
+
+/**
+ * @return State of the node client's circuit breaker
+ */
+BreakerState oneM2MBreakerState();
+
+/**
+ * @return ms until the breaker lets a probe request through, 0 if closed
+ */
+uint32_t oneM2MProbeDelayMs();
+
+/**
+ * Take a retry from the node client's retry budget
+ * @return false if retries are used up for this window
  */
-bool oneM2MRequest(const char* method, const String& path, const String& payload,
-                   int resourceType, String& response, int& statusCode);
+bool oneM2MRetryAllowed();
 
 /**
- * Perform OneM2M GET request
+ * Perform OneM2M GET request, streaming the reply into response
  */
-bool oneM2MGet(const String& path, String& response, int& statusCode);
+bool oneM2MGet(const String& path, ResponseSink& response, int& statusCode);
 
 /**
- * Perform OneM2M POST request
+ * Perform OneM2M POST request; the reply body is discarded
  */
-bool oneM2MPost(const String& path, const String& payload, int resourceType,
-                String& response, int& statusCode);
+bool oneM2MPost(const String& path, const JsonDocument& body, int resourceType, int& statusCode);
 
 /**
- * Perform OneM2M DELETE request
+ * Perform OneM2M DELETE request; the reply body is discarded
  */
-bool oneM2MDelete(const String& path, String& response, int& statusCode);
+bool oneM2MDelete(const String& path, int& statusCode);
 
 /**
- * Perform OneM2M PUT request (for updating existing resources)
+ * Perform OneM2M PUT request (for updating existing resources); the reply
+ * body is discarded
  */
-bool oneM2MPut(const String& path, const String& payload,
-               String& response, int& statusCode);
+bool oneM2MPut(const String& path, const JsonDocument& body, int& statusCode);
 
 // ==================== CSE INITIALIZATION ====================
 
@@ -86,31 +319,47 @@ bool oneM2MPut(const String& path, const String& payload,
  */
 bool waitForCSE(int maxAttempts = 30);
 
+// ==================== RESOURCE UPDATES ====================
+// Resource creation lives in provisioning.cpp
+
 /**
- * Create a container (Room or Desk)
- * @param containerName Name of the container to create
- * @return true if created successfully or already exists
+ * PUT a serialized FlexContainer update
+ * @param path Resource path
+ * @param doc Document holding one FlexContainer object
+ * @return true if update succeeded
  */
-bool createContainer(const char* containerName);
+bool putFlex(const String& path, const JsonDocument& doc);
 
 /**
- * Create the mioDeviceLux FlexContainer
- * @return true if created successfully or already exists
+ * Write an update of FlexContainer attributes described by module class D
+ * @param doc Receives the request body
+ * @param fields flexField<D::attr>(value) for each attribute
  */
-bool createLuxDevice();
+template <typename D, typename... Fields>
+void writeFlexUpdate(JsonDocument& doc, const Fields&... fields) {
+    writeFlex<D>(doc.createNestedObject(D::TYPE), fields...);
+}
 
 /**
- * Update lux value in the FlexContainer
- * @param luxValue Current lux reading
+ * Update FlexContainer attributes described by module class D
+ * @param path Resource path
+ * @param fields flexField<D::attr>(value) for each attribute
  * @return true if update succeeded
  */
-bool updateLuxValue(float luxValue);
+template <typename D, typename... Fields>
+bool updateFlex(const String& path, const Fields&... fields) {
+    StaticJsonDocument<256> doc;
+    writeFlexUpdate<D>(doc, fields...);
+    return putFlex(path, doc);
+}
 
 /**
- * Create the acousticSensor FlexContainer (OneM2M standard moduleclass)
- * @return true if created successfully or already exists
+ * Update lux value in the FlexContainer
+ * @param luxValue Current lux reading
+ * @param generatedAt Sample time (dgt) for replayed readings, NULL for now
+ * @return true if update succeeded
  */
-bool createAudioDevice();
+bool updateLuxValue(float luxValue, const char* generatedAt = nullptr);
 
 /**
  * Update audio loudness value in the FlexContainer
@@ -120,17 +369,29 @@ bool createAudioDevice();
 bool updateAudioValue(float loudness);
 
 /**
- * Create the occupancySensor FlexContainer (custom mio moduleclass)
- * @return true if created successfully or already exists
+ * Update occupancy value in the FlexContainer
+ * @param occupied Current occupancy state
+ * @param generatedAt Sample time (dgt) for replayed readings, NULL for now
+ * @return true if update succeeded
  */
-bool createOccupancyDevice();
+bool updateOccupancyValue(bool occupied, const char* generatedAt = nullptr);
 
 /**
- * Update occupancy value in the FlexContainer
- * @param occupied Current occupancy state
+ * Update presence statistics in the occupancy FlexContainer
+ * @param stats Aggregated dwell-time statistics for the last window
  * @return true if update succeeded
  */
-bool updateOccupancyValue(bool occupied);
+bool updateOccupancyStats(const OccupancyStats& stats);
+
+/**
+ * Publish a SENSOR_SUMMARY_INTERVAL window summary (smc..siv) to the
+ * sensor's FlexContainer; loudness goes to the acousticSummary container
+ * since cod:acoSr has no summary attributes
+ * @return true if update succeeded
+ */
+bool updateLuxSummary(const WindowSummary& summary);
+bool updateAudioSummary(const WindowSummary& summary);
+bool updateOccupancySummary(const WindowSummary& summary);
 
 /**
  * Update lamp binary switch state
@@ -139,4 +400,18 @@ bool updateOccupancyValue(bool occupied);
  */
 bool updateLampSwitch(bool on);
 
+// ==================== UPDATE PAYLOADS ====================
+// Request bodies of the update functions above, without the request.
+// StaticJsonDocument<256> holds any of them. Lux and loudness are rounded
+// to LUX_QUANTUM and AUDIO_QUANTUM.
+
+void buildLuxPayload(JsonDocument& doc, float luxValue, const char* generatedAt = nullptr);
+void buildAudioPayload(JsonDocument& doc, float loudness);
+void buildOccupancyPayload(JsonDocument& doc, bool occupied, const char* generatedAt = nullptr);
+void buildOccupancyStatsPayload(JsonDocument& doc, const OccupancyStats& stats);
+void buildLuxSummaryPayload(JsonDocument& doc, const WindowSummary& summary);
+void buildAudioSummaryPayload(JsonDocument& doc, const WindowSummary& summary);
+void buildOccupancySummaryPayload(JsonDocument& doc, const WindowSummary& summary);
+void buildLampSwitchPayload(JsonDocument& doc, bool on);
+
 #endif // ONEM2M_H
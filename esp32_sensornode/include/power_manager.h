@@ -0,0 +1,57 @@
+/**
+ * power_manager.h
+ *
+ * Opt-in low-power profile (LOW_POWER_PROFILE): dynamic frequency scaling,
+ * automatic light sleep where the build supports it, WiFi modem sleep on a
+ * DTIM-aligned listen interval, and residency counters for duty cycle.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+struct PowerResidency {
+    uint64_t windowUs;
+    uint64_t activeUs;    // Sensor jobs running with the CPU held at max clock
+    uint64_t idleUs;      // Idle tasks on both cores (WAITI or light sleep); needs run time stats
+    uint32_t activeRuns;
+    bool dfsEnabled;
+    bool lightSleepEnabled;
+    bool modemSleepEnabled;
+};
+
+/**
+ * Configure DFS and light sleep; no-op unless LOW_POWER_PROFILE
+ * @return true if the requested profile is active
+ */
+bool initPowerManagement();
+
+/**
+ * Apply modem sleep and listen interval; call after WiFi.begin(..., false)
+ * and before esp_wifi_connect()
+ */
+void applyWiFiPowerSave();
+
+/**
+ * Hold the CPU at max clock for a burst of work and count it as active
+ */
+void beginActiveWork();
+
+/**
+ * Release the clock lock taken by beginActiveWork()
+ */
+void endActiveWork();
+
+/**
+ * Read and reset the residency window
+ * @return Time spent per power state since the previous call
+ */
+PowerResidency takePowerResidency();
+
+/**
+ * Publish the residency counters as a diag:power record
+ */
+void publishPowerResidency();
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,50 @@
+/**
+ * provisioning.h
+ *
+ * oneM2M resource tree provisioning with an NVS cache. A hash of the
+ * provisioning manifest and the resource IDs returned by the CSE are
+ * stored after a successful cold provisioning; on warm boot one discovery
+ * request confirms the tree still exists and creation is skipped.
+ */
+
+#ifndef PROVISIONING_H
+#define PROVISIONING_H
+
+#include <Arduino.h>
+
+#define PROVISIONING_NVS_NAMESPACE "prov"
+#define PROVISIONING_VERSION 2  // Bump when payloads change; .fcp changes are hashed in
+                                // through MIO_DESCRIPTORS_HASH
+
+/**
+ * Check the NVS cache against the current manifest and the CSE
+ * @return true if the cached resource tree is still present on the CSE
+ */
+bool verifyProvisioningCache();
+
+/**
+ * Create containers and FlexContainers (sensors not required).
+ * Independent branches of the tree are created concurrently, one worker
+ * per pooled connection; a failed parent skips its children.
+ * @return true if every resource was created or already existed
+ */
+bool provisionResources();
+
+/**
+ * Create subscriptions; requires the notification server to be running
+ * @return true if every subscription was created or already existed
+ */
+bool provisionSubscriptions();
+
+/**
+ * Store the manifest hash and the CSE's resource IDs in NVS
+ * @return true if the cache was written
+ */
+bool saveProvisioningCache();
+
+/**
+ * Forget the cached tree so the next boot provisions from scratch
+ */
+void clearProvisioningCache();
+
+#endif // PROVISIONING_H
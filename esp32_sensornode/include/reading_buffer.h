@@ -0,0 +1,128 @@
+/**
+ * reading_buffer.h
+ *
+ * Hands sensor readings and window summaries from the sensor jobs to the
+ * connectivity task, which does all of their network I/O. Readings wait
+ * in a ring buffer until the node is online; readings the CSE could not
+ * take (transport errors, 5xx, breaker open) go back into it and are
+ * replayed once the CSE answers again. A job never waits for the CSE.
+ */
+
+#ifndef READING_BUFFER_H
+#define READING_BUFFER_H
+
+#include <Arduino.h>
+#include "report_policy.h"
+
+enum ReadingKind : uint8_t {
+    READING_LUX,
+    READING_AUDIO,
+    READING_OCCUPANCY
+};
+
+enum ReadingResult : uint8_t {
+    READING_PUBLISHED,
+    READING_RETRY,     // CSE unreachable or failing: worth sending again
+    READING_REJECTED   // 4xx: sending it again would not help
+};
+
+struct ReadingUpdate {
+    ReadingKind kind;
+    float value;
+    const char* generatedAt;  // dgt, or nullptr for the time of arrival
+};
+
+enum SummaryKind : uint8_t {
+    SUMMARY_LUX,
+    SUMMARY_AUDIO,
+    SUMMARY_OCCUPANCY,
+    SUMMARY_OCCUPANCY_STATS,
+    SUMMARY_KIND_COUNT
+};
+
+enum SummaryOutcome : uint8_t {
+    SUMMARY_IDLE,     // Nothing posted, or the outcome was collected
+    SUMMARY_PENDING,  // Waiting for or in the hands of the connectivity task
+    SUMMARY_SENT,
+    SUMMARY_FAILED    // The CSE did not take it: fold the window back in
+};
+
+/**
+ * Queue a reading for the connectivity task; never blocks on the network
+ * @param kind Sensor the value belongs to
+ * @param value Reading (occupancy: 0 or 1)
+ * @return true if the reading was queued; false for loudness while the
+ *         node is offline or the CSE fails, since cod:acoSr has no dgt
+ */
+bool reportReading(ReadingKind kind, float value);
+
+/**
+ * Queue a closed window's summary or dwell-time statistics for the
+ * connectivity task. One per kind is in flight at a time.
+ * @return false while the previous one has no outcome yet
+ */
+bool postSummary(SummaryKind kind, const WindowSummary& summary);
+bool postOccupancyStats(const OccupancyStats& stats);
+
+/**
+ * Outcome of the last post for a kind; SENT and FAILED are reported once
+ * and the slot is free again afterwards
+ */
+SummaryOutcome collectSummaryOutcome(SummaryKind kind);
+
+/**
+ * Close a job's summary window for the connectivity task once it is due.
+ * The closed window is kept in posted; if the CSE does not take its
+ * summary it is folded back in front of the open one, so the next
+ * summary covers both and no sample is lost. Call once the node is
+ * online (isCloudReady()); until then the window keeps growing.
+ * @param kind Summary slot of the job
+ * @param window Open window, fed by the job
+ * @param posted Last closed window, owned by the job
+ * @param now millis() of the job run
+ * @return true if a window was closed on this run
+ */
+template <typename T>
+bool closeSummaryWindow(SummaryKind kind, WindowAggregator<T>& window, WindowAggregator<T>& posted,
+                        unsigned long now) {
+    SummaryOutcome outcome = collectSummaryOutcome(kind);
+    if (outcome == SUMMARY_FAILED) {
+        posted.append(window);
+        window = posted;
+    }
+    if (outcome == SUMMARY_PENDING || !window.windowDue(now)) return false;
+    if (!postSummary(kind, window.peek(now))) return false;
+    posted = window;
+    window.restart(now);
+    return true;
+}
+
+/**
+ * Publish queued readings oldest first, then queued summaries; called by
+ * the connectivity task. Stops at the first window the CSE could not take
+ * and keeps the rest.
+ * @return Number of readings published
+ */
+size_t flushReadingBuffer();
+
+/**
+ * @return true until the buffer has been replayed, and again while
+ *         readings the CSE could not take wait for the next replay
+ */
+bool readingsPending();
+
+/**
+ * Publish several readings, ONEM2M_PIPELINE_DEPTH of them pipelined at a time
+ * @param updates Readings, oldest first
+ * @param count Number of readings
+ * @param results Set per reading to what the CSE made of it
+ * @return Number of readings published
+ */
+size_t publishReadings(const ReadingUpdate* updates, size_t count, ReadingResult* results);
+
+/**
+ * @return Readings overwritten because the buffer was full
+ */
+uint32_t getDroppedReadingCount();
+
+#endif // READING_BUFFER_H
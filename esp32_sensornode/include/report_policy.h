@@ -0,0 +1,192 @@
+/**
+ * report_policy.h
+ *
+ * When a sensor reading is worth sending to the CSE. The sensor jobs own
+ * one instance of each; the fleet simulator (sim/fleet) runs hundreds.
+ */
+
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include "config.h"
+
+// ==================== CHANGE THRESHOLD ====================
+
+/**
+ * @param current New reading
+ * @param lastReported Last reading the CSE accepted, negative if none yet
+ * @param threshold Smallest change worth a report (LUX_THRESHOLD, AUDIO_THRESHOLD)
+ * @return true if the reading should be reported
+ */
+inline bool changeReportable(double current, double lastReported, double threshold) {
+    return (lastReported < 0) || (fabs(current - lastReported) >= threshold);
+}
+
+// ==================== PRESENCE STATISTICS ====================
+// Aggregated per OCCUPANCY_STATS_INTERVAL at the sampling resolution of
+// OCCUPANCY_UPDATE_INTERVAL
+struct OccupancyStats {
+    uint32_t intervalSeconds;           // Length of the aggregation window
+    uint32_t occupiedSeconds;           // Occupied time within the window
+    uint16_t sessions;                  // Sessions active within the window
+    uint32_t longestSessionSeconds;     // Longest session overlapping the window
+    uint32_t secondsSinceLastPresence;  // 0 while occupied or before the first presence
+    bool presenceSeen;                  // false until the first presence since boot: no tlp
+};
+
+/**
+ * Dwell-time accumulator fed with every occupancy sample
+ */
+class OccupancyTracker {
+public:
+    /**
+     * Start the first window; call before the first sample
+     */
+    void begin(unsigned long now);
+
+    /**
+     * Account the time since the previous sample to that sample's state
+     */
+    void sample(bool occupied, unsigned long now);
+
+    /**
+     * @return true once the window has reached OCCUPANCY_STATS_INTERVAL
+     */
+    bool windowDue(unsigned long now) const;
+
+    /**
+     * Statistics of the window so far; the window stays open, so stats
+     * the CSE did not take are sent again, grown, on the next try
+     */
+    OccupancyStats peek(unsigned long now) const;
+
+    /**
+     * Close the window once its stats are published and start the next;
+     * an ongoing session carries over
+     */
+    void restart(unsigned long now);
+
+    /**
+     * Fold a later window back in behind this one, e.g. when the CSE did
+     * not take this window's stats
+     * @param later Copy of this tracker restart()ed at the end of this window
+     */
+    void append(const OccupancyTracker& later);
+
+private:
+    unsigned long windowStart = 0;
+    unsigned long lastSampleTime = 0;
+    unsigned long sessionStart = 0;
+    unsigned long lastPresenceTime = 0;
+    bool sessionActive = false;
+    bool presenceSeen = false;
+    uint32_t occupiedMs = 0;
+    uint16_t sessionCount = 0;
+    uint32_t longestSessionMs = 0;
+};
+
+// ==================== WINDOW SUMMARIES ====================
+// Distribution of a reading over SENSOR_SUMMARY_INTERVAL at the job's
+// sampling rate, which change reports alone do not carry
+
+struct WindowSummary {
+    uint32_t intervalSeconds;  // Length of the window
+    uint32_t count;            // Samples in the window, 0 if none
+    float minimum;
+    float maximum;
+    float mean;
+    float stddev;              // Sample standard deviation, 0 below two samples
+};
+
+/**
+ * Running count/min/max/mean/variance (Welford), one instance per sensor
+ * job. Samples take O(1) time and memory and stay exact for long windows,
+ * unlike a sum of squares.
+ */
+template <typename T>
+class WindowAggregator {
+    static_assert(std::is_arithmetic<T>::value, "WindowAggregator needs a numeric sample type");
+
+public:
+    /**
+     * Start the first window; call before the first sample
+     */
+    void begin(unsigned long now) {
+        windowStart = now;
+        reset();
+    }
+
+    void sample(T value) {
+        double x = (double)value;
+        samples++;
+        if (samples == 1 || value < minimum) minimum = value;
+        if (samples == 1 || value > maximum) maximum = value;
+        double delta = x - mean;
+        mean += delta / samples;
+        m2 += delta * (x - mean);
+    }
+
+    /**
+     * @return true once the window has reached SENSOR_SUMMARY_INTERVAL
+     */
+    bool windowDue(unsigned long now) const {
+        return now - windowStart >= SENSOR_SUMMARY_INTERVAL;
+    }
+
+    /**
+     * Summary of the window so far; the window stays open, so a summary
+     * the CSE did not take is sent again, grown, on the next try
+     */
+    WindowSummary peek(unsigned long now) const {
+        WindowSummary summary;
+        summary.intervalSeconds = (now - windowStart) / 1000;
+        summary.count = samples;
+        summary.minimum = samples ? (float)minimum : 0.0f;
+        summary.maximum = samples ? (float)maximum : 0.0f;
+        summary.mean = (float)mean;
+        summary.stddev = samples > 1 ? (float)sqrt(m2 / (samples - 1)) : 0.0f;
+        return summary;
+    }
+
+    /**
+     * Close the window once its summary is published and start the next
+     */
+    void restart(unsigned long now) {
+        windowStart = now;
+        reset();
+    }
+
+    /**
+     * Fold a later window back in behind this one, e.g. when the CSE did
+     * not take this window's summary. Chan's parallel update keeps the
+     * variance exact.
+     */
+    void append(const WindowAggregator& later) {
+        if (later.samples == 0) return;
+        if (samples == 0 || later.minimum < minimum) minimum = later.minimum;
+        if (samples == 0 || later.maximum > maximum) maximum = later.maximum;
+        double total = (double)samples + later.samples;
+        double delta = later.mean - mean;
+        mean += delta * later.samples / total;
+        m2 += later.m2 + delta * delta * samples * later.samples / total;
+        samples += later.samples;
+    }
+
+private:
+    void reset() {
+        samples = 0;
+        mean = 0;
+        m2 = 0;
+    }
+
+    unsigned long windowStart = 0;
+    uint32_t samples = 0;
+    T minimum = 0;
+    T maximum = 0;
+    double mean = 0;
+    double m2 = 0;  // Sum of squared differences from the running mean
+};
+
+#endif // REPORT_POLICY_H
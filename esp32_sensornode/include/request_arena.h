@@ -0,0 +1,47 @@
+/**
+ * request_arena.h
+ *
+ * Bump allocator for the buffers of one oneM2M request (URL, serialized
+ * body). Every pooled connection owns a fixed block allocated with the
+ * pool and resets it when its request ends, so request traffic never
+ * leaves short-lived heap blocks between the long-lived ones.
+ */
+
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <Arduino.h>
+
+class RequestArena {
+public:
+    RequestArena(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {}
+
+    /**
+     * @return size bytes, 4-byte aligned, or nullptr if the arena is full
+     */
+    char* allocate(size_t size);
+
+    /**
+     * printf into the arena
+     * @return The string, or nullptr (nothing allocated) if it does not fit
+     */
+    const char* format(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    /**
+     * Free everything at once; call when the request is done
+     */
+    void reset();
+
+    size_t used() const { return offset; }
+    size_t highWater() const { return peak; }
+    uint32_t overflows() const { return overflowCount; }
+
+private:
+    char* buffer;
+    size_t capacity;
+    size_t offset = 0;
+    size_t peak = 0;
+    uint32_t overflowCount = 0;  // Requests that fell back to the heap
+};
+
+#endif // REQUEST_ARENA_H
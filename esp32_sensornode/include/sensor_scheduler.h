@@ -0,0 +1,72 @@
+/**
+ * sensor_scheduler.h
+ *
+ * Cooperative scheduler running sensor acquisition jobs from a single
+ * FreeRTOS task on a timer wheel
+ */
+
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <Arduino.h>
+
+// ==================== SCHEDULER CONFIGURATION ====================
+
+#define SCHEDULER_TICK_MS       100   // Timer wheel resolution
+#define SCHEDULER_WHEEL_SLOTS   64    // One rotation = 6.4 s
+#define SCHEDULER_MAX_JOBS      8
+
+typedef void (*SensorJobFunction)();
+
+// ==================== JOB METRICS ====================
+
+struct SensorJobStats {
+    const char* name;
+    uint32_t periodMs;
+    uint32_t runs;
+    uint32_t deadlineMisses;   // Finished later than due + deadline
+    uint32_t lastLatencyMs;    // Start time minus due time
+    uint32_t maxLatencyMs;
+    uint32_t lastRunMs;        // Execution time
+    uint32_t maxRunMs;
+};
+
+// ==================== SCHEDULER FUNCTIONS ====================
+
+/**
+ * Register a periodic job; must be called before startSensorScheduler()
+ * @param name Job name used in metrics
+ * @param job Function executing one acquisition cycle
+ * @param periodMs Period between due times (rounded to SCHEDULER_TICK_MS)
+ * @param deadlineMs Maximum time from due time to job completion
+ * @param initialDelayMs Delay before the first run
+ * @return true if the job was registered
+ */
+bool addSensorJob(const char* name, SensorJobFunction job, uint32_t periodMs,
+                  uint32_t deadlineMs, uint32_t initialDelayMs = 0);
+
+/**
+ * Start the scheduler task
+ * @return true if task created successfully
+ */
+bool startSensorScheduler();
+
+/**
+ * Copy per-job metrics
+ * @param stats Output array
+ * @param maxJobs Capacity of the output array
+ * @return Number of jobs copied
+ */
+size_t getSensorJobStats(SensorJobStats* stats, size_t maxJobs);
+
+/**
+ * Minimum free stack of the scheduler task since start (bytes)
+ */
+uint32_t getSensorSchedulerStackHighWaterMark();
+
+/**
+ * Print job metrics and stack high-water mark to Serial
+ */
+void logSensorSchedulerStats();
+
+#endif // SENSOR_SCHEDULER_H
@@ -0,0 +1,37 @@
+/**
+ * sensor_snapshot.h
+ *
+ * Latest reading of every sensor and the lamp state, shared between the
+ * sensor jobs, the notification handler and any reporter through a
+ * seqlock instead of one mutex per value
+ */
+
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+#include <Arduino.h>
+
+struct SensorSnapshot {
+    uint32_t sequence;      // Monotonic, increments on every write
+    float lux;
+    float audioLevel;       // dB SPL
+    bool occupied;
+    bool lampOn;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+/**
+ * Read all values as one consistent snapshot (never blocks writers)
+ */
+SensorSnapshot getSensorSnapshot();
+
+void setSnapshotLux(float lux);
+void setSnapshotAudioLevel(float level);
+void setSnapshotOccupied(bool occupied);
+void setSnapshotLamp(bool on, uint8_t red, uint8_t green, uint8_t blue);
+void setSnapshotLampPower(bool on);
+void setSnapshotLampColor(uint8_t red, uint8_t green, uint8_t blue);
+
+#endif // SENSOR_SNAPSHOT_H
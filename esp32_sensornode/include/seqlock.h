@@ -0,0 +1,88 @@
+/**
+ * seqlock.h
+ *
+ * Sequence lock for small trivially copyable values. Readers never take a
+ * lock and never block writers; they retry if a write overlapped their
+ * copy. Writers serialize through a short critical section.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+public:
+    SeqLock() : sequence(0) {
+        T initial{};
+        store(initial);
+    }
+
+    /**
+     * Modify the value in place under the writer lock and publish it
+     * @param update Callable taking T& (keep it short, runs in a critical section)
+     */
+    template <typename F>
+    void write(F update) {
+        portENTER_CRITICAL(&writerMux);
+        update(shadow);
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store(shadow);
+        sequence.store(seq + 2, std::memory_order_release);
+        portEXIT_CRITICAL(&writerMux);
+    }
+
+    /**
+     * Read a consistent copy of the value
+     * @param version Optional output for the write version (monotonic)
+     */
+    T read(uint32_t* version = nullptr) const {
+        T value;
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            while (before & 1) {
+                before = sequence.load(std::memory_order_acquire);
+            }
+            load(value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after);
+
+        if (version) *version = before / 2;
+        return value;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    void store(const T& value) {
+        uint32_t buffer[WORDS] = {};
+        memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < WORDS; i++) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    void load(T& value) const {
+        uint32_t buffer[WORDS];
+        for (size_t i = 0; i < WORDS; i++) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        memcpy(&value, buffer, sizeof(T));
+    }
+
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORDS];
+    T shadow{};
+    portMUX_TYPE writerMux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif // SEQLOCK_H
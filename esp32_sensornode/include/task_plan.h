@@ -0,0 +1,75 @@
+/**
+ * task_plan.h
+ *
+ * Core affinity, priority and stack plan for every task this firmware
+ * creates. The WiFi/lwIP stack runs on core 0 at high priority, so
+ * time-sensitive capture stays on core 1 above the UI task.
+ */
+
+#ifndef TASK_PLAN_H
+#define TASK_PLAN_H
+
+#include <Arduino.h>
+
+// ==================== TASK TABLE ====================
+
+enum TaskId {
+    TASK_SENSOR_SCHEDULER,
+    TASK_NEOPIXEL,
+    TASK_NOTIFICATION_SERVER,
+    TASK_PROFILER,
+    TASK_PROVISIONER,
+    TASK_CONNECTIVITY,
+    TASK_WIFI_MANAGER,
+    TASK_COUNT
+};
+
+struct TaskPlanEntry {
+    const char* name;
+    BaseType_t core;
+    UBaseType_t priority;
+    uint32_t stackSize;   // bytes
+    uint32_t periodMs;    // Nominal wake period, used for latency tracking
+    uint32_t lowPowerPeriodMs;  // Longer period under LOW_POWER_PROFILE, 0 = unchanged
+};
+
+extern const TaskPlanEntry TASK_PLAN[TASK_COUNT];
+
+// ==================== SCHEDULING LATENCY ====================
+
+struct TaskLatencyStats {
+    uint32_t wakeups;
+    uint32_t totalLatencyMs;
+    uint32_t maxLatencyMs;
+};
+
+// ==================== FUNCTIONS ====================
+
+/**
+ * Create a task with the core, priority and stack from TASK_PLAN
+ * @param id Task to create
+ * @param function Task entry point
+ * @param handle Optional output for the task handle
+ * @return true if task created successfully
+ */
+bool startPlannedTask(TaskId id, TaskFunction_t function, TaskHandle_t* handle = nullptr);
+
+/**
+ * Wake period of a planned task under the active power profile
+ */
+uint32_t taskPeriodMs(TaskId id);
+
+/**
+ * Block until the next period of a planned task and record how late the
+ * task was actually woken
+ * @param id Calling task
+ * @param lastWake State for vTaskDelayUntil, initialize with xTaskGetTickCount()
+ */
+void waitForNextPeriod(TaskId id, TickType_t& lastWake);
+
+/**
+ * Read and reset the latency window of a planned task
+ */
+TaskLatencyStats takeTaskLatencyStats(TaskId id);
+
+#endif // TASK_PLAN_H
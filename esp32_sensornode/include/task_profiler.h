@@ -0,0 +1,21 @@
+/**
+ * task_profiler.h
+ *
+ * Periodic per-task CPU share, stack and scheduling latency report built
+ * from uxTaskGetSystemState() and published as a diagnostics record
+ */
+
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <Arduino.h>
+
+#define PROFILER_MAX_TASKS 24
+
+/**
+ * Start the profiler task (TASK_PROFILER in the task plan)
+ * @return true if task created successfully
+ */
+bool startTaskProfiler();
+
+#endif // TASK_PROFILER_H
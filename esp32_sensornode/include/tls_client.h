@@ -0,0 +1,115 @@
+/**
+ * tls_client.h
+ *
+ * HTTPS for the oneM2M connection pool. A TlsClient is a WiFiClient that
+ * runs mbedTLS over its own socket, so HTTPClient and the pipelining code
+ * use it unchanged. All connections of a pool share one TlsContext: the
+ * mbedTLS configuration, the CA and optional client certificate (mTLS),
+ * and the session of the last full handshake. A reconnect offers that
+ * session (ID and ticket) and the CSE can resume it with an abbreviated
+ * handshake instead of a full ECDHE exchange and certificate check.
+ */
+
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+/**
+ * PEM credentials; clientCert and clientKey nullptr for server-only TLS
+ */
+struct TlsCredentials {
+    const char* caCert;       // Verifies the CSE's certificate
+    const char* clientCert;   // Presented to a CSE that requires one
+    const char* clientKey;
+    const char* serverName;   // Must match the certificate's CN or a DNS SAN
+};
+
+class TlsContext {
+public:
+    explicit TlsContext(uint32_t timeoutMs) : timeoutMs(timeoutMs) {}
+    ~TlsContext();
+
+    /**
+     * Parse the credentials and set up the shared configuration
+     * @return false if a certificate or key does not parse
+     */
+    bool begin(const TlsCredentials& credentials);
+
+    /**
+     * Drop the cached session so the next connection does a full handshake
+     */
+    void forgetSession();
+
+private:
+    friend class TlsClient;
+
+    bool restoreSession(mbedtls_ssl_context* ssl);
+    void recordHandshake(mbedtls_ssl_context* ssl, bool offered, uint32_t elapsedMs);
+
+    const uint32_t timeoutMs;
+    const char* serverName = nullptr;
+    bool ready = false;
+    mbedtls_ssl_config config;
+    mbedtls_x509_crt caChain;
+    mbedtls_x509_crt clientChain;
+    mbedtls_pk_context clientKey;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context random;
+
+    SemaphoreHandle_t sessionLock = NULL;
+    mbedtls_ssl_session session;
+    bool haveSession = false;
+};
+
+class TlsClient : public WiFiClient {
+public:
+    TlsClient() = default;
+    ~TlsClient() override;
+
+    /**
+     * Speak TLS from the next connect() on; without a context the client
+     * is plain TCP
+     */
+    void setContext(TlsContext* context) { this->context = context; }
+
+    bool secure() const { return context != nullptr; }
+
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeoutMs) override;
+    uint8_t connected() override;
+    void stop() override;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override {}  // WiFiClient's would discard undecrypted records
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+private:
+    static int sendRaw(void* client, const unsigned char* buffer, size_t length);
+    static int receiveRaw(void* client, unsigned char* buffer, size_t length);
+
+    int fail(const char* step, int error);  // Closes the socket, returns 0
+    void drop();                            // Connection unusable after an error
+
+    TlsContext* context = nullptr;
+    mbedtls_ssl_context ssl;
+    bool sslReady = false;       // mbedtls_ssl_setup() done; reset per connection
+    bool established = false;
+    int peeked = -1;             // Byte decrypted by available() or peek()
+};
+
+#endif // TLS_CLIENT_H
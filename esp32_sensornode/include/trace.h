@@ -0,0 +1,71 @@
+/**
+ * trace.h
+ *
+ * Binary event tracer for task-level timing (TRACE_ENABLED). Events are
+ * 8-byte records in a fixed RAM ring; GET /trace on the notification
+ * server dumps it for tools/trace_decode.py. With TRACE_ENABLED false the
+ * TRACE() macro compiles to nothing.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define TRACE_MAGIC "TRC1"
+#define TRACE_MAX_TASKS 16
+
+// Keep in sync with EVENTS in tools/trace_decode.py
+enum TraceEvent : uint8_t {
+    TRACE_TASK_WAKE,       // Periodic task returned from its delay
+    TRACE_TASK_SLEEP,      // Periodic task entered its delay
+    TRACE_JOB_BEGIN,       // arg: sensor job index
+    TRACE_JOB_END,
+    TRACE_I2S_READ_BEGIN,
+    TRACE_I2S_READ_END,    // arg: bytes read
+    TRACE_HTTP_BEGIN,      // arg: pool slot
+    TRACE_HTTP_END,        // arg: HTTP status, 0 on transport error
+    TRACE_NOTIFICATION,    // oneM2M notification received
+    TRACE_LED_SHOW,        // arg: RGB565 of the shown color
+    TRACE_BREAKER,         // arg: new BreakerState of the CSE circuit breaker
+    TRACE_EVENT_COUNT
+};
+
+struct TraceRecord {
+    uint32_t timestampUs;  // Low 32 bits of esp_timer, wraps after ~71 min
+    uint8_t event;
+    uint8_t task;          // Bit 7: core, bits 0-6: registered task slot + 1 (0 = other)
+    uint16_t arg;
+};
+
+static_assert(sizeof(TraceRecord) == 8, "trace records are 8 bytes");
+
+class WebServer;
+
+#if TRACE_ENABLED
+
+/**
+ * Append one record; lock-free and safe from any task on either core
+ */
+void traceRecord(TraceEvent event, uint16_t arg);
+
+/**
+ * Name a task for the dump; called by startPlannedTask()
+ */
+void traceRegisterTask(TaskHandle_t handle, const char* name);
+
+/**
+ * Stream the ring (oldest first) with its task and job name tables
+ */
+void sendTraceDump(WebServer& server);
+
+#define TRACE(event, arg) traceRecord((event), (uint16_t)(arg))
+
+#else
+
+#define TRACE(event, arg) ((void)0)
+
+#endif // TRACE_ENABLED
+
+#endif // TRACE_H
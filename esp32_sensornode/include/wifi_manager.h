@@ -0,0 +1,52 @@
+/**
+ * wifi_manager.h
+ *
+ * WiFi connection manager: associates with the cached BSSID/channel
+ * (RTC memory, NVS) before falling back to a full scan, reconnects on
+ * disconnect events, and tracks reconnect durations and RSSI history.
+ */
+
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+
+#define WIFI_NVS_NAMESPACE "wifi"
+#define WIFI_RSSI_HISTORY 12
+
+struct WiFiStats {
+    uint32_t connectAttempts;
+    uint32_t fastConnects;          // Associated using the cached BSSID/channel
+    uint32_t fullScans;
+    uint32_t reconnects;            // Outages recovered since boot
+    uint32_t lastReconnectMs;       // Disconnect event to IP
+    uint32_t maxReconnectMs;
+    uint32_t totalReconnectMs;
+    int8_t rssi[WIFI_RSSI_HISTORY]; // Oldest first
+    uint8_t rssiCount;
+};
+
+/**
+ * Start the manager task; it connects and keeps the link up
+ * @return true if the task was created
+ */
+bool startWiFiManager();
+
+/**
+ * Block until the station has an IP address
+ * @param timeoutMs Maximum wait
+ * @return true if connected
+ */
+bool waitForWiFi(uint32_t timeoutMs);
+
+/**
+ * @return Connection counters and RSSI history
+ */
+WiFiStats getWiFiStats();
+
+/**
+ * Forget the cached BSSID/channel/IP (e.g. after moving the node)
+ */
+void clearWiFiCache();
+
+#endif // WIFI_MANAGER_H
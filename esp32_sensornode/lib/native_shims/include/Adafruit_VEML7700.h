@@ -0,0 +1,23 @@
+/**
+ * Adafruit_VEML7700.h (native)
+ *
+ * Returns the lux set with nativeSetLux().
+ */
+
+#ifndef NATIVE_ADAFRUIT_VEML7700_H
+#define NATIVE_ADAFRUIT_VEML7700_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+class Adafruit_VEML7700 {
+public:
+    bool begin(TwoWire* wire = &Wire);
+    void enable(bool enabled) { this->enabled = enabled; }
+    float readLux();
+
+private:
+    bool enabled = false;
+};
+
+#endif // NATIVE_ADAFRUIT_VEML7700_H
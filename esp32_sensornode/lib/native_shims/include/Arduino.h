@@ -0,0 +1,99 @@
+/**
+ * Arduino.h (native)
+ *
+ * Host stand-in for the Arduino-ESP32 core so the firmware sources build
+ * and run on Linux ([env:native]). Time starts at 0 with the process;
+ * GPIO levels, sensor values and serial traffic are set from tests
+ * through native_hal.h.
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+#include "IPAddress.h"
+#include "esp_err.h"
+
+#define ARDUINO 10819
+#define ARDUINO_ARCH_ESP32 1
+#define NATIVE_BUILD 1
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define BIT(n) (1UL << (n))
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// ==================== TIME ====================
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t timeoutMs = 5000);
+
+// ==================== GPIO ====================
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+uint16_t analogRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// ==================== CHIP ====================
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize();
+    uint32_t getCpuFreqMHz() { return 240; }
+    const char* getChipModel() { return "native"; }
+    void restart();
+};
+
+extern EspClass ESP;
+
+// Sketch entry points, called by the native main()
+void setup();
+void loop();
+
+#endif // NATIVE_ARDUINO_H
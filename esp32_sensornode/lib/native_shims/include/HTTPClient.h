@@ -0,0 +1,94 @@
+/**
+ * HTTPClient.h (native)
+ *
+ * HTTP/1.1 client over WiFiClient with the Arduino-ESP32 surface the
+ * firmware uses: keep-alive reuse, Content-Length and chunked bodies,
+ * and the same negative error codes. The body is read with the headers;
+ * getStreamPtr() replays it as the socket carried it (chunk framing
+ * included), writeToStream() without the framing. getSize() is the
+ * Content-Length header, -1 if absent, as on the ESP32.
+ */
+
+#ifndef NATIVE_HTTP_CLIENT_H
+#define NATIVE_HTTP_CLIENT_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_CREATED 201
+
+class HTTPClient {
+public:
+    bool begin(WiFiClient& client, const String& url);
+    void end();
+
+    void setReuse(bool reuse) { this->reuse = reuse; }
+    void setTimeout(uint16_t timeoutMs) { this->timeoutMs = timeoutMs; }
+    void setConnectTimeout(int32_t timeoutMs) { connectTimeoutMs = timeoutMs; }
+    void addHeader(const String& name, const String& value);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+
+    int GET();
+    int POST(const String& payload);
+    int POST(uint8_t* payload, size_t size);
+    int PUT(const String& payload);
+    int PUT(uint8_t* payload, size_t size);
+    int sendRequest(const char* method, const String& payload = String());
+    int sendRequest(const char* method, uint8_t* payload, size_t size);
+
+    String getString();
+    int getSize() { return chunked ? -1 : size; }
+    Stream* getStreamPtr();
+    int writeToStream(Stream* stream);
+    bool connected() { return client && client->connected(); }
+
+private:
+    // Reads the buffered body like the socket behind it on the ESP32
+    class BodyStream : public Stream {
+    public:
+        void reset(const std::string* source) { body = source; position = 0; }
+        int available() override { return (int)(body->size() - position); }
+        int read() override { return position < body->size() ? (uint8_t)(*body)[position++] : -1; }
+        int peek() override { return position < body->size() ? (uint8_t)(*body)[position] : -1; }
+        size_t write(uint8_t) override { return 0; }
+
+    private:
+        const std::string* body = nullptr;
+        size_t position = 0;
+    };
+
+    int readResponse(const char* method);
+    bool readLine(std::string& line);
+
+    WiFiClient* client = nullptr;
+    String host;
+    uint16_t port = 80;
+    String uri;
+    bool reuse = true;
+    bool keepAlive = false;
+    uint16_t timeoutMs = 5000;
+    int32_t connectTimeoutMs = 3000;
+    std::vector<std::pair<String, String>> headers;
+    std::vector<std::pair<String, String>> collected;  // Keys from collectHeaders(), last reply's values
+    std::string body;
+    std::string wire;  // Chunked body with its framing
+    bool chunked = false;
+    int size = -1;     // Content-Length of the last reply
+    BodyStream bodyStream;
+};
+
+#endif // NATIVE_HTTP_CLIENT_H
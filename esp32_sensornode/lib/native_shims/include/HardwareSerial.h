@@ -0,0 +1,52 @@
+/**
+ * HardwareSerial.h (native)
+ *
+ * Serial writes to stdout. Other ports keep a TX log and an RX queue that
+ * tests fill, optionally from a responder called on every write.
+ */
+
+#ifndef NATIVE_HARDWARE_SERIAL_H
+#define NATIVE_HARDWARE_SERIAL_H
+
+#include "Stream.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial : public Stream {
+public:
+    typedef std::function<void(HardwareSerial& port, const uint8_t* data, size_t length)> Responder;
+
+    explicit HardwareSerial(int port);
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {}
+    void end() {}
+    size_t setRxBufferSize(size_t size) { return size; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+
+    // Test hooks
+    void inject(const uint8_t* data, size_t length);
+    void setResponder(Responder responder);
+    std::vector<uint8_t> takeWritten();
+
+private:
+    int port;
+    std::mutex lock;
+    std::deque<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    Responder responder;
+};
+
+extern HardwareSerial Serial;
+
+#endif // NATIVE_HARDWARE_SERIAL_H
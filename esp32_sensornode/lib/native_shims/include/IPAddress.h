@@ -0,0 +1,27 @@
+/**
+ * IPAddress.h (native)
+ */
+
+#ifndef NATIVE_IP_ADDRESS_H
+#define NATIVE_IP_ADDRESS_H
+
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t address) : address(address) {}
+
+    operator uint32_t() const { return address; }
+    uint8_t operator[](int index) const { return (address >> (index * 8)) & 0xFF; }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+    String toString() const;
+    bool fromString(const char* text);
+
+private:
+    uint32_t address;  // Network order, first octet in the low byte
+};
+
+#endif // NATIVE_IP_ADDRESS_H
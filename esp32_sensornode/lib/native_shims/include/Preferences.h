@@ -0,0 +1,48 @@
+/**
+ * Preferences.h (native)
+ *
+ * NVS stand-in kept in memory for the life of the process; namespaces are
+ * shared between instances like on the device.
+ */
+
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putBool(const char* key, bool value) { return putUChar(key, value ? 1 : 0); }
+    size_t putString(const char* key, const String& value);
+    size_t putBytes(const char* key, const void* value, size_t length);
+
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return get(key, defaultValue); }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { return get(key, defaultValue); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+    bool getBool(const char* key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+    String getString(const char* key, const String& defaultValue = String());
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+    size_t getBytesLength(const char* key);
+
+private:
+    template <typename T>
+    T get(const char* key, T defaultValue) {
+        T value;
+        return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) == sizeof(T) ? value : defaultValue;
+    }
+
+    String name;
+    bool readOnly = false;
+    bool opened = false;
+};
+
+#endif // NATIVE_PREFERENCES_H
@@ -0,0 +1,36 @@
+/**
+ * Print.h (native)
+ */
+
+#ifndef NATIVE_PRINT_H
+#define NATIVE_PRINT_H
+
+#include "WString.h"
+#include <cstdarg>
+#include <cstring>
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+    virtual void flush() {}
+
+    size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int number, int base = 10) { return print(String(number, base)); }
+    size_t print(unsigned int number, int base = 10) { return print(String(number, base)); }
+    size_t print(long number, int base = 10) { return print(String(number, base)); }
+    size_t print(unsigned long number, int base = 10) { return print(String(number, base)); }
+    size_t print(double number, int decimals = 2) { return print(String(number, decimals)); }
+
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#endif // NATIVE_PRINT_H
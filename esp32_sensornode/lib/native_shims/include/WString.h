@@ -0,0 +1,93 @@
+/**
+ * WString.h (native)
+ *
+ * Arduino String on top of std::string: the subset the firmware and
+ * ArduinoJson use
+ */
+
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class String {
+public:
+    String() = default;
+    String(const char* text) : value(text ? text : "") {}
+    String(const char* text, size_t length) : value(text, length) {}
+    String(const std::string& text) : value(text) {}
+    explicit String(char c) : value(1, c) {}
+    explicit String(int number, unsigned char base = 10);
+    explicit String(unsigned int number, unsigned char base = 10);
+    explicit String(long number, unsigned char base = 10);
+    explicit String(unsigned long number, unsigned char base = 10);
+    explicit String(long long number, unsigned char base = 10);
+    explicit String(unsigned long long number, unsigned char base = 10);
+    explicit String(float number, unsigned int decimals = 2);
+    explicit String(double number, unsigned int decimals = 2);
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+
+    bool concat(const String& other) { value += other.value; return true; }
+    bool concat(const char* text) { if (text) value += text; return true; }
+    bool concat(const char* text, unsigned int length) { value.append(text, length); return true; }
+    bool concat(char c) { value += c; return true; }
+    bool concat(int number) { return concat(String(number)); }
+    bool concat(unsigned int number) { return concat(String(number)); }
+    bool concat(long number) { return concat(String(number)); }
+    bool concat(unsigned long number) { return concat(String(number)); }
+    bool concat(float number) { return concat(String(number)); }
+    bool concat(double number) { return concat(String(number)); }
+
+    template <typename T>
+    String& operator+=(const T& other) { concat(other); return *this; }
+
+    char charAt(unsigned int index) const { return index < value.size() ? value[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return value[index]; }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& text, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+    bool equals(const String& other) const { return value == other.value; }
+    bool equalsIgnoreCase(const String& other) const;
+    int compareTo(const String& other) const { return value.compare(other.value); }
+
+    void trim();
+    void toLowerCase();
+    void toUpperCase();
+    void replace(const String& from, const String& to);
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* text) const { return value == (text ? text : ""); }
+    bool operator!=(const String& other) const { return !(*this == other); }
+    bool operator!=(const char* text) const { return !(*this == text); }
+    bool operator<(const String& other) const { return value < other.value; }
+    explicit operator bool() const { return true; }
+
+    const std::string& str() const { return value; }
+
+private:
+    std::string value;
+};
+
+inline String operator+(const String& left, const String& right) { String out(left); out += right; return out; }
+inline String operator+(const String& left, const char* right) { String out(left); out += right; return out; }
+inline String operator+(const char* left, const String& right) { String out(left); out += right; return out; }
+inline String operator+(const String& left, char right) { String out(left); out += right; return out; }
+inline bool operator==(const char* left, const String& right) { return right == left; }
+
+#endif // NATIVE_WSTRING_H
@@ -0,0 +1,65 @@
+/**
+ * WebServer.h (native)
+ *
+ * Single-threaded HTTP/1.0 server on a listening socket: handleClient()
+ * accepts at most one connection, dispatches it and closes it, like the
+ * ESP32 WebServer without keep-alive.
+ */
+
+#ifndef NATIVE_WEB_SERVER_H
+#define NATIVE_WEB_SERVER_H
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS } HTTPMethod;
+
+class WebServer {
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    explicit WebServer(int port = 80) : port(port) {}
+    ~WebServer();
+
+    void begin();
+    void close();
+    void handleClient();
+
+    void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { notFound = handler; }
+
+    String uri() const { return requestUri; }
+    HTTPMethod method() const { return requestMethod; }
+    String arg(const String& name) const;
+    bool hasArg(const String& name) const { return name == "plain" && !requestBody.isEmpty(); }
+
+    void send(int code, const char* contentType = nullptr, const String& content = String());
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void setContentLength(size_t length) { contentLength = (long)length; }
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t length);
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+
+    int port;
+    int listenFd = -1;
+    std::vector<Route> routes;
+    THandlerFunction notFound;
+
+    std::unique_ptr<WiFiClient> current;
+    String requestUri;
+    HTTPMethod requestMethod = HTTP_ANY;
+    String requestBody;
+    long contentLength = -1;
+};
+
+#endif // NATIVE_WEB_SERVER_H
@@ -0,0 +1,85 @@
+/**
+ * WiFi.h (native)
+ *
+ * The host network is always up: begin() connects immediately and fires
+ * the same events the ESP32 station raises. localIP() is 127.0.0.1 unless
+ * NATIVE_LOCAL_IP is set, so subscriptions can point a CSE at the host.
+ */
+
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include "esp_wifi.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_STOP = 3,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8
+} arduino_event_id_t;
+
+typedef struct {
+    struct {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid, const char* password = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    bool reconnect();
+    wl_status_t status();
+
+    bool mode(wifi_mode_t mode);
+    bool persistent(bool persistent) { return true; }
+    bool setAutoReconnect(bool autoReconnect) { return true; }
+    bool setSleep(bool enabled) { return true; }
+    void setScanMethod(wifi_scan_method_t method) {}
+    void setSortMethod(wifi_sort_method_t method) {}
+    bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    int onEvent(WiFiEventFuncCb callback, WiFiEvent_t event = (WiFiEvent_t)0);
+
+    IPAddress localIP();
+    IPAddress gatewayIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress subnetMask() { return IPAddress(255, 0, 0, 0); }
+    IPAddress dnsIP(uint8_t index = 0) { return IPAddress(127, 0, 0, 53); }
+    String SSID() { return ssid; }
+    uint8_t* BSSID() { return bssid; }
+    int32_t channel() { return 6; }
+    int8_t RSSI();
+    String macAddress() { return "02:00:00:00:00:01"; }
+
+    // Used by esp_wifi_connect() and tests to drive reconnects
+    void raise(WiFiEvent_t event, uint8_t reason = 0);
+
+private:
+    String ssid;
+    uint8_t bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
@@ -0,0 +1,56 @@
+/**
+ * WiFiClient.h (native)
+ *
+ * TCP client on a POSIX socket. Reads are non-blocking like on the
+ * ESP32 and served from a receive buffer so header parsing does not cost
+ * a syscall per byte. The socket methods are virtual as in the core's
+ * Client, so a subclass can layer TLS on top.
+ */
+
+#ifndef NATIVE_WIFI_CLIENT_H
+#define NATIVE_WIFI_CLIENT_H
+
+#include "Arduino.h"
+#include <stddef.h>
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient() = default;
+    explicit WiFiClient(int fd) : fd(fd) {}
+    ~WiFiClient() override { stop(); }
+
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+
+    virtual int connect(const char* host, uint16_t port) { return connect(host, port, 3000); }
+    virtual int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    virtual uint8_t connected();
+    virtual void stop();
+    void setNoDelay(bool noDelay);
+
+    int available() override;
+    int read() override;
+    virtual int read(uint8_t* buffer, size_t size);
+    int peek() override;
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    operator bool() { return connected(); }
+
+    /**
+     * Native only: block until data is buffered or the peer closes
+     * @return true if data is available
+     */
+    bool waitForData(uint32_t timeoutMs);
+
+private:
+    bool fill(int timeoutMs);
+
+    int fd = -1;
+    uint8_t rxBuffer[1460];
+    size_t rxStart = 0;
+    size_t rxEnd = 0;
+};
+
+#endif // NATIVE_WIFI_CLIENT_H
@@ -0,0 +1,30 @@
+/**
+ * Wire.h (native)
+ *
+ * I2C bus with no devices; sensor libraries are shimmed above it.
+ */
+
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire : public Stream {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+    bool end() { return true; }
+    bool setClock(uint32_t frequency) { return true; }
+    void beginTransmission(uint8_t address) {}
+    uint8_t endTransmission(bool stop = true) { return 2; }  // Address NACK
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool stop = true) { return 0; }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t byte) override { return 1; }
+    using Print::write;
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
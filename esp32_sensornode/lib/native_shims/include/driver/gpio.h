@@ -0,0 +1,20 @@
+/**
+ * driver/gpio.h (native)
+ */
+
+#ifndef NATIVE_DRIVER_GPIO_H
+#define NATIVE_DRIVER_GPIO_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_MAX = 49
+} gpio_num_t;
+
+int gpio_get_level(gpio_num_t pin);
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level);
+
+#endif // NATIVE_DRIVER_GPIO_H
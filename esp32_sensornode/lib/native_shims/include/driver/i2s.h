@@ -0,0 +1,69 @@
+/**
+ * driver/i2s.h (native)
+ *
+ * Legacy I2S RX driver producing a 32-bit left-justified sine whose
+ * amplitude is set with nativeSetAudioAmplitude(). i2s_read() paces
+ * itself to the configured sample rate like the DMA would.
+ */
+
+#ifndef NATIVE_DRIVER_I2S_H
+#define NATIVE_DRIVER_I2S_H
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+typedef enum { I2S_NUM_0 = 0, I2S_NUM_1 = 1, I2S_NUM_MAX } i2s_port_t;
+
+typedef int i2s_mode_t;
+#define I2S_MODE_MASTER (1 << 0)
+#define I2S_MODE_SLAVE (1 << 1)
+#define I2S_MODE_TX (1 << 2)
+#define I2S_MODE_RX (1 << 3)
+
+typedef enum {
+    I2S_BITS_PER_SAMPLE_16BIT = 16,
+    I2S_BITS_PER_SAMPLE_24BIT = 24,
+    I2S_BITS_PER_SAMPLE_32BIT = 32
+} i2s_bits_per_sample_t;
+
+typedef enum {
+    I2S_CHANNEL_FMT_RIGHT_LEFT,
+    I2S_CHANNEL_FMT_ALL_RIGHT,
+    I2S_CHANNEL_FMT_ALL_LEFT,
+    I2S_CHANNEL_FMT_ONLY_RIGHT,
+    I2S_CHANNEL_FMT_ONLY_LEFT
+} i2s_channel_fmt_t;
+
+typedef enum {
+    I2S_COMM_FORMAT_STAND_I2S = 0x01,
+    I2S_COMM_FORMAT_STAND_MSB = 0x02
+} i2s_comm_format_t;
+
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct {
+    i2s_mode_t mode;
+    uint32_t sample_rate;
+    i2s_bits_per_sample_t bits_per_sample;
+    i2s_channel_fmt_t channel_format;
+    i2s_comm_format_t communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;
+    bool use_apll;
+} i2s_config_t;
+
+typedef struct {
+    int mck_io_num;
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int queueSize, void* queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t port);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins);
+esp_err_t i2s_read(i2s_port_t port, void* destination, size_t size, size_t* bytesRead, TickType_t timeout);
+
+#endif // NATIVE_DRIVER_I2S_H
@@ -0,0 +1,14 @@
+/**
+ * esp_idf_version.h (native)
+ *
+ * Reports the IDF 4.4 line shipped with Arduino-ESP32 2.x.
+ */
+
+#ifndef NATIVE_ESP_IDF_VERSION_H
+#define NATIVE_ESP_IDF_VERSION_H
+
+#define ESP_IDF_VERSION_MAJOR 4
+#define ESP_IDF_VERSION_MINOR 4
+#define ESP_IDF_VERSION_PATCH 0
+
+#endif // NATIVE_ESP_IDF_VERSION_H
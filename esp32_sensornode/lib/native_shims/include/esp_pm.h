@@ -0,0 +1,13 @@
+/**
+ * esp_pm.h (native)
+ *
+ * CONFIG_PM_ENABLE is left undefined: there is no light sleep on the
+ * host, so power_manager.cpp takes its modem-sleep-only path.
+ */
+
+#ifndef NATIVE_ESP_PM_H
+#define NATIVE_ESP_PM_H
+
+#include "esp_err.h"
+
+#endif // NATIVE_ESP_PM_H
@@ -0,0 +1,29 @@
+/**
+ * esp_sleep.h (native)
+ *
+ * esp_deep_sleep_start() exits the process with status 0 after flushing
+ * stdout; a harness restarts it to model the next wake. The wake cause
+ * comes from the NATIVE_WAKE_CAUSE environment variable (timer, ext0).
+ */
+
+#ifndef NATIVE_ESP_SLEEP_H
+#define NATIVE_ESP_SLEEP_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER
+} esp_sleep_wakeup_cause_t;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs);
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level);
+[[noreturn]] void esp_deep_sleep_start();
+
+#endif // NATIVE_ESP_SLEEP_H
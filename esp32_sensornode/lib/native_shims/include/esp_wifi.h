@@ -0,0 +1,33 @@
+/**
+ * esp_wifi.h (native)
+ */
+
+#ifndef NATIVE_ESP_WIFI_H
+#define NATIVE_ESP_WIFI_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP = 1 } wifi_interface_t;
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+typedef enum { WIFI_FAST_SCAN = 0, WIFI_ALL_CHANNEL_SCAN } wifi_scan_method_t;
+typedef enum { WIFI_CONNECT_AP_BY_SIGNAL = 0, WIFI_CONNECT_AP_BY_SECURITY } wifi_sort_method_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+    uint8_t channel;
+    uint16_t listen_interval;
+} wifi_sta_config_t;
+
+typedef union {
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* config);
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config);
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type);
+esp_err_t esp_wifi_connect();
+
+#endif // NATIVE_ESP_WIFI_H
@@ -0,0 +1,55 @@
+/**
+ * FreeRTOS.h (native)
+ *
+ * FreeRTOS API on top of std::thread: tasks are detached threads, one
+ * tick is one millisecond, critical sections are a recursive mutex per
+ * portMUX. Priorities and core affinity are recorded but not enforced.
+ */
+
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define errQUEUE_FULL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(ticks))
+
+#define portNUM_PROCESSORS 2
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// No run time stats or system state on the host
+#define configUSE_TRACE_FACILITY 0
+#define configGENERATE_RUN_TIME_STATS 0
+
+struct portMUX_TYPE {
+    std::recursive_mutex lock;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->lock.lock()
+#define portEXIT_CRITICAL(mux) (mux)->lock.unlock()
+#define portENTER_CRITICAL_ISR(mux) (mux)->lock.lock()
+#define portEXIT_CRITICAL_ISR(mux) (mux)->lock.unlock()
+#define taskENTER_CRITICAL(mux) portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux) portEXIT_CRITICAL(mux)
+
+BaseType_t xPortGetCoreID();
+
+#endif // NATIVE_FREERTOS_H
@@ -0,0 +1,27 @@
+/**
+ * event_groups.h (native)
+ */
+
+#ifndef NATIVE_FREERTOS_EVENT_GROUPS_H
+#define NATIVE_FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+
+struct NativeEventGroup;
+typedef NativeEventGroup* EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+EventGroupHandle_t xEventGroupCreate();
+void vEventGroupDelete(EventGroupHandle_t group);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t timeout);
+
+#endif // NATIVE_FREERTOS_EVENT_GROUPS_H
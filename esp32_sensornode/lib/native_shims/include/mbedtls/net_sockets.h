@@ -0,0 +1,12 @@
+/**
+ * mbedtls/net_sockets.h (native): error codes only
+ */
+
+#ifndef NATIVE_MBEDTLS_NET_SOCKETS_H
+#define NATIVE_MBEDTLS_NET_SOCKETS_H
+
+#define MBEDTLS_ERR_NET_RECV_FAILED (-0x004C)
+#define MBEDTLS_ERR_NET_SEND_FAILED (-0x004E)
+#define MBEDTLS_ERR_NET_CONN_RESET (-0x0050)
+
+#endif // NATIVE_MBEDTLS_NET_SOCKETS_H
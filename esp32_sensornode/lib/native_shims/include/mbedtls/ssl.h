@@ -0,0 +1,96 @@
+/**
+ * mbedtls/ssl.h (native)
+ *
+ * The part of the mbedTLS 2.28 client API (ESP-IDF 4.4) the firmware
+ * uses, on OpenSSL. Capped at TLS 1.2 like the ESP32's mbedTLS, so
+ * sessions resume by session ID or ticket the same way.
+ */
+
+#ifndef NATIVE_MBEDTLS_SSL_H
+#define NATIVE_MBEDTLS_SSL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/x509_crt.h"
+
+#define MBEDTLS_SSL_IS_CLIENT 0
+#define MBEDTLS_SSL_TRANSPORT_STREAM 0
+#define MBEDTLS_SSL_PRESET_DEFAULT 0
+
+#define MBEDTLS_SSL_VERIFY_NONE 0
+#define MBEDTLS_SSL_VERIFY_OPTIONAL 1
+#define MBEDTLS_SSL_VERIFY_REQUIRED 2
+
+#define MBEDTLS_ERR_SSL_ALLOC_FAILED (-0x7F00)
+#define MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE (-0x7780)
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY (-0x7880)
+#define MBEDTLS_ERR_SSL_CONN_EOF (-0x7280)
+#define MBEDTLS_ERR_SSL_INTERNAL_ERROR (-0x6C00)
+#define MBEDTLS_ERR_SSL_TIMEOUT (-0x6800)
+#define MBEDTLS_ERR_SSL_WANT_WRITE (-0x6880)
+#define MBEDTLS_ERR_SSL_WANT_READ (-0x6900)
+
+typedef int mbedtls_ssl_send_t(void* ctx, const unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void* ctx, unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void* ctx, unsigned char* buf, size_t len, uint32_t timeout);
+
+struct ssl_ctx_st;
+struct ssl_st;
+struct ssl_session_st;
+
+typedef struct mbedtls_ssl_session {
+    unsigned char id[32];
+    size_t id_len;
+    unsigned char master[48];
+    struct ssl_session_st* handle;  // Native only
+} mbedtls_ssl_session;
+
+typedef struct mbedtls_ssl_config {
+    int authmode;
+    const mbedtls_x509_crt* ca_chain;
+    const mbedtls_x509_crt* own_cert;
+    const mbedtls_pk_context* own_key;
+    struct ssl_ctx_st* handle;  // Native only: built by the first mbedtls_ssl_setup()
+} mbedtls_ssl_config;
+
+typedef struct mbedtls_ssl_context {
+    const mbedtls_ssl_config* conf;
+    struct ssl_st* handle;  // Native only
+    char hostname[256];
+    void* p_bio;
+    mbedtls_ssl_send_t* f_send;
+    mbedtls_ssl_recv_t* f_recv;
+    int bio_error;               // Last callback error, returned instead of a generic one
+    mbedtls_ssl_session session;  // Negotiated, for mbedtls_ssl_get_session_pointer()
+} mbedtls_ssl_context;
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset);
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode);
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config* conf, mbedtls_x509_crt* ca_chain, void* ca_crl);
+int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config* conf, mbedtls_x509_crt* own_cert, mbedtls_pk_context* pk_key);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf);
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf);
+int mbedtls_ssl_session_reset(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+                         mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout);
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len);
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len);
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl);
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl);
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session);
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session);
+const mbedtls_ssl_session* mbedtls_ssl_get_session_pointer(const mbedtls_ssl_context* ssl);
+
+#endif // NATIVE_MBEDTLS_SSL_H
@@ -0,0 +1,21 @@
+/**
+ * mbedtls/x509_crt.h (native)
+ */
+
+#ifndef NATIVE_MBEDTLS_X509_CRT_H
+#define NATIVE_MBEDTLS_X509_CRT_H
+
+#include <stddef.h>
+
+#define MBEDTLS_ERR_X509_INVALID_FORMAT (-0x2180)
+#define MBEDTLS_ERR_X509_CERT_VERIFY_FAILED (-0x2700)
+
+typedef struct mbedtls_x509_crt {
+    char* pem;  // Native only: the parsed chain, loaded into the SSL_CTX
+} mbedtls_x509_crt;
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt* crt);
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* chain, const unsigned char* buf, size_t buflen);
+void mbedtls_x509_crt_free(mbedtls_x509_crt* crt);
+
+#endif // NATIVE_MBEDTLS_X509_CRT_H
@@ -0,0 +1,57 @@
+/**
+ * native_hal.h
+ *
+ * Test and benchmark hooks for the native shims: inputs the hardware
+ * would produce and outputs it would show. Only available in the native
+ * environment.
+ */
+
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include "Arduino.h"
+#include "HardwareSerial.h"
+
+/**
+ * Level returned by digitalRead() and gpio_get_level()
+ */
+void nativeSetPin(uint8_t pin, int level);
+
+/**
+ * @return Last level written with digitalWrite()
+ */
+int nativeGetPin(uint8_t pin);
+
+/**
+ * Lux returned by the VEML7700; negative makes begin() fail
+ */
+void nativeSetLux(float lux);
+
+/**
+ * Peak amplitude of the I2S test tone (0..1 of full scale) and its
+ * frequency
+ */
+void nativeSetAudio(float amplitude, float frequencyHz = 1000.0f);
+
+/**
+ * @return Last color shown on pixel 0, brightness applied (0xRRGGBB)
+ */
+uint32_t nativeShownPixel();
+
+/**
+ * @return Number of Adafruit_NeoPixel::show() calls
+ */
+uint32_t nativeShowCount();
+
+/**
+ * UART by number, as passed to the HardwareSerial constructor
+ */
+HardwareSerial& nativeSerialPort(int port);
+
+/**
+ * Move millis()/micros()/ticks forward without sleeping; delays still
+ * sleep in real time
+ */
+void nativeAdvanceClock(uint64_t us);
+
+#endif // NATIVE_HAL_H
@@ -0,0 +1,374 @@
+/**
+ * arduino_shim.cpp (native)
+ *
+ * Core Arduino types and functions: String, Print/Stream, the serial
+ * ports, IPAddress, time, GPIO and the ESP chip object.
+ */
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "native_hal.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <malloc.h>
+#include <thread>
+
+// ==================== STRING ====================
+
+static std::string formatInteger(unsigned long long magnitude, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    std::string digits;
+    do {
+        unsigned digit = magnitude % base;
+        digits += (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        magnitude /= base;
+    } while (magnitude);
+    if (negative) digits += '-';
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+static std::string formatSigned(long long number, unsigned char base) {
+    // Arduino prints negative numbers in other bases as two's complement
+    if (base != 10) return formatInteger((unsigned long long)(unsigned long)number, false, base);
+    unsigned long long magnitude = number < 0 ? 0ULL - (unsigned long long)number : (unsigned long long)number;
+    return formatInteger(magnitude, number < 0, base);
+}
+
+String::String(int number, unsigned char base) : value(formatSigned(number, base)) {}
+String::String(unsigned int number, unsigned char base) : value(formatInteger(number, false, base)) {}
+String::String(long number, unsigned char base) : value(formatSigned(number, base)) {}
+String::String(unsigned long number, unsigned char base) : value(formatInteger(number, false, base)) {}
+String::String(long long number, unsigned char base) : value(formatSigned(number, base)) {}
+String::String(unsigned long long number, unsigned char base) : value(formatInteger(number, false, base)) {}
+String::String(float number, unsigned int decimals) : String((double)number, decimals) {}
+
+String::String(double number, unsigned int decimals) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+    value = buffer;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t found = value.find(c, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String& text, unsigned int from) const {
+    size_t found = value.find(text.value, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t found = value.rfind(c);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from) const {
+    return from < value.size() ? String(value.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= value.size()) return String();
+    return String(value.substr(from, std::min<size_t>(to, value.size()) - from));
+}
+
+bool String::startsWith(const String& prefix) const {
+    return value.compare(0, prefix.value.size(), prefix.value) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return value.size() >= suffix.value.size() &&
+           value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+    return value.size() == other.value.size() &&
+           std::equal(value.begin(), value.end(), other.value.begin(),
+                      [](char a, char b) { return tolower((unsigned char)a) == tolower((unsigned char)b); });
+}
+
+void String::trim() {
+    size_t begin = value.find_first_not_of(" \t\r\n\f\v");
+    if (begin == std::string::npos) {
+        value.clear();
+        return;
+    }
+    size_t end = value.find_last_not_of(" \t\r\n\f\v");
+    value = value.substr(begin, end - begin + 1);
+}
+
+void String::toLowerCase() {
+    for (char& c : value) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (char& c : value) c = (char)toupper((unsigned char)c);
+}
+
+void String::replace(const String& from, const String& to) {
+    if (from.value.empty()) return;
+    size_t position = 0;
+    while ((position = value.find(from.value, position)) != std::string::npos) {
+        value.replace(position, from.value.size(), to.value);
+        position += to.value.size();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index < value.size()) value.erase(index, count);
+}
+
+long String::toInt() const { return strtol(value.c_str(), nullptr, 10); }
+float String::toFloat() const { return strtof(value.c_str(), nullptr); }
+double String::toDouble() const { return strtod(value.c_str(), nullptr); }
+
+// ==================== PRINT / STREAM ====================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written])) written++;
+    return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    if ((size_t)length < sizeof(stackBuffer)) return write((const uint8_t*)stackBuffer, length);
+
+    std::string heapBuffer(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuffer[0], heapBuffer.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heapBuffer.data(), length);
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        delay(1);
+    } while (millis() - start < timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = read();
+        if (c < 0) c = timedRead();  // Only wait when nothing is buffered
+        if (c < 0) break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String out;
+    int c;
+    while ((c = timedRead()) >= 0) out += (char)c;
+    return out;
+}
+
+// ==================== SERIAL ====================
+
+#define NATIVE_SERIAL_PORTS 4
+
+static HardwareSerial* serialPorts[NATIVE_SERIAL_PORTS];
+
+HardwareSerial Serial(0);
+
+HardwareSerial::HardwareSerial(int port) : port(port) {
+    if (port >= 0 && port < NATIVE_SERIAL_PORTS) serialPorts[port] = this;
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(lock);
+    return (int)rx.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (rx.empty()) return -1;
+    uint8_t c = rx.front();
+    rx.pop_front();
+    return c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> guard(lock);
+    return rx.empty() ? -1 : rx.front();
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (port == 0) {
+        fwrite(buffer, 1, size, stdout);
+        if (memchr(buffer, '\n', size)) fflush(stdout);
+        return size;
+    }
+
+    Responder respond;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        tx.insert(tx.end(), buffer, buffer + size);
+        respond = responder;
+    }
+    if (respond) respond(*this, buffer, size);
+    return size;
+}
+
+void HardwareSerial::inject(const uint8_t* data, size_t length) {
+    std::lock_guard<std::mutex> guard(lock);
+    rx.insert(rx.end(), data, data + length);
+}
+
+void HardwareSerial::setResponder(Responder responder) {
+    std::lock_guard<std::mutex> guard(lock);
+    this->responder = responder;
+}
+
+std::vector<uint8_t> HardwareSerial::takeWritten() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<uint8_t> out;
+    out.swap(tx);
+    return out;
+}
+
+HardwareSerial& nativeSerialPort(int port) {
+    if (port < 0 || port >= NATIVE_SERIAL_PORTS || !serialPorts[port]) {
+        fprintf(stderr, "native: serial port %d was never constructed\n", port);
+        abort();
+    }
+    return *serialPorts[port];
+}
+
+// ==================== IP ADDRESS ====================
+
+String IPAddress::toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+}
+
+bool IPAddress::fromString(const char* text) {
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+        return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+}
+
+// ==================== TIME ====================
+
+static const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+static std::atomic<uint64_t> clockOffsetUs(0);
+
+static uint64_t uptimeUs() {
+    auto elapsed = std::chrono::steady_clock::now() - processStart;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + clockOffsetUs.load();
+}
+
+void nativeAdvanceClock(uint64_t us) {
+    clockOffsetUs.fetch_add(us);
+}
+
+int64_t esp_timer_get_time() { return (int64_t)uptimeUs(); }
+unsigned long millis() { return (unsigned long)(uptimeUs() / 1000); }
+unsigned long micros() { return (unsigned long)uptimeUs(); }
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() { std::this_thread::yield(); }
+
+// The host clock is already synchronized
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2, const char* server3) {}
+
+bool getLocalTime(struct tm* info, uint32_t timeoutMs) {
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return info->tm_year > (2016 - 1900);
+}
+
+// ==================== GPIO ====================
+
+#define NATIVE_PIN_COUNT 64
+
+static std::atomic<int> pinLevels[NATIVE_PIN_COUNT];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < NATIVE_PIN_COUNT && mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+
+int digitalRead(uint8_t pin) { return pin < NATIVE_PIN_COUNT ? pinLevels[pin].load() : LOW; }
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin < NATIVE_PIN_COUNT) pinLevels[pin] = level ? HIGH : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) { return digitalRead(pin) ? 4095 : 0; }
+
+void nativeSetPin(uint8_t pin, int level) { digitalWrite(pin, level); }
+int nativeGetPin(uint8_t pin) { return digitalRead(pin); }
+
+int gpio_get_level(gpio_num_t pin) { return pin >= 0 ? digitalRead((uint8_t)pin) : 0; }
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    if (pin < 0) return ESP_ERR_INVALID_ARG;
+    digitalWrite((uint8_t)pin, level);
+    return ESP_OK;
+}
+
+long random(long max) { return max > 0 ? ::random() % max : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+void randomSeed(unsigned long seed) { srandom(seed); }
+
+TwoWire Wire;
+
+// ==================== CHIP ====================
+
+// ESP32-S3 internal heap available to the Arduino core
+#define NATIVE_HEAP_SIZE 327680u
+
+EspClass ESP;
+
+static std::atomic<uint32_t> minFreeHeap(NATIVE_HEAP_SIZE);
+
+uint32_t EspClass::getHeapSize() { return NATIVE_HEAP_SIZE; }
+
+// Heap figures track what the process has allocated against the device budget
+uint32_t EspClass::getFreeHeap() {
+    struct mallinfo2 info = mallinfo2();
+    uint32_t used = (uint32_t)std::min<size_t>(info.uordblks, NATIVE_HEAP_SIZE);
+    uint32_t free = NATIVE_HEAP_SIZE - used;
+
+    uint32_t lowest = minFreeHeap.load();
+    while (free < lowest && !minFreeHeap.compare_exchange_weak(lowest, free)) {
+    }
+    return free;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    getFreeHeap();
+    return minFreeHeap.load();
+}
+
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+
+void EspClass::restart() {
+    fprintf(stdout, "native: ESP.restart()\n");
+    fflush(stdout);
+    exit(3);
+}
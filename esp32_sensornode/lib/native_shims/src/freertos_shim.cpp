@@ -0,0 +1,335 @@
+/**
+ * freertos_shim.cpp (native)
+ *
+ * Tasks are detached std::threads that carry a NativeTask control block
+ * in thread-local storage; threads the shim did not create get one on
+ * first use. Blocking calls wait on condition variables with a tick
+ * (millisecond) timeout.
+ */
+
+#include "Arduino.h"
+#include "freertos/event_groups.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct NativeTask {
+    std::string name;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t stackDepth;
+
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifyCount = 0;
+};
+
+static thread_local NativeTask* currentTask = nullptr;
+
+// ==================== WAITING ====================
+
+// Wait on a condition with FreeRTOS timeout semantics: 0 polls, portMAX_DELAY blocks
+template <typename Predicate>
+static bool waitFor(std::condition_variable& condition, std::unique_lock<std::mutex>& guard,
+                    TickType_t timeout, Predicate ready) {
+    if (timeout == portMAX_DELAY) {
+        condition.wait(guard, ready);
+        return true;
+    }
+    return condition.wait_for(guard, std::chrono::milliseconds(timeout), ready);
+}
+
+// ==================== TASKS ====================
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+    NativeTask* task = new NativeTask();
+    task->name = name ? name : "";
+    task->priority = priority;
+    task->core = (core == 0 || core == 1) ? core : 0;
+    task->stackDepth = stackDepth;
+    if (handle) *handle = task;
+
+    std::thread([task, function, parameters]() {
+        currentTask = task;
+        pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+        function(parameters);
+        // FreeRTOS tasks must not return; treat it like vTaskDelete(NULL)
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameters, UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameters, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == currentTask) {
+        pthread_exit(nullptr);
+    }
+    // Another thread cannot be stopped safely on the host
+    fprintf(stderr, "native: vTaskDelete(%s) ignored, only self-delete is supported\n", task->name.c_str());
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (!currentTask) {
+        currentTask = new NativeTask();
+        currentTask->name = "native";
+        currentTask->priority = 1;
+        currentTask->core = 0;
+        currentTask->stackDepth = 0;
+    }
+    return currentTask;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    return &task->name[0];
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    return task->priority;
+}
+
+// Host stacks are 8 MB; report the requested depth as untouched
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    return task->stackDepth;
+}
+
+BaseType_t xPortGetCoreID() {
+    return xTaskGetCurrentTaskHandle()->core;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) std::this_thread::yield();
+    else delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    TickType_t wake = *previousWake + period;
+    int32_t remaining = (int32_t)(wake - xTaskGetTickCount());
+    if (remaining > 0) delay(remaining);
+    *previousWake = wake;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifyCount++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t timeout) {
+    NativeTask* self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(self->lock);
+    if (!waitFor(self->notified, guard, timeout, [self]() { return self->notifyCount > 0; })) {
+        return 0;
+    }
+    uint32_t count = self->notifyCount;
+    self->notifyCount = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+// ==================== QUEUES ====================
+
+struct NativeQueue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+    std::mutex lock;
+    std::condition_variable changed;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* queue = new NativeQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void* item, TickType_t timeout, bool front) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->changed, guard, timeout, [queue]() { return queue->items.size() < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    const uint8_t* bytes = (const uint8_t*)item;
+    std::vector<uint8_t> copy(bytes, bytes + queue->itemSize);
+    if (front) queue->items.push_front(std::move(copy));
+    else queue->items.push_back(std::move(copy));
+    guard.unlock();
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t timeout) {
+    return queueSend(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t timeout) {
+    return queueSend(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t timeout) {
+    return queueSend(queue, item, timeout, true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t queue, void* item, TickType_t timeout, bool remove) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->changed, guard, timeout, [queue]() { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    if (!remove) return pdTRUE;
+
+    queue->items.pop_front();
+    guard.unlock();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t timeout) {
+    return queueReceive(queue, item, timeout, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t timeout) {
+    return queueReceive(queue, item, timeout, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return (UBaseType_t)queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->length - (UBaseType_t)queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->items.clear();
+    }
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+// ==================== SEMAPHORES ====================
+
+struct NativeSemaphore {
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    std::mutex lock;
+    std::condition_variable released;
+};
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount) {
+    NativeSemaphore* semaphore = new NativeSemaphore();
+    semaphore->count = initialCount;
+    semaphore->maxCount = maxCount;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return createSemaphore(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return createSemaphore(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return createSemaphore(maxCount, initialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout) {
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    if (!waitFor(semaphore->released, guard, timeout, [semaphore]() { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count >= semaphore->maxCount) return pdFALSE;
+        semaphore->count++;
+    }
+    semaphore->released.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> guard(semaphore->lock);
+    return semaphore->count;
+}
+
+// ==================== EVENT GROUPS ====================
+
+struct NativeEventGroup {
+    EventBits_t bits = 0;
+    std::mutex lock;
+    std::condition_variable changed;
+};
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new NativeEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t value;
+    {
+        std::lock_guard<std::mutex> guard(group->lock);
+        group->bits |= bits;
+        value = group->bits;
+    }
+    group->changed.notify_all();
+    return value;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t timeout) {
+    std::unique_lock<std::mutex> guard(group->lock);
+    auto satisfied = [group, bits, waitForAll]() {
+        return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool ready = waitFor(group->changed, guard, timeout, satisfied);
+    EventBits_t value = group->bits;
+    if (ready && clearOnExit) group->bits &= ~bits;
+    return value;
+}
@@ -0,0 +1,31 @@
+/**
+ * native_main.cpp (native)
+ *
+ * Runs the sketch like the Arduino-ESP32 core: setup() then loop()
+ * forever on "loopTask" (core 1). Unit tests and the fleet simulator
+ * provide their own main(), so this one is left out when PIO_UNIT_TESTING
+ * or NATIVE_CUSTOM_MAIN is defined.
+ */
+
+#if !defined(PIO_UNIT_TESTING) && !defined(NATIVE_CUSTOM_MAIN)
+
+#include "Arduino.h"
+
+static void loopTask(void* parameters) {
+    setup();
+    while (true) {
+        loop();
+    }
+}
+
+int main() {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    TaskHandle_t handle;
+    xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, &handle, 1);
+    while (true) {
+        delay(1000);
+    }
+}
+
+#endif // !PIO_UNIT_TESTING && !NATIVE_CUSTOM_MAIN
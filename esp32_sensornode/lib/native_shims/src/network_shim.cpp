@@ -0,0 +1,626 @@
+/**
+ * network_shim.cpp (native)
+ *
+ * WiFi station state and events, TCP client, HTTP client and the
+ * notification WebServer over the host's sockets.
+ */
+
+#include "WiFi.h"
+#include "WiFiClient.h"
+#include "HTTPClient.h"
+#include "WebServer.h"
+#include "esp_wifi.h"
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// ==================== WIFI ====================
+
+WiFiClass WiFi;
+
+static std::mutex wifiLock;
+static wl_status_t wifiStatus = WL_DISCONNECTED;
+static std::vector<WiFiEventFuncCb> eventCallbacks;
+static wifi_config_t stationConfig = {};
+static wifi_ps_type_t powerSave = WIFI_PS_MIN_MODEM;
+
+// Events are delivered on their own thread, like the ESP32 sys_evt task.
+// The queue is never destroyed: exit() must not wait on its condition.
+struct EventQueue {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<std::pair<WiFiEvent_t, uint8_t>> pending;
+};
+
+static EventQueue& eventQueue() {
+    static EventQueue* queue = new EventQueue();
+    return *queue;
+}
+
+static void eventLoop() {
+    EventQueue& queue = eventQueue();
+    while (true) {
+        std::unique_lock<std::mutex> guard(queue.lock);
+        queue.ready.wait(guard, [&queue]() { return !queue.pending.empty(); });
+        std::pair<WiFiEvent_t, uint8_t> event = queue.pending.front();
+        queue.pending.pop_front();
+        guard.unlock();
+
+        std::vector<WiFiEventFuncCb> callbacks;
+        {
+            std::lock_guard<std::mutex> wifiGuard(wifiLock);
+            callbacks = eventCallbacks;
+        }
+        WiFiEventInfo_t info = {};
+        info.wifi_sta_disconnected.reason = event.second;
+        for (WiFiEventFuncCb callback : callbacks) callback(event.first, info);
+    }
+}
+
+void WiFiClass::raise(WiFiEvent_t event, uint8_t reason) {
+    static std::once_flag started;
+    std::call_once(started, []() { std::thread(eventLoop).detach(); });
+
+    {
+        std::lock_guard<std::mutex> guard(wifiLock);
+        if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) wifiStatus = WL_CONNECTED;
+        if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+            wifiStatus = WL_DISCONNECTED;
+        }
+    }
+    EventQueue& queue = eventQueue();
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.pending.push_back(std::make_pair(event, reason));
+    }
+    queue.ready.notify_one();
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* password, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+    this->ssid = ssid ? ssid : "";
+    if (connect) esp_wifi_connect();
+    return status();
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    if (status() == WL_CONNECTED) raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, 8);  // ASSOC_LEAVE
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    return esp_wifi_connect() == ESP_OK;
+}
+
+wl_status_t WiFiClass::status() {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    return wifiStatus;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    if (mode == WIFI_OFF) disconnect(true);
+    return true;
+}
+
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    return true;
+}
+
+int WiFiClass::onEvent(WiFiEventFuncCb callback, WiFiEvent_t event) {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    eventCallbacks.push_back(callback);
+    return (int)eventCallbacks.size();
+}
+
+IPAddress WiFiClass::localIP() {
+    IPAddress address(127, 0, 0, 1);
+    const char* configured = getenv("NATIVE_LOCAL_IP");
+    if (configured) address.fromString(configured);
+    return address;
+}
+
+int8_t WiFiClass::RSSI() {
+    return status() == WL_CONNECTED ? -55 : 0;
+}
+
+esp_err_t esp_wifi_connect() {
+    WiFi.raise(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    WiFi.raise(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* config) {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    *config = stationConfig;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config) {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    stationConfig = *config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    powerSave = type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type) {
+    std::lock_guard<std::mutex> guard(wifiLock);
+    *type = powerSave;
+    return ESP_OK;
+}
+
+// ==================== TCP CLIENT ====================
+
+static bool waitReadable(int fd, int timeoutMs) {
+    struct pollfd request = { fd, POLLIN, 0 };
+    return poll(&request, 1, timeoutMs) > 0;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) return 0;
+
+    int socketFd = socket(result->ai_family, result->ai_socktype | SOCK_CLOEXEC, result->ai_protocol);
+    if (socketFd < 0) {
+        freeaddrinfo(result);
+        return 0;
+    }
+
+    // Non-blocking connect so the timeout applies
+    fcntl(socketFd, F_SETFL, O_NONBLOCK);
+    int status = ::connect(socketFd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (status != 0 && errno == EINPROGRESS) {
+        struct pollfd request = { socketFd, POLLOUT, 0 };
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&request, 1, timeoutMs) > 0 &&
+            getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+            status = 0;
+        }
+    }
+    if (status != 0) {
+        ::close(socketFd);
+        return 0;
+    }
+    fcntl(socketFd, F_SETFL, 0);
+
+    fd = socketFd;
+    setNoDelay(true);
+    return 1;
+}
+
+// Pull whatever the socket has into the empty buffer; false on close or error
+bool WiFiClient::fill(int timeoutMs) {
+    if (fd < 0) return false;
+    if (rxStart < rxEnd) return true;
+    if (timeoutMs > 0 && !waitReadable(fd, timeoutMs)) return true;
+
+    ssize_t received = recv(fd, rxBuffer, sizeof(rxBuffer), MSG_DONTWAIT);
+    if (received > 0) {
+        rxStart = 0;
+        rxEnd = (size_t)received;
+        return true;
+    }
+    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+uint8_t WiFiClient::connected() {
+    if (rxStart < rxEnd) return 1;
+    return fill(0) ? 1 : 0;
+}
+
+void WiFiClient::stop() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    rxStart = rxEnd = 0;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+    int flag = noDelay ? 1 : 0;
+    if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+bool WiFiClient::waitForData(uint32_t timeoutMs) {
+    return fill((int)timeoutMs) && rxStart < rxEnd;
+}
+
+int WiFiClient::available() {
+    fill(0);
+    return (int)(rxEnd - rxStart);
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (!fill(0) || rxStart == rxEnd) return -1;
+    size_t count = std::min(size, rxEnd - rxStart);
+    memcpy(buffer, rxBuffer + rxStart, count);
+    rxStart += count;
+    return (int)count;
+}
+
+int WiFiClient::peek() {
+    if (!fill(0) || rxStart == rxEnd) return -1;
+    return rxBuffer[rxStart];
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    size_t sent = 0;
+    while (fd >= 0 && sent < size) {
+        ssize_t result = send(fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (result <= 0) {
+            stop();
+            break;
+        }
+        sent += result;
+    }
+    return sent;
+}
+
+// ==================== HTTP CLIENT ====================
+
+static bool parseUrl(const String& url, String& host, uint16_t& port, String& uri) {
+    // https: the WiFiClient passed to begin() does the TLS, as on the ESP32
+    bool tls = url.startsWith("https://");
+    if (!tls && !url.startsWith("http://")) return false;
+
+    String rest = url.substring(tls ? 8 : 7);
+    int slash = rest.indexOf('/');
+    String authority = slash < 0 ? rest : rest.substring(0, slash);
+    uri = slash < 0 ? String("/") : rest.substring(slash);
+
+    int colon = authority.indexOf(':');
+    host = colon < 0 ? authority : authority.substring(0, colon);
+    port = colon < 0 ? (tls ? 443 : 80) : (uint16_t)authority.substring(colon + 1).toInt();
+    return !host.isEmpty();
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+    String newHost;
+    uint16_t newPort;
+    if (!parseUrl(url, newHost, newPort, uri)) return false;
+
+    // Keep the open connection only for the same server
+    if (this->client && (this->client != &client || newHost != host || newPort != port)) {
+        this->client->stop();
+    }
+    this->client = &client;
+    host = newHost;
+    port = newPort;
+    headers.clear();
+    body.clear();
+    return true;
+}
+
+void HTTPClient::end() {
+    if (client && !(reuse && keepAlive)) client->stop();
+    headers.clear();
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+    for (auto& header : headers) {
+        if (header.first.equalsIgnoreCase(name)) {
+            header.second = value;
+            return;
+        }
+    }
+    headers.emplace_back(name, value);
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    collected.clear();
+    for (size_t i = 0; i < headerKeysCount; i++) collected.emplace_back(headerKeys[i], String());
+}
+
+String HTTPClient::header(const char* name) {
+    for (const auto& header : collected) {
+        if (header.first.equalsIgnoreCase(name)) return header.second;
+    }
+    return String();
+}
+
+int HTTPClient::GET() { return sendRequest("GET", nullptr, 0); }
+int HTTPClient::POST(const String& payload) { return sendRequest("POST", payload); }
+int HTTPClient::POST(uint8_t* payload, size_t size) { return sendRequest("POST", payload, size); }
+int HTTPClient::PUT(const String& payload) { return sendRequest("PUT", payload); }
+int HTTPClient::PUT(uint8_t* payload, size_t size) { return sendRequest("PUT", payload, size); }
+
+int HTTPClient::sendRequest(const char* method, const String& payload) {
+    return sendRequest(method, (uint8_t*)payload.c_str(), payload.length());
+}
+
+int HTTPClient::sendRequest(const char* method, uint8_t* payload, size_t size) {
+    if (!client) return HTTPC_ERROR_NOT_CONNECTED;
+    body.clear();
+
+    if (!client->connected() && !client->connect(host.c_str(), port, connectTimeoutMs)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    std::string request = std::string(method) + " " + uri.c_str() + " HTTP/1.1\r\n";
+    request += "Host: " + std::string(host.c_str()) + ":" + std::to_string(port) + "\r\n";
+    request += reuse ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    for (const auto& header : headers) {
+        request += std::string(header.first.c_str()) + ": " + header.second.c_str() + "\r\n";
+    }
+    if (payload && size > 0) request += "Content-Length: " + std::to_string(size) + "\r\n";
+    request += "\r\n";
+    if (payload && size > 0) request.append((const char*)payload, size);
+
+    if (client->write((const uint8_t*)request.data(), request.size()) != request.size()) {
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    return readResponse(method);
+}
+
+static uint32_t remainingMs(unsigned long start, uint32_t timeoutMs) {
+    unsigned long elapsed = millis() - start;
+    return elapsed < timeoutMs ? timeoutMs - elapsed : 0;
+}
+
+bool HTTPClient::readLine(std::string& line) {
+    line.clear();
+    unsigned long start = millis();
+    while (millis() - start < timeoutMs) {
+        int c = client->read();
+        if (c < 0) {
+            if (!client->waitForData(remainingMs(start, timeoutMs)) && !client->connected()) return false;
+            continue;
+        }
+        if (c == '\n') {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        line += (char)c;
+    }
+    return false;
+}
+
+int HTTPClient::readResponse(const char* method) {
+    std::string line;
+    if (!readLine(line)) {
+        client->stop();
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    int code = 0;
+    if (sscanf(line.c_str(), "HTTP/%*d.%*d %d", &code) != 1) {
+        client->stop();
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+
+    long contentLength = -1;
+    chunked = false;
+    keepAlive = true;
+    wire.clear();
+    for (auto& header : collected) header.second = String();
+    while (readLine(line) && !line.empty()) {
+        String header(line);
+        int colon = header.indexOf(':');
+        if (colon < 0) continue;
+        String name = header.substring(0, colon);
+        String value = header.substring(colon + 1);
+        value.trim();
+        for (auto& wanted : collected) {
+            if (wanted.first.equalsIgnoreCase(name)) wanted.second = value;
+        }
+        if (name.equalsIgnoreCase("Content-Length")) contentLength = value.toInt();
+        else if (name.equalsIgnoreCase("Transfer-Encoding")) chunked = value.equalsIgnoreCase("chunked");
+        else if (name.equalsIgnoreCase("Connection")) keepAlive = !value.equalsIgnoreCase("close");
+    }
+
+    auto readExactly = [this](size_t length) {
+        unsigned long start = millis();
+        uint8_t buffer[1024];
+        while (length > 0 && millis() - start < timeoutMs) {
+            int received = client->read(buffer, std::min(length, sizeof(buffer)));
+            if (received > 0) {
+                body.append((const char*)buffer, received);
+                length -= received;
+            } else if (!client->waitForData(remainingMs(start, timeoutMs)) && !client->connected()) {
+                break;
+            }
+        }
+        return length == 0;
+    };
+
+    size = (int)contentLength;
+    bool interim = (code >= 100 && code < 200);
+    bool complete = true;
+    if (strcmp(method, "HEAD") == 0 || interim || code == 204 || code == 304) {
+        // No body whatever the headers say
+        chunked = false;
+    } else if (chunked) {
+        while (readLine(line)) {
+            wire += line + "\r\n";
+            size_t chunk = strtoul(line.c_str(), nullptr, 16);
+            if (chunk == 0) {
+                readLine(line);
+                wire += "\r\n";
+                break;
+            }
+            complete = readExactly(chunk) && readLine(line);
+            if (!complete) break;
+            wire.append(body, body.size() - chunk, chunk);
+            wire += "\r\n";
+        }
+    } else if (contentLength >= 0) {
+        complete = readExactly((size_t)contentLength);
+    } else {
+        // No framing: the body runs to connection close
+        keepAlive = false;
+        while (readExactly(1)) {
+        }
+    }
+
+    if (!complete || !keepAlive || !reuse) client->stop();
+    return complete ? code : HTTPC_ERROR_CONNECTION_LOST;
+}
+
+String HTTPClient::getString() {
+    return String(body);
+}
+
+Stream* HTTPClient::getStreamPtr() {
+    bodyStream.reset(chunked ? &wire : &body);
+    return &bodyStream;
+}
+
+int HTTPClient::writeToStream(Stream* stream) {
+    if (!stream) return HTTPC_ERROR_NO_STREAM;
+    return (int)stream->write((const uint8_t*)body.data(), body.size());
+}
+
+// ==================== WEB SERVER ====================
+
+WebServer::~WebServer() {
+    close();
+}
+
+void WebServer::begin() {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int reuseAddress = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 8) != 0) {
+        fprintf(stderr, "native: WebServer cannot listen on port %d (%s)\n", port, strerror(errno));
+        ::close(listenFd);
+        listenFd = -1;
+    }
+}
+
+void WebServer::close() {
+    if (listenFd >= 0) ::close(listenFd);
+    listenFd = -1;
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler) {
+    routes.push_back({ uri, method, handler });
+}
+
+String WebServer::arg(const String& name) const {
+    return name == "plain" ? requestBody : String();
+}
+
+static HTTPMethod methodFromName(const String& name) {
+    if (name == "GET") return HTTP_GET;
+    if (name == "HEAD") return HTTP_HEAD;
+    if (name == "POST") return HTTP_POST;
+    if (name == "PUT") return HTTP_PUT;
+    if (name == "PATCH") return HTTP_PATCH;
+    if (name == "DELETE") return HTTP_DELETE;
+    if (name == "OPTIONS") return HTTP_OPTIONS;
+    return HTTP_ANY;
+}
+
+void WebServer::handleClient() {
+    if (listenFd < 0 || !waitReadable(listenFd, 0)) return;
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    current.reset(new WiFiClient(fd));
+    std::string request;
+    char buffer[1024];
+
+    // Read until the end of the headers, then the declared body
+    size_t headerEnd = std::string::npos;
+    unsigned long start = millis();
+    while (headerEnd == std::string::npos && millis() - start < 2000) {
+        if (!waitReadable(fd, 100)) continue;
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        request.append(buffer, received);
+        headerEnd = request.find("\r\n\r\n");
+    }
+    if (headerEnd == std::string::npos) {
+        current.reset();
+        return;
+    }
+
+    String head(request.substr(0, headerEnd));
+    int lineEnd = head.indexOf("\r\n");
+    String requestLine = lineEnd < 0 ? head : head.substring(0, lineEnd);
+    int firstSpace = requestLine.indexOf(' ');
+    int secondSpace = requestLine.indexOf(' ', firstSpace + 1);
+    requestMethod = methodFromName(requestLine.substring(0, firstSpace));
+    requestUri = requestLine.substring(firstSpace + 1, secondSpace);
+
+    size_t declared = 0;
+    String lowerHead = head;
+    lowerHead.toLowerCase();
+    int lengthAt = lowerHead.indexOf("content-length:");
+    if (lengthAt >= 0) declared = (size_t)head.substring(lengthAt + 15).toInt();
+
+    std::string body = request.substr(headerEnd + 4);
+    while (body.size() < declared && millis() - start < 2000) {
+        if (!waitReadable(fd, 100)) continue;
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        body.append(buffer, received);
+    }
+    requestBody = String(body);
+    contentLength = -1;
+
+    bool handled = false;
+    for (const Route& route : routes) {
+        if (route.uri == requestUri && (route.method == HTTP_ANY || route.method == requestMethod)) {
+            route.handler();
+            handled = true;
+            break;
+        }
+    }
+    if (!handled) {
+        if (notFound) notFound();
+        else send(404, "text/plain", "Not found");
+    }
+
+    current.reset();
+    requestBody = String();
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    if (!current) return;
+    long length = contentLength >= 0 ? contentLength : (long)content.length();
+
+    char header[256];
+    int headerLength = snprintf(header, sizeof(header),
+                                "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %ld\r\nConnection: close\r\n\r\n",
+                                code, code < 400 ? "OK" : "Error", contentType ? contentType : "text/plain", length);
+    current->write((const uint8_t*)header, headerLength);
+    if (content.length() > 0) current->write((const uint8_t*)content.c_str(), content.length());
+}
+
+void WebServer::sendContent(const char* content, size_t length) {
+    if (current) current->write((const uint8_t*)content, length);
+}
@@ -0,0 +1,212 @@
+/**
+ * peripheral_shim.cpp (native)
+ *
+ * NVS, the VEML7700, the NeoPixel, the I2S microphone and deep sleep,
+ * with their test hooks from native_hal.h.
+ */
+
+#include "Arduino.h"
+#include "Preferences.h"
+#include "Adafruit_VEML7700.h"
+#include "Adafruit_NeoPixel.h"
+#include "driver/i2s.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "native_hal.h"
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+// ==================== PREFERENCES ====================
+
+typedef std::map<std::string, std::vector<uint8_t>> NativeNamespace;
+
+static std::mutex nvsLock;
+static std::map<std::string, NativeNamespace> nvs;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+    if (!name || strlen(name) > 15) return false;  // NVS key length limit
+    this->name = name;
+    this->readOnly = readOnly;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    if (!opened || readOnly) return false;
+    std::lock_guard<std::mutex> guard(nvsLock);
+    nvs[name.c_str()].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!opened || readOnly) return false;
+    std::lock_guard<std::mutex> guard(nvsLock);
+    return nvs[name.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!opened) return false;
+    std::lock_guard<std::mutex> guard(nvsLock);
+    NativeNamespace& space = nvs[name.c_str()];
+    return space.find(key) != space.end();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!opened || readOnly || !key || strlen(key) > 15) return 0;
+    const uint8_t* bytes = (const uint8_t*)value;
+    std::lock_guard<std::mutex> guard(nvsLock);
+    nvs[name.c_str()][key] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+    return putBytes(key, value.c_str(), value.length() + 1) ? value.length() : 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!opened) return 0;
+    std::lock_guard<std::mutex> guard(nvsLock);
+    NativeNamespace& space = nvs[name.c_str()];
+    auto entry = space.find(key);
+    return entry == space.end() ? 0 : entry->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    if (!opened) return 0;
+    std::lock_guard<std::mutex> guard(nvsLock);
+    NativeNamespace& space = nvs[name.c_str()];
+    auto entry = space.find(key);
+    if (entry == space.end() || entry->second.size() > maxLength) return 0;
+    memcpy(buffer, entry->second.data(), entry->second.size());
+    return entry->second.size();
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    size_t length = getBytesLength(key);
+    if (length == 0) return defaultValue;
+    std::vector<char> text(length);
+    getBytes(key, text.data(), length);
+    return String(text.data());
+}
+
+// ==================== LIGHT SENSOR ====================
+
+static std::atomic<float> simulatedLux(250.0f);
+
+void nativeSetLux(float lux) {
+    simulatedLux = lux;
+}
+
+bool Adafruit_VEML7700::begin(TwoWire* wire) {
+    enabled = simulatedLux.load() >= 0;
+    return enabled;
+}
+
+float Adafruit_VEML7700::readLux() {
+    return enabled ? simulatedLux.load() : 0.0f;
+}
+
+// ==================== NEOPIXEL ====================
+
+static std::atomic<uint32_t> shownPixel(0);
+static std::atomic<uint32_t> showCount(0);
+
+void Adafruit_NeoPixel::show() {
+    uint32_t color = pixels.empty() ? 0 : pixels[0];
+    uint32_t scaled = 0;
+    for (int shift = 0; shift <= 16; shift += 8) {
+        uint32_t channel = (color >> shift) & 0xFF;
+        scaled |= ((channel * (brightness + 1)) >> 8) << shift;  // Same scaling as setBrightness()
+    }
+    shownPixel = scaled;
+    showCount++;
+}
+
+uint32_t nativeShownPixel() { return shownPixel.load(); }
+uint32_t nativeShowCount() { return showCount.load(); }
+
+// ==================== I2S ====================
+
+static std::atomic<float> audioAmplitude(0.01f);
+static std::atomic<float> audioFrequency(1000.0f);
+
+static bool i2sInstalled = false;
+static uint32_t i2sSampleRate = 16000;
+static uint64_t i2sSamples = 0;
+static int64_t i2sStartUs = 0;
+
+void nativeSetAudio(float amplitude, float frequencyHz) {
+    audioAmplitude = amplitude;
+    audioFrequency = frequencyHz;
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int queueSize, void* queue) {
+    if (i2sInstalled || config->sample_rate == 0) return ESP_ERR_INVALID_STATE;
+    i2sInstalled = true;
+    i2sSampleRate = config->sample_rate;
+    i2sSamples = 0;
+    i2sStartUs = esp_timer_get_time();
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+    i2sInstalled = false;
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins) {
+    return i2sInstalled ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_read(i2s_port_t port, void* destination, size_t size, size_t* bytesRead, TickType_t timeout) {
+    if (!i2sInstalled) return ESP_ERR_INVALID_STATE;
+
+    int32_t* samples = (int32_t*)destination;
+    size_t count = size / sizeof(int32_t);
+    float amplitude = audioAmplitude.load() * 2147483647.0f;
+    float step = 2.0f * (float)M_PI * audioFrequency.load() / i2sSampleRate;
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int32_t)(amplitude * sinf(step * (float)(i2sSamples + i)));
+    }
+    i2sSamples += count;
+
+    // Block until the DMA would have captured these samples
+    int64_t readyUs = i2sStartUs + (int64_t)(i2sSamples * 1000000ULL / i2sSampleRate);
+    int64_t waitUs = readyUs - esp_timer_get_time();
+    if (waitUs > 0) delayMicroseconds((uint32_t)waitUs);
+
+    *bytesRead = count * sizeof(int32_t);
+    return ESP_OK;
+}
+
+// ==================== SLEEP ====================
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    const char* cause = getenv("NATIVE_WAKE_CAUSE");
+    if (!cause) return ESP_SLEEP_WAKEUP_UNDEFINED;
+    if (strcmp(cause, "timer") == 0) return ESP_SLEEP_WAKEUP_TIMER;
+    if (strcmp(cause, "ext0") == 0) return ESP_SLEEP_WAKEUP_EXT0;
+    return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+    printf("native: timer wakeup in %llu us\n", (unsigned long long)timeUs);
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level) {
+    printf("native: ext0 wakeup on GPIO %d level %d\n", (int)pin, level);
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    printf("native: deep sleep\n");
+    fflush(stdout);
+    exit(0);
+}
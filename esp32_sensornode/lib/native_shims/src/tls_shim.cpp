@@ -0,0 +1,395 @@
+/**
+ * tls_shim.cpp (native)
+ *
+ * The mbedTLS client subset on OpenSSL. Records go through a BIO that
+ * calls the send and receive callbacks set with mbedtls_ssl_set_bio(), so
+ * TlsClient drives the socket exactly as on the device.
+ */
+
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include <mutex>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ==================== PEM ====================
+
+// Appends like mbedtls_x509_crt_parse() does for a chain
+static int appendPem(char** pem, const unsigned char* buf, size_t buflen) {
+    size_t length = strnlen((const char*)buf, buflen);
+    size_t previous = *pem ? strlen(*pem) : 0;
+    char* joined = (char*)realloc(*pem, previous + length + 2);
+    if (!joined) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    memcpy(joined + previous, buf, length);
+    joined[previous + length] = '\n';
+    joined[previous + length + 1] = '\0';
+    *pem = joined;
+    return 0;
+}
+
+static BIO* pemBio(const char* pem) {
+    return BIO_new_mem_buf(pem, -1);
+}
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt* crt) {
+    crt->pem = nullptr;
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* chain, const unsigned char* buf, size_t buflen) {
+    BIO* bio = BIO_new_mem_buf(buf, (int)strnlen((const char*)buf, buflen));
+    X509* cert = bio ? PEM_read_bio_X509(bio, nullptr, nullptr, nullptr) : nullptr;
+    BIO_free(bio);
+    if (!cert) return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    X509_free(cert);
+    return appendPem(&chain->pem, buf, buflen);
+}
+
+void mbedtls_x509_crt_free(mbedtls_x509_crt* crt) {
+    free(crt->pem);
+    crt->pem = nullptr;
+}
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx) {
+    ctx->pem = nullptr;
+}
+
+int mbedtls_pk_parse_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen,
+                         const unsigned char* pwd, size_t pwdlen) {
+    (void)pwd;
+    (void)pwdlen;
+    BIO* bio = BIO_new_mem_buf(key, (int)strnlen((const char*)key, keylen));
+    EVP_PKEY* parsed = bio ? PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr) : nullptr;
+    BIO_free(bio);
+    if (!parsed) return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+    EVP_PKEY_free(parsed);
+    free(ctx->pem);
+    ctx->pem = nullptr;
+    return appendPem(&ctx->pem, key, keylen);
+}
+
+void mbedtls_pk_free(mbedtls_pk_context* ctx) {
+    free(ctx->pem);
+    ctx->pem = nullptr;
+}
+
+// ==================== RANDOM ====================
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) {
+    ctx->unused = 0;
+}
+
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx) {
+    (void)ctx;
+}
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+    (void)data;
+    return RAND_bytes(output, (int)len) == 1 ? 0 : -1;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) {
+    ctx->seeded = 0;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+                          void* p_entropy, const unsigned char* custom, size_t len) {
+    (void)f_entropy;
+    (void)p_entropy;
+    (void)custom;
+    (void)len;
+    ctx->seeded = 1;
+    return 0;
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len) {
+    return mbedtls_entropy_func(p_rng, output, output_len);
+}
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx) {
+    ctx->seeded = 0;
+}
+
+// ==================== CONFIG ====================
+
+static std::mutex configLock;  // Connections of a pool set up concurrently
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf) {
+    memset(conf, 0, sizeof(*conf));
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset) {
+    (void)endpoint;
+    (void)transport;
+    (void)preset;
+    conf->authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
+    return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode) {
+    conf->authmode = authmode;
+}
+
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config* conf, mbedtls_x509_crt* ca_chain, void* ca_crl) {
+    (void)ca_crl;
+    conf->ca_chain = ca_chain;
+}
+
+int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config* conf, mbedtls_x509_crt* own_cert, mbedtls_pk_context* pk_key) {
+    conf->own_cert = own_cert;
+    conf->own_key = pk_key;
+    return 0;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+    (void)conf;
+    (void)f_rng;
+    (void)p_rng;
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf) {
+    SSL_CTX_free(conf->handle);
+    conf->handle = nullptr;
+}
+
+static bool loadCertificates(SSL_CTX* ctx, const mbedtls_ssl_config* conf) {
+    if (conf->ca_chain && conf->ca_chain->pem) {
+        X509_STORE* store = SSL_CTX_get_cert_store(ctx);
+        BIO* bio = pemBio(conf->ca_chain->pem);
+        X509* cert;
+        while ((cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) != nullptr) {
+            X509_STORE_add_cert(store, cert);
+            X509_free(cert);
+        }
+        ERR_clear_error();  // End of the PEM text
+        BIO_free(bio);
+    }
+    if (!conf->own_cert || !conf->own_cert->pem || !conf->own_key || !conf->own_key->pem) return true;
+
+    BIO* bio = pemBio(conf->own_cert->pem);
+    X509* leaf = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    bool loaded = leaf && SSL_CTX_use_certificate(ctx, leaf) == 1;
+    X509_free(leaf);
+    X509* intermediate;
+    while (loaded && (intermediate = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) != nullptr) {
+        SSL_CTX_add_extra_chain_cert(ctx, intermediate);  // Takes ownership
+    }
+    ERR_clear_error();
+    BIO_free(bio);
+
+    bio = pemBio(conf->own_key->pem);
+    EVP_PKEY* key = PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
+    loaded = loaded && key && SSL_CTX_use_PrivateKey(ctx, key) == 1 && SSL_CTX_check_private_key(ctx) == 1;
+    EVP_PKEY_free(key);
+    BIO_free(bio);
+    return loaded;
+}
+
+static SSL_CTX* configContext(const mbedtls_ssl_config* conf) {
+    std::lock_guard<std::mutex> lock(configLock);
+    if (conf->handle) return conf->handle;
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx) return nullptr;
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);  // mbedTLS 2.28 on the ESP32
+    SSL_CTX_set_verify(ctx, conf->authmode == MBEDTLS_SSL_VERIFY_NONE ? SSL_VERIFY_NONE : SSL_VERIFY_PEER,
+                       nullptr);
+    if (!loadCertificates(ctx, conf)) {
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+    // The handle is filled in on first use, as mbedTLS would finish its setup
+    const_cast<mbedtls_ssl_config*>(conf)->handle = ctx;
+    return ctx;
+}
+
+// ==================== BIO ====================
+
+static int bioWrite(BIO* bio, const char* data, int length) {
+    mbedtls_ssl_context* ssl = (mbedtls_ssl_context*)BIO_get_data(bio);
+    int result = ssl->f_send(ssl->p_bio, (const unsigned char*)data, (size_t)length);
+    if (result < 0) ssl->bio_error = result;
+    return result < 0 ? -1 : result;
+}
+
+static int bioRead(BIO* bio, char* data, int length) {
+    mbedtls_ssl_context* ssl = (mbedtls_ssl_context*)BIO_get_data(bio);
+    int result = ssl->f_recv(ssl->p_bio, (unsigned char*)data, (size_t)length);
+    if (result < 0) ssl->bio_error = result;
+    return result < 0 ? -1 : result;
+}
+
+static long bioControl(BIO* bio, int command, long num, void* ptr) {
+    (void)bio;
+    (void)num;
+    (void)ptr;
+    return command == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+static BIO_METHOD* callbackMethod() {
+    static BIO_METHOD* method = [] {
+        BIO_METHOD* created = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "mbedtls bio");
+        BIO_meth_set_write(created, bioWrite);
+        BIO_meth_set_read(created, bioRead);
+        BIO_meth_set_ctrl(created, bioControl);
+        return created;
+    }();
+    return method;
+}
+
+// ==================== SESSIONS ====================
+
+static void describeSession(SSL_SESSION* handle, mbedtls_ssl_session* session) {
+    unsigned int idLength = 0;
+    const unsigned char* id = SSL_SESSION_get_id(handle, &idLength);
+    session->id_len = idLength < sizeof(session->id) ? idLength : sizeof(session->id);
+    memcpy(session->id, id, session->id_len);
+    memset(session->master, 0, sizeof(session->master));
+    SSL_SESSION_get_master_key(handle, session->master, sizeof(session->master));
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session) {
+    memset(session, 0, sizeof(*session));
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session) {
+    SSL_SESSION_free(session->handle);
+    memset(session, 0, sizeof(*session));
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session) {
+    SSL_SESSION* handle = ssl->handle ? SSL_get1_session(ssl->handle) : nullptr;
+    if (!handle) return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    SSL_SESSION_free(session->handle);
+    session->handle = handle;
+    describeSession(handle, session);
+    return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session) {
+    if (!ssl->handle || !session->handle) return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    return SSL_set_session(ssl->handle, session->handle) == 1 ? 0 : MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+}
+
+const mbedtls_ssl_session* mbedtls_ssl_get_session_pointer(const mbedtls_ssl_context* ssl) {
+    return ssl->handle ? &ssl->session : nullptr;
+}
+
+// ==================== CONNECTION ====================
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+static int openConnection(mbedtls_ssl_context* ssl) {
+    SSL_CTX* ctx = configContext(ssl->conf);
+    if (!ctx) return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    ssl->handle = SSL_new(ctx);
+    if (!ssl->handle) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+
+    BIO* bio = BIO_new(callbackMethod());
+    if (!bio) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    BIO_set_data(bio, ssl);
+    BIO_set_init(bio, 1);
+    SSL_set_bio(ssl->handle, bio, bio);
+    return 0;
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf) {
+    ssl->conf = conf;
+    return openConnection(ssl);
+}
+
+int mbedtls_ssl_session_reset(mbedtls_ssl_context* ssl) {
+    SSL_free(ssl->handle);
+    ssl->handle = nullptr;
+    ssl->hostname[0] = '\0';
+    ssl->bio_error = 0;
+    mbedtls_ssl_session_init(&ssl->session);
+    return openConnection(ssl);
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname) {
+    if (strlen(hostname) >= sizeof(ssl->hostname)) return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    strcpy(ssl->hostname, hostname);
+    SSL_set_tlsext_host_name(ssl->handle, ssl->hostname);
+    if (ssl->conf->authmode != MBEDTLS_SSL_VERIFY_NONE) SSL_set1_host(ssl->handle, ssl->hostname);
+    return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+                         mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout) {
+    (void)f_recv_timeout;
+    ssl->p_bio = p_bio;
+    ssl->f_send = f_send;
+    ssl->f_recv = f_recv;
+}
+
+// OpenSSL's outcome as the mbedTLS error the firmware logs and handles
+static int translateError(mbedtls_ssl_context* ssl, int result) {
+    int error = SSL_get_error(ssl->handle, result);
+    ERR_clear_error();
+    switch (error) {
+        case SSL_ERROR_WANT_READ:
+            return MBEDTLS_ERR_SSL_WANT_READ;
+        case SSL_ERROR_WANT_WRITE:
+            return MBEDTLS_ERR_SSL_WANT_WRITE;
+        case SSL_ERROR_ZERO_RETURN:
+            return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+        case SSL_ERROR_SYSCALL:
+            return ssl->bio_error ? ssl->bio_error : MBEDTLS_ERR_SSL_CONN_EOF;
+        default:
+            if (ssl->bio_error) return ssl->bio_error;
+            return MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE;
+    }
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl) {
+    ssl->bio_error = 0;
+    int result = SSL_connect(ssl->handle);
+    if (result != 1) {
+        if (SSL_get_verify_result(ssl->handle) != X509_V_OK) {
+            ERR_clear_error();
+            return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        }
+        return translateError(ssl, result);
+    }
+    SSL_SESSION* negotiated = SSL_get_session(ssl->handle);
+    if (negotiated) describeSession(negotiated, &ssl->session);
+    return 0;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len) {
+    ssl->bio_error = 0;
+    int result = SSL_read(ssl->handle, buf, (int)len);
+    return result > 0 ? result : translateError(ssl, result);
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len) {
+    ssl->bio_error = 0;
+    int result = SSL_write(ssl->handle, buf, (int)len);
+    return result > 0 ? result : translateError(ssl, result);
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl) {
+    return ssl->handle ? (size_t)SSL_pending(ssl->handle) : 0;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl) {
+    ssl->bio_error = 0;
+    int result = SSL_shutdown(ssl->handle);  // Sends ours; the peer's is not waited for
+    return result >= 0 ? 0 : translateError(ssl, result);
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl) {
+    SSL_free(ssl->handle);
+    memset(ssl, 0, sizeof(*ssl));
+}
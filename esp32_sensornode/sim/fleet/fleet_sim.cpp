@@ -0,0 +1,763 @@
+/**
+ * fleet_sim.cpp (native, pio run -e fleet)
+ *
+ * Runs many virtual desks in one process against a real CSE or
+ * tools/fake_cse.py and reports requests/s, latency percentiles and error
+ * rates for each fleet size:
+ *
+ *   .pio/build/fleet/program --host 127.0.0.1 --nodes 10,50,100,200 --json fleet.json
+ *
+ * Every desk has its own OneM2MPaths (Desk001, Desk002, ...), its own
+ * OneM2MClient keep-alive pool, and reports with the firmware's update
+ * payload builders and report_policy.h thresholds on the job periods
+ * from config.h. Desk jobs run on a virtual clock --speed times
+ * faster than wall time, so one simulated desk offers the load of --speed
+ * real desks over a single connection.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "onem2m.h"
+#include "metrics.h"
+#include "diagnostics.h"
+#include "report_policy.h"
+#include "task_plan.h"
+#include "sensor_traces.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock SteadyClock;
+
+// ==================== OPTIONS ====================
+
+struct SimOptions {
+    String host = "127.0.0.1";
+    int port = CSE_PORT;
+    String cseName = CSE_NAME;
+    String aeName = AE_NAME;
+    String roomName = ROOM_CONTAINER;
+    std::vector<int> nodeCounts = {10, 25, 50, 100, 200};
+    double speed = 10.0;            // Virtual seconds per wall second
+    unsigned warmupSeconds = 5;     // Boot burst, excluded from the results
+    unsigned durationSeconds = 30;  // Measured wall time per step
+    unsigned startHour = 9;         // Virtual time of day at the start of each step
+    uint32_t seed = 1;
+    double maxErrorRate = 1.0;      // Stop the sweep once a step exceeds this
+    bool provision = true;
+    String jsonPath;
+};
+
+// ==================== REQUEST SAMPLES ====================
+
+enum RequestKind : uint8_t {
+    REQ_PROVISION,
+    REQ_LUX,
+    REQ_AUDIO,
+    REQ_OCCUPANCY,
+    REQ_LAMP,
+    REQ_STATS,
+    REQ_SUMMARY,
+    REQ_METRICS,
+    REQ_DIAGNOSTICS,
+    REQ_KIND_COUNT
+};
+
+static const char* const REQUEST_KIND_NAMES[REQ_KIND_COUNT] = {
+    "provision", "lux", "audio", "occupancy", "lamp", "stats", "summary", "metrics", "diagnostics"
+};
+
+struct RequestSample {
+    uint32_t startMs;    // Wall time since the step started
+    uint32_t latencyUs;
+    int16_t status;      // HTTP status, -1 on transport errors
+    uint8_t kind;
+};
+
+// ==================== VIRTUAL CLOCK ====================
+
+/**
+ * Shared clock and stop signal of one sweep step
+ */
+class StepControl {
+public:
+    explicit StepControl(double speed) : origin(SteadyClock::now()), speed(speed) {}
+
+    unsigned long virtualMillis() const {
+        return (unsigned long)(wallMillis() * speed);
+    }
+
+    double wallMillis() const {
+        return std::chrono::duration<double, std::milli>(SteadyClock::now() - origin).count();
+    }
+
+    /**
+     * Sleep until a virtual time
+     * @return false if the step ended first
+     */
+    bool sleepUntil(unsigned long virtualMs) {
+        auto wakeAt = origin + std::chrono::duration_cast<SteadyClock::duration>(
+            std::chrono::duration<double, std::milli>(virtualMs / speed));
+        std::unique_lock<std::mutex> lock(mutex);
+        return !wake.wait_until(lock, wakeAt, [this] { return stopping.load(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+    }
+
+    const SteadyClock::time_point origin;
+    const double speed;
+
+private:
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+};
+
+// ==================== VIRTUAL DESK ====================
+
+class VirtualNode {
+public:
+    VirtualNode(int index, const SimOptions& options) : index(index), options(options) {
+        char deskName[16];
+        snprintf(deskName, sizeof(deskName), "Desk%03d", index + 1);
+        paths.initialize(options.host.c_str(), options.port, options.cseName.c_str(),
+                         options.aeName.c_str(), options.roomName.c_str(), deskName, LUX_DEVICE_NAME);
+        client.begin();
+    }
+
+    /**
+     * Create the desk's resources (the PHASE_RESOURCES part of the
+     * firmware's tree, without announcements); 409 counts as created
+     */
+    bool provision();
+
+    /**
+     * Run the desk's sensor jobs until the step stops
+     */
+    void run(StepControl& step);
+
+    bool provisioned = false;
+    std::vector<RequestSample> samples;
+    uint32_t maxLagMs = 0;   // Wall time a job started after its due time
+    uint32_t overruns = 0;   // Jobs that started a whole period late
+
+private:
+    typedef void (VirtualNode::*JobFunction)(unsigned long now);
+
+    struct SimJob {
+        unsigned long period;
+        unsigned long next;
+        JobFunction run;
+    };
+
+    bool send(RequestKind kind, const char* method, const String& path, const JsonDocument* body,
+              int resourceType, int& statusCode);
+    bool create(const String& parentPath, int resourceType, const JsonDocument& doc);
+    bool publishRecord(const char* kind, const JsonDocument& record);
+
+    // putFlex() on this desk's client
+    bool put(RequestKind kind, const String& path, const JsonDocument& doc) {
+        int statusCode;
+        send(kind, "PUT", path, &doc, 0, statusCode);
+        return (statusCode == 200 || statusCode == 204);
+    }
+
+    void luxJob(unsigned long now);
+    void audioJob(unsigned long now);
+    void occupancyJob(unsigned long now);
+    void profilerJob(unsigned long now);
+    void wifiJob(unsigned long now);
+
+    const int index;
+    const SimOptions& options;
+    OneM2MPaths paths;
+    OneM2MClient client;
+    StepControl* step = nullptr;
+
+    // Sensor job state, reset for every step like a reboot
+    std::unique_ptr<SensorTraces> traces;
+    OccupancyTracker occupancy;
+    WindowAggregator<float> luxSummary;
+    WindowAggregator<float> audioSummary;
+    WindowAggregator<bool> occupancySummary;
+    float lastReportedLux = -1;
+    float lastReportedAudio = -1;
+    bool firstOccupancy = true;
+    bool occupied = false;
+    bool lastReportedOccupied = false;
+    bool lampOn = false;
+
+    // Counters behind the desk's own metrics FlexContainer
+    uint32_t requestCount = 0;
+    uint32_t transportErrors = 0;
+    uint32_t clientErrors = 0;
+    uint32_t serverErrors = 0;
+    std::vector<uint32_t> windowLatencyMs;
+};
+
+bool VirtualNode::send(RequestKind kind, const char* method, const String& path, const JsonDocument* body,
+                       int resourceType, int& statusCode) {
+    SteadyClock::time_point start = SteadyClock::now();
+    bool received = client.request(method, paths.BASE_URL, path, body, resourceType, nullptr, statusCode);
+    SteadyClock::time_point end = SteadyClock::now();
+
+    RequestSample sample;
+    sample.startMs = step ? (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(start - step->origin).count() : 0;
+    sample.latencyUs = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    sample.status = received ? statusCode : -1;
+    sample.kind = kind;
+    samples.push_back(sample);
+
+    requestCount++;
+    if (!received) transportErrors++;
+    else if (statusCode >= 500) serverErrors++;
+    else if (statusCode >= 400) clientErrors++;
+    windowLatencyMs.push_back(sample.latencyUs / 1000);
+    return received;
+}
+
+// ==================== PROVISIONING ====================
+
+bool VirtualNode::create(const String& parentPath, int resourceType, const JsonDocument& doc) {
+    int statusCode = -1;
+    send(REQ_PROVISION, "POST", parentPath, &doc, resourceType, statusCode);
+    return (statusCode == 201 || statusCode == 409);
+}
+
+static void addSimAccessControl(JsonObject resource, const SimOptions& options) {
+    JsonArray acpi = resource.createNestedArray("acpi");
+    acpi.add(options.cseName + "/acpMoodMonitor");
+}
+
+static JsonObject beginContainer(JsonDocument& doc, const char* name, const SimOptions& options,
+                                 uint32_t maxBytes, uint16_t maxInstances) {
+    JsonObject cnt = doc.createNestedObject("m2m:cnt");
+    cnt["rn"] = name;
+    addSimAccessControl(cnt, options);
+    cnt["mbs"] = maxBytes;
+    cnt["mni"] = maxInstances;
+    return cnt;
+}
+
+bool VirtualNode::provision() {
+    typedef MioOccupancySensor Occ;
+    String deskName = paths.DESK_PATH.substring(paths.ROOM_PATH.length() + 1);
+    String lampPath = paths.DESK_PATH + "/lamp";
+    bool ok = true;
+
+    {
+        DynamicJsonDocument doc(512);
+        beginContainer(doc, options.roomName.c_str(), options, 10000, 10);
+        ok = create(paths.AE_PATH, ONEM2M_RT_CONTAINER, doc) && ok;
+    }
+    {
+        DynamicJsonDocument doc(512);
+        beginContainer(doc, deskName.c_str(), options, 10000, 10);
+        ok = ok && create(paths.ROOM_PATH, ONEM2M_RT_CONTAINER, doc);
+    }
+    if (!ok) return false;
+
+    DynamicJsonDocument doc(1024);
+    JsonObject flex = beginFlexCreate<MioLuxSensor>(doc, LUX_DEVICE_NAME);
+    addSimAccessControl(flex, options);
+    writeFlex<MioLuxSensor>(flex, flexField<MioLuxSensor::lux>(0.0f));
+    ok = create(paths.DESK_PATH, ONEM2M_RT_FLEXCONTAINER, doc) && ok;
+
+    doc.clear();
+    flex = beginFlexCreate<AcousticSensor>(doc, AUDIO_DEVICE_NAME);
+    addSimAccessControl(flex, options);
+    writeFlex<AcousticSensor>(flex, flexField<AcousticSensor::louds>(0.0f));
+    ok = create(paths.DESK_PATH, ONEM2M_RT_FLEXCONTAINER, doc) && ok;
+
+    doc.clear();
+    flex = beginFlexCreate<MioAcousticSummary>(doc, AUDIO_SUMMARY_NAME);
+    addSimAccessControl(flex, options);
+    ok = create(paths.DESK_PATH, ONEM2M_RT_FLEXCONTAINER, doc) && ok;
+
+    doc.clear();
+    flex = beginFlexCreate<Occ>(doc, OCCUPANCY_DEVICE_NAME);
+    addSimAccessControl(flex, options);
+    writeFlex<Occ>(flex,
+                   flexField<Occ::occ>(false),
+                   flexField<Occ::ivl>(OCCUPANCY_STATS_INTERVAL / 1000));
+    ok = create(paths.DESK_PATH, ONEM2M_RT_FLEXCONTAINER, doc) && ok;
+
+    doc.clear();
+    flex = beginFlexCreate<DeviceLight>(doc, "lamp");
+    addSimAccessControl(flex, options);
+    bool lamp = create(paths.DESK_PATH, ONEM2M_RT_FLEXCONTAINER, doc);
+    ok = lamp && ok;
+
+    if (lamp) {
+        doc.clear();
+        flex = beginFlexCreate<BinarySwitch>(doc, "binarySwitch");
+        addSimAccessControl(flex, options);
+        writeFlex<BinarySwitch>(flex, flexField<BinarySwitch::state>(false));
+        ok = create(lampPath, ONEM2M_RT_FLEXCONTAINER, doc) && ok;
+    }
+
+    doc.clear();
+    beginContainer(doc, DIAGNOSTICS_CONTAINER, options, 100000, 50);
+    ok = create(paths.DESK_PATH, ONEM2M_RT_CONTAINER, doc) && ok;
+
+    doc.clear();
+    flex = beginFlexCreate<MioNodeMetrics>(doc, METRICS_CONTAINER);
+    addSimAccessControl(flex, options);
+    ok = create(paths.DESK_PATH, ONEM2M_RT_FLEXCONTAINER, doc) && ok;
+
+    provisioned = ok;
+    return ok;
+}
+
+// ==================== SENSOR JOBS ====================
+// Mirror luxSensorJob, audioSensorJob, occupancySensorJob and the profiler
+// and WiFi reports with the readings taken from SensorTraces
+
+void VirtualNode::luxJob(unsigned long now) {
+    float lux = traces->lux(now, lampOn);
+    StaticJsonDocument<256> doc;
+
+    luxSummary.sample(lux);
+    bool windowClosed = luxSummary.windowDue(now);
+    if (windowClosed) {
+        buildLuxSummaryPayload(doc, luxSummary.peek(now));
+        if (put(REQ_SUMMARY, paths.DEVICE_PATH, doc)) luxSummary.restart(now);
+        doc.clear();
+    }
+
+    if (!changeReportable(lux, lastReportedLux, LUX_THRESHOLD) ||
+        !(SENSOR_CHANGE_REPORTS || windowClosed || lastReportedLux < 0)) {
+        return;
+    }
+    buildLuxPayload(doc, lux);
+    if (put(REQ_LUX, paths.DEVICE_PATH, doc)) {
+        lastReportedLux = lux;
+    }
+}
+
+void VirtualNode::audioJob(unsigned long now) {
+    float level = traces->audioLevel(occupied);
+    StaticJsonDocument<256> doc;
+
+    audioSummary.sample(level);
+    bool windowClosed = audioSummary.windowDue(now);
+    if (windowClosed) {
+        buildAudioSummaryPayload(doc, audioSummary.peek(now));
+        if (put(REQ_SUMMARY, paths.DESK_PATH + "/" + AUDIO_SUMMARY_NAME, doc)) audioSummary.restart(now);
+        doc.clear();
+    }
+
+    if (!changeReportable(level, lastReportedAudio, AUDIO_THRESHOLD) ||
+        !(SENSOR_CHANGE_REPORTS || windowClosed || lastReportedAudio < 0)) {
+        return;
+    }
+    buildAudioPayload(doc, level);
+    if (put(REQ_AUDIO, paths.DESK_PATH + "/" + AUDIO_DEVICE_NAME, doc)) {
+        lastReportedAudio = level;
+    }
+}
+
+void VirtualNode::occupancyJob(unsigned long now) {
+    String occPath = paths.DESK_PATH + "/" + OCCUPANCY_DEVICE_NAME;
+    StaticJsonDocument<256> doc;
+
+    occupied = traces->occupied(now);
+    if (firstOccupancy) {
+        occupancy.begin(now);
+        occupancySummary.begin(now);
+    }
+    occupancy.sample(occupied, now);
+    occupancySummary.sample(occupied);
+
+    if (firstOccupancy || occupied != lastReportedOccupied) {
+        buildOccupancyPayload(doc, occupied);
+        if (put(REQ_OCCUPANCY, occPath, doc)) {
+            lastReportedOccupied = occupied;
+            #if SYNC_OCCUPANCY_TO_LAMP
+            doc.clear();
+            buildLampSwitchPayload(doc, occupied);
+            if (put(REQ_LAMP, paths.DESK_PATH + "/lamp/binarySwitch", doc)) {
+                lampOn = occupied;
+            }
+            #endif
+        }
+        firstOccupancy = false;
+    }
+
+    if (occupancy.windowDue(now)) {
+        doc.clear();
+        buildOccupancyStatsPayload(doc, occupancy.peek(now));
+        if (put(REQ_STATS, occPath, doc)) occupancy.restart(now);
+    }
+
+    if (occupancySummary.windowDue(now)) {
+        doc.clear();
+        buildOccupancySummaryPayload(doc, occupancySummary.peek(now));
+        if (put(REQ_SUMMARY, occPath, doc)) occupancySummary.restart(now);
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)ceil(q * sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+bool VirtualNode::publishRecord(const char* kind, const JsonDocument& record) {
+    String content;
+    serializeJson(record, content);
+
+    DynamicJsonDocument doc(content.length() + 256);
+    JsonObject cin = doc.createNestedObject("m2m:cin");
+    cin["cnf"] = "application/json:0";
+    cin["con"] = content;
+    JsonArray lbl = cin.createNestedArray("lbl");
+    lbl.add(String("diag:") + kind);
+
+    int statusCode;
+    send(REQ_DIAGNOSTICS, "POST", paths.DESK_PATH + "/" + DIAGNOSTICS_CONTAINER, &doc,
+         ONEM2M_RT_CONTENT_INSTANCE, statusCode);
+    return statusCode == 201;
+}
+
+void VirtualNode::profilerJob(unsigned long now) {
+    typedef MioNodeMetrics M;
+
+    DynamicJsonDocument record(2048);
+    record["up"] = now / 1000;
+    record["heap"] = 180000;
+    JsonArray tasks = record.createNestedArray("tasks");
+    for (int i = 0; i < TASK_COUNT; i++) {
+        JsonObject task = tasks.createNestedObject();
+        task["n"] = TASK_PLAN[i].name;
+        task["p"] = TASK_PLAN[i].priority;
+        task["stk"] = TASK_PLAN[i].stackSize / 4;
+        task["c"] = TASK_PLAN[i].core;
+        task["lat"] = 0;
+        task["latMax"] = 1;
+    }
+    publishRecord("tasks", record);
+
+    std::vector<uint32_t> window;
+    window.swap(windowLatencyMs);
+    std::sort(window.begin(), window.end());
+    StaticJsonDocument<256> doc;
+    writeFlexUpdate<M>(doc,
+                       flexField<M::upt>((uint32_t)(now / 1000)),
+                       flexField<M::ivl>((uint32_t)(TASK_PROFILE_INTERVAL / 1000)),
+                       flexField<M::rqc>(requestCount),
+                       flexField<M::rqt>(transportErrors),
+                       flexField<M::rq4>(clientErrors),
+                       flexField<M::rq5>(serverErrors),
+                       flexField<M::l50>(percentile(window, 0.50)),
+                       flexField<M::l90>(percentile(window, 0.90)),
+                       flexField<M::l99>(percentile(window, 0.99)),
+                       flexField<M::lmx>(window.empty() ? 0 : window.back()));
+    put(REQ_METRICS, paths.DESK_PATH + "/" + METRICS_CONTAINER, doc);
+}
+
+void VirtualNode::wifiJob(unsigned long now) {
+    StaticJsonDocument<512> record;
+    record["channel"] = 6;
+    record["attempts"] = 1;
+    record["fastConnects"] = 1;
+    record["fullScans"] = 0;
+    record["reconnects"] = 0;
+    JsonArray rssi = record.createNestedArray("rssi");
+    for (int i = 0; i < 8; i++) {
+        rssi.add(-55 - (int)((now / 1000 + i + index) % 7));
+    }
+    publishRecord("wifi", record);
+}
+
+void VirtualNode::run(StepControl& control) {
+    step = &control;
+    samples.clear();
+    maxLagMs = 0;
+    overruns = 0;
+
+    traces.reset(new SensorTraces(options.seed * 7919 + index, options.startHour * 3600000UL));
+    occupancy = OccupancyTracker();
+    luxSummary = WindowAggregator<float>();  // Windows start at virtual 0 like a boot
+    audioSummary = WindowAggregator<float>();
+    occupancySummary = WindowAggregator<bool>();
+    lastReportedLux = -1;
+    lastReportedAudio = -1;
+    firstOccupancy = true;
+    occupied = false;
+    lastReportedOccupied = false;
+    lampOn = false;
+
+    // Desks boot at different times; jobs within a desk share the sample grid
+    unsigned long phase = (unsigned long)(((options.seed + 1) * 2654435761UL * (index + 1)) % PM_SAMPLE_ALIGN_MS);
+    SimJob jobs[] = {
+        { LUX_UPDATE_INTERVAL,       phase,                         &VirtualNode::luxJob },
+        { AUDIO_UPDATE_INTERVAL,     phase,                         &VirtualNode::audioJob },
+        { OCCUPANCY_UPDATE_INTERVAL, phase + 2000,                  &VirtualNode::occupancyJob },
+        { TASK_PROFILE_INTERVAL,     phase + TASK_PROFILE_INTERVAL, &VirtualNode::profilerJob },
+        { WIFI_REPORT_INTERVAL,      phase + WIFI_REPORT_INTERVAL,  &VirtualNode::wifiJob },
+    };
+
+    while (true) {
+        SimJob* job = &jobs[0];
+        for (SimJob& candidate : jobs) {
+            if (candidate.next < job->next) job = &candidate;
+        }
+        if (!control.sleepUntil(job->next)) break;
+
+        unsigned long now = control.virtualMillis();
+        unsigned long lag = now > job->next ? now - job->next : 0;
+        maxLagMs = std::max(maxLagMs, (uint32_t)(lag / control.speed));
+        if (lag >= job->period) overruns++;
+
+        (this->*job->run)(now);
+
+        // Fixed rate; slots missed while blocked on the CSE are skipped
+        now = control.virtualMillis();
+        do {
+            job->next += job->period;
+        } while (job->next <= now);
+    }
+    step = nullptr;
+}
+
+// ==================== RESULTS ====================
+
+struct KindResult {
+    uint32_t requests = 0;
+    uint32_t errors = 0;
+    std::vector<uint32_t> latencyUs;
+};
+
+static double toMs(uint32_t us) {
+    return us / 1000.0;
+}
+
+static void writeLatency(JsonObject out, std::vector<uint32_t>& sortedUs) {
+    out["p50"] = toMs(percentile(sortedUs, 0.50));
+    out["p90"] = toMs(percentile(sortedUs, 0.90));
+    out["p99"] = toMs(percentile(sortedUs, 0.99));
+    out["max"] = toMs(sortedUs.empty() ? 0 : sortedUs.back());
+}
+
+/**
+ * Summarize the measured window of one step
+ * @return Error rate of the step
+ */
+static double summarizeStep(const std::vector<std::unique_ptr<VirtualNode>>& nodes, int nodeCount,
+                            const SimOptions& options, JsonObject out) {
+    uint32_t fromMs = options.warmupSeconds * 1000;
+    uint32_t toMsLimit = fromMs + options.durationSeconds * 1000;
+
+    KindResult total;
+    KindResult kinds[REQ_KIND_COUNT];
+    uint32_t transport = 0, client = 0, server = 0;
+    uint32_t maxLag = 0, overruns = 0;
+
+    for (int i = 0; i < nodeCount; i++) {
+        const VirtualNode& node = *nodes[i];
+        maxLag = std::max(maxLag, node.maxLagMs);
+        overruns += node.overruns;
+        for (const RequestSample& sample : node.samples) {
+            if (sample.startMs < fromMs || sample.startMs >= toMsLimit) continue;
+
+            bool failed = sample.status < 200 || sample.status >= 300;
+            if (sample.status <= 0) transport++;
+            else if (sample.status >= 500) server++;
+            else if (sample.status >= 400) client++;
+
+            for (KindResult* result : { &total, &kinds[sample.kind] }) {
+                result->requests++;
+                if (failed) result->errors++;
+                result->latencyUs.push_back(sample.latencyUs);
+            }
+        }
+    }
+
+    double errorRate = total.requests ? (double)total.errors / total.requests : 0.0;
+    double requestsPerSecond = total.requests / (double)options.durationSeconds;
+    std::sort(total.latencyUs.begin(), total.latencyUs.end());
+
+    out["nodes"] = nodeCount;
+    out["virtual_desks"] = nodeCount * options.speed;
+    out["requests"] = total.requests;
+    out["requests_per_s"] = requestsPerSecond;
+    writeLatency(out.createNestedObject("latency_ms"), total.latencyUs);
+    JsonObject errors = out.createNestedObject("errors");
+    errors["transport"] = transport;
+    errors["4xx"] = client;
+    errors["5xx"] = server;
+    out["error_rate"] = errorRate;
+    out["max_lag_ms"] = maxLag;
+    out["overruns"] = overruns;
+
+    JsonObject byKind = out.createNestedObject("by_kind");
+    for (int k = 0; k < REQ_KIND_COUNT; k++) {
+        if (kinds[k].requests == 0) continue;
+        std::sort(kinds[k].latencyUs.begin(), kinds[k].latencyUs.end());
+        JsonObject kind = byKind.createNestedObject(REQUEST_KIND_NAMES[k]);
+        kind["requests"] = kinds[k].requests;
+        kind["errors"] = kinds[k].errors;
+        writeLatency(kind.createNestedObject("latency_ms"), kinds[k].latencyUs);
+    }
+
+    Serial.printf("%6d %8.1f %9.2f %9.2f %9.2f %9.2f %6u %6u %6u %6.2f%% %8u\n",
+                  nodeCount, requestsPerSecond,
+                  toMs(percentile(total.latencyUs, 0.50)), toMs(percentile(total.latencyUs, 0.90)),
+                  toMs(percentile(total.latencyUs, 0.99)), toMs(total.latencyUs.empty() ? 0 : total.latencyUs.back()),
+                  transport, client, server, 100.0 * errorRate, maxLag);
+    return errorRate;
+}
+
+// ==================== SWEEP ====================
+
+static bool provisionNodes(std::vector<std::unique_ptr<VirtualNode>>& nodes, int nodeCount) {
+    std::vector<std::thread> threads;
+    std::atomic<int> failed(0);
+    std::atomic<uint32_t> requests(0);
+    SteadyClock::time_point start = SteadyClock::now();
+
+    for (int i = 0; i < nodeCount; i++) {
+        if (nodes[i]->provisioned) continue;
+        threads.emplace_back([&, i] {
+            if (!nodes[i]->provision()) failed++;
+            requests += nodes[i]->samples.size();
+        });
+    }
+    if (threads.empty()) return true;
+    for (std::thread& thread : threads) thread.join();
+
+    double seconds = std::chrono::duration<double>(SteadyClock::now() - start).count();
+    Serial.printf("Provisioned %u desks in %.2f s (%u requests, %d failed)\n",
+                  (unsigned)threads.size(), seconds, (unsigned)requests.load(), failed.load());
+    return failed == 0;
+}
+
+static void runStep(std::vector<std::unique_ptr<VirtualNode>>& nodes, int nodeCount, const SimOptions& options) {
+    StepControl control(options.speed);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nodeCount; i++) {
+        threads.emplace_back([&, i] { nodes[i]->run(control); });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.warmupSeconds + options.durationSeconds));
+    control.stop();
+    // Desks finish the request in flight; its sample falls after the window
+    for (std::thread& thread : threads) thread.join();
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        String arg = argv[i];
+        if (arg == "--no-provision") {
+            options.provision = false;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        String value = argv[++i];
+
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = value.toInt();
+        else if (arg == "--cse") options.cseName = value;
+        else if (arg == "--ae") options.aeName = value;
+        else if (arg == "--room") options.roomName = value;
+        else if (arg == "--speed") options.speed = value.toFloat();
+        else if (arg == "--warmup") options.warmupSeconds = value.toInt();
+        else if (arg == "--duration") options.durationSeconds = value.toInt();
+        else if (arg == "--start-hour") options.startHour = value.toInt() % 24;
+        else if (arg == "--seed") options.seed = value.toInt();
+        else if (arg == "--max-error-rate") options.maxErrorRate = value.toFloat();
+        else if (arg == "--json") options.jsonPath = value;
+        else if (arg == "--nodes") {
+            options.nodeCounts.clear();
+            int start = 0;
+            while (start < (int)value.length()) {
+                int comma = value.indexOf(',', start);
+                if (comma < 0) comma = value.length();
+                int count = value.substring(start, comma).toInt();
+                if (count > 0) options.nodeCounts.push_back(count);
+                start = comma + 1;
+            }
+        } else {
+            return false;
+        }
+    }
+    std::sort(options.nodeCounts.begin(), options.nodeCounts.end());
+    return !options.nodeCounts.empty() && options.speed > 0 && options.durationSeconds > 0;
+}
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--host H] [--port P] [--cse NAME] [--ae NAME] [--room NAME]\n"
+                "          [--nodes 10,25,50] [--speed X] [--warmup S] [--duration S]\n"
+                "          [--start-hour H] [--seed N] [--max-error-rate R] [--json FILE] [--no-provision]\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<VirtualNode>> nodes;
+    for (int i = 0; i < options.nodeCounts.back(); i++) {
+        nodes.emplace_back(new VirtualNode(i, options));
+        nodes.back()->provisioned = !options.provision;
+    }
+
+    Serial.printf("Fleet against http://%s:%d/%s, %.1fx speed, %us warmup + %us per step\n",
+                  options.host.c_str(), options.port, options.cseName.c_str(),
+                  options.speed, options.warmupSeconds, options.durationSeconds);
+
+    DynamicJsonDocument report(16384 + 4096 * options.nodeCounts.size());
+    report["cse"] = String("http://") + options.host + ":" + String(options.port) + "/" + options.cseName;
+    report["speed"] = options.speed;
+    report["warmup_s"] = options.warmupSeconds;
+    report["duration_s"] = options.durationSeconds;
+    JsonArray steps = report.createNestedArray("steps");
+
+    bool header = false;
+    for (int nodeCount : options.nodeCounts) {
+        if (!provisionNodes(nodes, nodeCount)) {
+            Serial.println("Provisioning failed; measuring anyway");
+        }
+        runStep(nodes, nodeCount, options);
+
+        if (!header) {
+            Serial.printf("%6s %8s %9s %9s %9s %9s %6s %6s %6s %7s %8s\n", "nodes", "req/s", "p50 ms",
+                          "p90 ms", "p99 ms", "max ms", "xport", "4xx", "5xx", "errors", "lag ms");
+            header = true;
+        }
+        double errorRate = summarizeStep(nodes, nodeCount, options, steps.createNestedObject());
+        if (errorRate > options.maxErrorRate) {
+            Serial.printf("Error rate %.1f%% above --max-error-rate, stopping\n", 100.0 * errorRate);
+            break;
+        }
+    }
+
+    if (options.jsonPath.length()) {
+        String json;
+        serializeJson(report, json);
+        FILE* file = fopen(options.jsonPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        fputs(json.c_str(), file);
+        fputc('\n', file);
+        fclose(file);
+    }
+    return 0;
+}
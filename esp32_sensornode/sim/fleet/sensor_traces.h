@@ -0,0 +1,119 @@
+/**
+ * sensor_traces.h (fleet simulator)
+ *
+ * Synthetic readings for one virtual desk, sampled on the node's virtual
+ * clock: occupancy as alternating sessions and absences, daylight plus
+ * desk lamp for lux, ambient noise plus speech while occupied for audio.
+ * Every desk draws from its own seeded generator, so a run is repeatable.
+ */
+
+#ifndef SENSOR_TRACES_H
+#define SENSOR_TRACES_H
+
+#include <Arduino.h>
+#include <math.h>
+#include <random>
+
+#define SIM_DAY_MS 86400000UL
+
+// Mean session and absence lengths during working hours
+#define SIM_SESSION_MEAN_MS (40UL * 60000)
+#define SIM_ABSENCE_MEAN_MS (25UL * 60000)
+#define SIM_WORK_START_HOUR 7
+#define SIM_WORK_END_HOUR 19
+
+class SensorTraces {
+public:
+    /**
+     * @param seed Per-desk seed
+     * @param startOfDayMs Virtual time of day at clock zero
+     */
+    SensorTraces(uint32_t seed, unsigned long startOfDayMs)
+        : rng(seed), startOfDay(startOfDayMs) {
+        cloud = uniform(0.6, 1.0);
+        deskLight = uniform(0.5, 1.2);
+        nextToggle = exponential(SIM_ABSENCE_MEAN_MS / 2);  // Desks fill up gradually
+    }
+
+    /**
+     * Occupancy at virtual time now; sessions only start in working hours
+     */
+    bool occupied(unsigned long now) {
+        while (now >= nextToggle) {
+            bool working = isWorkingHours(nextToggle);
+            if (!present && working) {
+                present = true;
+                nextToggle += exponential(SIM_SESSION_MEAN_MS);
+            } else if (present) {
+                present = false;
+                nextToggle += exponential(working ? SIM_ABSENCE_MEAN_MS : 4 * SIM_ABSENCE_MEAN_MS);
+            } else {
+                nextToggle += exponential(SIM_ABSENCE_MEAN_MS);
+            }
+        }
+        return present;
+    }
+
+    /**
+     * Daylight through the window with drifting cloud cover, plus the desk
+     * lamp while occupied (SYNC_OCCUPANCY_TO_LAMP)
+     */
+    float lux(unsigned long now, bool lampOn) {
+        double hour = hourOfDay(now);
+        double daylight = 0;
+        if (hour > 6 && hour < 20) {
+            daylight = 650.0 * sin(M_PI * (hour - 6) / 14.0);
+        }
+        cloud += 0.02 * (0.8 - cloud) + normal(0, 0.015);
+        cloud = fmin(fmax(cloud, 0.2), 1.0);
+
+        double value = daylight * cloud + (lampOn ? 320.0 * deskLight : 0) + normal(0, 0.6);
+        return (float)fmax(value, 0);
+    }
+
+    /**
+     * Sound level in dB SPL; conversation bursts while occupied
+     */
+    float audioLevel(bool isOccupied) {
+        double level = 34.0 + normal(0, 0.8);
+        if (isOccupied) {
+            if (uniform(0, 1) < 0.3) talking = !talking;
+            level = talking ? 58.0 + normal(0, 4.0) : 41.0 + normal(0, 1.5);
+        } else {
+            talking = false;
+        }
+        return (float)level;
+    }
+
+private:
+    double hourOfDay(unsigned long now) const {
+        return ((startOfDay + now) % SIM_DAY_MS) / 3600000.0;
+    }
+
+    bool isWorkingHours(unsigned long now) const {
+        double hour = hourOfDay(now);
+        return hour >= SIM_WORK_START_HOUR && hour < SIM_WORK_END_HOUR;
+    }
+
+    double uniform(double low, double high) {
+        return std::uniform_real_distribution<double>(low, high)(rng);
+    }
+
+    double normal(double mean, double deviation) {
+        return std::normal_distribution<double>(mean, deviation)(rng);
+    }
+
+    unsigned long exponential(unsigned long mean) {
+        return (unsigned long)std::exponential_distribution<double>(1.0 / mean)(rng) + 1;
+    }
+
+    std::mt19937 rng;
+    unsigned long startOfDay;
+    unsigned long nextToggle = 0;
+    bool present = false;
+    bool talking = false;
+    double cloud;
+    double deskLight;
+};
+
+#endif // SENSOR_TRACES_H
@@ -0,0 +1,225 @@
+/**
+ * pipeline_bench.cpp (native, pio run -e pipeline)
+ *
+ * Times batches of oneM2M requests on one connection at each pipeline
+ * depth, against tools/fake_cse.py with its RTT relay:
+ *
+ *   python tools/fake_cse.py --port 8081 --no-verify --rtt 0 &
+ *   .pio/build/pipeline/program --rtt 10,50,100 --depths 1,2,4,8 --json pipeline.json
+ *
+ * The round trip is switched per step through /__fake/faults. Two
+ * batches run at every step: "independent" creates contentInstances in
+ * one container, as a reading replay does; "chain" creates containers,
+ * each followed by a contentInstance that depends on it, as provisioning
+ * does. Depth 1 is the lockstep request() path.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "onem2m.h"
+#include <memory>
+#include <vector>
+
+#define PIPELINE_BENCH_CONTAINER "pipelineBench"
+
+// ==================== OPTIONS ====================
+
+struct BenchOptions {
+    String host = "127.0.0.1";
+    int port = CSE_PORT;
+    std::vector<int> rtts = {10, 50, 100};
+    std::vector<int> depths = {1, 2, 4, 8};
+    int requests = 64;
+    String jsonPath;
+};
+
+static bool parseList(const String& value, std::vector<int>& list) {
+    list.clear();
+    int start = 0;
+    while (start < (int)value.length()) {
+        int comma = value.indexOf(',', start);
+        if (comma < 0) comma = value.length();
+        list.push_back(value.substring(start, comma).toInt());
+        start = comma + 1;
+    }
+    return !list.empty();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        String arg = argv[i];
+        String value = argv[i + 1];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = value.toInt();
+        else if (arg == "--rtt") { if (!parseList(value, options.rtts)) return false; }
+        else if (arg == "--depths") { if (!parseList(value, options.depths)) return false; }
+        else if (arg == "--requests") options.requests = value.toInt();
+        else if (arg == "--json") options.jsonPath = value;
+        else return false;
+    }
+    return (argc % 2 == 1) && options.requests >= 2;
+}
+
+// ==================== CSE ====================
+
+static OneM2MClient client(1);  // One connection: the pool is not what is measured
+
+static bool control(const char* command, const JsonDocument* body) {
+    int statusCode;
+    String path = String("/__fake/") + command;
+    client.request("POST", onem2mPaths.BASE_URL, path, body, 0, nullptr, statusCode);
+    return statusCode == 200;
+}
+
+static bool setRtt(int rttMs) {
+    StaticJsonDocument<64> faults;
+    faults["rtt"] = rttMs;
+    return control("faults", &faults);
+}
+
+// Fresh tree with the container the independent batch writes to
+static bool resetTree() {
+    if (!control("reset", nullptr)) return false;
+
+    StaticJsonDocument<128> doc;
+    doc["m2m:cnt"]["rn"] = PIPELINE_BENCH_CONTAINER;
+    int statusCode;
+    client.request("POST", onem2mPaths.BASE_URL, onem2mPaths.AE_PATH, &doc, ONEM2M_RT_CONTAINER, nullptr, statusCode);
+    return statusCode == 201;
+}
+
+// ==================== BATCHES ====================
+
+struct Batch {
+    std::unique_ptr<StaticJsonDocument<128>[]> docs;
+    std::vector<String> paths;
+    std::vector<OneM2MBatchEntry> entries;
+};
+
+static void buildIndependent(Batch& batch, int count) {
+    batch.docs.reset(new StaticJsonDocument<128>[count]);
+    batch.paths.assign(1, onem2mPaths.AE_PATH + "/" PIPELINE_BENCH_CONTAINER);
+    batch.entries.clear();
+    for (int i = 0; i < count; i++) {
+        batch.docs[i]["m2m:cin"]["con"] = i;
+        batch.entries.push_back({"POST", &batch.paths[0], &batch.docs[i], ONEM2M_RT_CONTENT_INSTANCE,
+                                 nullptr, -1, 0});
+    }
+}
+
+static void buildChain(Batch& batch, int count) {
+    count -= count % 2;
+    batch.docs.reset(new StaticJsonDocument<128>[count]);
+    batch.paths.clear();
+    batch.paths.reserve(count);  // Entries point into it
+    batch.entries.clear();
+    for (int i = 0; i < count; i += 2) {
+        String name = "chain" + String(i / 2);
+        batch.docs[i]["m2m:cnt"]["rn"] = name;
+        batch.paths.push_back(onem2mPaths.AE_PATH);
+        batch.entries.push_back({"POST", &batch.paths.back(), &batch.docs[i], ONEM2M_RT_CONTAINER, nullptr, -1, 0});
+
+        batch.docs[i + 1]["m2m:cin"]["con"] = i;
+        batch.paths.push_back(onem2mPaths.AE_PATH + "/" + name);
+        batch.entries.push_back({"POST", &batch.paths.back(), &batch.docs[i + 1], ONEM2M_RT_CONTENT_INSTANCE,
+                                 nullptr, i, 0});
+    }
+}
+
+struct StepResult {
+    double ms;
+    int failures;
+};
+
+static StepResult runBatch(Batch& batch) {
+    unsigned long start = micros();
+    client.pipeline(onem2mPaths.BASE_URL, batch.entries.data(), batch.entries.size());
+    StepResult result;
+    result.ms = (micros() - start) / 1000.0;
+    result.failures = 0;
+    for (const OneM2MBatchEntry& entry : batch.entries) {
+        if (entry.statusCode != 201) result.failures++;
+    }
+    return result;
+}
+
+// ==================== MAIN ====================
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--host H] [--port P] [--rtt 10,50,100] [--depths 1,2,4,8]\n"
+                "          [--requests N] [--json FILE]\n",
+                argv[0]);
+        return 2;
+    }
+
+    onem2mPaths.initialize(options.host.c_str(), options.port, CSE_NAME, AE_NAME, ROOM_CONTAINER,
+                           DESK_CONTAINER, LUX_DEVICE_NAME);
+    if (!client.begin() || !setRtt(0)) {
+        fprintf(stderr, "No fake CSE with --rtt at %s\n", onem2mPaths.BASE_URL.c_str());
+        return 1;
+    }
+
+    DynamicJsonDocument report(4096 + 256 * options.rtts.size() * options.depths.size());
+    report["cse"] = onem2mPaths.BASE_URL;
+    report["requests"] = options.requests;
+    JsonArray steps = report.createNestedArray("steps");
+
+    Serial.printf("%6s %6s %14s %10s %14s %10s %6s\n", "rtt ms", "depth", "independent ms", "req/s",
+                  "chain ms", "req/s", "fails");
+    int totalFailures = 0;
+    Batch batch;
+    for (int rtt : options.rtts) {
+        for (int depth : options.depths) {
+            client.setPipelineDepth(depth);
+            if (!setRtt(0) || !resetTree() || !setRtt(rtt)) {
+                fprintf(stderr, "Fake CSE control failed\n");
+                return 1;
+            }
+
+            buildIndependent(batch, options.requests);
+            StepResult independent = runBatch(batch);
+            size_t independentCount = batch.entries.size();
+            buildChain(batch, options.requests);
+            StepResult chain = runBatch(batch);
+            size_t chainCount = batch.entries.size();
+
+            int failures = independent.failures + chain.failures;
+            totalFailures += failures;
+            double independentRate = independentCount * 1000.0 / independent.ms;
+            double chainRate = chainCount * 1000.0 / chain.ms;
+            Serial.printf("%6d %6d %14.1f %10.1f %14.1f %10.1f %6d\n", rtt, depth, independent.ms,
+                          independentRate, chain.ms, chainRate, failures);
+
+            JsonObject step = steps.createNestedObject();
+            step["rtt_ms"] = rtt;
+            step["depth"] = depth;
+            step["independent_ms"] = serialized(String(independent.ms, 1));
+            step["independent_rps"] = serialized(String(independentRate, 1));
+            step["chain_ms"] = serialized(String(chain.ms, 1));
+            step["chain_rps"] = serialized(String(chainRate, 1));
+            step["failures"] = failures;
+        }
+    }
+    setRtt(0);
+    report["pipelining"] = client.pipeliningEnabled();
+
+    if (options.jsonPath.length()) {
+        String json;
+        serializeJson(report, json);
+        FILE* file = fopen(options.jsonPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        fputs(json.c_str(), file);
+        fputc('\n', file);
+        fclose(file);
+    }
+    return totalFailures == 0 ? 0 : 1;
+}
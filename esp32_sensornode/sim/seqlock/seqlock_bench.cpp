@@ -0,0 +1,207 @@
+/**
+ * seqlock_bench.cpp (native, pio run -e seqlock)
+ *
+ * Read cost of the sensor snapshot under contention: reader threads call
+ * getSensorSnapshot() in a loop while one writer updates it, against the
+ * same values behind a FreeRTOS mutex as the sensor state was shared
+ * before the seqlock:
+ *
+ *   .pio/build/seqlock/program --readers 1,2,4,8 --write-us 0,1000 --duration 1000 --json seqlock.json
+ *
+ * --write-us is the writer's period, 0 for back to back. Every 64th read
+ * is timed on its own for the worst case a reader waited.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "sensor_snapshot.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define TIMED_READ_EVERY 64
+
+// ==================== OPTIONS ====================
+
+struct BenchOptions {
+    std::vector<int> readers = {1, 2, 4, 8};
+    std::vector<int> writePeriods = {0, 1000};
+    int durationMs = 1000;
+    String jsonPath;
+};
+
+static bool parseList(const String& value, std::vector<int>& list) {
+    list.clear();
+    int start = 0;
+    while (start < (int)value.length()) {
+        int comma = value.indexOf(',', start);
+        if (comma < 0) comma = value.length();
+        list.push_back(value.substring(start, comma).toInt());
+        start = comma + 1;
+    }
+    return !list.empty();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        String arg = argv[i];
+        String value = argv[i + 1];
+        if (arg == "--readers") { if (!parseList(value, options.readers)) return false; }
+        else if (arg == "--write-us") { if (!parseList(value, options.writePeriods)) return false; }
+        else if (arg == "--duration") options.durationMs = value.toInt();
+        else if (arg == "--json") options.jsonPath = value;
+        else return false;
+    }
+    for (int readers : options.readers) {
+        if (readers < 1) return false;
+    }
+    return (argc % 2 == 1) && options.durationMs >= 10;
+}
+
+// ==================== MUTEX BASELINE ====================
+
+static SemaphoreHandle_t baselineMutex = NULL;
+static SensorSnapshot baselineValues = {};
+
+static SensorSnapshot readBaseline() {
+    xSemaphoreTake(baselineMutex, portMAX_DELAY);
+    SensorSnapshot values = baselineValues;
+    xSemaphoreGive(baselineMutex);
+    return values;
+}
+
+static void writeBaseline(float lux) {
+    xSemaphoreTake(baselineMutex, portMAX_DELAY);
+    baselineValues.lux = lux;
+    baselineValues.sequence++;
+    xSemaphoreGive(baselineMutex);
+}
+
+// ==================== STEPS ====================
+
+typedef std::chrono::steady_clock Clock;
+
+struct Lock {
+    const char* name;
+    SensorSnapshot (*read)();
+    void (*write)(float lux);
+};
+
+static const Lock LOCKS[] = {
+    {"seqlock", getSensorSnapshot, setSnapshotLux},
+    {"mutex", readBaseline, writeBaseline},
+};
+
+struct StepResult {
+    double readsPerSecond;   // All readers together
+    double nsPerRead;        // Per reader thread
+    double maxReadUs;
+    double writesPerSecond;
+};
+
+static StepResult runStep(const Lock& lock, int readerCount, int writePeriodUs, int durationMs) {
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> reads(0), maxReadNs(0);
+    std::atomic<uint32_t> checksum(0);  // Keeps the reads from being optimized out
+    uint64_t writes = 0;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; r++) {
+        readers.emplace_back([&] {
+            uint64_t count = 0, worst = 0;
+            uint32_t sink = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                if (count % TIMED_READ_EVERY == 0) {
+                    Clock::time_point start = Clock::now();
+                    sink += lock.read().sequence;
+                    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                    if (ns > worst) worst = ns;
+                } else {
+                    sink += lock.read().sequence;
+                }
+                count++;
+            }
+            reads += count;
+            checksum += sink;
+            uint64_t seen = maxReadNs.load();
+            while (worst > seen && !maxReadNs.compare_exchange_weak(seen, worst)) {}
+        });
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::milliseconds(durationMs);
+    Clock::time_point next = start;
+    while (Clock::now() < end) {
+        lock.write((float)writes);
+        writes++;
+        if (writePeriodUs > 0) {
+            next += std::chrono::microseconds(writePeriodUs);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    running = false;
+    for (std::thread& reader : readers) reader.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    StepResult result;
+    result.readsPerSecond = reads / seconds;
+    result.nsPerRead = reads ? seconds * 1e9 * readerCount / reads : 0;
+    result.maxReadUs = maxReadNs / 1000.0;
+    result.writesPerSecond = writes / seconds;
+    return result;
+}
+
+// ==================== MAIN ====================
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--readers 1,2,4,8] [--write-us 0,1000] [--duration MS] [--json FILE]\n",
+                argv[0]);
+        return 2;
+    }
+    baselineMutex = xSemaphoreCreateMutex();
+
+    DynamicJsonDocument report(1024 + 256 * options.readers.size() * options.writePeriods.size());
+    report["duration_ms"] = options.durationMs;
+    report["cpus"] = std::thread::hardware_concurrency();
+    JsonArray steps = report.createNestedArray("steps");
+
+    Serial.printf("%-8s %7s %8s %12s %8s %11s %10s\n", "lock", "readers", "write us", "reads/s", "ns/read",
+                  "max read us", "writes/s");
+    for (int writePeriod : options.writePeriods) {
+        for (int readers : options.readers) {
+            for (const Lock& lock : LOCKS) {
+                StepResult result = runStep(lock, readers, writePeriod, options.durationMs);
+                Serial.printf("%-8s %7d %8d %12.0f %8.1f %11.1f %10.0f\n", lock.name, readers, writePeriod,
+                              result.readsPerSecond, result.nsPerRead, result.maxReadUs, result.writesPerSecond);
+
+                JsonObject step = steps.createNestedObject();
+                step["lock"] = lock.name;
+                step["readers"] = readers;
+                step["write_period_us"] = writePeriod;
+                step["reads_per_s"] = (uint32_t)result.readsPerSecond;
+                step["ns_per_read"] = serialized(String(result.nsPerRead, 1));
+                step["max_read_us"] = serialized(String(result.maxReadUs, 1));
+                step["writes_per_s"] = (uint32_t)result.writesPerSecond;
+            }
+        }
+    }
+
+    if (options.jsonPath.length()) {
+        String json;
+        serializeJson(report, json);
+        FILE* file = fopen(options.jsonPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        fputs(json.c_str(), file);
+        fputc('\n', file);
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * model_heap.cpp (native)
+ */
+
+#include <Arduino.h>
+
+#ifdef NATIVE_BUILD
+
+#include "model_heap.h"
+#include <mutex>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Header in front of every block; free blocks link through their payload
+struct BlockHeader {
+    uint32_t size;  // Including the header
+    uint32_t used;
+    uint64_t reserved;
+};
+
+struct FreeBlock {
+    BlockHeader header;
+    FreeBlock* next;
+};
+
+#define MIN_BLOCK_SIZE (2 * MODEL_HEAP_ALIGN)
+
+alignas(MODEL_HEAP_ALIGN) static uint8_t region[MODEL_HEAP_SIZE];
+static FreeBlock* freeList = nullptr;  // Ascending addresses
+static std::mutex heapLock;
+static bool enabled = false;
+static uint32_t usedBlocks = 0;
+static uint32_t allocations = 0;
+static uint32_t failures = 0;
+
+static inline bool inRegion(const void* pointer) {
+    return pointer >= (const void*)region && pointer < (const void*)(region + MODEL_HEAP_SIZE);
+}
+
+void modelHeapEnable() {
+    std::lock_guard<std::mutex> guard(heapLock);
+    if (enabled) return;
+    freeList = (FreeBlock*)region;
+    freeList->header.size = MODEL_HEAP_SIZE;
+    freeList->header.used = 0;
+    freeList->next = nullptr;
+    enabled = true;
+}
+
+ModelHeapStats modelHeapStats() {
+    std::lock_guard<std::mutex> guard(heapLock);
+    ModelHeapStats stats = {};
+    for (FreeBlock* block = freeList; block; block = block->next) {
+        uint32_t payload = block->header.size - sizeof(BlockHeader);
+        stats.freeBytes += payload;
+        if (payload > stats.largestFreeBlock) stats.largestFreeBlock = payload;
+        stats.freeBlocks++;
+    }
+    stats.usedBlocks = usedBlocks;
+    stats.allocations = allocations;
+    stats.failures = failures;
+    return stats;
+}
+
+static void* modelMalloc(size_t size) {
+    size_t need = (size + sizeof(BlockHeader) + MODEL_HEAP_ALIGN - 1) & ~(size_t)(MODEL_HEAP_ALIGN - 1);
+    if (need < MIN_BLOCK_SIZE) need = MIN_BLOCK_SIZE;
+
+    std::lock_guard<std::mutex> guard(heapLock);
+    FreeBlock** link = &freeList;
+    while (*link && (*link)->header.size < need) link = &(*link)->next;
+    FreeBlock* block = *link;
+    if (!block) {
+        failures++;
+        return nullptr;
+    }
+
+    if (block->header.size - need >= MIN_BLOCK_SIZE) {
+        // Split: the tail stays free in the same list position
+        FreeBlock* rest = (FreeBlock*)((uint8_t*)block + need);
+        rest->header.size = block->header.size - need;
+        rest->header.used = 0;
+        rest->next = block->next;
+        *link = rest;
+        block->header.size = need;
+    } else {
+        *link = block->next;
+    }
+    block->header.used = 1;
+    usedBlocks++;
+    allocations++;
+    return (uint8_t*)block + sizeof(BlockHeader);
+}
+
+static void modelFree(void* pointer) {
+    FreeBlock* block = (FreeBlock*)((uint8_t*)pointer - sizeof(BlockHeader));
+
+    std::lock_guard<std::mutex> guard(heapLock);
+    if (!block->header.used) {
+        fprintf(stderr, "model heap: double free of %p\n", pointer);
+        abort();
+    }
+    block->header.used = 0;
+    usedBlocks--;
+
+    FreeBlock* previous = nullptr;
+    FreeBlock* next = freeList;
+    while (next && next < block) {
+        previous = next;
+        next = next->next;
+    }
+
+    block->next = next;
+    if (next && (uint8_t*)block + block->header.size == (uint8_t*)next) {
+        block->header.size += next->header.size;
+        block->next = next->next;
+    }
+    if (previous && (uint8_t*)previous + previous->header.size == (uint8_t*)block) {
+        previous->header.size += block->header.size;
+        previous->next = block->next;
+    } else if (previous) {
+        previous->next = block;
+    } else {
+        freeList = block;
+    }
+}
+
+static size_t modelUsableSize(void* pointer) {
+    BlockHeader* header = (BlockHeader*)((uint8_t*)pointer - sizeof(BlockHeader));
+    return header->size - sizeof(BlockHeader);
+}
+
+// ==================== LINK-TIME WRAPPERS ====================
+// Linked with -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void __real_free(void* pointer);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    return enabled ? modelMalloc(size) : __real_malloc(size);
+}
+
+void __wrap_free(void* pointer) {
+    if (!pointer) return;
+    if (inRegion(pointer)) modelFree(pointer);
+    else __real_free(pointer);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if (!enabled) return __real_calloc(count, size);
+    void* pointer = modelMalloc(count * size);
+    if (pointer) memset(pointer, 0, count * size);
+    return pointer;
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    if (!pointer) return __wrap_malloc(size);
+    if (!inRegion(pointer)) return __real_realloc(pointer, size);
+
+    size_t usable = modelUsableSize(pointer);
+    if (size <= usable) return pointer;
+    void* grown = modelMalloc(size);
+    if (!grown) return nullptr;
+    memcpy(grown, pointer, usable);
+    modelFree(pointer);
+    return grown;
+}
+
+}  // extern "C"
+
+// libstdc++ allocates through its own malloc calls, which --wrap does not reach
+void* operator new(size_t size) {
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        fprintf(stderr, "model heap: out of memory (%zu bytes)\n", size);
+        abort();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+#endif // NATIVE_BUILD
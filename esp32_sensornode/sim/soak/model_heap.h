@@ -0,0 +1,38 @@
+/**
+ * model_heap.h (native, pio run -e soak)
+ *
+ * Address-ordered first-fit heap with immediate coalescing over a region
+ * the size of the S3's internal heap. [env:soak] links malloc, free and
+ * operator new through it (-Wl,--wrap) once modelHeapEnable() is called,
+ * so the largest free block shows the fragmentation that glibc's
+ * allocator hides on the host. It stands in for multi_heap (TLSF on
+ * Arduino-ESP32 2.x): trends match, absolute figures do not.
+ */
+
+#ifndef MODEL_HEAP_H
+#define MODEL_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MODEL_HEAP_SIZE 327680
+#define MODEL_HEAP_ALIGN 16  // Header size and block granularity
+
+struct ModelHeapStats {
+    uint32_t freeBytes;
+    uint32_t largestFreeBlock;  // Largest allocation that would succeed
+    uint32_t freeBlocks;
+    uint32_t usedBlocks;
+    uint32_t allocations;       // Successful allocations since enable
+    uint32_t failures;          // Allocations that found no block
+};
+
+/**
+ * Serve all later allocations from the model; earlier ones stay in the
+ * host heap and are freed there
+ */
+void modelHeapEnable();
+
+ModelHeapStats modelHeapStats();
+
+#endif // MODEL_HEAP_H
@@ -0,0 +1,613 @@
+/**
+ * soak_main.cpp (pio run -e soak, pio run -e soak-esp32)
+ *
+ * Sends millions of oneM2M requests and follows the free heap and the
+ * largest free block, next to background allocations that stand in for
+ * the node's other tasks:
+ *
+ *   .pio/build/soak/program --mode arena --requests 2000000 --json arena.json
+ *   .pio/build/soak/program --mode legacy --requests 2000000 --json legacy.json
+ *
+ * "arena" is OneM2MClient as the firmware uses it. "legacy" replays the
+ * request path the arena replaced (URL, request ID and body as heap
+ * Strings, every reply read with getString()) as the baseline. On Linux
+ * the requests go to a responder process forked at start and the heap is
+ * model_heap.h; on the S3 they go to CSE_HOST (tools/fake_cse.py) and
+ * the heap is the real one.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include "config.h"
+#include "onem2m.h"
+#include "report_policy.h"
+
+#ifdef NATIVE_BUILD
+#include "model_heap.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#else
+#include <esp_heap_caps.h>
+#endif
+
+#define SOAK_MAX_SAMPLES 64
+#define SOAK_CHURN_SLOTS 48        // Live background allocations
+#define SOAK_CHURN_PERIOD_US 50
+#define SOAK_DEVICE_REQUESTS 1000000
+
+// Reply sizes of the responder, close to the CSE's resource representations
+#define SOAK_UPDATE_REPLY 450
+#define SOAK_CREATE_REPLY 400
+#define SOAK_RETRIEVE_REPLY 1200
+
+// ==================== OPTIONS ====================
+
+struct SoakOptions {
+    bool legacy = false;
+    uint32_t requests = 1000000;
+    uint32_t reportEvery = 100000;
+    uint32_t seed = 1;
+    uint32_t residentKb = 120;  // Long-lived blocks allocated first (WiFi, tasks)
+    String host;                // Empty: built-in responder
+    int port = CSE_PORT;
+    String jsonPath;
+};
+
+// ==================== HEAP ====================
+
+struct HeapSample {
+    uint32_t requests;
+    uint32_t freeBytes;
+    uint32_t largestFreeBlock;
+    uint32_t freeBlocks;
+    uint32_t allocations;  // Native only: heap allocations so far
+};
+
+static HeapSample readHeap(uint32_t requests) {
+    HeapSample sample;
+    sample.requests = requests;
+#ifdef NATIVE_BUILD
+    ModelHeapStats stats = modelHeapStats();
+    sample.freeBytes = stats.freeBytes;
+    sample.largestFreeBlock = stats.largestFreeBlock;
+    sample.freeBlocks = stats.freeBlocks;
+    sample.allocations = stats.allocations;
+#else
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    sample.freeBytes = info.total_free_bytes;
+    sample.largestFreeBlock = info.largest_free_block;
+    sample.freeBlocks = info.free_blocks;
+    sample.allocations = 0;
+#endif
+    return sample;
+}
+
+// ==================== BACKGROUND ALLOCATIONS ====================
+// Other tasks allocate and free at random while requests are in flight:
+// Strings, JSON documents and the occasional large buffer. Blocks they
+// place next to a request's buffers are what fragments the heap.
+
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static uint32_t requestRandom = 1;
+static uint32_t churnRandom = 2;
+static volatile bool churnRunning = false;
+static volatile uint32_t churnAllocations = 0;
+static void* churnBlocks[SOAK_CHURN_SLOTS];
+
+static size_t churnSize() {
+    uint32_t pick = nextRandom(churnRandom) % 100;
+    if (pick < 70) return 16 + nextRandom(churnRandom) % 80;
+    if (pick < 95) return 128 + nextRandom(churnRandom) % 512;
+    return 1024 + nextRandom(churnRandom) % 2048;
+}
+
+static void churnTask(void* pvParameters) {
+    while (churnRunning) {
+        uint32_t slot = nextRandom(churnRandom) % SOAK_CHURN_SLOTS;
+        free(churnBlocks[slot]);
+        churnBlocks[slot] = malloc(churnSize());
+        churnAllocations = churnAllocations + 1;
+        delayMicroseconds(SOAK_CHURN_PERIOD_US);
+    }
+    vTaskDelete(NULL);
+}
+
+static void* residentBlocks = nullptr;  // Chained through their first word
+
+static void allocateResident(uint32_t kilobytes) {
+    size_t remaining = kilobytes * 1024;
+    while (remaining > 0) {
+        size_t size = max(min(remaining, (size_t)(256 + nextRandom(requestRandom) % 3840)), sizeof(void*));
+        void* block = malloc(size);
+        if (!block) return;
+        *(void**)block = residentBlocks;
+        residentBlocks = block;
+        remaining -= min(remaining, size);
+    }
+}
+
+// ==================== TRAFFIC ====================
+
+enum SoakKind : uint8_t {
+    SOAK_LUX,
+    SOAK_AUDIO,
+    SOAK_OCCUPANCY,
+    SOAK_STATS,
+    SOAK_METRICS,
+    SOAK_DIAGNOSTICS,
+    SOAK_RETRIEVE
+};
+
+// Roughly the node's mix: readings, then stats, metrics, diagnostics and
+// the occasional retrieve with a reply the caller reads
+static SoakKind kindOf(uint32_t request) {
+    if (request % 100 == 99) return SOAK_RETRIEVE;
+    if (request % 50 == 49) return SOAK_DIAGNOSTICS;
+    if (request % 30 == 29) return SOAK_METRICS;
+    if (request % 10 == 9) return SOAK_STATS;
+    return (SoakKind)(request % 3);
+}
+
+struct SoakPaths {
+    String baseUrl;
+    String lux;
+    String audio;
+    String occupancy;
+    String metrics;
+    String diagnostics;
+};
+
+struct SoakRequest {
+    const char* method;
+    const String* path;
+    int resourceType;
+    bool readReply;
+};
+
+static SoakRequest buildRequest(SoakKind kind, const SoakPaths& paths, JsonDocument& doc) {
+    typedef MioNodeMetrics M;
+    float value = (nextRandom(requestRandom) % 10000) / 10.0f;
+
+    switch (kind) {
+        case SOAK_LUX:
+            buildLuxPayload(doc, value);
+            return {"PUT", &paths.lux, 0, false};
+        case SOAK_AUDIO:
+            buildAudioPayload(doc, value);
+            return {"PUT", &paths.audio, 0, false};
+        case SOAK_OCCUPANCY:
+            buildOccupancyPayload(doc, value > 500);
+            return {"PUT", &paths.occupancy, 0, false};
+        case SOAK_STATS: {
+            OccupancyStats stats = {300, nextRandom(requestRandom) % 300, 2, 1260, 0, true};
+            buildOccupancyStatsPayload(doc, stats);
+            return {"PUT", &paths.occupancy, 0, false};
+        }
+        case SOAK_METRICS:
+            writeFlexUpdate<M>(doc,
+                               flexField<M::upt>(nextRandom(requestRandom)),
+                               flexField<M::ivl>((uint32_t)60),
+                               flexField<M::hpf>(nextRandom(requestRandom) % 200000),
+                               flexField<M::hpm>(nextRandom(requestRandom) % 200000),
+                               flexField<M::hlb>(nextRandom(requestRandom) % 100000),
+                               flexField<M::rqc>(nextRandom(requestRandom)),
+                               flexField<M::l50>(nextRandom(requestRandom) % 100),
+                               flexField<M::l90>(nextRandom(requestRandom) % 400),
+                               flexField<M::l99>(nextRandom(requestRandom) % 2000),
+                               flexField<M::lmx>(nextRandom(requestRandom) % 5000));
+            return {"PUT", &paths.metrics, 0, false};
+        case SOAK_DIAGNOSTICS: {
+            JsonObject cin = doc.createNestedObject("m2m:cin");
+            cin["cnf"] = "application/json:0";
+            cin["con"] = String("{\"kind\":\"profile\",\"tasks\":[") + String(nextRandom(requestRandom)) + ",\"sensors\",\"lamp\",\"connectivity\"]}";
+            cin.createNestedArray("lbl").add("diag:profile");
+            return {"POST", &paths.diagnostics, ONEM2M_RT_CONTENT_INSTANCE, false};
+        }
+        case SOAK_RETRIEVE:
+        default:
+            return {"GET", &paths.occupancy, 0, true};
+    }
+}
+
+// ==================== LEGACY REQUEST PATH ====================
+
+struct LegacyConnection {
+    WiFiClient client;
+    HTTPClient http;
+};
+
+// Allocated like the pool it stands for; used round-robin
+static LegacyConnection* legacyConnections = nullptr;
+static uint8_t legacyNext = 0;
+static unsigned long legacyRequestCounter = 0;
+
+// The request ID as a heap String, as the firmware built it then
+static String generateRequestId() {
+    return String("req_") + String(legacyRequestCounter++);
+}
+
+static void legacyBegin() {
+    legacyConnections = new LegacyConnection[ONEM2M_POOL_SIZE];
+    for (uint8_t i = 0; i < ONEM2M_POOL_SIZE; i++) legacyConnections[i].http.setReuse(true);
+}
+
+// OneM2MClient::request() before the arena
+static bool legacyRequest(const char* method, const String& baseUrl, const String& path, const JsonDocument* body,
+                          int resourceType, String& response, int& statusCode) {
+    WiFiClient& legacyClient = legacyConnections[legacyNext].client;
+    HTTPClient& legacyHttp = legacyConnections[legacyNext].http;
+    legacyNext = (legacyNext + 1) % ONEM2M_POOL_SIZE;
+
+    String url = baseUrl + path;
+    url.trim();
+    if (!legacyHttp.begin(legacyClient, url)) {
+        statusCode = -1;
+        return false;
+    }
+
+    legacyHttp.setTimeout(5000);
+    legacyHttp.addHeader("X-M2M-Origin", ORIGINATOR);
+    legacyHttp.addHeader("X-M2M-RI", generateRequestId());
+    legacyHttp.addHeader("X-M2M-RVI", "3");
+    legacyHttp.addHeader("Accept", "application/json");
+    if (resourceType > 0) {
+        legacyHttp.addHeader("Content-Type", "application/json;ty=" + String(resourceType));
+    } else {
+        legacyHttp.addHeader("Content-Type", "application/json");
+    }
+
+    String payload;
+    if (body) serializeJson(*body, payload);
+
+    int httpCode = -1;
+    if (strcmp(method, "GET") == 0) httpCode = legacyHttp.GET();
+    else if (strcmp(method, "POST") == 0) httpCode = legacyHttp.POST(payload);
+    else if (strcmp(method, "PUT") == 0) httpCode = legacyHttp.PUT(payload);
+
+    statusCode = httpCode;
+    if (httpCode > 0) response = legacyHttp.getString();
+    legacyHttp.end();
+    if (httpCode <= 0) legacyClient.stop();
+    return (httpCode > 0);
+}
+
+// ==================== RESPONDER (NATIVE) ====================
+
+#ifdef NATIVE_BUILD
+
+static std::string replyFor(const std::string& request) {
+    int code = 200;
+    size_t size = SOAK_UPDATE_REPLY;
+    if (request.compare(0, 4, "GET ") == 0) size = SOAK_RETRIEVE_REPLY;
+    else if (request.compare(0, 5, "POST ") == 0) {
+        code = 201;
+        size = SOAK_CREATE_REPLY;
+    }
+
+    std::string body = "{\"m2m:rsp\":{\"ri\":\"id-4711\",\"ct\":\"20250101T080000,000000\",\"pad\":\"" +
+                       std::string(size - 60, 'x') + "\"}}";
+    return "HTTP/1.1 " + std::to_string(code) + " OK\r\nContent-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+}
+
+// Keep-alive HTTP responder; runs in a child process with the host heap
+static void runResponder(int listener) {
+    std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+    std::vector<std::string> inboxes(1);
+    char buffer[4096];
+
+    while (poll(fds.data(), fds.size(), -1) >= 0) {
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                fds.push_back({fd, POLLIN, 0});
+                inboxes.emplace_back();
+            }
+        }
+        for (size_t i = fds.size() - 1; i > 0; i--) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ssize_t received = recv(fds[i].fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                inboxes.erase(inboxes.begin() + i);
+                continue;
+            }
+
+            std::string& inbox = inboxes[i];
+            inbox.append(buffer, received);
+            while (true) {
+                size_t end = inbox.find("\r\n\r\n");
+                if (end == std::string::npos) break;
+                size_t length = 0;
+                size_t header = inbox.find("Content-Length: ");
+                if (header != std::string::npos && header < end) length = strtoul(inbox.c_str() + header + 16, nullptr, 10);
+                if (inbox.size() < end + 4 + length) break;
+
+                std::string reply = replyFor(inbox);
+                send(fds[i].fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+                inbox.erase(0, end + 4 + length);
+            }
+        }
+    }
+    _exit(0);
+}
+
+static pid_t startResponder(int& port) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (listener < 0 || bind(listener, (sockaddr*)&address, length) != 0 || listen(listener, 16) != 0 ||
+        getsockname(listener, (sockaddr*)&address, &length) != 0) {
+        return -1;
+    }
+    port = ntohs(address.sin_port);
+
+    pid_t pid = fork();
+    if (pid == 0) runResponder(listener);
+    close(listener);
+    return pid;
+}
+
+#endif // NATIVE_BUILD
+
+// ==================== SOAK ====================
+
+struct SoakResult {
+    uint32_t requests = 0;
+    uint32_t failures = 0;
+    float seconds = 0;
+    HeapSample start;
+    HeapSample end;
+    float allocationsPerRequest = 0;  // Churn task excluded
+    uint32_t minFreeBytes = UINT32_MAX;
+    uint32_t minLargestFreeBlock = UINT32_MAX;
+    HeapSample samples[SOAK_MAX_SAMPLES];
+    size_t sampleCount = 0;
+};
+
+static void record(SoakResult& result, const HeapSample& sample) {
+    result.minFreeBytes = min(result.minFreeBytes, sample.freeBytes);
+    result.minLargestFreeBlock = min(result.minLargestFreeBlock, sample.largestFreeBlock);
+}
+
+static void runSoak(const SoakOptions& options, const String& host, int port, SoakResult& result) {
+    OneM2MPaths nodePaths;
+    nodePaths.initialize(host.c_str(), port, CSE_NAME, AE_NAME, ROOM_CONTAINER, DESK_CONTAINER, LUX_DEVICE_NAME);
+    SoakPaths paths;
+    paths.baseUrl = nodePaths.BASE_URL;
+    paths.lux = nodePaths.DEVICE_PATH;
+    paths.audio = nodePaths.DESK_PATH + "/" + AUDIO_DEVICE_NAME;
+    paths.occupancy = nodePaths.DESK_PATH + "/" + OCCUPANCY_DEVICE_NAME;
+    paths.metrics = nodePaths.DESK_PATH + "/metrics";
+    paths.diagnostics = nodePaths.DESK_PATH + "/diagnostics";
+
+    static OneM2MClient client;
+    if (options.legacy) {
+        legacyBegin();
+    } else {
+        client.begin();
+    }
+
+    uint32_t sampleEvery = max(options.requests / SOAK_MAX_SAMPLES, (uint32_t)1);
+    result.start = readHeap(0);
+    record(result, result.start);
+    unsigned long startMs = millis();
+
+    churnRunning = true;
+    xTaskCreate(churnTask, "churn", 4096, nullptr, 1, nullptr);
+
+    Serial.printf("%-6s %10s %9s %9s %9s %7s\n", options.legacy ? "legacy" : "arena",
+                  "requests", "free", "largest", "min larg", "blocks");
+    // Retrieves keep the resource ID and creation time, parsed as they arrive
+    StaticJsonDocument<64> filter;
+    filter["m2m:rsp"]["ri"] = true;
+    filter["m2m:rsp"]["ct"] = true;
+
+    for (uint32_t n = 0; n < options.requests; n++) {
+        StaticJsonDocument<768> doc;
+        SoakRequest request = buildRequest(kindOf(n), paths, doc);
+        const JsonDocument* body = doc.isNull() ? nullptr : &doc;
+        int statusCode = -1;
+        bool received;
+        if (options.legacy) {
+            String response;
+            received = legacyRequest(request.method, paths.baseUrl, *request.path, body,
+                                     request.resourceType, response, statusCode);
+        } else {
+            StaticJsonDocument<128> fields;
+            JsonFilterSink sink(fields, filter);
+            received = client.request(request.method, paths.baseUrl, *request.path, body,
+                                      request.resourceType, request.readReply ? &sink : nullptr, statusCode);
+        }
+        if (!received || statusCode >= 400) result.failures++;
+
+        uint32_t done = n + 1;
+        if (done % sampleEvery == 0 || done % options.reportEvery == 0) {
+            HeapSample sample = readHeap(done);
+            record(result, sample);
+            if (done % sampleEvery == 0 && result.sampleCount < SOAK_MAX_SAMPLES) {
+                result.samples[result.sampleCount++] = sample;
+            }
+            if (done % options.reportEvery == 0) {
+                Serial.printf("%-6s %10lu %9lu %9lu %9lu %7lu\n", "", (unsigned long)done,
+                              (unsigned long)sample.freeBytes, (unsigned long)sample.largestFreeBlock,
+                              (unsigned long)result.minLargestFreeBlock, (unsigned long)sample.freeBlocks);
+            }
+        }
+    }
+
+    churnRunning = false;
+    result.requests = options.requests;
+    result.seconds = (millis() - startMs) / 1000.0f;
+    result.end = readHeap(options.requests);
+    record(result, result.end);
+    result.allocationsPerRequest =
+        (float)(result.end.allocations - result.start.allocations - churnAllocations) / options.requests;
+
+    Serial.printf("%lu requests in %.1f s (%.0f/s), %lu failed", (unsigned long)result.requests, result.seconds,
+                  result.requests / max(result.seconds, 0.001f), (unsigned long)result.failures);
+#ifdef NATIVE_BUILD
+    Serial.printf(", %.1f allocations/request", result.allocationsPerRequest);
+#endif
+    if (!options.legacy) {
+        Serial.printf(", arena high water %lu bytes, %lu overflows",
+                      (unsigned long)client.arenaHighWater(), (unsigned long)client.arenaOverflows());
+    }
+    Serial.println();
+}
+
+static void writeJson(const SoakOptions& options, const SoakResult& result, Print& out) {
+    DynamicJsonDocument doc(8192);
+    doc["mode"] = options.legacy ? "legacy" : "arena";
+    doc["requests"] = result.requests;
+    doc["failures"] = result.failures;
+    doc["seconds"] = result.seconds;
+    doc["churn_slots"] = SOAK_CHURN_SLOTS;
+    doc["resident_kb"] = options.residentKb;
+    doc["start_free"] = result.start.freeBytes;
+    doc["start_largest"] = result.start.largestFreeBlock;
+    doc["end_free"] = result.end.freeBytes;
+    doc["end_largest"] = result.end.largestFreeBlock;
+    doc["min_free"] = result.minFreeBytes;
+    doc["min_largest"] = result.minLargestFreeBlock;
+#ifdef NATIVE_BUILD
+    doc["allocs_per_request"] = serialized(String(result.allocationsPerRequest, 1));
+#endif
+
+    // [requests, free, largest, free blocks]
+    JsonArray samples = doc.createNestedArray("samples");
+    for (size_t i = 0; i < result.sampleCount; i++) {
+        JsonArray sample = samples.createNestedArray();
+        sample.add(result.samples[i].requests);
+        sample.add(result.samples[i].freeBytes);
+        sample.add(result.samples[i].largestFreeBlock);
+        sample.add(result.samples[i].freeBlocks);
+    }
+    serializeJson(doc, out);
+    out.println();
+}
+
+#ifdef NATIVE_CUSTOM_MAIN
+
+static bool parseOptions(int argc, char** argv, SoakOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        String arg = argv[i];
+        String value = argv[i + 1];
+        if (arg == "--mode") {
+            if (value != "arena" && value != "legacy") return false;
+            options.legacy = (value == "legacy");
+        }
+        else if (arg == "--requests") options.requests = value.toInt();
+        else if (arg == "--report-every") options.reportEvery = value.toInt();
+        else if (arg == "--seed") options.seed = value.toInt();
+        else if (arg == "--resident-kb") options.residentKb = value.toInt();
+        else if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = value.toInt();
+        else if (arg == "--json") options.jsonPath = value;
+        else return false;
+    }
+    return (argc % 2 == 1) && options.requests > 0 && options.reportEvery > 0;
+}
+
+// Print to a file for --json
+class FilePrint : public Print {
+public:
+    explicit FilePrint(FILE* file) : file(file) {}
+    size_t write(uint8_t byte) override { return fputc(byte, file) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, file); }
+
+private:
+    FILE* file;
+};
+
+int main(int argc, char** argv) {
+    SoakOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--mode arena|legacy] [--requests N] [--report-every N] [--seed N]\n"
+                "          [--resident-kb KB] [--host H --port P] [--json FILE]\n",
+                argv[0]);
+        return 2;
+    }
+
+    String host = options.host;
+    int port = options.port;
+    pid_t responder = -1;
+    if (host.isEmpty()) {
+        responder = startResponder(port);
+        if (responder < 0) {
+            fprintf(stderr, "cannot start the responder\n");
+            return 1;
+        }
+        host = "127.0.0.1";
+    }
+
+    requestRandom = options.seed;
+    churnRandom = options.seed * 2 + 1;
+    modelHeapEnable();
+    allocateResident(options.residentKb);
+
+    static SoakResult result;
+    runSoak(options, host, port, result);
+
+    if (responder > 0) {
+        kill(responder, SIGTERM);
+        waitpid(responder, nullptr, 0);
+    }
+
+    if (!options.jsonPath.isEmpty()) {
+        FILE* file = fopen(options.jsonPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        FilePrint out(file);
+        writeJson(options, result, out);
+        fclose(file);
+    }
+    return result.failures == 0 ? 0 : 1;
+}
+
+#else
+
+void setup() {
+    Serial.begin(115200);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    while (WiFi.status() != WL_CONNECTED) delay(100);
+
+    SoakOptions options;
+    options.requests = SOAK_DEVICE_REQUESTS;
+    options.reportEvery = 10000;
+    #ifdef SOAK_LEGACY
+    options.legacy = true;
+    #endif
+
+    static SoakResult result;
+    runSoak(options, CSE_HOST, CSE_PORT, result);
+    writeJson(options, result, Serial);
+}
+
+void loop() {
+    delay(1000);
+}
+
+#endif // NATIVE_CUSTOM_MAIN
@@ -0,0 +1,266 @@
+/**
+ * tls_bench.cpp (native, pio run -e tls)
+ *
+ * Times TLS connection setup and requests against tools/fake_cse.py
+ * serving HTTPS with client certificates required, through its RTT relay
+ * (certificates from scripts/generate-certificates.sh):
+ *
+ *   python tools/fake_cse.py --port 8443 --no-verify --rtt 0 --tls-cert ../certs/raspberry-cse.crt \
+ *       --tls-key ../certs/raspberry-cse.key --client-ca ../certs/ca.crt &
+ *   .pio/build/tls/program --port 8443 --ca ../certs/ca.crt --cert ../certs/node.crt \
+ *       --key ../certs/node.key --rtt 10,50,100 --json tls.json
+ *
+ * At every round trip it connects --connections times with the session
+ * forgotten before each (full handshakes), as often again offering it
+ * (resumed), then sends --requests retrieves on one kept-alive
+ * connection. Handshake kinds are counted on both ends: the node's
+ * metrics and the fake CSE's "tls" records must agree.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "metrics.h"
+#include "onem2m.h"
+#include "tls_client.h"
+#include <algorithm>
+#include <vector>
+
+// ==================== OPTIONS ====================
+
+struct BenchOptions {
+    String host = "127.0.0.1";
+    int port = 8443;
+    String serverName = CSE_TLS_SERVER_NAME;
+    String caPath;
+    String certPath;
+    String keyPath;
+    std::vector<int> rtts = {10, 50, 100};
+    int connections = 10;
+    int requests = 20;
+    String jsonPath;
+};
+
+static bool parseList(const String& value, std::vector<int>& list) {
+    list.clear();
+    int start = 0;
+    while (start < (int)value.length()) {
+        int comma = value.indexOf(',', start);
+        if (comma < 0) comma = value.length();
+        list.push_back(value.substring(start, comma).toInt());
+        start = comma + 1;
+    }
+    return !list.empty();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        String arg = argv[i];
+        String value = argv[i + 1];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = value.toInt();
+        else if (arg == "--server-name") options.serverName = value;
+        else if (arg == "--ca") options.caPath = value;
+        else if (arg == "--cert") options.certPath = value;
+        else if (arg == "--key") options.keyPath = value;
+        else if (arg == "--rtt") { if (!parseList(value, options.rtts)) return false; }
+        else if (arg == "--connections") options.connections = value.toInt();
+        else if (arg == "--requests") options.requests = value.toInt();
+        else if (arg == "--json") options.jsonPath = value;
+        else return false;
+    }
+    return (argc % 2 == 1) && options.caPath.length() && (options.certPath.length() == options.keyPath.length()) &&
+           options.connections >= 1 && options.requests >= 1;
+}
+
+static bool readFile(const String& path, String& contents) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) return false;
+    char chunk[512];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        contents.concat(chunk, length);
+    }
+    fclose(file);
+    return contents.length() > 0;
+}
+
+// ==================== CSE ====================
+
+static OneM2MClient client(1);  // Control requests and the kept-alive batch
+
+static bool control(const char* method, const char* command, const JsonDocument* body,
+                    ResponseSink* response = nullptr) {
+    int statusCode;
+    String path = String("/__fake/") + command;
+    client.request(method, onem2mPaths.BASE_URL, path, body, 0, response, statusCode);
+    return statusCode == 200;
+}
+
+static bool setRtt(int rttMs) {
+    StaticJsonDocument<64> faults;
+    faults["rtt"] = rttMs;
+    return control("POST", "faults", &faults);
+}
+
+// Handshakes the CSE recorded since the last reset, by kind
+static bool serverHandshakes(int& full, int& resumed) {
+    static char buffer[4096];
+    BufferSink sink(buffer, sizeof(buffer));
+    if (!control("GET", "stats", nullptr, &sink) || sink.truncated()) return false;
+    DynamicJsonDocument stats(4096);
+    if (deserializeJson(stats, buffer)) return false;
+    full = stats["groups"]["tls full"]["count"] | 0;
+    resumed = stats["groups"]["tls resumed"]["count"] | 0;
+    return true;
+}
+
+// ==================== STEPS ====================
+
+struct Timing {
+    double medianMs;
+    double maxMs;
+    int failures;
+};
+
+static Timing summarize(std::vector<double>& samples, int failures) {
+    Timing timing = {0, 0, failures};
+    if (samples.empty()) return timing;
+    std::sort(samples.begin(), samples.end());
+    timing.medianMs = samples[samples.size() / 2];
+    timing.maxMs = samples.back();
+    return timing;
+}
+
+// Connect and close count times; forget drops the session before each
+static Timing timeConnections(TlsContext& context, const BenchOptions& options, bool forget) {
+    std::vector<double> samples;
+    int failures = 0;
+    TlsClient connection;
+    connection.setContext(&context);
+    for (int i = 0; i < options.connections; i++) {
+        if (forget) context.forgetSession();
+        unsigned long start = micros();
+        if (connection.connect(options.host.c_str(), options.port)) samples.push_back((micros() - start) / 1000.0);
+        else failures++;
+        connection.stop();
+    }
+    return summarize(samples, failures);
+}
+
+static Timing timeRequests(const BenchOptions& options) {
+    std::vector<double> samples;
+    int failures = 0;
+    for (int i = 0; i < options.requests; i++) {
+        int statusCode;
+        unsigned long start = micros();
+        client.request("GET", onem2mPaths.BASE_URL, onem2mPaths.AE_PATH, nullptr, 0, nullptr, statusCode);
+        if (statusCode == 200) samples.push_back((micros() - start) / 1000.0);
+        else failures++;
+    }
+    return summarize(samples, failures);
+}
+
+// ==================== MAIN ====================
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s --ca FILE [--cert FILE --key FILE] [--host H] [--port P] [--server-name N]\n"
+                "          [--rtt 10,50,100] [--connections N] [--requests N] [--json FILE]\n",
+                argv[0]);
+        return 2;
+    }
+
+    String ca, cert, key;
+    if (!readFile(options.caPath, ca) || (options.certPath.length() && !readFile(options.certPath, cert)) ||
+        (options.keyPath.length() && !readFile(options.keyPath, key))) {
+        fprintf(stderr, "Cannot read the PEM files\n");
+        return 1;
+    }
+    TlsCredentials credentials = {ca.c_str(), cert.length() ? cert.c_str() : nullptr,
+                                  key.length() ? key.c_str() : nullptr, options.serverName.c_str()};
+
+    onem2mPaths.initialize(options.host.c_str(), options.port, CSE_NAME, AE_NAME, ROOM_CONTAINER,
+                           DESK_CONTAINER, LUX_DEVICE_NAME, true);
+    TlsContext context(ONEM2M_TIMEOUT_MS);
+    if (!context.begin(credentials) || !client.begin(&credentials) || !setRtt(0)) {
+        fprintf(stderr, "No fake CSE with --tls-cert and --rtt at %s\n", onem2mPaths.BASE_URL.c_str());
+        return 1;
+    }
+
+    DynamicJsonDocument report(2048 + 512 * options.rtts.size());
+    report["cse"] = onem2mPaths.BASE_URL;
+    report["mtls"] = cert.length() > 0;
+    report["connections"] = options.connections;
+    report["requests"] = options.requests;
+    JsonArray steps = report.createNestedArray("steps");
+
+    int totalFailures = 0;
+    std::vector<String> rows;
+    for (int rtt : options.rtts) {
+        if (!setRtt(0) || !control("POST", "reset", nullptr) || !setRtt(rtt)) {
+            fprintf(stderr, "Fake CSE control failed\n");
+            return 1;
+        }
+        uint32_t fullBefore = metricValue(METRIC_TLS_FULL_HANDSHAKES);
+        uint32_t resumedBefore = metricValue(METRIC_TLS_RESUMED_HANDSHAKES);
+
+        Timing full = timeConnections(context, options, true);
+        Timing resumed = timeConnections(context, options, false);
+        Timing request = timeRequests(options);
+
+        int nodeFull = metricValue(METRIC_TLS_FULL_HANDSHAKES) - fullBefore;
+        int nodeResumed = metricValue(METRIC_TLS_RESUMED_HANDSHAKES) - resumedBefore;
+        int cseFull = -1, cseResumed = -1;
+        if (!setRtt(0) || !serverHandshakes(cseFull, cseResumed)) {
+            fprintf(stderr, "Fake CSE stats failed\n");
+            return 1;
+        }
+        // The first "resumed" connection may still be a full one if the CSE dropped the session
+        int failures = full.failures + resumed.failures + request.failures;
+        if (nodeResumed != cseResumed || nodeFull != cseFull || nodeResumed < options.connections - 1) failures++;
+        totalFailures += failures;
+
+        char row[160];
+        snprintf(row, sizeof(row), "%6d %11.1f %11.1f %11.1f %11.1f %11.1f %9d/%-3d %9d/%-3d %6d", rtt,
+                 full.medianMs, full.maxMs, resumed.medianMs, resumed.maxMs, request.medianMs, nodeFull,
+                 cseFull, nodeResumed, cseResumed, failures);
+        rows.push_back(row);
+
+        JsonObject step = steps.createNestedObject();
+        step["rtt_ms"] = rtt;
+        step["full_ms"] = serialized(String(full.medianMs, 1));
+        step["full_max_ms"] = serialized(String(full.maxMs, 1));
+        step["resumed_ms"] = serialized(String(resumed.medianMs, 1));
+        step["resumed_max_ms"] = serialized(String(resumed.maxMs, 1));
+        step["keepalive_request_ms"] = serialized(String(request.medianMs, 1));
+        step["node_full"] = nodeFull;
+        step["node_resumed"] = nodeResumed;
+        step["cse_full"] = cseFull;
+        step["cse_resumed"] = cseResumed;
+        step["failures"] = failures;
+    }
+
+    // The table goes out after the handshake log lines
+    Serial.printf("%6s %11s %11s %11s %11s %11s %13s %13s %6s\n", "rtt ms", "full ms", "full max", "resumed ms",
+                  "resumed max", "request ms", "full node/cse", "resumed n/c", "fails");
+    for (const String& row : rows) Serial.println(row);
+
+    if (options.jsonPath.length()) {
+        String json;
+        serializeJson(report, json);
+        FILE* file = fopen(options.jsonPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        fputs(json.c_str(), file);
+        fputc('\n', file);
+        fclose(file);
+    }
+    return totalFailures == 0 ? 0 : 1;
+}
@@ -7,18 +7,25 @@
 
 #include "audio_sensor.h"
 #include "config.h"
+#include "reading_buffer.h"
+#include "sensor_scheduler.h"
+#include "sensor_snapshot.h"
+#include "metrics.h"
+#include "report_policy.h"
 #include "onem2m.h"
+#include "connectivity.h"
+#include "trace.h"
 #include <math.h>
 
 // Global state
 AudioSensorState audioState = {
-  .currentLevel = 0.0,
   .lastReportedLevel = -1.0,
-  .initialized = false,
-  .mutex = NULL
+  .initialized = false
 };
 
-static TaskHandle_t audioTaskHandle = NULL;
+// Open and last posted summary window (owned by audioSensorJob)
+static WindowAggregator<double> audioSummary;
+static WindowAggregator<double> audioSummaryPosted;
 
 // Initialize INMP441 I2S microphone
 bool initAudioSensor() {
@@ -53,42 +60,23 @@ bool initAudioSensor() {
     return false;
   }
 
-  audioState.mutex = xSemaphoreCreateMutex();
-  if (!audioState.mutex) {
-    Serial.println("ERROR: Failed to create audio mutex");
-    return false;
-  }
-
   audioState.initialized = true;
   Serial.println("INMP441 initialized successfully");
   return true;
 }
 
-// Read audio level and convert to dB SPL
-bool readAudioLevel(double& level) {
-  if (!audioState.initialized) {
-    return false;
-  }
-
-  int32_t i2s_data[I2S_READ_LEN];
-  size_t bytes_read;
-
-  if (i2s_read(I2S_NUM_0, &i2s_data, sizeof(i2s_data), &bytes_read, 100) != ESP_OK) {
-    return false;
-  }
-
-  int samples = bytes_read / 4;
+double audioLevelFromSamples(const int32_t* samples, size_t count) {
   double sum = 0.0;
 
   // Calculate RMS from I2S samples
-  for (int i = 0; i < samples; i++) {
+  for (size_t i = 0; i < count; i++) {
     // INMP441 outputs 24-bit data in 32-bit words (left-aligned)
     // Shift right by 8 to extract the 24-bit signed value
-    int32_t sample = i2s_data[i] >> 8;
+    int32_t sample = samples[i] >> 8;
     sum += (double)sample * (double)sample;
   }
 
-  double rms = sqrt(sum / samples);
+  double rms = sqrt(sum / count);
 
   // Convert RMS to dB SPL (Sound Pressure Level)
   //
@@ -106,65 +94,71 @@ bool readAudioLevel(double& level) {
   const double DB_OFFSET = 120.0;       // Derived from -26 dBFS = 94 dB SPL
 
   if (rms > 0) {
-    level = 20.0 * log10(rms / FULL_SCALE) + DB_OFFSET;
-  } else {
-    level = 0.0;
+    return 20.0 * log10(rms / FULL_SCALE) + DB_OFFSET;
+  }
+  return 0.0;
+}
+
+// Read audio level and convert to dB SPL
+bool readAudioLevel(double& level) {
+  if (!audioState.initialized) {
+    return false;
+  }
+
+  int32_t i2s_data[I2S_READ_LEN];
+  size_t bytes_read = 0;
+
+  unsigned long start = micros();
+  TRACE(TRACE_I2S_READ_BEGIN, 0);
+  esp_err_t result = i2s_read(I2S_NUM_0, &i2s_data, sizeof(i2s_data), &bytes_read, 100);
+  TRACE(TRACE_I2S_READ_END, bytes_read);
+  if (result != ESP_OK) {
+    return false;
   }
+  metricObserve(METRIC_AUDIO_READ_US, micros() - start);
 
+  level = audioLevelFromSamples(i2s_data, bytes_read / 4);
   return true;
 }
 
 float getLastReportedAudioLevel() {
-  xSemaphoreTake(audioState.mutex, portMAX_DELAY);
-  float val = audioState.lastReportedLevel;
-  xSemaphoreGive(audioState.mutex);
-  return val;
+  return audioState.lastReportedLevel;
 }
 
 void setLastReportedAudioLevel(float level) {
-  xSemaphoreTake(audioState.mutex, portMAX_DELAY);
   audioState.lastReportedLevel = level;
-  xSemaphoreGive(audioState.mutex);
 }
 
-// FreeRTOS task for periodic audio monitoring
-void AudioSensorTask(void* pvParameters) {
-  Serial.println("AudioSensorTask started");
-  TickType_t lastWake = xTaskGetTickCount();
-  const TickType_t interval = pdMS_TO_TICKS(AUDIO_UPDATE_INTERVAL);
-
-  while (true) {
-    double currentLevel;
-    if (readAudioLevel(currentLevel)) {
-      xSemaphoreTake(audioState.mutex, portMAX_DELAY);
-      audioState.currentLevel = currentLevel;
-      xSemaphoreGive(audioState.mutex);
-
-      double last = getLastReportedAudioLevel();
-      bool shouldReport = (last < 0) || (fabs(currentLevel - last) >= AUDIO_THRESHOLD);
-
-      if (shouldReport) {
-        if (updateAudioValue(currentLevel)) {
-          setLastReportedAudioLevel(currentLevel);
-        }
-      }
-    } else {
-      Serial.println("ERROR: Failed to read audio sensor");
-    }
+// One periodic audio monitoring cycle, run by the sensor scheduler
+void audioSensorJob() {
+  double currentLevel;
+  if (!readAudioLevel(currentLevel)) {
+    Serial.println("ERROR: Failed to read audio sensor");
+    return;
+  }
+
+  setSnapshotAudioLevel(currentLevel);
+
+  unsigned long now = millis();
+  audioSummary.sample(currentLevel);
+  bool windowClosed = isCloudReady() && closeSummaryWindow(SUMMARY_AUDIO, audioSummary, audioSummaryPosted, now);
 
-    vTaskDelayUntil(&lastWake, interval);
+  double last = getLastReportedAudioLevel();
+  bool shouldReport = changeReportable(currentLevel, last, AUDIO_THRESHOLD) &&
+                      (SENSOR_CHANGE_REPORTS || windowClosed || last < 0);
+
+  if (shouldReport) {
+    if (reportReading(READING_AUDIO, currentLevel)) {
+      setLastReportedAudioLevel(currentLevel);
+    }
   }
 }
 
-bool startAudioSensorTask() {
-  BaseType_t result = xTaskCreatePinnedToCore(
-    AudioSensorTask, "AudioSensor", 4096, NULL, 1, &audioTaskHandle, 1);
-
-  if (result != pdPASS) {
-    Serial.println("ERROR: Failed to create AudioSensorTask");
+bool scheduleAudioSensorJob() {
+  audioSummary.begin(millis());
+  if (!addSensorJob("audio", audioSensorJob, AUDIO_UPDATE_INTERVAL, AUDIO_JOB_DEADLINE)) {
+    Serial.println("ERROR: Failed to schedule audio sensor job");
     return false;
   }
-
-  Serial.println("AudioSensorTask created successfully");
   return true;
 }
@@ -0,0 +1,328 @@
+/**
+ * battery_mode.cpp
+ *
+ * Everything that must survive deep sleep lives in RTC slow memory; the
+ * rest of the firmware starts from scratch on every wake. The VEML7700 is
+ * shut down between wakes and the radar keeps running, holding OT2 at the
+ * current occupancy level so an edge wakes the ESP32 via ext0.
+ */
+
+#include "battery_mode.h"
+#include "config.h"
+#include "lux_sensor.h"
+#include "occupancy_sensor.h"
+#include "onem2m.h"
+#include "reading_buffer.h"
+#include "provisioning.h"
+#include "connectivity.h"
+#include "diagnostics.h"
+#include "delta_batch.h"
+#include "wifi_manager.h"
+#include <WiFi.h>
+#include <esp_sleep.h>
+#include <time.h>
+
+#define BATTERY_STATE_MAGIC 0x42415454u
+#define BATTERY_MAX_BACKOFF 4   // Failed uplinks stretch the interval up to this factor
+#define DELTA_BATCH_BYTES (BATTERY_BATCH_CAPACITY * 3 + 16)  // Typical need; a larger batch takes two posts
+
+struct BatterySample {
+    uint32_t time;      // Epoch seconds, or seconds since power-on before the first sync
+    float lux;          // NAN if the sensor was unavailable
+    uint8_t occupied;
+    uint8_t wakeCause;
+};
+
+struct BatteryState {
+    uint32_t magic;
+    uint32_t wakeCount;
+    uint32_t nextUplinkWake;
+    uint8_t failedUplinks;
+    uint16_t batchCount;
+    uint32_t dropped;
+    uint32_t uplinks;
+    uint32_t lastRadioMs;
+    uint32_t totalRadioMs;
+    bool provisioned;
+    bool lastOccupied;
+    bool haveSentLux;
+    float lastSentLux;
+    bool haveSentOccupancy;
+    bool lastSentOccupied;
+    BatterySample batch[BATTERY_BATCH_CAPACITY];
+};
+
+RTC_DATA_ATTR static BatteryState state;
+
+// ==================== SAMPLING ====================
+
+static bool clockIsSet(time_t t) {
+    return t >= 1700000000;
+}
+
+static void pushSample(const BatterySample& sample) {
+    if (state.batchCount == BATTERY_BATCH_CAPACITY) {
+        memmove(state.batch, state.batch + 1, sizeof(BatterySample) * (BATTERY_BATCH_CAPACITY - 1));
+        state.batchCount--;
+        state.dropped++;
+    }
+    state.batch[state.batchCount++] = sample;
+}
+
+static void takeSample(esp_sleep_wakeup_cause_t cause) {
+    BatterySample sample = {};
+    sample.time = (uint32_t)time(nullptr);
+    sample.wakeCause = (uint8_t)cause;
+    sample.lux = NAN;
+    sample.occupied = state.lastOccupied;  // Kept if the radar cannot be read
+
+    if (initLuxSensor()) {
+        // Cold VEML7700 needs one full integration before the first read
+        delay(VEML_SETTLE_MS);
+        float lux;
+        if (readLuxValue(lux)) sample.lux = lux;
+    }
+
+    if (initOccupancySensor()) {
+        sample.occupied = digitalRead(OCCUPANCY_OT2_PIN);
+        state.lastOccupied = sample.occupied;
+    }
+
+    pushSample(sample);
+    Serial.printf("Wake %lu (cause %d): lux %.1f, %s, %u buffered\n",
+                  (unsigned long)state.wakeCount, (int)cause, sample.lux,
+                  sample.occupied ? "OCCUPIED" : "EMPTY", state.batchCount);
+}
+
+// ==================== UPLINK ====================
+
+// Samples taken before the first NTP sync carry seconds since power-on
+static void syncClock() {
+    time_t before = time(nullptr);
+    configTime(0, 0, NTP_SERVER);
+
+    struct tm now;
+    if (!getLocalTime(&now, CLOCK_SYNC_TIMEOUT) || clockIsSet(before)) return;
+
+    uint32_t offset = (uint32_t)(time(nullptr) - before);
+    for (uint16_t i = 0; i < state.batchCount; i++) {
+        if (!clockIsSet(state.batch[i].time)) state.batch[i].time += offset;
+    }
+}
+
+static bool ensureProvisioned() {
+    if (state.provisioned) return true;
+
+    // Subscriptions need the notification server, which battery mode never runs
+    state.provisioned = verifyProvisioningCache() || (waitForCSE(1) && provisionResources());
+    return state.provisioned;
+}
+
+static void recordSent(const ReadingUpdate& update) {
+    if (update.kind == READING_LUX) {
+        state.haveSentLux = true;
+        state.lastSentLux = update.value;
+    } else {
+        state.haveSentOccupancy = true;
+        state.lastSentOccupied = update.value != 0.0f;
+    }
+}
+
+// Only changes are sent, pipelined a window at a time; the batch keeps
+// whatever did not go out
+static uint16_t sendBatch() {
+    uint16_t sent = 0;
+
+    while (sent < state.batchCount) {
+        ReadingUpdate updates[ONEM2M_PIPELINE_DEPTH];
+        uint16_t sampleOf[ONEM2M_PIPELINE_DEPTH];
+        char dgt[ONEM2M_PIPELINE_DEPTH][20];
+        size_t count = 0;
+
+        // Plan against the last values sent; state follows what the CSE accepts
+        bool haveLux = state.haveSentLux;
+        float lastLux = state.lastSentLux;
+        bool haveOccupancy = state.haveSentOccupancy;
+        bool lastOccupied = state.lastSentOccupied;
+
+        uint16_t next = sent;
+        for (; next < state.batchCount && count + 2 <= ONEM2M_PIPELINE_DEPTH; next++) {
+            const BatterySample& sample = state.batch[next];
+            char* timestamp = dgt[count];
+            const char* generatedAt = formatTimestamp(sample.time, timestamp, sizeof(dgt[0])) &&
+                clockIsSet(sample.time) ? timestamp : nullptr;
+
+            if (!isnan(sample.lux) && (!haveLux || fabsf(sample.lux - lastLux) >= LUX_THRESHOLD)) {
+                updates[count] = {READING_LUX, sample.lux, generatedAt};
+                sampleOf[count++] = next;
+                haveLux = true;
+                lastLux = sample.lux;
+            }
+
+            bool occupied = sample.occupied;
+            if (!haveOccupancy || occupied != lastOccupied) {
+                updates[count] = {READING_OCCUPANCY, occupied ? 1.0f : 0.0f, generatedAt};
+                sampleOf[count++] = next;
+                haveOccupancy = true;
+                lastOccupied = occupied;
+            }
+        }
+
+        ReadingResult results[ONEM2M_PIPELINE_DEPTH];
+        publishReadings(updates, count, results);
+
+        // Samples count as sent up to the first update the CSE refused
+        bool refused = false;
+        for (size_t i = 0; i < count && !refused; i++) {
+            if (results[i] != READING_PUBLISHED) {
+                next = sampleOf[i];
+                refused = true;
+                continue;
+            }
+            recordSent(updates[i]);
+        }
+        sent = next;
+        if (refused) break;
+    }
+
+    memmove(state.batch, state.batch + sent, sizeof(BatterySample) * (state.batchCount - sent));
+    state.batchCount -= sent;
+    return sent;
+}
+
+// The FlexContainers only get the newest sample; the batch holds the history
+static void publishNewestSample(const BatterySample& sample) {
+    char dgt[20];
+    const char* generatedAt = clockIsSet(sample.time) && formatTimestamp(sample.time, dgt, sizeof(dgt)) ? dgt : nullptr;
+
+    ReadingUpdate updates[2];
+    size_t count = 0;
+    if (!isnan(sample.lux) && (!state.haveSentLux || fabsf(sample.lux - state.lastSentLux) >= LUX_THRESHOLD)) {
+        updates[count++] = {READING_LUX, sample.lux, generatedAt};
+    }
+    if (!state.haveSentOccupancy || (sample.occupied != 0) != state.lastSentOccupied) {
+        updates[count++] = {READING_OCCUPANCY, sample.occupied ? 1.0f : 0.0f, generatedAt};
+    }
+
+    ReadingResult results[2];
+    publishReadings(updates, count, results);
+    for (size_t i = 0; i < count; i++) {
+        if (results[i] == READING_PUBLISHED) recordSent(updates[i]);
+    }
+}
+
+// Every sample goes out, delta-encoded, as one contentInstance per
+// DELTA_BATCH_BYTES; the batch keeps the samples of a post that failed
+static uint16_t sendDeltaBatch() {
+    String path = onem2mPaths.DESK_PATH + "/" + DELTA_BATCH_CONTAINER;
+    uint16_t sent = 0;
+
+    while (sent < state.batchCount) {
+        uint8_t encoded[DELTA_BATCH_BYTES];
+        DeltaBatchEncoder encoder(encoded, sizeof(encoded), LUX_QUANTUM);
+        uint16_t next = sent;
+        while (next < state.batchCount &&
+               encoder.add(state.batch[next].time, state.batch[next].lux, state.batch[next].occupied)) {
+            next++;
+        }
+        if (next == sent) break;  // Cannot happen with DELTA_BATCH_BYTES, but never loop on it
+
+        char content[base64Capacity(DELTA_BATCH_BYTES)];
+        base64Encode(encoded, encoder.length(), content, sizeof(content));
+        StaticJsonDocument<256> doc;
+        JsonObject cin = doc.createNestedObject("m2m:cin");
+        cin["cnf"] = DELTA_BATCH_CONTENT_FORMAT;
+        cin["con"] = (const char*)content;  // Referenced, not copied into the document
+
+        int statusCode;
+        oneM2MPost(path, doc, ONEM2M_RT_CONTENT_INSTANCE, statusCode);
+        if (statusCode != 201) break;
+        Serial.printf("Batch of %u samples in %u bytes\n", (unsigned)encoder.count(), (unsigned)encoder.length());
+        sent = next;
+    }
+    if (sent > 0) publishNewestSample(state.batch[sent - 1]);
+
+    memmove(state.batch, state.batch + sent, sizeof(BatterySample) * (state.batchCount - sent));
+    state.batchCount -= sent;
+    return sent;
+}
+
+static void publishBatteryReport(uint16_t sent) {
+    StaticJsonDocument<256> doc;
+    doc["wakes"] = state.wakeCount;
+    doc["uplinks"] = state.uplinks;
+    doc["sent"] = sent;
+    doc["pending"] = state.batchCount;
+    doc["dropped"] = state.dropped;
+    doc["lastRadioMs"] = state.lastRadioMs;
+    doc["totalRadioMs"] = state.totalRadioMs;
+
+    publishDiagnostics("battery", doc);
+}
+
+static bool uplink() {
+    unsigned long radioStart = millis();
+    bool success = false;
+    uint16_t sent = 0;
+
+    if (startWiFiManager() && waitForWiFi(BATTERY_UPLINK_TIMEOUT)) {
+        syncClock();
+        onem2mPaths.initialize(CSE_HOST, CSE_PORT, CSE_NAME, AE_NAME, ROOM_CONTAINER, DESK_CONTAINER, LUX_DEVICE_NAME,
+                               CSE_USE_TLS);
+
+        if (initOneM2MClient() && ensureProvisioned()) {
+            sent = BATTERY_DELTA_BATCH ? sendDeltaBatch() : sendBatch();
+            success = (state.batchCount == 0);
+            state.uplinks++;
+            publishBatteryReport(sent);
+        }
+    }
+
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+
+    state.lastRadioMs = millis() - radioStart;
+    state.totalRadioMs += state.lastRadioMs;
+    Serial.printf("Uplink %s: %u sent, %u pending, radio on %lu ms\n",
+                  success ? "done" : "incomplete", sent, state.batchCount,
+                  (unsigned long)state.lastRadioMs);
+    return success;
+}
+
+// ==================== WAKE CYCLE ====================
+
+static void scheduleNextUplink(bool success) {
+    state.failedUplinks = success ? 0 : min((uint8_t)BATTERY_MAX_BACKOFF, (uint8_t)(state.failedUplinks + 1));
+    state.nextUplinkWake = state.wakeCount + BATTERY_UPLINK_EVERY * (state.failedUplinks ? state.failedUplinks : 1);
+}
+
+static void enterDeepSleep() {
+    shutdownLuxSensor();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)BATTERY_WAKE_INTERVAL * 1000);
+    // Wake on the next occupancy edge: OT2 leaving its current level
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)OCCUPANCY_OT2_PIN, state.lastOccupied ? 0 : 1);
+
+    Serial.flush();
+    esp_deep_sleep_start();
+}
+
+void runBatteryWakeCycle() {
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (state.magic != BATTERY_STATE_MAGIC) {
+        // Power-on: RTC memory holds garbage. Soft resets keep the batch.
+        memset(&state, 0, sizeof(state));
+        state.magic = BATTERY_STATE_MAGIC;
+    }
+
+    state.wakeCount++;
+    takeSample(cause);
+
+    // First wake uplinks immediately to provision and sync the clock. A full
+    // batch drops its oldest sample rather than forcing an early uplink.
+    if (state.wakeCount == 1 || state.wakeCount >= state.nextUplinkWake) {
+        scheduleNextUplink(uplink());
+    }
+
+    enterDeepSleep();
+}
@@ -0,0 +1,112 @@
+/**
+ * circuit_breaker.cpp
+ *
+ * State lives under a spinlock so any task may report outcomes; logging
+ * happens after the lock is released.
+ */
+
+#include "circuit_breaker.h"
+#include "metrics.h"
+#include "trace.h"
+
+// ==================== BACKOFF ====================
+
+uint32_t jitteredDelay(uint32_t ms) {
+    return ms / 2 + (uint32_t)random(ms / 2 + 1);
+}
+
+uint32_t backoffDelay(uint32_t baseMs, uint32_t maxMs, uint8_t attempt) {
+    uint64_t ms = (uint64_t)baseMs << min(attempt, (uint8_t)20);
+    return jitteredDelay((uint32_t)min(ms, (uint64_t)maxMs));
+}
+
+// ==================== CIRCUIT BREAKER ====================
+
+bool CircuitBreaker::enter(BreakerState next) {
+    if (current == next) return false;
+    current = next;
+    metricRaise(METRIC_BREAKER_STATE, next);
+    if (next == BREAKER_OPEN) metricIncrement(METRIC_BREAKER_OPENS);
+    else if (next == BREAKER_CLOSED) metricIncrement(METRIC_BREAKER_CLOSES);
+    TRACE(TRACE_BREAKER, next);
+    return true;
+}
+
+bool CircuitBreaker::allowRequest() {
+    portENTER_CRITICAL(&mux);
+    bool allowed = (current == BREAKER_CLOSED);
+    bool probing = false;
+    if (current == BREAKER_OPEN && millis() - openedAt >= openMs) {
+        probing = enter(BREAKER_HALF_OPEN);
+        allowed = true;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (probing) Serial.println("CSE breaker half-open - probing");
+    if (!allowed) metricIncrement(METRIC_FAST_FAILS);
+    return allowed;
+}
+
+void CircuitBreaker::recordSuccess() {
+    portENTER_CRITICAL(&mux);
+    failures = 0;
+    trips = 0;
+    bool closed = enter(BREAKER_CLOSED);
+    portEXIT_CRITICAL(&mux);
+
+    if (closed) Serial.println("CSE breaker closed");
+}
+
+void CircuitBreaker::recordFailure() {
+    portENTER_CRITICAL(&mux);
+    bool opened = false;
+    // Failures of requests sent before the breaker opened change nothing
+    if (current == BREAKER_HALF_OPEN || (current == BREAKER_CLOSED && ++failures >= threshold)) {
+        openMs = backoffDelay(baseOpenMs, maxOpenMs, trips);
+        if (trips < UINT8_MAX) trips++;
+        openedAt = millis();
+        failures = 0;
+        opened = enter(BREAKER_OPEN);
+    }
+    uint32_t openFor = openMs;
+    portEXIT_CRITICAL(&mux);
+
+    if (opened) Serial.printf("CSE breaker open for %lu ms\n", (unsigned long)openFor);
+}
+
+BreakerState CircuitBreaker::state() const {
+    portENTER_CRITICAL(&mux);
+    BreakerState state = current;
+    portEXIT_CRITICAL(&mux);
+    return state;
+}
+
+uint32_t CircuitBreaker::msUntilProbe() const {
+    portENTER_CRITICAL(&mux);
+    uint32_t wait = 0;
+    if (current == BREAKER_OPEN) {
+        uint32_t elapsed = millis() - openedAt;
+        wait = elapsed < openMs ? openMs - elapsed : 0;
+    } else if (current == BREAKER_HALF_OPEN) {
+        wait = baseOpenMs;  // The probe's outcome decides
+    }
+    portEXIT_CRITICAL(&mux);
+    return wait;
+}
+
+// ==================== RETRY BUDGET ====================
+
+bool RetryBudget::tryAcquire() {
+    unsigned long now = millis();
+    portENTER_CRITICAL(&mux);
+    if (now - windowStart >= windowMs) {
+        windowStart = now;
+        used = 0;
+    }
+    bool allowed = (used < limit);
+    if (allowed) used++;
+    portEXIT_CRITICAL(&mux);
+
+    if (!allowed) metricIncrement(METRIC_RETRIES_DENIED);
+    return allowed;
+}
@@ -0,0 +1,170 @@
+/**
+ * connectivity.cpp
+ *
+ * Clock and CSE bring-up with jittered exponential backoff, provisioning,
+ * buffered reading replay and the boot timeline diagnostics record
+ */
+
+#include "connectivity.h"
+#include "config.h"
+#include "onem2m.h"
+#include "provisioning.h"
+#include "led_actuator.h"
+#include "reading_buffer.h"
+#include "diagnostics.h"
+#include "task_plan.h"
+#include "wifi_manager.h"
+#include <time.h>
+
+static volatile bool cloudReady = false;
+static TaskHandle_t connectivityTask = nullptr;
+
+// ==================== BOOT TIMELINE ====================
+
+static const char* const BOOT_PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "sensorsStarted",
+    "firstSample",
+    "wifiConnected",
+    "clockSynced",
+    "cseReachable",
+    "provisioned",
+    "bufferFlushed",
+};
+
+static uint32_t bootPhaseMs[BOOT_PHASE_COUNT] = {};
+static portMUX_TYPE bootMux = portMUX_INITIALIZER_UNLOCKED;
+
+void markBootPhase(BootPhase phase) {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&bootMux);
+    if (bootPhaseMs[phase] == 0) bootPhaseMs[phase] = now ? now : 1;
+    portEXIT_CRITICAL(&bootMux);
+}
+
+static void publishBootTimeline(size_t replayed) {
+    StaticJsonDocument<512> doc;
+    JsonObject phases = doc.createNestedObject("phasesMs");
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (bootPhaseMs[i]) phases[BOOT_PHASE_NAMES[i]] = bootPhaseMs[i];
+    }
+    doc["wifiAttempts"] = getWiFiStats().connectAttempts;
+    doc["replayed"] = replayed;
+    doc["dropped"] = getDroppedReadingCount();
+
+    publishDiagnostics("boot", doc);
+
+    Serial.print("Boot timeline:");
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (bootPhaseMs[i]) Serial.printf(" %s=%lu", BOOT_PHASE_NAMES[i], (unsigned long)bootPhaseMs[i]);
+    }
+    Serial.println(" ms");
+}
+
+// ==================== BRING-UP ====================
+
+static void waitBackoff(uint8_t& attempt) {
+    vTaskDelay(pdMS_TO_TICKS(backoffDelay(CONNECT_BACKOFF_MIN_MS, CONNECT_BACKOFF_MAX_MS, attempt)));
+    if (attempt < UINT8_MAX) attempt++;
+}
+
+static void connectWiFi() {
+    if (!startWiFiManager()) {
+        Serial.println("ERROR: WiFi manager failed");
+        return;
+    }
+    waitForWiFi(UINT32_MAX);
+    markBootPhase(BOOT_WIFI_CONNECTED);
+}
+
+static void syncClock() {
+    configTime(0, 0, NTP_SERVER);
+
+    struct tm now;
+    if (getLocalTime(&now, CLOCK_SYNC_TIMEOUT)) {
+        markBootPhase(BOOT_CLOCK_SYNCED);
+    } else {
+        Serial.println("Clock not synchronized - buffered readings sent without dgt");
+    }
+}
+
+static void provisionWithBackoff() {
+    // Warm boot: one discovery request replaces CSE polling and creation
+    if (verifyProvisioningCache()) {
+        markBootPhase(BOOT_CSE_REACHABLE);
+        markBootPhase(BOOT_PROVISIONED);
+        return;
+    }
+
+    uint8_t attempt = 0;
+    while (!waitForCSE(1)) {
+        waitBackoff(attempt);
+    }
+    markBootPhase(BOOT_CSE_REACHABLE);
+
+    // Not online until the tree exists: readings PUT to missing resources
+    // would be rejected and lost, so they stay buffered meanwhile
+    attempt = 0;
+    while (!(provisionResources() &&
+             waitForNotificationServer(NOTIFICATION_SERVER_TIMEOUT) &&
+             provisionSubscriptions())) {
+        Serial.println("Provisioning incomplete - retrying, readings stay buffered");
+        waitBackoff(attempt);
+    }
+    saveProvisioningCache();
+    markBootPhase(BOOT_PROVISIONED);
+}
+
+static void ConnectivityTask(void* pvParameters) {
+    connectWiFi();
+    syncClock();
+    provisionWithBackoff();
+    cloudReady = true;
+
+    size_t replayed = flushReadingBuffer();
+    markBootPhase(BOOT_BUFFER_FLUSHED);
+    publishBootTimeline(replayed);
+
+    Serial.println("\nSystem online\n");
+
+    // The sensor jobs only queue; every PUT for them goes out from here
+    while (true) {
+        // Readings the CSE could not take are replayed no faster than the
+        // breaker lets a probe through
+        while (readingsPending()) {
+            uint32_t waitMs = max(oneM2MProbeDelayMs(), (uint32_t)READING_REPLAY_INTERVAL_MS);
+            vTaskDelay(pdMS_TO_TICKS(waitMs));
+            flushReadingBuffer();
+        }
+
+        // Woken for every queued reading and summary
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        flushReadingBuffer();
+    }
+}
+
+// ==================== PUBLIC API ====================
+
+bool startConnectivity() {
+    return startPlannedTask(TASK_CONNECTIVITY, ConnectivityTask, &connectivityTask);
+}
+
+void requestReadingReplay() {
+    if (cloudReady && connectivityTask) xTaskNotifyGive(connectivityTask);
+}
+
+bool isCloudReady() {
+    return cloudReady;
+}
+
+bool formatSampleTime(unsigned long sampleMs, char* out, size_t len) {
+    time_t now = time(nullptr);
+    if (now < 1700000000) return false;  // Clock not set
+
+    return formatTimestamp(now - (time_t)((millis() - sampleMs) / 1000), out, len);
+}
+
+bool formatTimestamp(time_t t, char* out, size_t len) {
+    struct tm utc;
+    gmtime_r(&t, &utc);
+    return strftime(out, len, "%Y%m%dT%H%M%S", &utc) > 0;
+}
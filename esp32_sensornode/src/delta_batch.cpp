@@ -0,0 +1,72 @@
+/**
+ * delta_batch.cpp
+ */
+
+#include "delta_batch.h"
+
+// ==================== ENCODER ====================
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+DeltaBatchEncoder::DeltaBatchEncoder(uint8_t* buffer, size_t capacity, float luxQuantum)
+    : buffer(buffer), capacity(capacity), luxQuantum(isfinite(luxQuantum) && luxQuantum > 0 ? luxQuantum : 1.0f) {
+    if (capacity == 0) return;
+    buffer[used++] = DELTA_BATCH_VERSION;
+    if (!putVarint((uint64_t)lroundf(this->luxQuantum * 1000))) used = capacity;  // Nothing will fit
+}
+
+bool DeltaBatchEncoder::putVarint(uint64_t value) {
+    do {
+        if (used == capacity) return false;
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        buffer[used++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return true;
+}
+
+bool DeltaBatchEncoder::add(uint32_t time, float lux, bool occupied) {
+    size_t mark = used;
+    // A non-finite or out-of-range reading goes as no reading: lroundf()
+    // is undefined for it
+    float steps = lux / luxQuantum;
+    bool hasLux = isfinite(steps) && fabsf(steps) < (float)INT32_MAX;
+    int64_t interval = samples == 0 ? 0 : (int64_t)time - (int64_t)lastTime;
+    int32_t luxSteps = hasLux ? (int32_t)lroundf(steps) : lastLuxSteps;
+
+    bool fits = (samples > 0 || putVarint(time)) &&
+                putVarint(zigzag(interval - lastInterval) << 2 | (occupied ? 2 : 0) | (hasLux ? 1 : 0)) &&
+                (!hasLux || putVarint(zigzag((int64_t)luxSteps - lastLuxSteps)));
+    if (!fits) {
+        used = mark;
+        return false;
+    }
+
+    samples++;
+    lastTime = time;
+    lastInterval = interval;
+    lastLuxSteps = luxSteps;
+    return true;
+}
+
+// ==================== BASE64 ====================
+
+size_t base64Encode(const uint8_t* data, size_t length, char* out, size_t capacity) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    if (capacity < base64Capacity(length)) return 0;
+
+    size_t written = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = (uint32_t)data[i] << 16;
+        if (i + 1 < length) group |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) group |= data[i + 2];
+        out[written++] = ALPHABET[(group >> 18) & 0x3F];
+        out[written++] = ALPHABET[(group >> 12) & 0x3F];
+        out[written++] = i + 1 < length ? ALPHABET[(group >> 6) & 0x3F] : '=';
+        out[written++] = i + 2 < length ? ALPHABET[group & 0x3F] : '=';
+    }
+    out[written] = '\0';
+    return written;
+}
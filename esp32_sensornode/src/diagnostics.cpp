@@ -0,0 +1,30 @@
+/**
+ * diagnostics.cpp
+ *
+ * Diagnostics container and record publishing
+ */
+
+#include "diagnostics.h"
+#include "onem2m.h"
+#include "config.h"
+#include "connectivity.h"
+
+bool publishDiagnostics(const char* kind, const JsonDocument& record) {
+    if (!isCloudReady()) return false;
+
+    String content;
+    serializeJson(record, content);
+
+    DynamicJsonDocument doc(content.length() + 256);
+    JsonObject cin = doc.createNestedObject("m2m:cin");
+    cin["cnf"] = "application/json:0";
+    cin["con"] = content;
+    JsonArray lbl = cin.createNestedArray("lbl");
+    lbl.add(String("diag:") + kind);
+
+    int statusCode;
+    String path = onem2mPaths.DESK_PATH + "/" + DIAGNOSTICS_CONTAINER;
+    oneM2MPost(path, doc, ONEM2M_RT_CONTENT_INSTANCE, statusCode);
+
+    return statusCode == 201;
+}
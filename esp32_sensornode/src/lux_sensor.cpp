@@ -5,29 +5,38 @@
  */
 
 #include "lux_sensor.h"
-#include "onem2m.h"
+#include "reading_buffer.h"
 #include "config.h"
+#include "sensor_scheduler.h"
+#include "sensor_snapshot.h"
+#include "metrics.h"
+#include "report_policy.h"
+#include "onem2m.h"
+#include "connectivity.h"
 #include <Wire.h>
 
 // ==================== GLOBAL STATE ====================
 
 LuxSensorState luxState = {
-    .currentLux = 0.0,
     .lastReportedLux = -1.0,
-    .initialized = false,
-    .mutex = NULL
+    .initialized = false
 };
 
 // Local sensor instance
 static Adafruit_VEML7700 veml;
-static TaskHandle_t luxTaskHandle = NULL;
+
+// Open and last posted summary window (owned by luxSensorJob)
+static WindowAggregator<float> luxSummary;
+static WindowAggregator<float> luxSummaryPosted;
 
 // ==================== SENSOR INITIALIZATION ====================
 
 bool initLuxSensor() {
+    if (luxState.initialized) return true;
+
     Serial.println("\n=== Initializing VEML7700 ===");
 
-    // Initialize I2C
+    // Initialize I2C (no-op if the bus is already up)
     Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
 
     // Initialize sensor
@@ -36,19 +45,18 @@ bool initLuxSensor() {
         return false;
     }
 
-    // Create mutex for thread-safe access
-    luxState.mutex = xSemaphoreCreateMutex();
-    if (luxState.mutex == NULL) {
-        Serial.println("ERROR: Failed to create lux mutex");
-        return false;
-    }
-
     luxState.initialized = true;
     Serial.println("VEML7700 initialized successfully");
 
     return true;
 }
 
+void shutdownLuxSensor() {
+    if (!luxState.initialized) return;
+    veml.enable(false);
+    luxState.initialized = false;
+}
+
 // ==================== SENSOR READING ====================
 
 bool readLuxValue(float& luxValue) {
@@ -56,83 +64,61 @@ bool readLuxValue(float& luxValue) {
         return false;
     }
 
+    unsigned long start = micros();
     luxValue = veml.readLux();
+    metricObserve(METRIC_LUX_READ_US, micros() - start);
     return true;
 }
 
 float getLastReportedLux() {
-    float value;
-    xSemaphoreTake(luxState.mutex, portMAX_DELAY);
-    value = luxState.lastReportedLux;
-    xSemaphoreGive(luxState.mutex);
-    return value;
+    return luxState.lastReportedLux;
 }
 
 void setLastReportedLux(float luxValue) {
-    xSemaphoreTake(luxState.mutex, portMAX_DELAY);
     luxState.lastReportedLux = luxValue;
-    xSemaphoreGive(luxState.mutex);
 }
 
-// ==================== FREERTOS TASK ====================
+// ==================== SCHEDULED JOB ====================
 
-void LuxSensorTask(void* pvParameters) {
-    Serial.println("LuxSensorTask started");
+void luxSensorJob() {
+    float currentLux;
 
-    TickType_t lastWakeTime = xTaskGetTickCount();
-    const TickType_t updateInterval = pdMS_TO_TICKS(LUX_UPDATE_INTERVAL);
+    // Read sensor
+    if (!readLuxValue(currentLux)) {
+        Serial.println("ERROR: Failed to read lux sensor");
+        return;
+    }
 
-    while (true) {
-        float currentLux;
+    // Publish current value to readers without blocking
+    setSnapshotLux(currentLux);
 
-        // Read sensor
-        if (readLuxValue(currentLux)) {
-            // Update current value (thread-safe)
-            xSemaphoreTake(luxState.mutex, portMAX_DELAY);
-            luxState.currentLux = currentLux;
-            xSemaphoreGive(luxState.mutex);
+    // While offline the window keeps growing instead of being dropped
+    unsigned long now = millis();
+    luxSummary.sample(currentLux);
+    bool windowClosed = isCloudReady() && closeSummaryWindow(SUMMARY_LUX, luxSummary, luxSummaryPosted, now);
 
-            float lastReported = getLastReportedLux();
+    float lastReported = getLastReportedLux();
 
-            // Check if change is significant enough to report
-            bool shouldReport = (lastReported < 0) ||
-                              (abs(currentLux - lastReported) >= LUX_THRESHOLD);
+    // Check if change is significant enough to report; without change
+    // reports only once per summary window
+    bool shouldReport = changeReportable(currentLux, lastReported, LUX_THRESHOLD) &&
+                        (SENSOR_CHANGE_REPORTS || windowClosed || lastReported < 0);
 
-            if (shouldReport) {
-                Serial.println("Lux reading: " + String(currentLux) + " lux");
+    if (shouldReport) {
+        Serial.println("Lux reading: " + String(currentLux) + " lux");
 
-                // Update OneM2M
-                if (updateLuxValue(currentLux)) {
-                    setLastReportedLux(currentLux);
-                }
-            }
-        } else {
-            Serial.println("ERROR: Failed to read lux sensor");
+        // Queued for the connectivity task
+        if (reportReading(READING_LUX, currentLux)) {
+            setLastReportedLux(currentLux);
         }
-
-        // Wait for next update interval
-        vTaskDelayUntil(&lastWakeTime, updateInterval);
     }
 }
 
-// ==================== TASK MANAGEMENT ====================
-
-bool startLuxSensorTask() {
-    BaseType_t result = xTaskCreatePinnedToCore(
-        LuxSensorTask,
-        "LuxSensor",
-        LUX_TASK_STACK_SIZE,
-        NULL,
-        LUX_TASK_PRIORITY,
-        &luxTaskHandle,
-        0  // Core 0
-    );
-
-    if (result != pdPASS) {
-        Serial.println("ERROR: Failed to create LuxSensorTask");
+bool scheduleLuxSensorJob() {
+    luxSummary.begin(millis());
+    if (!addSensorJob("lux", luxSensorJob, LUX_UPDATE_INTERVAL, LUX_JOB_DEADLINE)) {
+        Serial.println("ERROR: Failed to schedule lux sensor job");
         return false;
     }
-
-    Serial.println("LuxSensorTask created successfully");
     return true;
 }
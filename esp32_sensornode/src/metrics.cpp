@@ -0,0 +1,169 @@
+/**
+ * metrics.cpp
+ *
+ * Storage is one atomic word per counter/gauge and per histogram bucket,
+ * so instrumented paths never take a lock or allocate. Histograms are
+ * reset on every report; percentiles are bucket upper bounds.
+ */
+
+#include "metrics.h"
+#include "config.h"
+#include "onem2m.h"
+#include "connectivity.h"
+#include <atomic>
+
+static const uint32_t LATENCY_BOUNDS_MS[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+static const uint32_t READ_BOUNDS_US[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000 };
+static const uint32_t HANDSHAKE_BOUNDS_MS[] = { 25, 50, 100, 250, 500, 1000, 2000, 4000 };
+
+#define BOUNDS(array) array, (uint8_t)(sizeof(array) / sizeof(array[0]))
+
+const MetricDefinition METRICS[METRIC_COUNT] = {
+    { "httpRequests",        METRIC_COUNTER,   NULL, 0 },
+    { "httpTransportErrors", METRIC_COUNTER,   NULL, 0 },
+    { "httpClientErrors",    METRIC_COUNTER,   NULL, 0 },
+    { "httpServerErrors",    METRIC_COUNTER,   NULL, 0 },
+    { "httpLatencyMs",       METRIC_HISTOGRAM, BOUNDS(LATENCY_BOUNDS_MS) },
+    { "poolWaitMs",          METRIC_MAX_GAUGE, NULL, 0 },
+    { "readingBufferDepth",  METRIC_MAX_GAUGE, NULL, 0 },
+    { "luxReadUs",           METRIC_HISTOGRAM, BOUNDS(READ_BOUNDS_US) },
+    { "audioReadUs",         METRIC_HISTOGRAM, BOUNDS(READ_BOUNDS_US) },
+    { "breakerState",        METRIC_MAX_GAUGE, NULL, 0 },
+    { "breakerOpens",        METRIC_COUNTER,   NULL, 0 },
+    { "breakerCloses",       METRIC_COUNTER,   NULL, 0 },
+    { "fastFails",           METRIC_COUNTER,   NULL, 0 },
+    { "retriesDenied",       METRIC_COUNTER,   NULL, 0 },
+    { "tlsFullHandshakes",   METRIC_COUNTER,   NULL, 0 },
+    { "tlsResumed",          METRIC_COUNTER,   NULL, 0 },
+    { "tlsFailures",         METRIC_COUNTER,   NULL, 0 },
+    { "tlsHandshakeMs",      METRIC_HISTOGRAM, BOUNDS(HANDSHAKE_BOUNDS_MS) },
+};
+
+static_assert(sizeof(LATENCY_BOUNDS_MS) / sizeof(uint32_t) < METRIC_MAX_BUCKETS, "too many latency buckets");
+static_assert(sizeof(READ_BOUNDS_US) / sizeof(uint32_t) < METRIC_MAX_BUCKETS, "too many read buckets");
+static_assert(sizeof(HANDSHAKE_BOUNDS_MS) / sizeof(uint32_t) < METRIC_MAX_BUCKETS, "too many handshake buckets");
+
+static std::atomic<uint32_t> values[METRIC_COUNT];
+static std::atomic<uint32_t> buckets[METRIC_COUNT][METRIC_MAX_BUCKETS];
+
+// ==================== UPDATES ====================
+
+static void raiseMax(std::atomic<uint32_t>& slot, uint32_t value) {
+    uint32_t current = slot.load(std::memory_order_relaxed);
+    while (value > current &&
+           !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void metricIncrement(MetricId id, uint32_t amount) {
+    values[id].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void metricRaise(MetricId id, uint32_t value) {
+    raiseMax(values[id], value);
+}
+
+void metricObserve(MetricId id, uint32_t value) {
+    const MetricDefinition& metric = METRICS[id];
+    uint8_t bucket = 0;
+    while (bucket < metric.boundCount && value > metric.bounds[bucket]) bucket++;
+
+    buckets[id][bucket].fetch_add(1, std::memory_order_relaxed);
+    raiseMax(values[id], value);  // Histograms keep their max in the value slot
+}
+
+// ==================== SNAPSHOTS ====================
+
+uint32_t metricValue(MetricId id) {
+    return values[id].load(std::memory_order_relaxed);
+}
+
+uint32_t takeMetricMax(MetricId id) {
+    return values[id].exchange(0, std::memory_order_relaxed);
+}
+
+// Observations racing with the reset land in either window, never lost
+HistogramSnapshot takeHistogram(MetricId id) {
+    HistogramSnapshot snapshot = {};
+    snapshot.bucketCount = METRICS[id].boundCount + 1;
+    for (uint8_t i = 0; i < snapshot.bucketCount; i++) {
+        snapshot.buckets[i] = buckets[id][i].exchange(0, std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.max = takeMetricMax(id);
+    return snapshot;
+}
+
+uint32_t histogramQuantile(const HistogramSnapshot& snapshot, const uint32_t* bounds, float q) {
+    if (snapshot.count == 0) return 0;
+
+    uint32_t rank = (uint32_t)ceilf(q * snapshot.count);
+    if (rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < snapshot.bucketCount - 1; i++) {
+        seen += snapshot.buckets[i];
+        if (seen >= rank) return min(bounds[i], snapshot.max);
+    }
+    return snapshot.max;
+}
+
+// ==================== PUBLISHING ====================
+
+static unsigned long lastPublish = 0;
+
+bool publishMetrics() {
+    if (!isCloudReady()) return false;
+
+    unsigned long now = millis();
+    uint32_t intervalMs = now - lastPublish;
+    lastPublish = now;
+
+    typedef MioNodeMetrics M;
+    HistogramSnapshot latency = takeHistogram(METRIC_HTTP_LATENCY_MS);
+    HistogramSnapshot luxRead = takeHistogram(METRIC_LUX_READ_US);
+    HistogramSnapshot audioRead = takeHistogram(METRIC_AUDIO_READ_US);
+    HistogramSnapshot handshake = takeHistogram(METRIC_TLS_HANDSHAKE_MS);
+    FlexList<uint32_t> latencyBuckets = { latency.buckets, latency.bucketCount };
+    // A breaker that stays open raises no new maximum
+    uint32_t breakerState = max(takeMetricMax(METRIC_BREAKER_STATE), (uint32_t)oneM2MBreakerState());
+
+    DynamicJsonDocument doc(1024);
+    JsonObject flex = doc.createNestedObject(M::TYPE);
+    writeFlex<M>(flex,
+                 flexField<M::upt>((uint32_t)(now / 1000)),
+                 flexField<M::ivl>(intervalMs / 1000),
+                 flexField<M::hpf>(ESP.getFreeHeap()),
+                 flexField<M::hpm>(ESP.getMinFreeHeap()),
+                 flexField<M::hlb>(ESP.getMaxAllocHeap()),
+                 flexField<M::rqc>(metricValue(METRIC_HTTP_REQUESTS)),
+                 flexField<M::rqt>(metricValue(METRIC_HTTP_TRANSPORT_ERRORS)),
+                 flexField<M::rq4>(metricValue(METRIC_HTTP_CLIENT_ERRORS)),
+                 flexField<M::rq5>(metricValue(METRIC_HTTP_SERVER_ERRORS)),
+                 flexField<M::l50>(histogramQuantile(latency, LATENCY_BOUNDS_MS, 0.50f)),
+                 flexField<M::l90>(histogramQuantile(latency, LATENCY_BOUNDS_MS, 0.90f)),
+                 flexField<M::l99>(histogramQuantile(latency, LATENCY_BOUNDS_MS, 0.99f)),
+                 flexField<M::lmx>(latency.max),
+                 flexField<M::lhs>(latencyBuckets),
+                 flexField<M::pwm>(takeMetricMax(METRIC_POOL_WAIT_MS)),
+                 flexField<M::rbd>(takeMetricMax(METRIC_READING_BUFFER_DEPTH)),
+                 flexField<M::lxr>(histogramQuantile(luxRead, READ_BOUNDS_US, 0.90f)),
+                 flexField<M::adr>(histogramQuantile(audioRead, READ_BOUNDS_US, 0.90f)),
+                 flexField<M::bks>(breakerState),
+                 flexField<M::bko>(metricValue(METRIC_BREAKER_OPENS)),
+                 flexField<M::bkc>(metricValue(METRIC_BREAKER_CLOSES)),
+                 flexField<M::ffc>(metricValue(METRIC_FAST_FAILS)),
+                 flexField<M::rtd>(metricValue(METRIC_RETRIES_DENIED)),
+                 flexField<M::tlf>(metricValue(METRIC_TLS_FULL_HANDSHAKES)),
+                 flexField<M::tlr>(metricValue(METRIC_TLS_RESUMED_HANDSHAKES)),
+                 flexField<M::tle>(metricValue(METRIC_TLS_HANDSHAKE_FAILURES)),
+                 flexField<M::th9>(histogramQuantile(handshake, HANDSHAKE_BOUNDS_MS, 0.90f)),
+                 flexField<M::thx>(handshake.max));
+
+    char generatedAt[20];
+    if (formatSampleTime(now, generatedAt, sizeof(generatedAt))) {
+        writeFlex<M>(flex, flexField<M::dgt>((const char*)generatedAt));
+    }
+
+    return putFlex(onem2mPaths.DESK_PATH + "/" + METRICS_CONTAINER, doc);
+}
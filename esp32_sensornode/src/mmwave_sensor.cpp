@@ -0,0 +1,88 @@
+/**
+ * mmwave_sensor.cpp
+ *
+ * S3KM1110 command transport and ACK parsing
+ */
+
+#include "mmwave_sensor.h"
+
+namespace {
+
+constexpr uint8_t FRAME_HEADER[4] = {0xFD, 0xFC, 0xFB, 0xFA};
+constexpr uint8_t FRAME_TAIL[4] = {0x04, 0x03, 0x02, 0x01};
+
+template <size_t N>
+constexpr bool frameEquals(const RadarFrame<N>& frame, const uint8_t (&expected)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        if (frame.bytes[i] != expected[i]) return false;
+    }
+    return true;
+}
+
+// Normal-mode command previously sent as "FDFCFBFA0800120000006400000004030201"
+constexpr uint8_t LEGACY_NORMAL_MODE[] = {
+    0xFD, 0xFC, 0xFB, 0xFA, 0x08, 0x00, 0x12, 0x00, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x04, 0x03, 0x02, 0x01
+};
+static_assert(frameEquals(radarSystemModeFrame(RADAR_MODE_NORMAL), LEGACY_NORMAL_MODE),
+              "S3KM1110 frame encoder mismatch");
+
+}  // namespace
+
+RadarAckResult RadarAckParser::feed(uint8_t byte) {
+    if (received < sizeof(FRAME_HEADER)) {
+        if (byte != FRAME_HEADER[received]) {
+            received = (byte == FRAME_HEADER[0]) ? 1 : 0;
+            if (received) buffer[0] = byte;
+            return RadarAckResult::Pending;
+        }
+        buffer[received++] = byte;
+        return RadarAckResult::Pending;
+    }
+
+    buffer[received++] = byte;
+
+    if (received == 6) {
+        frameLength = 4 + 2 + (buffer[4] | (buffer[5] << 8)) + 4;
+        if (frameLength > sizeof(buffer) || frameLength < 12) {
+            received = 0;
+        }
+        return RadarAckResult::Pending;
+    }
+
+    if (received < 6 || received < frameLength) {
+        return RadarAckResult::Pending;
+    }
+
+    received = 0;
+    if (memcmp(&buffer[frameLength - 4], FRAME_TAIL, sizeof(FRAME_TAIL)) != 0) {
+        return RadarAckResult::Pending;
+    }
+
+    uint16_t command = buffer[6] | (buffer[7] << 8);
+    if (command != expected) {
+        return RadarAckResult::Pending;  // Unrelated frame, keep waiting
+    }
+
+    uint16_t status = (frameLength >= 14) ? (buffer[8] | (buffer[9] << 8)) : 0;
+    return (status == 0) ? RadarAckResult::Ok : RadarAckResult::Rejected;
+}
+
+RadarAckResult radarTransact(HardwareSerial& serial, const uint8_t* bytes, size_t length,
+                             uint16_t command, uint32_t timeoutMs) {
+    while (serial.available()) serial.read();
+
+    serial.write(bytes, length);
+    serial.flush();
+
+    RadarAckParser parser(command);
+    unsigned long start = millis();
+    while (millis() - start < timeoutMs) {
+        while (serial.available()) {
+            RadarAckResult result = parser.feed(serial.read());
+            if (result != RadarAckResult::Pending) return result;
+        }
+        delay(2);
+    }
+    return RadarAckResult::Timeout;
+}
@@ -1,84 +1,270 @@
 #include "occupancy_sensor.h"
 #include "config.h"
 #include "onem2m.h"
+#include "sensor_scheduler.h"
+#include "sensor_snapshot.h"
+#include "reading_buffer.h"
+#include "connectivity.h"
 #include <HardwareSerial.h>
 
 static HardwareSerial radarSerial(1);
-static TaskHandle_t occupancyTaskHandle = NULL;
-static SemaphoreHandle_t occupancyMutex = NULL;
-static volatile bool isOccupied = false;
 static bool lastReportedState = false;
 
-void sendHexData(String hexString) {
-    int len = hexString.length();
-    byte bytes[len / 2];
-    for (int i = 0; i < len; i += 2) {
-        bytes[i / 2] = strtoul(hexString.substring(i, i + 2).c_str(), NULL, 16);
+// Presence statistics and window summary, open and last posted (owned by occupancySensorJob)
+static OccupancyTracker occupancyTracker;
+static OccupancyTracker occupancyTrackerPosted;
+static WindowAggregator<bool> occupancySummary;
+static WindowAggregator<bool> occupancySummaryPosted;
+
+static SemaphoreHandle_t radarMutex = NULL;
+static RadarConfig radarConfig = {
+    .maxDistanceGate = RADAR_MAX_DISTANCE_GATE,
+    .unmannedDurationSeconds = RADAR_UNMANNED_DURATION,
+    .engineeringMode = RADAR_ENGINEERING_MODE,
+    .hasMaxDistanceGate = RADAR_WRITE_DEFAULTS,
+    .hasUnmannedDuration = RADAR_WRITE_DEFAULTS,
+    .hasGateSensitivity = false,
+    .gateSensitivity = {}
+};
+
+const char* const RADAR_CONFIG_ATTRIBUTES[RADAR_CONFIG_ATTRIBUTE_COUNT] = {
+    flexName<MioOccupancySensor, MioOccupancySensor::mxg>(),
+    flexName<MioOccupancySensor, MioOccupancySensor::sen>(),
+    flexName<MioOccupancySensor, MioOccupancySensor::udr>(),
+    flexName<MioOccupancySensor, MioOccupancySensor::eng>(),
+};
+
+static constexpr auto ENABLE_CONFIG_FRAME = radarEnableConfigFrame();
+static constexpr auto DISABLE_CONFIG_FRAME = radarDisableConfigFrame();
+
+static bool radarAck(RadarAckResult result, const char* what) {
+    if (result == RadarAckResult::Ok) return true;
+    Serial.printf("Radar %s %s\n", what, result == RadarAckResult::Timeout ? "timed out" : "rejected");
+    return false;
+}
+
+bool applyRadarConfig(const RadarConfig& config) {
+    if (!radarMutex) return false;
+    if (config.hasMaxDistanceGate && config.maxDistanceGate >= MMWAVE_GATE_COUNT) return false;
+
+    xSemaphoreTake(radarMutex, portMAX_DELAY);
+
+    bool ok = false;
+    for (uint8_t attempt = 0; !ok && attempt < MMWAVE_ENABLE_ATTEMPTS; attempt++) {
+        ok = radarAck(radarTransact(radarSerial, ENABLE_CONFIG_FRAME), "enable config");
+    }
+    if (ok) {
+        // Parameters in the radar's flash are only written when configured
+        if (config.hasMaxDistanceGate) {
+            auto frame = radarParamFrame(RADAR_CMD_WRITE_PARAMS, RADAR_PARAM_MAX_GATE, config.maxDistanceGate);
+            ok = radarAck(radarTransact(radarSerial, frame), "max gate");
+        }
+        if (ok && config.hasUnmannedDuration) {
+            auto frame = radarParamFrame(RADAR_CMD_WRITE_PARAMS, RADAR_PARAM_UNMANNED_DURATION,
+                                         config.unmannedDurationSeconds);
+            ok = radarAck(radarTransact(radarSerial, frame), "unmanned duration");
+        }
+
+        for (uint16_t gate = 0; ok && config.hasGateSensitivity && gate < MMWAVE_GATE_COUNT; gate++) {
+            auto frame = radarParamFrame(RADAR_CMD_WRITE_PARAMS, RADAR_PARAM_TRIGGER_THRESHOLD + gate,
+                                         config.gateSensitivity[gate]);
+            ok = radarAck(radarTransact(radarSerial, frame), "gate sensitivity");
+        }
+
+        // The mode goes out even after a failed write, so presence output
+        // does not depend on every parameter being accepted
+        uint32_t mode = config.engineeringMode ? RADAR_MODE_ENGINEERING : RADAR_MODE_NORMAL;
+        ok = radarAck(radarTransact(radarSerial, radarSystemModeFrame(mode)), "mode") && ok;
     }
-    radarSerial.write(bytes, sizeof(bytes));
+
+    // Always leave configuration mode, even after a failed write or an
+    // enable whose ACK was lost
+    radarAck(radarTransact(radarSerial, DISABLE_CONFIG_FRAME), "disable config");
+
+    if (ok) radarConfig = config;
+    xSemaphoreGive(radarMutex);
+    return ok;
 }
 
+RadarConfig getRadarConfig() {
+    if (!radarMutex) return radarConfig;
+    RadarConfig config;
+    xSemaphoreTake(radarMutex, portMAX_DELAY);
+    config = radarConfig;
+    xSemaphoreGive(radarMutex);
+    return config;
+}
+
+static bool sameRadarConfig(const RadarConfig& a, const RadarConfig& b) {
+    if (a.maxDistanceGate != b.maxDistanceGate ||
+        a.unmannedDurationSeconds != b.unmannedDurationSeconds ||
+        a.engineeringMode != b.engineeringMode ||
+        a.hasMaxDistanceGate != b.hasMaxDistanceGate ||
+        a.hasUnmannedDuration != b.hasUnmannedDuration ||
+        a.hasGateSensitivity != b.hasGateSensitivity) {
+        return false;
+    }
+    return memcmp(a.gateSensitivity, b.gateSensitivity, sizeof(a.gateSensitivity)) == 0;
+}
+
+// Merge the attributes present in a representation into config
+static bool radarConfigFromJson(JsonObject occSensor, RadarConfig& config) {
+    typedef MioOccupancySensor Occ;
+
+    if (occSensor.containsKey(flexName<Occ, Occ::mxg>())) {
+        JsonVariant mxg = occSensor[flexName<Occ, Occ::mxg>()];
+        int gate = mxg;
+        if (!mxg.is<int>() || gate < 0 || gate >= MMWAVE_GATE_COUNT) return false;
+        config.maxDistanceGate = gate;
+        config.hasMaxDistanceGate = true;
+    }
+    if (occSensor.containsKey(flexName<Occ, Occ::udr>())) {
+        JsonVariant udr = occSensor[flexName<Occ, Occ::udr>()];
+        long duration = udr;
+        if (!udr.is<long>() || duration < 0 || duration > UINT16_MAX) return false;
+        config.unmannedDurationSeconds = duration;
+        config.hasUnmannedDuration = true;
+    }
+    if (occSensor.containsKey(flexName<Occ, Occ::eng>())) {
+        JsonVariant eng = occSensor[flexName<Occ, Occ::eng>()];
+        if (!eng.is<bool>()) return false;
+        config.engineeringMode = eng;
+    }
+    if (occSensor.containsKey(flexName<Occ, Occ::sen>())) {
+        JsonArray sen = occSensor[flexName<Occ, Occ::sen>()];
+        if (sen.size() != MMWAVE_GATE_COUNT) return false;
+        for (size_t gate = 0; gate < MMWAVE_GATE_COUNT; gate++) {
+            int threshold = sen[gate];
+            if (!sen[gate].is<int>() || threshold < 0 || threshold > MMWAVE_MAX_THRESHOLD) return false;
+            config.gateSensitivity[gate] = threshold;
+        }
+        config.hasGateSensitivity = true;
+    }
+    return true;
+}
+
+// Handed from the notification server task to the occupancy job
+static portMUX_TYPE queuedConfigMux = portMUX_INITIALIZER_UNLOCKED;
+static RadarConfig queuedConfig;
+static bool configQueued = false;
+
+bool queueRadarConfigFromJson(JsonObject occSensor) {
+    // Attributes build on a configuration that is still queued
+    RadarConfig config = getRadarConfig();
+    portENTER_CRITICAL(&queuedConfigMux);
+    if (configQueued) config = queuedConfig;
+    portEXIT_CRITICAL(&queuedConfigMux);
+
+    if (!radarConfigFromJson(occSensor, config)) {
+        Serial.println("Radar config rejected: value missing or out of range");
+        return false;
+    }
+
+    portENTER_CRITICAL(&queuedConfigMux);
+    queuedConfig = config;
+    configQueued = true;
+    portEXIT_CRITICAL(&queuedConfigMux);
+    return true;
+}
+
+bool applyQueuedRadarConfig() {
+    RadarConfig config;
+    portENTER_CRITICAL(&queuedConfigMux);
+    bool queued = configQueued;
+    config = queuedConfig;
+    configQueued = false;
+    portEXIT_CRITICAL(&queuedConfigMux);
+
+    if (!queued || sameRadarConfig(config, getRadarConfig())) return true;
+
+    bool ok = applyRadarConfig(config);
+    Serial.printf("Radar config: gate %u, unmanned %us, %s mode %s\n",
+                  config.maxDistanceGate, config.unmannedDurationSeconds,
+                  config.engineeringMode ? "engineering" : "normal", ok ? "applied" : "failed");
+    return ok;
+}
+
+// The radar stays powered while the ESP32 deep-sleeps. Latched on the
+// attempt, not the ACK: a radar that does not answer would otherwise
+// cost every battery wake the settle delay and a round of timeouts
+RTC_DATA_ATTR static bool radarConfigAttempted = false;
+
 bool initOccupancySensor() {
-    occupancyMutex = xSemaphoreCreateMutex();
-    if (!occupancyMutex) return false;
+    if (radarMutex) return true;
+
+    radarMutex = xSemaphoreCreateMutex();
+    if (!radarMutex) return false;
 
     radarSerial.begin(115200, SERIAL_8N1, RADAR_RX_PIN, RADAR_TX_PIN);
     pinMode(OCCUPANCY_OT2_PIN, INPUT);
-    delay(500);
 
-    sendHexData("FDFCFBFA0800120000006400000004030201");
-    delay(100);
+    if (!radarConfigAttempted) {
+        radarConfigAttempted = true;
+        delay(500);
+        if (!applyRadarConfig(radarConfig)) {
+            Serial.println("Radar configuration not acknowledged, using sensor defaults");
+        }
+    }
 
     Serial.println("Occupancy sensor ready");
     return true;
 }
 
 bool getOccupancyDetected() {
-    if (!occupancyMutex) return false;
-    bool occupied;
-    xSemaphoreTake(occupancyMutex, portMAX_DELAY);
-    occupied = isOccupied;
-    xSemaphoreGive(occupancyMutex);
-    return occupied;
+    return getSensorSnapshot().occupied;
 }
 
-void OccupancySensorTask(void* pvParameters) {
-    vTaskDelay(pdMS_TO_TICKS(2000));
+void occupancySensorJob() {
+    static bool firstReport = true;
+    static bool lastLocalState = false;
 
-    TickType_t lastWake = xTaskGetTickCount();
-    const TickType_t interval = pdMS_TO_TICKS(OCCUPANCY_UPDATE_INTERVAL);
-    bool firstReport = true;
-    bool lastLocalState = false;
+    applyQueuedRadarConfig();
 
-    while (true) {
-        bool pinState = digitalRead(OCCUPANCY_OT2_PIN);
+    bool pinState = digitalRead(OCCUPANCY_OT2_PIN);
+    unsigned long now = millis();
+    if (firstReport) {
+        occupancyTracker.begin(now);
+        occupancySummary.begin(now);
+    }
+    occupancyTracker.sample(pinState, now);
+    occupancySummary.sample(pinState);
 
-        if (pinState != lastLocalState) {
-            lastLocalState = pinState;
-            xSemaphoreTake(occupancyMutex, portMAX_DELAY);
-            isOccupied = pinState;
-            xSemaphoreGive(occupancyMutex);
-        }
+    if (pinState != lastLocalState) {
+        lastLocalState = pinState;
+        setSnapshotOccupied(pinState);
+    }
 
-        bool currentState = getOccupancyDetected();
-        bool shouldReport = firstReport || (currentState != lastReportedState);
+    // Changes are reported whatever SENSOR_CHANGE_REPORTS says; they drive the lamp
+    bool currentState = getOccupancyDetected();
+    bool shouldReport = firstReport || (currentState != lastReportedState);
 
-        if (shouldReport) {
-            if (updateOccupancyValue(currentState)) {
-                lastReportedState = currentState;
-                Serial.printf("Occupancy: %s\n", currentState ? "OCCUPIED" : "EMPTY");
-            }
-            firstReport = false;
+    if (shouldReport) {
+        if (reportReading(READING_OCCUPANCY, currentState ? 1.0f : 0.0f)) {
+            lastReportedState = currentState;
+            Serial.printf("Occupancy: %s\n", currentState ? "OCCUPIED" : "EMPTY");
         }
+        firstReport = false;
+    }
 
-        vTaskDelayUntil(&lastWake, interval);
+    // While offline the windows keep growing instead of being dropped;
+    // stats the CSE did not take are folded back in like the summaries
+    if (!isCloudReady()) return;
+    SummaryOutcome statsOutcome = collectSummaryOutcome(SUMMARY_OCCUPANCY_STATS);
+    if (statsOutcome == SUMMARY_FAILED) {
+        occupancyTrackerPosted.append(occupancyTracker);
+        occupancyTracker = occupancyTrackerPosted;
+    }
+    if (statsOutcome != SUMMARY_PENDING && occupancyTracker.windowDue(now) &&
+        postOccupancyStats(occupancyTracker.peek(now))) {
+        occupancyTrackerPosted = occupancyTracker;
+        occupancyTracker.restart(now);
     }
+
+    closeSummaryWindow(SUMMARY_OCCUPANCY, occupancySummary, occupancySummaryPosted, now);
 }
 
-bool startOccupancySensorTask() {
-    BaseType_t result = xTaskCreatePinnedToCore(
-        OccupancySensorTask, "OccupancySensor",
-        4096, NULL, 1, &occupancyTaskHandle, 1
-    );
-    return (result == pdPASS);
+bool scheduleOccupancySensorJob() {
+    // First sample after 2 s to let the radar settle
+    return addSensorJob("occupancy", occupancySensorJob, OCCUPANCY_UPDATE_INTERVAL,
+                        OCCUPANCY_JOB_DEADLINE, 2000);
 }
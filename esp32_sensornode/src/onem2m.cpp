@@ -1,13 +1,22 @@
 #include "onem2m.h"
 #include "config.h"
+#include "occupancy_sensor.h"
+#include "report_policy.h"
+#include "metrics.h"
+#include "trace.h"
+#if CSE_USE_TLS
+#include "cse_credentials.h"
+#endif
 #include <HTTPClient.h>
 #include <WiFiClient.h>
+#include <atomic>
 
 OneM2MPaths onem2mPaths;
 
 void OneM2MPaths::initialize(const char* host, int port, const char* cseName,
-                             const char* aeName, const char* roomName, const char* deskName, const char* deviceName) {
-    BASE_URL = String("http://") + host + ":" + String(port);
+                             const char* aeName, const char* roomName, const char* deskName, const char* deviceName,
+                             bool tls) {
+    BASE_URL = String(tls ? "https://" : "http://") + host + ":" + String(port);
     CSE_PATH = "/" + String(cseName);
     AE_PATH = CSE_PATH + "/" + String(aeName);
     ROOM_PATH = AE_PATH + "/" + String(roomName);
@@ -15,311 +24,751 @@ void OneM2MPaths::initialize(const char* host, int port, const char* cseName,
     DEVICE_PATH = DESK_PATH + "/" + String(deviceName);
 }
 
-String generateRequestId() {
-    static unsigned long counter = 0;
-    return String("req_") + String(counter++);
+static std::atomic<unsigned long> requestCounter(0);
+
+// ==================== CONNECTION POOL ====================
+
+struct PooledConnection {
+    TlsClient client;  // Plain TCP unless the pool has a TLS context
+    HTTPClient http;
+    char arenaBuffer[ONEM2M_ARENA_SIZE];
+    RequestArena arena{arenaBuffer, sizeof(arenaBuffer)};
+};
+
+// Reply headers the client reads besides the ones HTTPClient handles
+static const char* REPLY_HEADERS[] = {"Transfer-Encoding"};
+
+// ==================== REPLY BODY ====================
+
+// link is the connection under socket (the same object, or the socket
+// HTTPClient reads through); once it is closed and drained, nothing more
+// can arrive and waiting out the timeout would only stall the caller
+static int socketRead(Stream* socket, WiFiClient* link) {
+    unsigned long start = millis();
+    do {
+        int c = socket->read();
+        if (c >= 0) return c;
+        if (!link->connected() && !socket->available()) return -1;
+        delay(1);
+    } while (millis() - start < ONEM2M_TIMEOUT_MS);
+    return -1;
 }
 
-bool oneM2MRequest(const char* method, const String& path, const String& payload,
-                   int resourceType, String& response, int& statusCode) {
-    WiFiClient* client = new WiFiClient();
-    if (!client) {
-        statusCode = -1;
+// One CRLF-terminated line, cut to size - 1 characters
+static bool readSocketLine(Stream* socket, WiFiClient* link, char* line, size_t size) {
+    size_t length = 0;
+    int c;
+    while ((c = socketRead(socket, link)) >= 0) {
+        if (c == '\n') {
+            if (length > 0 && line[length - 1] == '\r') length--;
+            line[length] = '\0';
+            return true;
+        }
+        if (length + 1 < size) line[length++] = (char)c;
+    }
+    return false;
+}
+
+bool replyHasBody(const char* method, int statusCode) {
+    if (strcmp(method, "HEAD") == 0) return false;
+    return !(statusCode >= 100 && statusCode < 200) && statusCode != 204 && statusCode != 304;
+}
+
+/**
+ * The reply body as a Stream over the connection. It ends at
+ * Content-Length or removes the chunked framing, so a sink never reads
+ * into the next reply on a kept-alive socket.
+ */
+class ReplyBody : public Stream {
+public:
+    /**
+     * @param link Connection under socket, see socketRead()
+     * @param contentLength Body size, -1 if chunked or until close
+     */
+    ReplyBody(Stream* socket, WiFiClient* link, int contentLength, bool chunked)
+        : socket(socket), link(link), remaining(chunked ? 0 : contentLength), chunked(chunked),
+          finished(socket == nullptr) {}
+
+    int available() override {
+        if (peeked >= 0) return 1;
+        if (finished || remaining == 0) return 0;
+        int ready = socket->available();
+        return remaining > 0 ? min(ready, (int)remaining) : ready;
+    }
+
+    int read() override {
+        int c = peek();
+        peeked = -1;
+        return c;
+    }
+
+    int peek() override {
+        if (peeked < 0) peeked = next();
+        return peeked;
+    }
+
+    size_t write(uint8_t) override { return 0; }
+
+    /**
+     * Read what the sink left
+     * @return true if the whole body arrived and the connection can be reused
+     */
+    bool drain() {
+        while (read() >= 0) {
+        }
+        return !failed;
+    }
+
+private:
+    int next() {
+        if (finished) return -1;
+        if (remaining == 0 && !(chunked && nextChunk())) {
+            finished = true;
+            return -1;
+        }
+        int c = socketRead(socket, link);
+        if (c < 0) {
+            failed = true;  // Timed out, or the body ran to connection close
+            finished = true;
+            return -1;
+        }
+        if (remaining > 0) remaining--;
+        return c;
+    }
+
+    // @return false after the last chunk
+    bool nextChunk() {
+        char line[16];
+        if (!firstChunk && !readLine(line, sizeof(line))) return false;  // CRLF after the data
+        firstChunk = false;
+        if (!readLine(line, sizeof(line))) return false;
+        remaining = strtol(line, nullptr, 16);
+        if (remaining > 0) return true;
+        while (readLine(line, sizeof(line)) && line[0]) {
+            // Trailers up to the empty line
+        }
         return false;
     }
 
-    HTTPClient http;
-    String url = onem2mPaths.BASE_URL + path;
-    url.trim();
+    bool readLine(char* line, size_t size) {
+        if (readSocketLine(socket, link, line, size)) return true;
+        failed = true;
+        return false;
+    }
+
+    Stream* socket;
+    WiFiClient* link;
+    long remaining;  // Left in the body or chunk; -1 until close
+    bool chunked;
+    bool finished;
+    bool firstChunk = true;
+    bool failed = false;
+    int peeked = -1;
+};
+
+// ==================== RESPONSE SINKS ====================
+
+bool BufferSink::consume(Stream& body) {
+    used = 0;
+    overflow = false;
+    if (capacity == 0) return false;
+
+    int c;
+    while ((c = body.read()) >= 0) {
+        if (used + 1 == capacity) {
+            overflow = true;
+            break;
+        }
+        buffer[used++] = (char)c;
+    }
+    buffer[used] = '\0';
+    return !overflow;
+}
+
+bool JsonFilterSink::consume(Stream& body) {
+    result = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+    return !result;
+}
+
+// ==================== ONEM2M CLIENT ====================
+
+static void formatContentType(char* contentType, size_t size, int resourceType) {
+    if (resourceType > 0) {
+        snprintf(contentType, size, "application/json;ty=%d", resourceType);
+    } else {
+        snprintf(contentType, size, "application/json");
+    }
+}
+
+static void recordOutcome(CircuitBreaker& breaker, int statusCode) {
+    if (statusCode <= 0 || statusCode >= 500) breaker.recordFailure();
+    else breaker.recordSuccess();
+}
+
+static void countReply(int statusCode) {
+    if (statusCode <= 0) metricIncrement(METRIC_HTTP_TRANSPORT_ERRORS);
+    else if (statusCode >= 500) metricIncrement(METRIC_HTTP_SERVER_ERRORS);
+    else if (statusCode >= 400) metricIncrement(METRIC_HTTP_CLIENT_ERRORS);
+}
+
+bool OneM2MClient::begin(const TlsCredentials* tls) {
+    if (freeConnections) return true;
+
+    if (tls && !tlsContext) {
+        tlsContext = new TlsContext(ONEM2M_TIMEOUT_MS);
+        if (!tlsContext->begin(*tls)) {
+            delete tlsContext;
+            tlsContext = nullptr;
+            return false;
+        }
+    }
+
+    freeConnections = xQueueCreate(poolSize, sizeof(uint8_t));
+    if (!freeConnections) return false;
 
-    if (!http.begin(*client, url)) {
-        delete client;
+    connections = new PooledConnection[poolSize];
+    for (uint8_t i = 0; i < poolSize; i++) {
+        connections[i].client.setContext(tlsContext);
+        connections[i].http.setReuse(true);
+        connections[i].http.collectHeaders(REPLY_HEADERS, 1);
+        xQueueSend(freeConnections, &i, 0);
+    }
+    return true;
+}
+
+bool OneM2MClient::request(const char* method, const String& baseUrl, const String& path, const JsonDocument* body,
+                           int resourceType, ResponseSink* response, int& statusCode) {
+    // Fail fast instead of waiting out a timeout per request
+    if (!breaker.allowRequest()) {
+        statusCode = ONEM2M_STATUS_BREAKER_OPEN;
+        return false;
+    }
+
+    uint8_t slot;
+    unsigned long waitStart = millis();
+    if (!freeConnections || xQueueReceive(freeConnections, &slot, portMAX_DELAY) != pdTRUE) {
+        breaker.recordFailure();
         statusCode = -1;
         return false;
     }
+    metricRaise(METRIC_POOL_WAIT_MS, millis() - waitStart);
+    metricIncrement(METRIC_HTTP_REQUESTS);
+
+    // Keep-alive: begin() reuses the slot's socket while the CSE keeps it open
+    HTTPClient& http = connections[slot].http;
+    RequestArena& arena = connections[slot].arena;
+    String urlFallback;
+    String bodyFallback;
+
+    const char* url = arena.format("%s%s", baseUrl.c_str(), path.c_str());
+    if (!url) {
+        urlFallback = baseUrl + path;
+        url = urlFallback.c_str();
+    }
 
-    http.setTimeout(5000);
+    if (!http.begin(connections[slot].client, url)) {
+        arena.reset();
+        xQueueSend(freeConnections, &slot, 0);
+        breaker.recordFailure();
+        metricIncrement(METRIC_HTTP_TRANSPORT_ERRORS);
+        statusCode = -1;
+        return false;
+    }
+
+    char requestId[24];
+    snprintf(requestId, sizeof(requestId), "req_%lu", requestCounter++);
+    char contentType[32];
+    formatContentType(contentType, sizeof(contentType), resourceType);
+
+    http.setTimeout(ONEM2M_TIMEOUT_MS);
     http.addHeader("X-M2M-Origin", ORIGINATOR);
-    http.addHeader("X-M2M-RI", generateRequestId());
+    http.addHeader("X-M2M-RI", requestId);
     http.addHeader("X-M2M-RVI", "3");
     http.addHeader("Accept", "application/json");
-
-    if (resourceType > 0) {
-        http.addHeader("Content-Type", "application/json;ty=" + String(resourceType));
-    } else {
-        http.addHeader("Content-Type", "application/json");
+    http.addHeader("Content-Type", contentType);
+
+    uint8_t* payload = nullptr;
+    size_t payloadLength = 0;
+    if (body) {
+        payloadLength = measureJson(*body);
+        payload = (uint8_t*)arena.allocate(payloadLength + 1);
+        if (payload) {
+            serializeJson(*body, (char*)payload, payloadLength + 1);
+        } else {
+            serializeJson(*body, bodyFallback);
+            payload = (uint8_t*)bodyFallback.c_str();
+        }
     }
 
     int httpCode = -1;
+    unsigned long requestStart = millis();
+    TRACE(TRACE_HTTP_BEGIN, slot);
     if (strcmp(method, "GET") == 0) httpCode = http.GET();
-    else if (strcmp(method, "POST") == 0) httpCode = http.POST(payload);
+    else if (strcmp(method, "POST") == 0) httpCode = http.POST(payload, payloadLength);
     else if (strcmp(method, "DELETE") == 0) httpCode = http.sendRequest("DELETE");
-    else if (strcmp(method, "PUT") == 0) httpCode = http.PUT(payload);
+    else if (strcmp(method, "PUT") == 0) httpCode = http.PUT(payload, payloadLength);
+    else if (strcmp(method, "HEAD") == 0) httpCode = http.sendRequest("HEAD");
 
     statusCode = httpCode;
-    if (httpCode > 0) response = http.getString();
+    bool reusable = (httpCode > 0);
+    bool accepted = (httpCode > 0);
+    if (httpCode > 0) {
+        // Without Content-Length or chunking the body runs to close, unless
+        // the reply has none: a 204 must not hold the connection until timeout
+        int size = http.getSize();
+        bool chunked = size < 0 && http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+        if (!replyHasBody(method, httpCode)) {
+            size = 0;
+            chunked = false;
+        }
+        ReplyBody reply(http.getStreamPtr(), &connections[slot].client, size, chunked);
+        if (response) accepted = response->consume(reply);
+        reusable = reply.drain();
+    }
+    metricObserve(METRIC_HTTP_LATENCY_MS, millis() - requestStart);
+    TRACE(TRACE_HTTP_END, httpCode > 0 ? httpCode : 0);
+
+    countReply(httpCode);
+    recordOutcome(breaker, httpCode);
 
     http.end();
-    client->stop();
-    delete client;
+    if (!reusable) {
+        connections[slot].client.stop();
+    }
+    arena.reset();
+    xQueueSend(freeConnections, &slot, 0);
 
-    return (httpCode > 0);
+    return accepted;
 }
 
-bool oneM2MGet(const String& path, String& response, int& statusCode) {
-    return oneM2MRequest("GET", path, "", 0, response, statusCode);
+// ==================== PIPELINING ====================
+
+struct ReplyHead {
+    int status;
+    long contentLength;  // -1 if absent
+    bool chunked;
+    bool keepAlive;
+};
+
+// Interim 1xx replies (100 Continue, 103 Early Hints) are skipped; they
+// have no body and the final reply follows on the same connection
+static bool readReplyHead(WiFiClient* socket, ReplyHead& head) {
+    char line[128];
+    int major, minor;
+    do {
+        if (!readSocketLine(socket, socket, line, sizeof(line)) ||
+            sscanf(line, "HTTP/%d.%d %d", &major, &minor, &head.status) != 3) {
+            return false;
+        }
+        head.contentLength = -1;
+        head.chunked = false;
+        head.keepAlive = (major == 1 && minor >= 1);
+
+        while (true) {
+            if (!readSocketLine(socket, socket, line, sizeof(line))) return false;
+            if (!line[0]) break;
+
+            char* value = strchr(line, ':');
+            if (!value) continue;
+            *value++ = '\0';
+            while (*value == ' ') value++;
+            if (strcasecmp(line, "Content-Length") == 0) head.contentLength = atol(value);
+            else if (strcasecmp(line, "Transfer-Encoding") == 0) head.chunked = (strcasecmp(value, "chunked") == 0);
+            else if (strcasecmp(line, "Connection") == 0) head.keepAlive = (strcasecmp(value, "close") != 0);
+        }
+    } while (head.status >= 100 && head.status < 200 && head.status != 101);
+
+    // 101 Switching Protocols: whatever follows is not HTTP
+    if (head.status == 101) head.keepAlive = false;
+    return true;
 }
 
-bool oneM2MPost(const String& path, const String& payload, int resourceType,
-                String& response, int& statusCode) {
-    return oneM2MRequest("POST", path, payload, resourceType, response, statusCode);
+// "http://host:port" or "https://host:port" as OneM2MPaths builds it
+static bool parseBaseUrl(const String& baseUrl, char* host, size_t hostSize, uint16_t& port) {
+    const char* authority = baseUrl.c_str();
+    bool tls = (strncmp(authority, "https://", 8) == 0);
+    if (tls) authority += 8;
+    else if (strncmp(authority, "http://", 7) == 0) authority += 7;
+    const char* colon = strchr(authority, ':');
+    size_t hostLength = colon ? (size_t)(colon - authority) : strlen(authority);
+    if (hostLength == 0 || hostLength >= hostSize) return false;
+
+    memcpy(host, authority, hostLength);
+    host[hostLength] = '\0';
+    port = colon ? (uint16_t)atoi(colon + 1) : (tls ? 443 : 80);
+    return true;
 }
 
-bool oneM2MDelete(const String& path, String& response, int& statusCode) {
-    return oneM2MRequest("DELETE", path, "", 0, response, statusCode);
+// The request HTTPClient would send, staged in the connection's arena
+static bool writePipelinedRequest(PooledConnection& connection, const char* host, uint16_t port,
+                                  const OneM2MBatchEntry& entry) {
+    RequestArena& arena = connection.arena;
+    size_t bodyLength = entry.body ? measureJson(*entry.body) : 0;
+    char contentType[32];
+    formatContentType(contentType, sizeof(contentType), entry.resourceType);
+
+    const char* head = arena.format("%s %s HTTP/1.1\r\nHost: %s:%u\r\nConnection: keep-alive\r\n"
+                                    "X-M2M-Origin: %s\r\nX-M2M-RI: req_%lu\r\nX-M2M-RVI: 3\r\n"
+                                    "Accept: application/json\r\nContent-Type: %s\r\nContent-Length: %u\r\n\r\n",
+                                    entry.method, entry.path->c_str(), host, port, ORIGINATOR,
+                                    requestCounter++, contentType, (unsigned)bodyLength);
+    String bodyFallback;
+    const char* body = nullptr;
+    if (bodyLength) {
+        char* staged = arena.allocate(bodyLength + 1);
+        if (staged) {
+            serializeJson(*entry.body, staged, bodyLength + 1);
+            body = staged;
+        } else {
+            serializeJson(*entry.body, bodyFallback);
+            body = bodyFallback.c_str();
+        }
+    }
+
+    WiFiClient& client = connection.client;
+    bool written = head && client.write((const uint8_t*)head, strlen(head)) == strlen(head) &&
+                   (!bodyLength || client.write((const uint8_t*)body, bodyLength) == bodyLength);
+    arena.reset();
+    return written;
 }
 
-bool oneM2MPut(const String& path, const String& payload,
-               String& response, int& statusCode) {
-    return oneM2MRequest("PUT", path, payload, 0, response, statusCode);
+static bool batchEntrySucceeded(int statusCode) {
+    return (statusCode >= 200 && statusCode < 300) || statusCode == 409;  // 409: already exists
 }
 
-bool waitForCSE(int maxAttempts) {
-    Serial.print("Waiting for CSE");
-    for (int i = 0; i < maxAttempts; i++) {
-        String response;
-        int statusCode;
-        if (oneM2MGet(onem2mPaths.CSE_PATH, response, statusCode)) {
-            if (statusCode == 200 || statusCode == 403) {
-                Serial.println(" ready");
-                return true;
-            }
-        }
-        Serial.print(".");
-        delay(2000);
-    }
-    Serial.println(" failed");
-    return false;
+void OneM2MClient::setPipelineDepth(uint8_t depth) {
+    if (depth < 1) depth = 1;
+    if (depth > ONEM2M_PIPELINE_MAX_DEPTH) depth = ONEM2M_PIPELINE_MAX_DEPTH;
+    pipelineDepth = depth;
 }
 
-bool createContainer(const char* containerName) {
-    StaticJsonDocument<512> doc;
-    JsonObject cnt = doc.createNestedObject("m2m:cnt");
-    cnt["rn"] = containerName;
-    JsonArray acpi = cnt.createNestedArray("acpi");
-    acpi.add(String(CSE_NAME) + "/acpMoodMonitor");
-    cnt["mbs"] = 10000;
-    cnt["mni"] = 10;
+bool OneM2MClient::pipeline(const String& baseUrl, OneM2MBatchEntry* entries, size_t count) {
+    for (size_t i = 0; i < count; i++) entries[i].statusCode = 0;  // 0: no reply yet
 
-    String payload;
-    serializeJson(doc, payload);
+    char host[64];
+    uint16_t port;
+    uint8_t slot;
+    bool pipelined = pipelining && pipelineDepth > 1 && count > 1 && parseBaseUrl(baseUrl, host, sizeof(host), port);
+    if (pipelined && !breaker.allowRequest()) {
+        for (size_t i = 0; i < count; i++) entries[i].statusCode = ONEM2M_STATUS_BREAKER_OPEN;
+        return false;
+    }
+    unsigned long waitStart = millis();
+    if (pipelined && (!freeConnections || xQueueReceive(freeConnections, &slot, portMAX_DELAY) != pdTRUE)) {
+        breaker.recordFailure();
+        pipelined = false;
+    }
 
-    String response;
-    int statusCode;
+    if (pipelined) {
+        metricRaise(METRIC_POOL_WAIT_MS, millis() - waitStart);
+        PooledConnection& connection = connections[slot];
+        WiFiClient& client = connection.client;
+        bool usable = client.connected() || client.connect(host, port, ONEM2M_TIMEOUT_MS);
+
+        // Ring of entries written but not answered, oldest first
+        size_t inFlight[ONEM2M_PIPELINE_MAX_DEPTH];
+        unsigned long sentAt[ONEM2M_PIPELINE_MAX_DEPTH];
+        size_t oldest = 0;
+        size_t pending = 0;
+        size_t next = 0;           // First entry not yet written or skipped
+        uint32_t written = 0;      // Bit i: entries[next + i] written or skipped
+        size_t answered = 0;
+
+        while (usable && (next < count || pending > 0)) {
+            // Entries go out in order, except that independent ones pass an
+            // entry held back until its dependency's reply is in
+            for (size_t i = next; i < count && i < next + 32 && pending < pipelineDepth; i++) {
+                uint32_t bit = 1UL << (i - next);
+                if (written & bit) continue;
+                OneM2MBatchEntry& entry = entries[i];
+                int dependsOn = entry.dependsOn;
+                if (dependsOn >= 0 && dependsOn < (int)i) {
+                    if (entries[dependsOn].statusCode == 0) continue;  // Not answered yet
+                    if (!batchEntrySucceeded(entries[dependsOn].statusCode)) {
+                        entry.statusCode = ONEM2M_STATUS_SKIPPED;
+                        written |= bit;
+                        continue;
+                    }
+                }
+                if (!writePipelinedRequest(connection, host, port, entry)) {
+                    usable = false;
+                    break;
+                }
+                metricIncrement(METRIC_HTTP_REQUESTS);
+                TRACE(TRACE_HTTP_BEGIN, slot);
+                size_t position = (oldest + pending) % ONEM2M_PIPELINE_MAX_DEPTH;
+                inFlight[position] = i;
+                sentAt[position] = millis();
+                pending++;
+                written |= bit;
+            }
+            while (next < count && (written & 1)) {
+                written >>= 1;
+                next++;
+            }
+            if (!usable || pending == 0) continue;
+
+            OneM2MBatchEntry& entry = entries[inFlight[oldest]];
+            ReplyHead head;
+            if (!readReplyHead(&client, head)) {
+                if (answered > 0) {
+                    // Answered the first request only: the CSE does not pipeline
+                    Serial.println("CSE does not answer pipelined requests - using lockstep");
+                    pipelining = false;
+                }
+                usable = false;
+                break;
+            }
+            // Same framing as request(): a 204 or a HEAD reply ends with its head,
+            // or its body would be read from the replies behind it
+            long length = head.chunked ? -1 : head.contentLength;
+            bool chunked = head.chunked;
+            if (!replyHasBody(entry.method, head.status)) {
+                length = 0;
+                chunked = false;
+            }
+            ReplyBody body(&client, &client, (int)length, chunked);
+            if (entry.response) entry.response->consume(body);
+            bool complete = body.drain();
+
+            entry.statusCode = head.status;
+            metricObserve(METRIC_HTTP_LATENCY_MS, millis() - sentAt[oldest]);
+            TRACE(TRACE_HTTP_END, head.status);
+            countReply(head.status);
+            recordOutcome(breaker, head.status);
+            oldest = (oldest + 1) % ONEM2M_PIPELINE_MAX_DEPTH;
+            pending--;
+            answered++;
+
+            if (!head.keepAlive) {
+                if (pending > 0 || next < count) {
+                    Serial.println("CSE closes pipelined connections - using lockstep");
+                    pipelining = false;
+                }
+                usable = false;
+            }
+            if (!complete) usable = false;
+        }
 
-    // Determine parent path based on container name
-    String parentPath;
-    if (strcmp(containerName, ROOM_CONTAINER) == 0) {
-        parentPath = onem2mPaths.AE_PATH;
-    } else {
-        parentPath = onem2mPaths.ROOM_PATH;
+        if (answered == 0) breaker.recordFailure();  // Connect, write or first read failed
+        if (!usable) client.stop();  // Unread replies would answer the next request
+        xQueueSend(freeConnections, &slot, 0);
     }
 
-    oneM2MPost(parentPath, payload, ONEM2M_RT_CONTAINER, response, statusCode);
+    // Lockstep for the entries the pipeline did not get answered
+    bool allAnswered = true;
+    for (size_t i = 0; i < count; i++) {
+        OneM2MBatchEntry& entry = entries[i];
+        if (entry.statusCode == 0) {
+            int dependsOn = entry.dependsOn;
+            if (dependsOn >= 0 && dependsOn < (int)i && !batchEntrySucceeded(entries[dependsOn].statusCode)) {
+                entry.statusCode = ONEM2M_STATUS_SKIPPED;
+            } else {
+                request(entry.method, baseUrl, *entry.path, entry.body, entry.resourceType, entry.response,
+                        entry.statusCode);
+            }
+        }
+        if (entry.statusCode <= 0) allAnswered = false;
+    }
+    return allAnswered;
+}
 
-    if (statusCode == 201 || statusCode == 409) {
-        Serial.printf("%s container ready\n", containerName);
-        return true;
+size_t OneM2MClient::arenaHighWater() const {
+    size_t highWater = 0;
+    for (uint8_t i = 0; connections && i < poolSize; i++) {
+        highWater = max(highWater, connections[i].arena.highWater());
     }
-    Serial.printf("%s container creation failed (%d)\n", containerName, statusCode);
-    return false;
+    return highWater;
 }
 
-bool createLuxDevice() {
-    // Create sensor with labels
-    StaticJsonDocument<512> doc;
-    JsonObject luxSensor = doc.createNestedObject("mio:luxSr");
-    luxSensor["rn"] = LUX_DEVICE_NAME;
-    luxSensor["cnd"] = "org.fhtwmio.common.moduleclass.mioLuxSensor";
-    JsonArray acpi = luxSensor.createNestedArray("acpi");
-    acpi.add(String(CSE_NAME) + "/acpMoodMonitor");
-    JsonArray lbl = luxSensor.createNestedArray("lbl");
-    lbl.add(String("room:") + ROOM_CONTAINER);
-    lbl.add(String("desk:") + DESK_CONTAINER);
-    lbl.add("sensor:lux");
-    luxSensor["lux"] = 0.0;
-
-    String payload;
-    serializeJson(doc, payload);
-
-    String response;
-    int statusCode;
-    oneM2MPost(onem2mPaths.DESK_PATH, payload, ONEM2M_RT_FLEXCONTAINER, response, statusCode);
+uint32_t OneM2MClient::arenaOverflows() const {
+    uint32_t overflows = 0;
+    for (uint8_t i = 0; connections && i < poolSize; i++) {
+        overflows += connections[i].arena.overflows();
+    }
+    return overflows;
+}
 
-    if (statusCode == 201 || statusCode == 409) {
-        Serial.println("Lux sensor ready");
+// Shared by all tasks of the node
+static OneM2MClient nodeClient;
 
-        // Add announcement attributes (may fail if IN-CSE not connected)
-        StaticJsonDocument<256> annDoc;
-        JsonObject annSensor = annDoc.createNestedObject("mio:luxSr");
-        JsonArray at = annSensor.createNestedArray("at");
-        at.add("/id-cloud-in-cse");
-        JsonArray aa = annSensor.createNestedArray("aa");
-        aa.add("lux");
+bool initOneM2MClient() {
+#if CSE_USE_TLS
+    static const TlsCredentials credentials = {CSE_CA_CERT, NODE_CLIENT_CERT, NODE_CLIENT_KEY, CSE_TLS_SERVER_NAME};
+    return nodeClient.begin(&credentials);
+#else
+    return nodeClient.begin();
+#endif
+}
 
-        String annPayload;
-        serializeJson(annDoc, annPayload);
+bool oneM2MRequest(const char* method, const String& path, const JsonDocument* body,
+                   int resourceType, ResponseSink* response, int& statusCode) {
+    return nodeClient.request(method, onem2mPaths.BASE_URL, path, body, resourceType, response, statusCode);
+}
 
-        String luxPath = onem2mPaths.DESK_PATH + "/" + String(LUX_DEVICE_NAME);
-        oneM2MPut(luxPath, annPayload, response, statusCode);
+bool oneM2MPipeline(OneM2MBatchEntry* entries, size_t count) {
+    return nodeClient.pipeline(onem2mPaths.BASE_URL, entries, count);
+}
 
-        return true;
-    }
-    Serial.printf("Lux sensor creation failed (%d)\n", statusCode);
-    return false;
+bool oneM2MPipeliningEnabled() {
+    return nodeClient.pipeliningEnabled();
 }
 
-bool updateLuxValue(float luxValue) {
-    StaticJsonDocument<256> doc;
-    JsonObject luxSensor = doc.createNestedObject("mio:luxSr");
-    luxSensor["lux"] = luxValue;
+BreakerState oneM2MBreakerState() {
+    return nodeClient.circuitBreaker().state();
+}
+
+uint32_t oneM2MProbeDelayMs() {
+    return nodeClient.circuitBreaker().msUntilProbe();
+}
 
-    String payload;
-    serializeJson(doc, payload);
+bool oneM2MRetryAllowed() {
+    return nodeClient.retryAllowed();
+}
 
-    String response;
-    int statusCode;
-    oneM2MPut(onem2mPaths.DEVICE_PATH, payload, response, statusCode);
+bool oneM2MGet(const String& path, ResponseSink& response, int& statusCode) {
+    return oneM2MRequest("GET", path, nullptr, 0, &response, statusCode);
+}
 
-    if (statusCode == 200 || statusCode == 204) {
-        Serial.printf("Lux: %.1f lux\n", luxValue);
-        return true;
+bool oneM2MPost(const String& path, const JsonDocument& body, int resourceType, int& statusCode) {
+    return oneM2MRequest("POST", path, &body, resourceType, nullptr, statusCode);
+}
+
+bool oneM2MDelete(const String& path, int& statusCode) {
+    return oneM2MRequest("DELETE", path, nullptr, 0, nullptr, statusCode);
+}
+
+bool oneM2MPut(const String& path, const JsonDocument& body, int& statusCode) {
+    return oneM2MRequest("PUT", path, &body, 0, nullptr, statusCode);
+}
+
+bool waitForCSE(int maxAttempts) {
+    Serial.print("Waiting for CSE");
+    for (int i = 0; i < maxAttempts; i++) {
+        int statusCode;
+        if (oneM2MRequest("GET", onem2mPaths.CSE_PATH, nullptr, 0, nullptr, statusCode)) {
+            if (statusCode == 200 || statusCode == 403) {
+                Serial.println(" ready");
+                return true;
+            }
+        }
+        Serial.print(".");
+        delay(2000);
     }
+    Serial.println(" failed");
     return false;
 }
 
-bool createAudioDevice() {
-    // Create sensor with labels
-    StaticJsonDocument<512> doc;
-    JsonObject audioSensor = doc.createNestedObject("cod:acoSr");
-    audioSensor["rn"] = AUDIO_DEVICE_NAME;
-    audioSensor["cnd"] = "org.onem2m.common.moduleclass.acousticSensor";
-    JsonArray acpi = audioSensor.createNestedArray("acpi");
-    acpi.add(String(CSE_NAME) + "/acpMoodMonitor");
-    JsonArray lbl = audioSensor.createNestedArray("lbl");
-    lbl.add(String("room:") + ROOM_CONTAINER);
-    lbl.add(String("desk:") + DESK_CONTAINER);
-    lbl.add("sensor:acoustic");
-    audioSensor["louds"] = 0.0;
-
-    String payload;
-    serializeJson(doc, payload);
-
-    String response;
+bool putFlex(const String& path, const JsonDocument& doc) {
     int statusCode;
-    oneM2MPost(onem2mPaths.DESK_PATH, payload, ONEM2M_RT_FLEXCONTAINER, response, statusCode);
-
-    if (statusCode == 201 || statusCode == 409) {
-        Serial.println("Audio sensor ready");
+    oneM2MPut(path, doc, statusCode);
 
-        // Add announcement attributes (may fail if IN-CSE not connected)
-        StaticJsonDocument<256> annDoc;
-        JsonObject annSensor = annDoc.createNestedObject("cod:acoSr");
-        JsonArray at = annSensor.createNestedArray("at");
-        at.add("/id-cloud-in-cse");
-        JsonArray aa = annSensor.createNestedArray("aa");
-        aa.add("louds");
-
-        String annPayload;
-        serializeJson(annDoc, annPayload);
+    return (statusCode == 200 || statusCode == 204);
+}
 
-        String audioPath = onem2mPaths.DESK_PATH + "/" + String(AUDIO_DEVICE_NAME);
-        oneM2MPut(audioPath, annPayload, response, statusCode);
+// ==================== UPDATE PAYLOADS ====================
 
-        return true;
+void buildLuxPayload(JsonDocument& doc, float luxValue, const char* generatedAt) {
+    FlexQuantized lux = flexQuantize(luxValue, LUX_QUANTUM);
+    if (generatedAt) {
+        writeFlexUpdate<MioLuxSensor>(doc,
+                                      flexField<MioLuxSensor::lux>(lux),
+                                      flexField<MioLuxSensor::dgt>(generatedAt));
+    } else {
+        writeFlexUpdate<MioLuxSensor>(doc, flexField<MioLuxSensor::lux>(lux));
     }
-    Serial.printf("Audio sensor creation failed (%d)\n", statusCode);
-    return false;
 }
 
-bool updateAudioValue(float loudness) {
-    StaticJsonDocument<256> doc;
-    JsonObject audioSensor = doc.createNestedObject("cod:acoSr");
-    audioSensor["louds"] = loudness;
-
-    String payload;
-    serializeJson(doc, payload);
+void buildAudioPayload(JsonDocument& doc, float loudness) {
+    writeFlexUpdate<AcousticSensor>(doc, flexField<AcousticSensor::louds>(flexQuantize(loudness, AUDIO_QUANTUM)));
+}
 
-    String response;
-    int statusCode;
-    String audioPath = onem2mPaths.DESK_PATH + "/" + String(AUDIO_DEVICE_NAME);
-    oneM2MPut(audioPath, payload, response, statusCode);
+void buildOccupancyPayload(JsonDocument& doc, bool occupied, const char* generatedAt) {
+    typedef MioOccupancySensor Occ;
+    if (generatedAt) {
+        writeFlexUpdate<Occ>(doc, flexField<Occ::occ>(occupied), flexField<Occ::dgt>(generatedAt));
+    } else {
+        writeFlexUpdate<Occ>(doc, flexField<Occ::occ>(occupied));
+    }
+}
 
-    if (statusCode == 200 || statusCode == 204) {
-        Serial.printf("Audio: %.1f\n", loudness);
-        return true;
+// tlp is left out until the radar has seen someone; uptime would read as
+// time since the desk was last used
+void buildOccupancyStatsPayload(JsonDocument& doc, const OccupancyStats& stats) {
+    typedef MioOccupancySensor Occ;
+    if (stats.presenceSeen) {
+        writeFlexUpdate<Occ>(doc,
+                             flexField<Occ::ocs>(stats.occupiedSeconds),
+                             flexField<Occ::ses>(stats.sessions),
+                             flexField<Occ::lgs>(stats.longestSessionSeconds),
+                             flexField<Occ::tlp>(stats.secondsSinceLastPresence),
+                             flexField<Occ::ivl>(stats.intervalSeconds));
+    } else {
+        writeFlexUpdate<Occ>(doc,
+                             flexField<Occ::ocs>(stats.occupiedSeconds),
+                             flexField<Occ::ses>(stats.sessions),
+                             flexField<Occ::lgs>(stats.longestSessionSeconds),
+                             flexField<Occ::ivl>(stats.intervalSeconds));
     }
-    return false;
 }
 
-bool createOccupancyDevice() {
-    // Create sensor with labels
-    StaticJsonDocument<512> doc;
-    JsonObject occSensor = doc.createNestedObject("mio:occSr");
-    occSensor["rn"] = OCCUPANCY_DEVICE_NAME;
-    occSensor["cnd"] = "org.fhtwmio.common.moduleclass.mioOccupancySensor";
-    JsonArray acpi = occSensor.createNestedArray("acpi");
-    acpi.add(String(CSE_NAME) + "/acpMoodMonitor");
-    JsonArray lbl = occSensor.createNestedArray("lbl");
-    lbl.add(String("room:") + ROOM_CONTAINER);
-    lbl.add(String("desk:") + DESK_CONTAINER);
-    lbl.add("sensor:occupancy");
-    occSensor["occ"] = false;
-
-    String payload;
-    serializeJson(doc, payload);
-
-    String response;
-    int statusCode;
-    oneM2MPost(onem2mPaths.DESK_PATH, payload, ONEM2M_RT_FLEXCONTAINER, response, statusCode);
+// Summary attributes have the same short names in every class that has them
+template <typename D>
+static void writeSummaryUpdate(JsonDocument& doc, const WindowSummary& summary, float quantum) {
+    writeFlexUpdate<D>(doc,
+                       flexField<D::smc>(summary.count),
+                       flexField<D::smn>(flexQuantize(summary.minimum, quantum)),
+                       flexField<D::smx>(flexQuantize(summary.maximum, quantum)),
+                       flexField<D::sav>(flexQuantize(summary.mean, quantum)),
+                       flexField<D::ssd>(flexQuantize(summary.stddev, quantum)),
+                       flexField<D::siv>(summary.intervalSeconds));
+}
+
+void buildLuxSummaryPayload(JsonDocument& doc, const WindowSummary& summary) {
+    writeSummaryUpdate<MioLuxSensor>(doc, summary, LUX_QUANTUM);
+}
 
-    if (statusCode == 201 || statusCode == 409) {
-        Serial.println("Occupancy sensor ready");
+void buildAudioSummaryPayload(JsonDocument& doc, const WindowSummary& summary) {
+    writeSummaryUpdate<MioAcousticSummary>(doc, summary, AUDIO_QUANTUM);
+}
 
-        // Add announcement attributes (may fail if IN-CSE not connected)
-        StaticJsonDocument<256> annDoc;
-        JsonObject annSensor = annDoc.createNestedObject("mio:occSr");
-        JsonArray at = annSensor.createNestedArray("at");
-        at.add("/id-cloud-in-cse");
-        JsonArray aa = annSensor.createNestedArray("aa");
-        aa.add("occ");
+// Samples are 0/1, so the mean is the share of samples that saw presence
+void buildOccupancySummaryPayload(JsonDocument& doc, const WindowSummary& summary) {
+    writeSummaryUpdate<MioOccupancySensor>(doc, summary, OCCUPANCY_SHARE_QUANTUM);
+}
 
-        String annPayload;
-        serializeJson(annDoc, annPayload);
+void buildLampSwitchPayload(JsonDocument& doc, bool on) {
+    writeFlexUpdate<BinarySwitch>(doc, flexField<BinarySwitch::state>(on));
+}
 
-        String occPath = onem2mPaths.DESK_PATH + "/" + String(OCCUPANCY_DEVICE_NAME);
-        oneM2MPut(occPath, annPayload, response, statusCode);
+// ==================== RESOURCE UPDATES ====================
 
+bool updateLuxValue(float luxValue, const char* generatedAt) {
+    StaticJsonDocument<256> doc;
+    buildLuxPayload(doc, luxValue, generatedAt);
+    if (putFlex(onem2mPaths.DEVICE_PATH, doc)) {
+        Serial.printf("Lux: %.1f lux\n", luxValue);
         return true;
     }
-    Serial.printf("Occupancy sensor creation failed (%d)\n", statusCode);
     return false;
 }
 
-bool updateOccupancyValue(bool occupied) {
+bool updateAudioValue(float loudness) {
+    String audioPath = onem2mPaths.DESK_PATH + "/" + String(AUDIO_DEVICE_NAME);
     StaticJsonDocument<256> doc;
-    JsonObject occSensor = doc.createNestedObject("mio:occSr");
-    occSensor["occ"] = occupied;
-
-    String payload;
-    serializeJson(doc, payload);
+    buildAudioPayload(doc, loudness);
+    if (putFlex(audioPath, doc)) {
+        Serial.printf("Audio: %.1f\n", loudness);
+        return true;
+    }
+    return false;
+}
 
-    String response;
-    int statusCode;
+bool updateOccupancyValue(bool occupied, const char* generatedAt) {
     String occPath = onem2mPaths.DESK_PATH + "/" + String(OCCUPANCY_DEVICE_NAME);
-    oneM2MPut(occPath, payload, response, statusCode);
-
-    bool success = (statusCode == 200 || statusCode == 204);
+    StaticJsonDocument<256> doc;
+    buildOccupancyPayload(doc, occupied, generatedAt);
+    bool success = putFlex(occPath, doc);
 
     // Sync occupancy to lamp if enabled
     #if SYNC_OCCUPANCY_TO_LAMP
@@ -331,18 +780,34 @@ bool updateOccupancyValue(bool occupied) {
     return success;
 }
 
-bool updateLampSwitch(bool on) {
+bool updateOccupancyStats(const OccupancyStats& stats) {
+    String occPath = onem2mPaths.DESK_PATH + "/" + String(OCCUPANCY_DEVICE_NAME);
+    StaticJsonDocument<256> doc;
+    buildOccupancyStatsPayload(doc, stats);
+    return putFlex(occPath, doc);
+}
+
+bool updateLuxSummary(const WindowSummary& summary) {
     StaticJsonDocument<256> doc;
-    JsonObject binSwitch = doc.createNestedObject("cod:binSh");
-    binSwitch["state"] = on;
+    buildLuxSummaryPayload(doc, summary);
+    return putFlex(onem2mPaths.DEVICE_PATH, doc);
+}
 
-    String payload;
-    serializeJson(doc, payload);
+bool updateAudioSummary(const WindowSummary& summary) {
+    StaticJsonDocument<256> doc;
+    buildAudioSummaryPayload(doc, summary);
+    return putFlex(onem2mPaths.DESK_PATH + "/" + AUDIO_SUMMARY_NAME, doc);
+}
 
-    String response;
-    int statusCode;
-    String switchPath = onem2mPaths.DESK_PATH + "/lamp/binarySwitch";
-    oneM2MPut(switchPath, payload, response, statusCode);
+bool updateOccupancySummary(const WindowSummary& summary) {
+    StaticJsonDocument<256> doc;
+    buildOccupancySummaryPayload(doc, summary);
+    return putFlex(onem2mPaths.DESK_PATH + "/" + OCCUPANCY_DEVICE_NAME, doc);
+}
 
-    return (statusCode == 200 || statusCode == 204);
+bool updateLampSwitch(bool on) {
+    String switchPath = onem2mPaths.DESK_PATH + "/lamp/binarySwitch";
+    StaticJsonDocument<256> doc;
+    buildLampSwitchPayload(doc, on);
+    return putFlex(switchPath, doc);
 }
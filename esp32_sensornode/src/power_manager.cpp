@@ -0,0 +1,163 @@
+/**
+ * power_manager.cpp
+ *
+ * Automatic light sleep needs CONFIG_PM_ENABLE and
+ * CONFIG_FREERTOS_USE_TICKLESS_IDLE in the sdkconfig; the stock Arduino
+ * core ships without tickless idle, so there the profile falls back to
+ * DFS and modem sleep only.
+ */
+
+#include "power_manager.h"
+#include "config.h"
+#include "diagnostics.h"
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+
+static int64_t activeSince = 0;
+static uint64_t activeUs = 0;
+static uint32_t activeRuns = 0;
+static bool dfsEnabled = false;
+static bool lightSleepEnabled = false;
+static bool modemSleepEnabled = false;
+static portMUX_TYPE activeMux = portMUX_INITIALIZER_UNLOCKED;
+
+#if LOW_POWER_PROFILE && CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t cpuMaxLock = NULL;
+#endif
+
+// ==================== PROFILE ====================
+
+bool initPowerManagement() {
+#if LOW_POWER_PROFILE
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pm = {};
+#else
+    esp_pm_config_esp32s3_t pm = {};
+#endif
+    pm.max_freq_mhz = PM_MAX_CPU_FREQ_MHZ;
+    pm.min_freq_mhz = PM_MIN_CPU_FREQ_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = true;
+#endif
+
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK) {
+        Serial.printf("ERROR: esp_pm_configure failed (%d)\n", (int)err);
+        return false;
+    }
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "sensorJobs", &cpuMaxLock);
+
+    dfsEnabled = true;
+    lightSleepEnabled = pm.light_sleep_enable;
+    Serial.printf("Power: DFS %d-%d MHz, light sleep %s\n", PM_MIN_CPU_FREQ_MHZ, PM_MAX_CPU_FREQ_MHZ,
+                  lightSleepEnabled ? "on" : "unavailable (no tickless idle)");
+    return true;
+#else
+    Serial.println("Power: CONFIG_PM_ENABLE not set - modem sleep only");
+    return false;
+#endif
+#else
+    return true;
+#endif
+}
+
+void applyWiFiPowerSave() {
+#if LOW_POWER_PROFILE
+    // Listen interval takes effect on association
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK) {
+        config.sta.listen_interval = WIFI_LISTEN_INTERVAL;
+        esp_wifi_set_config(WIFI_IF_STA, &config);
+    }
+    modemSleepEnabled = (esp_wifi_set_ps(WIFI_PS_MAX_MODEM) == ESP_OK);
+#endif
+}
+
+// ==================== ACTIVE WORK ====================
+
+void beginActiveWork() {
+#if LOW_POWER_PROFILE && CONFIG_PM_ENABLE
+    if (cpuMaxLock) esp_pm_lock_acquire(cpuMaxLock);
+#endif
+    activeSince = esp_timer_get_time();
+}
+
+void endActiveWork() {
+    int64_t elapsed = esp_timer_get_time() - activeSince;
+    portENTER_CRITICAL(&activeMux);
+    activeUs += elapsed;
+    activeRuns++;
+    portEXIT_CRITICAL(&activeMux);
+#if LOW_POWER_PROFILE && CONFIG_PM_ENABLE
+    if (cpuMaxLock) esp_pm_lock_release(cpuMaxLock);
+#endif
+}
+
+// ==================== RESIDENCY ====================
+
+static int64_t windowStart = 0;
+static uint64_t windowActiveStart = 0;
+static uint32_t windowRunsStart = 0;
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+static uint32_t previousIdle[portNUM_PROCESSORS] = {};
+#endif
+
+// 32-bit run time counters wrap after ~71 min; only deltas are used
+static uint64_t takeIdleRunTimeUs() {
+    uint64_t total = 0;
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    // Run time counter is esp_timer based, so light sleep counts as idle
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskStatus_t status;
+        vTaskGetInfo(xTaskGetIdleTaskHandleForCPU(core), &status, pdFALSE, eRunning);
+        total += (uint32_t)(status.ulRunTimeCounter - previousIdle[core]);
+        previousIdle[core] = status.ulRunTimeCounter;
+    }
+#endif
+    return total;
+}
+
+PowerResidency takePowerResidency() {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&activeMux);
+    uint64_t active = activeUs;
+    uint32_t runs = activeRuns;
+    portEXIT_CRITICAL(&activeMux);
+
+    PowerResidency residency = {};
+    residency.windowUs = now - windowStart;
+    residency.activeUs = active - windowActiveStart;
+    residency.activeRuns = runs - windowRunsStart;
+    residency.idleUs = takeIdleRunTimeUs();
+    residency.dfsEnabled = dfsEnabled;
+    residency.lightSleepEnabled = lightSleepEnabled;
+    residency.modemSleepEnabled = modemSleepEnabled;
+
+    windowStart = now;
+    windowActiveStart = active;
+    windowRunsStart = runs;
+    return residency;
+}
+
+void publishPowerResidency() {
+    PowerResidency residency = takePowerResidency();
+    if (residency.windowUs == 0) return;
+
+    StaticJsonDocument<256> doc;
+    doc["windowS"] = (uint32_t)(residency.windowUs / 1000000);
+    doc["activeMs"] = (uint32_t)(residency.activeUs / 1000);
+    doc["activeRuns"] = residency.activeRuns;
+    // Per-mille: active of one core, idle of both cores
+    doc["activePm"] = (uint32_t)(residency.activeUs * 1000 / residency.windowUs);
+    if (residency.idleUs) {
+        doc["idlePm"] = (uint32_t)(residency.idleUs * 1000 / (residency.windowUs * portNUM_PROCESSORS));
+    }
+    doc["dfs"] = residency.dfsEnabled;
+    doc["lightSleep"] = residency.lightSleepEnabled;
+    doc["modemSleep"] = residency.modemSleepEnabled;
+
+    publishDiagnostics("power", doc);
+}
@@ -0,0 +1,643 @@
+/**
+ * provisioning.cpp
+ *
+ * Declarative resource tree, concurrent provisioning engine, NVS cache
+ * and warm boot verification
+ */
+
+#include "provisioning.h"
+#include "config.h"
+#include "onem2m.h"
+#include "led_actuator.h"
+#include "occupancy_sensor.h"
+#include "diagnostics.h"
+#include "delta_batch.h"
+#include "metrics.h"
+#include "task_plan.h"
+#include <Preferences.h>
+#include <WiFi.h>
+
+// ==================== PAYLOAD BUILDERS ====================
+
+struct ProvisionNode;
+typedef void (*PayloadBuilder)(const ProvisionNode& node, JsonDocument& doc);
+typedef void (*CreateHook)(const String& path);
+
+static void addAccessControl(JsonObject resource) {
+    JsonArray acpi = resource.createNestedArray("acpi");
+    acpi.add(String(CSE_NAME) + "/acpMoodMonitor");
+}
+
+static void addLabels(JsonObject resource, const char* kind) {
+    JsonArray lbl = resource.createNestedArray("lbl");
+    lbl.add(String("room:") + ROOM_CONTAINER);
+    lbl.add(String("desk:") + DESK_CONTAINER);
+    lbl.add(kind);
+}
+
+struct ProvisionNode {
+    const char* name;
+    int8_t parent;           // Index into PROVISION_TREE, -1 for the AE
+    int resourceType;
+    uint8_t phase;           // Subscriptions need the notification server
+    PayloadBuilder build;
+    CreateHook afterCreate;  // Announcement / initial state, may be NULL
+};
+
+static void buildContainer(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject cnt = doc.createNestedObject("m2m:cnt");
+    cnt["rn"] = node.name;
+    addAccessControl(cnt);
+    cnt["mbs"] = 10000;
+    cnt["mni"] = 10;
+}
+
+static void buildDiagnosticsContainer(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject cnt = doc.createNestedObject("m2m:cnt");
+    cnt["rn"] = node.name;
+    addAccessControl(cnt);
+    addLabels(cnt, "diagnostics");
+    cnt["mbs"] = 100000;
+    cnt["mni"] = 50;
+}
+
+// Delta-encoded battery batches (BATTERY_DELTA_BATCH), a day of them at one uplink per 15 min
+static void buildBatchContainer(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject cnt = doc.createNestedObject("m2m:cnt");
+    cnt["rn"] = node.name;
+    addAccessControl(cnt);
+    addLabels(cnt, "batches:delta");
+    cnt["mbs"] = 100000;
+    cnt["mni"] = 100;
+}
+
+static void buildMetrics(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject metrics = beginFlexCreate<MioNodeMetrics>(doc, node.name);
+    addAccessControl(metrics);
+    addLabels(metrics, "diagnostics:metrics");
+}
+
+static void buildLuxSensor(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject luxSensor = beginFlexCreate<MioLuxSensor>(doc, node.name);
+    addAccessControl(luxSensor);
+    addLabels(luxSensor, "sensor:lux");
+    writeFlex<MioLuxSensor>(luxSensor, flexField<MioLuxSensor::lux>(0.0f));
+}
+
+static void buildAudioSensor(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject audioSensor = beginFlexCreate<AcousticSensor>(doc, node.name);
+    addAccessControl(audioSensor);
+    addLabels(audioSensor, "sensor:acoustic");
+    writeFlex<AcousticSensor>(audioSensor, flexField<AcousticSensor::louds>(0.0f));
+}
+
+// Filled by the first SENSOR_SUMMARY_INTERVAL window
+static void buildAudioSummary(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject summary = beginFlexCreate<MioAcousticSummary>(doc, node.name);
+    addAccessControl(summary);
+    addLabels(summary, "sensor:acoustic:summary");
+}
+
+static void buildOccupancySensor(const ProvisionNode& node, JsonDocument& doc) {
+    typedef MioOccupancySensor Occ;
+    JsonObject occSensor = beginFlexCreate<Occ>(doc, node.name);
+    addAccessControl(occSensor);
+    addLabels(occSensor, "sensor:occupancy");
+
+    RadarConfig radar = getRadarConfig();
+    writeFlex<Occ>(occSensor,
+                   flexField<Occ::occ>(false),
+                   flexField<Occ::ocs>(0u),
+                   flexField<Occ::ses>(0u),
+                   flexField<Occ::lgs>(0u),
+                   flexField<Occ::ivl>(OCCUPANCY_STATS_INTERVAL / 1000),
+                   flexField<Occ::eng>(radar.engineeringMode));
+    // Left out while the radar keeps its stored values, which the node does not read back
+    if (radar.hasMaxDistanceGate) {
+        writeFlex<Occ>(occSensor, flexField<Occ::mxg>(radar.maxDistanceGate));
+    }
+    if (radar.hasUnmannedDuration) {
+        writeFlex<Occ>(occSensor, flexField<Occ::udr>(radar.unmannedDurationSeconds));
+    }
+    if (radar.hasGateSensitivity) {
+        writeFlex<Occ>(occSensor, flexField<Occ::sen>(flexList(radar.gateSensitivity)));
+    }
+}
+
+static void buildLamp(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject lamp = beginFlexCreate<DeviceLight>(doc, node.name);
+    addAccessControl(lamp);
+    addLabels(lamp, "actuator:lamp");
+}
+
+static void buildBinarySwitch(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject binSwitch = beginFlexCreate<BinarySwitch>(doc, node.name);
+    addAccessControl(binSwitch);
+    writeFlex<BinarySwitch>(binSwitch, flexField<BinarySwitch::state>(false));
+}
+
+static void buildColor(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject color = beginFlexCreate<Colour>(doc, node.name);
+    addAccessControl(color);
+    writeFlex<Colour>(color,
+                      flexField<Colour::red>(0),
+                      flexField<Colour::green>(0),
+                      flexField<Colour::blue>(0));
+}
+
+static void addNotificationURI(JsonObject sub) {
+    JsonArray nu = sub.createNestedArray("nu");
+    nu.add(notificationURL + "/notify");
+}
+
+static JsonObject buildSubscriptionBase(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject sub = doc.createNestedObject("m2m:sub");
+    sub["rn"] = node.name;
+    addNotificationURI(sub);
+
+    JsonObject enc = sub.createNestedObject("enc");
+    JsonArray net = enc.createNestedArray("net");
+    net.add(1);  // Update of resource
+    net.add(2);  // Delete of resource
+    net.add(3);  // Create of direct child
+    net.add(4);  // Delete of direct child
+    return enc;
+}
+
+static void buildSubscription(const ProvisionNode& node, JsonDocument& doc) {
+    buildSubscriptionBase(node, doc);
+}
+
+static void buildRadarSubscription(const ProvisionNode& node, JsonDocument& doc) {
+    JsonObject enc = buildSubscriptionBase(node, doc);
+    JsonArray atr = enc.createNestedArray("atr");
+    for (size_t i = 0; i < RADAR_CONFIG_ATTRIBUTE_COUNT; i++) {
+        atr.add(RADAR_CONFIG_ATTRIBUTES[i]);
+    }
+}
+
+// ==================== CREATE HOOKS ====================
+
+// Announcement attributes (may fail if IN-CSE not connected)
+template <typename D>
+static void announce(const String& path) {
+    StaticJsonDocument<512> annDoc;  // Up to ~20 announced names
+    JsonObject annSensor = annDoc.createNestedObject(D::TYPE);
+    JsonArray at = annSensor.createNestedArray("at");
+    at.add("/id-cloud-in-cse");
+    writeFlexAnnouncedAttributes<D>(annSensor);
+
+    int statusCode;
+    oneM2MPut(path, annDoc, statusCode);
+}
+
+// Lamp starts OFF with no color on every provisioning
+static void resetBinarySwitch(const String& path) {
+    updateFlex<BinarySwitch>(path, flexField<BinarySwitch::state>(false));
+}
+
+static void resetColor(const String& path) {
+    updateFlex<Colour>(path,
+                       flexField<Colour::red>(0),
+                       flexField<Colour::green>(0),
+                       flexField<Colour::blue>(0));
+}
+
+// ==================== RESOURCE TREE ====================
+// Add new devices here; parents are created before their children and
+// independent siblings are created concurrently.
+
+enum ProvisionPhase : uint8_t {
+    PHASE_RESOURCES,
+    PHASE_SUBSCRIPTIONS
+};
+
+enum NodeIndex : int8_t {
+    NODE_ROOM,
+    NODE_DESK,
+    NODE_LUX,
+    NODE_AUDIO,
+    NODE_AUDIO_SUMMARY,
+    NODE_OCCUPANCY,
+    NODE_LAMP,
+    NODE_SWITCH,
+    NODE_COLOR,
+    NODE_DIAGNOSTICS,
+    NODE_METRICS,
+    NODE_BATCHES,
+    NODE_SUB_SWITCH,
+    NODE_SUB_COLOR,
+    NODE_SUB_OCCUPANCY,
+    NODE_COUNT
+};
+
+static const ProvisionNode PROVISION_TREE[NODE_COUNT] = {
+    { ROOM_CONTAINER,        -1,             ONEM2M_RT_CONTAINER,     PHASE_RESOURCES,     buildContainer,            NULL },
+    { DESK_CONTAINER,        NODE_ROOM,      ONEM2M_RT_CONTAINER,     PHASE_RESOURCES,     buildContainer,            NULL },
+    { LUX_DEVICE_NAME,       NODE_DESK,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildLuxSensor,            announce<MioLuxSensor> },
+    { AUDIO_DEVICE_NAME,     NODE_DESK,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildAudioSensor,          announce<AcousticSensor> },
+    { AUDIO_SUMMARY_NAME,    NODE_DESK,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildAudioSummary,         announce<MioAcousticSummary> },
+    { OCCUPANCY_DEVICE_NAME, NODE_DESK,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildOccupancySensor,      announce<MioOccupancySensor> },
+    { "lamp",                NODE_DESK,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildLamp,                 NULL },
+    { "binarySwitch",        NODE_LAMP,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildBinarySwitch,         resetBinarySwitch },
+    { "color",               NODE_LAMP,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildColor,                resetColor },
+    { DIAGNOSTICS_CONTAINER, NODE_DESK,      ONEM2M_RT_CONTAINER,     PHASE_RESOURCES,     buildDiagnosticsContainer, NULL },
+    { METRICS_CONTAINER,     NODE_DESK,      ONEM2M_RT_FLEXCONTAINER, PHASE_RESOURCES,     buildMetrics,              announce<MioNodeMetrics> },
+    { DELTA_BATCH_CONTAINER, NODE_DESK,      ONEM2M_RT_CONTAINER,     PHASE_RESOURCES,     buildBatchContainer,       NULL },
+    { "subLampSwitch",       NODE_SWITCH,    ONEM2M_RT_SUBSCRIPTION,  PHASE_SUBSCRIPTIONS, buildSubscription,         NULL },
+    { "subLampColor",        NODE_COLOR,     ONEM2M_RT_SUBSCRIPTION,  PHASE_SUBSCRIPTIONS, buildSubscription,         NULL },
+    { "subOccConfig",        NODE_OCCUPANCY, ONEM2M_RT_SUBSCRIPTION,  PHASE_SUBSCRIPTIONS, buildRadarSubscription,    NULL },
+};
+
+static String nodePath(int index) {
+    if (index < 0) return onem2mPaths.AE_PATH;
+    return nodePath(PROVISION_TREE[index].parent) + "/" + PROVISION_TREE[index].name;
+}
+
+static bool isBelowDesk(int index) {
+    for (int i = PROVISION_TREE[index].parent; i >= 0; i = PROVISION_TREE[i].parent) {
+        if (i == NODE_DESK) return true;
+    }
+    return false;
+}
+
+// FNV-1a over everything that determines the provisioned tree
+static uint32_t hashBytes(uint32_t hash, const char* text) {
+    while (*text) {
+        hash ^= (uint8_t)*text++;
+        hash *= 16777619u;
+    }
+    return hash ^ 0xFF;  // Field separator
+}
+
+static uint32_t manifestHash() {
+    uint32_t hash = 2166136261u;
+    hash = hashBytes(hash, String(PROVISIONING_VERSION).c_str());
+    hash = hashBytes(hash, onem2mPaths.BASE_URL.c_str());
+    hash = hashBytes(hash, ORIGINATOR);
+    hash = hashBytes(hash, String(MIO_DESCRIPTORS_HASH).c_str());
+
+    // Subscriptions point at this node's address
+    hash = hashBytes(hash, WiFi.localIP().toString().c_str());
+    hash = hashBytes(hash, String(NOTIFICATION_PORT).c_str());
+
+    for (int i = 0; i < NODE_COUNT; i++) {
+        hash = hashBytes(hash, nodePath(i).c_str());
+        hash = hashBytes(hash, String(PROVISION_TREE[i].resourceType).c_str());
+    }
+    return hash;
+}
+
+static size_t deskDescendantCount() {
+    size_t count = 0;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (isBelowDesk(i)) count++;
+    }
+    return count;
+}
+
+// ==================== DISCOVERY ====================
+
+// Resource IDs of all containers, FlexContainers and subscriptions below the desk
+static bool discoverDeskResources(JsonDocument& doc, JsonArray& ris) {
+    String path = onem2mPaths.DESK_PATH + "?fu=1&drt=2&ty=3&ty=28&ty=23";
+    StaticJsonDocument<32> filter;
+    filter["m2m:uril"] = true;
+    JsonFilterSink response(doc, filter);
+    int statusCode;
+
+    // Parsed from the connection: the reply never exists as text
+    if (!oneM2MGet(path, response, statusCode) || statusCode != 200) {
+        return false;
+    }
+
+    ris = doc["m2m:uril"];
+    return !ris.isNull();
+}
+
+// ==================== CACHE ====================
+
+bool verifyProvisioningCache() {
+    Preferences prefs;
+    if (!prefs.begin(PROVISIONING_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    uint32_t storedHash = prefs.getUInt("hash", 0);
+    String storedRis = prefs.getString("ris", "");
+    prefs.end();
+
+    if (storedHash == 0 || storedRis.length() == 0) {
+        Serial.println("Provisioning cache empty");
+        return false;
+    }
+    if (storedHash != manifestHash()) {
+        Serial.println("Provisioning manifest changed");
+        return false;
+    }
+
+    DynamicJsonDocument doc(2048);
+    JsonArray ris;
+    if (!discoverDeskResources(doc, ris)) {
+        Serial.println("Provisioning verification request failed");
+        return false;
+    }
+
+    // Every cached resource ID must still exist
+    int start = 0;
+    while (start < (int)storedRis.length()) {
+        int end = storedRis.indexOf(',', start);
+        if (end < 0) end = storedRis.length();
+        String ri = storedRis.substring(start, end);
+
+        bool found = false;
+        for (JsonVariant discovered : ris) {
+            if (ri == discovered.as<const char*>()) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            Serial.printf("Provisioned resource %s missing\n", ri.c_str());
+            return false;
+        }
+        start = end + 1;
+    }
+
+    Serial.println("Provisioning cache valid - skipping resource creation");
+    return true;
+}
+
+bool saveProvisioningCache() {
+    DynamicJsonDocument doc(2048);
+    JsonArray ris;
+    if (!discoverDeskResources(doc, ris) || ris.size() < deskDescendantCount()) {
+        Serial.println("Provisioning incomplete - cache not written");
+        return false;
+    }
+
+    String joined;
+    for (JsonVariant ri : ris) {
+        if (joined.length() > 0) joined += ",";
+        joined += ri.as<const char*>();
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(PROVISIONING_NVS_NAMESPACE, false)) {
+        return false;
+    }
+    prefs.putString("ris", joined);
+    prefs.putUInt("hash", manifestHash());
+    prefs.end();
+
+    Serial.printf("Provisioning cache written (%u resources)\n", (unsigned)ris.size());
+    return true;
+}
+
+void clearProvisioningCache() {
+    Preferences prefs;
+    if (prefs.begin(PROVISIONING_NVS_NAMESPACE, false)) {
+        prefs.clear();
+        prefs.end();
+    }
+}
+
+// ==================== PROVISIONING ENGINE ====================
+
+enum NodeState : uint8_t {
+    NODE_PENDING,
+    NODE_IN_FLIGHT,
+    NODE_DONE,
+    NODE_FAILED,
+    NODE_SKIPPED     // A parent failed
+};
+
+static NodeState nodeState[NODE_COUNT];
+static uint8_t activePhase = PHASE_RESOURCES;
+static SemaphoreHandle_t engineMutex = NULL;
+static SemaphoreHandle_t workerDone = NULL;
+
+static bool isTransientFailure(int statusCode) {
+    return statusCode <= 0 || statusCode >= 500;
+}
+
+// 409: the resource is left from an earlier provisioning. A subscription
+// may still notify the address the node had then (new DHCP lease), so
+// its nu is pointed at this node again; anything else is used as it is.
+static bool adoptExisting(const ProvisionNode& node, const String& path) {
+    if (node.resourceType != ONEM2M_RT_SUBSCRIPTION) return true;
+
+    StaticJsonDocument<256> doc;
+    addNotificationURI(doc.createNestedObject("m2m:sub"));
+    int statusCode = -1;
+    oneM2MPut(path, doc, statusCode);
+    if (statusCode == 200 || statusCode == 204) return true;
+
+    Serial.printf("%s notification URI update failed (%d)\n", node.name, statusCode);
+    return false;
+}
+
+static bool createNode(int index) {
+    const ProvisionNode& node = PROVISION_TREE[index];
+
+    DynamicJsonDocument doc(1024);
+    node.build(node, doc);
+
+    String parentPath = nodePath(node.parent);
+    int statusCode = -1;
+
+    for (int attempt = 0; attempt < PROVISION_MAX_ATTEMPTS; attempt++) {
+        if (attempt > 0) {
+            if (!oneM2MRetryAllowed()) break;  // The next provisioning round tries again
+            vTaskDelay(pdMS_TO_TICKS(backoffDelay(PROVISION_RETRY_BASE_MS, PROVISION_RETRY_MAX_MS, attempt - 1)));
+        }
+
+        oneM2MPost(parentPath, doc, node.resourceType, statusCode);
+
+        // A failed update is not retried here; the next provisioning round does
+        if (statusCode == 409 && !adoptExisting(node, parentPath + "/" + node.name)) return false;
+        if (statusCode == 201 || statusCode == 409) {
+            if (node.afterCreate) node.afterCreate(parentPath + "/" + node.name);
+            Serial.printf("%s ready\n", node.name);
+            return true;
+        }
+        if (!isTransientFailure(statusCode)) break;
+    }
+
+    Serial.printf("%s creation failed (%d)\n", node.name, statusCode);
+    return false;
+}
+
+// Caller holds engineMutex
+static int claimReadyNode(bool& phaseFinished) {
+    phaseFinished = true;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        const ProvisionNode& node = PROVISION_TREE[i];
+        if (node.phase != activePhase) continue;
+
+        if (nodeState[i] == NODE_IN_FLIGHT) {
+            phaseFinished = false;
+            continue;
+        }
+        if (nodeState[i] != NODE_PENDING) continue;
+
+        NodeState parentState = (node.parent < 0) ? NODE_DONE : nodeState[node.parent];
+        bool parentInPhase = (node.parent >= 0) && (PROVISION_TREE[node.parent].phase == activePhase);
+
+        if (parentState == NODE_DONE) {
+            nodeState[i] = NODE_IN_FLIGHT;
+            phaseFinished = false;
+            return i;
+        }
+        if (parentState == NODE_FAILED || parentState == NODE_SKIPPED || !parentInPhase) {
+            nodeState[i] = NODE_SKIPPED;
+            continue;
+        }
+        phaseFinished = false;  // Waiting for a parent in flight
+    }
+    return -1;
+}
+
+// Caller holds engineMutex. Ready nodes first, then pending children of
+// the nodes claimed, which the pipeline holds back until their parent's
+// reply is in
+static size_t claimReadyBatch(int* batch, int* dependsOn, bool& phaseFinished) {
+    size_t limit = oneM2MPipeliningEnabled() ? ONEM2M_PIPELINE_DEPTH : 1;
+    size_t count = 0;
+    int index;
+    while (count < limit && (index = claimReadyNode(phaseFinished)) >= 0) {
+        batch[count] = index;
+        dependsOn[count++] = -1;
+    }
+    if (count == 0) return 0;
+
+    // Parents come before their children in PROVISION_TREE
+    for (int i = 0; i < NODE_COUNT && count < limit; i++) {
+        const ProvisionNode& node = PROVISION_TREE[i];
+        if (node.phase != activePhase || nodeState[i] != NODE_PENDING) continue;
+        for (size_t j = 0; j < count; j++) {
+            if (batch[j] == node.parent) {
+                nodeState[i] = NODE_IN_FLIGHT;
+                batch[count] = i;
+                dependsOn[count++] = (int)j;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+struct PendingCreate {
+    DynamicJsonDocument doc{1024};
+    String parentPath;
+};
+
+static void createBatch(const int* batch, const int* dependsOn, size_t count, NodeState* results) {
+    PendingCreate* pending = new PendingCreate[count];  // Off the worker's stack
+    OneM2MBatchEntry entries[ONEM2M_PIPELINE_DEPTH];
+    for (size_t i = 0; i < count; i++) {
+        const ProvisionNode& node = PROVISION_TREE[batch[i]];
+        node.build(node, pending[i].doc);
+        pending[i].parentPath = nodePath(node.parent);
+        entries[i] = {"POST", &pending[i].parentPath, &pending[i].doc, node.resourceType, nullptr, dependsOn[i], 0};
+    }
+    oneM2MPipeline(entries, count);
+
+    for (size_t i = 0; i < count; i++) {
+        const ProvisionNode& node = PROVISION_TREE[batch[i]];
+        int statusCode = entries[i].statusCode;
+        String path = pending[i].parentPath + "/" + node.name;
+        if (statusCode == 409 && !adoptExisting(node, path)) {
+            results[i] = NODE_FAILED;
+        } else if (statusCode == 201 || statusCode == 409) {
+            if (node.afterCreate) node.afterCreate(path);
+            Serial.printf("%s ready\n", node.name);
+            results[i] = NODE_DONE;
+        } else if (statusCode == ONEM2M_STATUS_SKIPPED) {
+            // The parent may have made it on a retry below
+            bool parentDone = (results[dependsOn[i]] == NODE_DONE);
+            results[i] = !parentDone ? NODE_SKIPPED : createNode(batch[i]) ? NODE_DONE : NODE_FAILED;
+        } else if (isTransientFailure(statusCode)) {
+            results[i] = createNode(batch[i]) ? NODE_DONE : NODE_FAILED;  // Retries with backoff
+        } else {
+            Serial.printf("%s creation failed (%d)\n", node.name, statusCode);
+            results[i] = NODE_FAILED;
+        }
+    }
+    delete[] pending;
+}
+
+static void ProvisionWorkerTask(void* pvParameters) {
+    while (true) {
+        bool phaseFinished;
+        int batch[ONEM2M_PIPELINE_DEPTH];
+        int dependsOn[ONEM2M_PIPELINE_DEPTH];
+        xSemaphoreTake(engineMutex, portMAX_DELAY);
+        size_t count = claimReadyBatch(batch, dependsOn, phaseFinished);
+        xSemaphoreGive(engineMutex);
+
+        if (count > 0) {
+            NodeState results[ONEM2M_PIPELINE_DEPTH];
+            if (count == 1) {
+                results[0] = createNode(batch[0]) ? NODE_DONE : NODE_FAILED;
+            } else {
+                createBatch(batch, dependsOn, count, results);
+            }
+            xSemaphoreTake(engineMutex, portMAX_DELAY);
+            for (size_t i = 0; i < count; i++) {
+                nodeState[batch[i]] = results[i];
+            }
+            xSemaphoreGive(engineMutex);
+        } else if (phaseFinished) {
+            break;
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+    }
+
+    xSemaphoreGive(workerDone);
+    vTaskDelete(NULL);
+}
+
+static bool runPhase(uint8_t phase) {
+    if (!engineMutex) {
+        engineMutex = xSemaphoreCreateMutex();
+        workerDone = xSemaphoreCreateCounting(ONEM2M_POOL_SIZE, 0);
+        if (!engineMutex || !workerDone) return false;
+    }
+
+    activePhase = phase;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (PROVISION_TREE[i].phase == phase) nodeState[i] = NODE_PENDING;
+    }
+
+    // One worker per pooled connection
+    int workers = 0;
+    for (int i = 0; i < ONEM2M_POOL_SIZE; i++) {
+        if (startPlannedTask(TASK_PROVISIONER, ProvisionWorkerTask)) workers++;
+    }
+    if (workers == 0) return false;
+
+    for (int i = 0; i < workers; i++) {
+        xSemaphoreTake(workerDone, portMAX_DELAY);
+    }
+
+    bool ok = true;
+    for (int i = 0; i < NODE_COUNT; i++) {
+        if (PROVISION_TREE[i].phase == phase && nodeState[i] != NODE_DONE) ok = false;
+    }
+    return ok;
+}
+
+bool provisionResources() {
+    unsigned long start = millis();
+    bool ok = runPhase(PHASE_RESOURCES);
+    Serial.printf("Resources provisioned in %lu ms%s\n", millis() - start, ok ? "" : " (with failures)");
+    return ok;
+}
+
+bool provisionSubscriptions() {
+    unsigned long start = millis();
+    bool ok = runPhase(PHASE_SUBSCRIPTIONS);
+    Serial.printf("Subscriptions provisioned in %lu ms%s\n", millis() - start, ok ? "" : " (with failures)");
+    return ok;
+}
@@ -0,0 +1,301 @@
+/**
+ * reading_buffer.cpp
+ *
+ * Ring buffer and summary slots between the sensor jobs and the
+ * connectivity task, which publishes them
+ */
+
+#include "reading_buffer.h"
+#include "config.h"
+#include "connectivity.h"
+#include "onem2m.h"
+#include "metrics.h"
+
+struct BufferedReading {
+    unsigned long sampleMs;
+    float value;
+    ReadingKind kind;
+    bool late;  // Queued while offline or sent again: carries its sample time as dgt
+};
+
+static BufferedReading ring[READING_BUFFER_CAPACITY];
+static size_t ringHead = 0;
+static size_t ringCount = 0;
+static uint32_t droppedReadings = 0;
+static bool live = false;  // Set once the buffer has been replayed, cleared when the CSE fails
+static portMUX_TYPE bufferMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds bufferMux
+static void appendReading(ReadingKind kind, float value, unsigned long sampleMs) {
+    if (ringCount == READING_BUFFER_CAPACITY) {
+        ringHead = (ringHead + 1) % READING_BUFFER_CAPACITY;
+        ringCount--;
+        droppedReadings++;
+    }
+    BufferedReading& slot = ring[(ringHead + ringCount) % READING_BUFFER_CAPACITY];
+    slot.sampleMs = sampleMs;
+    slot.value = value;
+    slot.kind = kind;
+    slot.late = !live;
+    ringCount++;
+}
+
+static ReadingResult classifyStatus(int statusCode) {
+    if (statusCode == 200 || statusCode == 204) return READING_PUBLISHED;
+    if (statusCode <= 0 || statusCode >= 500) return READING_RETRY;
+    return READING_REJECTED;
+}
+
+static String readingPath(ReadingKind kind) {
+    switch (kind) {
+        case READING_LUX:       return onem2mPaths.DEVICE_PATH;
+        case READING_AUDIO:     return onem2mPaths.DESK_PATH + "/" + String(AUDIO_DEVICE_NAME);
+        case READING_OCCUPANCY: return onem2mPaths.DESK_PATH + "/" + String(OCCUPANCY_DEVICE_NAME);
+    }
+    return String();
+}
+
+static void buildReadingPayload(JsonDocument& doc, const ReadingUpdate& update) {
+    switch (update.kind) {
+        case READING_LUX:       buildLuxPayload(doc, update.value, update.generatedAt); break;
+        case READING_AUDIO:     buildAudioPayload(doc, update.value); break;
+        case READING_OCCUPANCY: buildOccupancyPayload(doc, update.value != 0.0f, update.generatedAt); break;
+    }
+}
+
+bool reportReading(ReadingKind kind, float value) {
+    markBootPhase(BOOT_FIRST_SAMPLE);
+
+    // cod:acoSr has no dgt, so a late loudness would read as current; the
+    // acousticSummary window still covers the outage
+    portENTER_CRITICAL(&bufferMux);
+    bool queued = live || kind != READING_AUDIO;
+    if (queued) appendReading(kind, value, millis());
+    size_t depth = ringCount;
+    portEXIT_CRITICAL(&bufferMux);
+
+    if (!queued) return false;
+    metricRaise(METRIC_READING_BUFFER_DEPTH, depth);
+    requestReadingReplay();
+    return true;
+}
+
+size_t publishReadings(const ReadingUpdate* updates, size_t count, ReadingResult* results) {
+    size_t publishedCount = 0;
+
+    for (size_t start = 0; start < count; start += ONEM2M_PIPELINE_DEPTH) {
+        size_t window = min(count - start, (size_t)ONEM2M_PIPELINE_DEPTH);
+        StaticJsonDocument<256> docs[ONEM2M_PIPELINE_DEPTH];
+        String paths[ONEM2M_PIPELINE_DEPTH];
+        OneM2MBatchEntry entries[ONEM2M_PIPELINE_DEPTH];
+
+        // Independent PUTs: no entry waits for another
+        for (size_t i = 0; i < window; i++) {
+            const ReadingUpdate& update = updates[start + i];
+            paths[i] = readingPath(update.kind);
+            buildReadingPayload(docs[i], update);
+            entries[i] = {"PUT", &paths[i], &docs[i], 0, nullptr, -1, 0};
+        }
+        oneM2MPipeline(entries, window);
+
+        int occupancy = -1;  // Last occupancy the CSE accepted in this window
+        for (size_t i = 0; i < window; i++) {
+            results[start + i] = classifyStatus(entries[i].statusCode);
+            if (results[start + i] != READING_PUBLISHED) continue;
+            publishedCount++;
+            if (updates[start + i].kind == READING_OCCUPANCY) occupancy = updates[start + i].value != 0.0f;
+        }
+
+        #if SYNC_OCCUPANCY_TO_LAMP
+        if (occupancy >= 0) {
+            updateLampSwitch(occupancy == 1);
+        }
+        #endif
+    }
+    return publishedCount;
+}
+
+// Put readings back at the front of the ring, newest first; when newer
+// readings have filled it meanwhile, the oldest are the ones dropped.
+// Readings queued from now on carry dgt until a replay gets through;
+// loudness readings cannot, and are not kept (see reportReading()).
+// @return Readings now buffered
+static size_t requeueReadings(const BufferedReading* readings, size_t count) {
+    portENTER_CRITICAL(&bufferMux);
+    live = false;
+    for (size_t i = count; i-- > 0;) {
+        if (readings[i].kind == READING_AUDIO) continue;
+        if (ringCount == READING_BUFFER_CAPACITY) {
+            droppedReadings++;
+            continue;
+        }
+        ringHead = (ringHead + READING_BUFFER_CAPACITY - 1) % READING_BUFFER_CAPACITY;
+        ring[ringHead] = readings[i];
+        ring[ringHead].late = true;
+        ringCount++;
+    }
+    size_t depth = ringCount;
+    portEXIT_CRITICAL(&bufferMux);
+    return depth;
+}
+
+// ==================== SUMMARY SLOTS ====================
+
+// Only the owning job posts to a slot, and only while it is idle; only
+// the connectivity task publishes a pending one
+struct SummarySlot {
+    SummaryOutcome state;
+    WindowSummary summary;
+    OccupancyStats stats;  // SUMMARY_OCCUPANCY_STATS only
+};
+
+static SummarySlot summarySlots[SUMMARY_KIND_COUNT];
+static portMUX_TYPE summaryMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool postSlot(SummaryKind kind, const WindowSummary* summary, const OccupancyStats* stats) {
+    portENTER_CRITICAL(&summaryMux);
+    SummarySlot& slot = summarySlots[kind];
+    bool free = (slot.state == SUMMARY_IDLE);
+    if (free) {
+        if (summary) slot.summary = *summary;
+        if (stats) slot.stats = *stats;
+        slot.state = SUMMARY_PENDING;
+    }
+    portEXIT_CRITICAL(&summaryMux);
+
+    if (free) requestReadingReplay();
+    return free;
+}
+
+bool postSummary(SummaryKind kind, const WindowSummary& summary) {
+    return postSlot(kind, &summary, nullptr);
+}
+
+bool postOccupancyStats(const OccupancyStats& stats) {
+    return postSlot(SUMMARY_OCCUPANCY_STATS, nullptr, &stats);
+}
+
+SummaryOutcome collectSummaryOutcome(SummaryKind kind) {
+    portENTER_CRITICAL(&summaryMux);
+    SummaryOutcome outcome = summarySlots[kind].state;
+    if (outcome == SUMMARY_SENT || outcome == SUMMARY_FAILED) summarySlots[kind].state = SUMMARY_IDLE;
+    portEXIT_CRITICAL(&summaryMux);
+    return outcome;
+}
+
+static bool publishSummary(SummaryKind kind, const SummarySlot& slot) {
+    const WindowSummary& summary = slot.summary;
+    switch (kind) {
+        case SUMMARY_LUX:
+            if (!updateLuxSummary(summary)) return false;
+            Serial.printf("Lux summary: %lu samples, %.1f-%.1f lux, mean %.1f\n", (unsigned long)summary.count,
+                          summary.minimum, summary.maximum, summary.mean);
+            return true;
+        case SUMMARY_AUDIO:
+            if (!updateAudioSummary(summary)) return false;
+            Serial.printf("Audio summary: %lu samples, %.1f-%.1f dB, mean %.1f, stddev %.1f\n",
+                          (unsigned long)summary.count, summary.minimum, summary.maximum, summary.mean,
+                          summary.stddev);
+            return true;
+        case SUMMARY_OCCUPANCY:
+            if (!updateOccupancySummary(summary)) return false;
+            Serial.printf("Occupancy summary: %lu samples, %.0f%% occupied\n", (unsigned long)summary.count,
+                          100.0f * summary.mean);
+            return true;
+        case SUMMARY_OCCUPANCY_STATS:
+            if (!updateOccupancyStats(slot.stats)) return false;
+            Serial.printf("Occupancy stats: %lus occupied, %u sessions, longest %lus\n",
+                          (unsigned long)slot.stats.occupiedSeconds, slot.stats.sessions,
+                          (unsigned long)slot.stats.longestSessionSeconds);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// A summary the CSE did not take goes back to its job, which folds the
+// window back in and posts it again, grown, when the next one is due
+static void publishSummaries() {
+    for (int kind = 0; kind < SUMMARY_KIND_COUNT; kind++) {
+        SummarySlot slot;
+        portENTER_CRITICAL(&summaryMux);
+        bool queued = summarySlots[kind].state == SUMMARY_PENDING;
+        if (queued) slot = summarySlots[kind];
+        portEXIT_CRITICAL(&summaryMux);
+        if (!queued) continue;
+
+        bool sent = publishSummary((SummaryKind)kind, slot);
+
+        portENTER_CRITICAL(&summaryMux);
+        summarySlots[kind].state = sent ? SUMMARY_SENT : SUMMARY_FAILED;
+        portEXIT_CRITICAL(&summaryMux);
+    }
+}
+
+// ==================== REPLAY ====================
+
+size_t flushReadingBuffer() {
+    size_t replayed = 0;
+    size_t late = 0;
+    size_t failed = 0;
+    size_t kept = 0;
+
+    // Readings taken during the flush are appended and replayed in order
+    while (true) {
+        BufferedReading readings[ONEM2M_PIPELINE_DEPTH];
+        size_t count = 0;
+        portENTER_CRITICAL(&bufferMux);
+        while (ringCount > 0 && count < ONEM2M_PIPELINE_DEPTH) {
+            readings[count++] = ring[ringHead];
+            ringHead = (ringHead + 1) % READING_BUFFER_CAPACITY;
+            ringCount--;
+        }
+        if (count == 0) live = true;
+        portEXIT_CRITICAL(&bufferMux);
+        if (count == 0) break;
+
+        ReadingUpdate updates[ONEM2M_PIPELINE_DEPTH];
+        char generatedAt[ONEM2M_PIPELINE_DEPTH][20];
+        ReadingResult results[ONEM2M_PIPELINE_DEPTH];
+        for (size_t i = 0; i < count; i++) {
+            bool timed = readings[i].late &&
+                         formatSampleTime(readings[i].sampleMs, generatedAt[i], sizeof(generatedAt[i]));
+            updates[i] = {readings[i].kind, readings[i].value, timed ? generatedAt[i] : nullptr};
+            if (readings[i].late) late++;
+        }
+        replayed += publishReadings(updates, count, results);
+
+        // Rejected readings are dropped; the rest wait for the next replay
+        BufferedReading retry[ONEM2M_PIPELINE_DEPTH];
+        size_t retryCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (results[i] == READING_REJECTED) failed++;
+            else if (results[i] == READING_RETRY) retry[retryCount++] = readings[i];
+        }
+        if (retryCount > 0) {
+            kept = requeueReadings(retry, retryCount);
+            break;
+        }
+    }
+
+    // Live readings are not worth a line each; replays are
+    if (late > 0 || failed > 0) {
+        Serial.printf("Replayed %u buffered readings (%u failed, %u kept, %lu dropped)\n",
+                      (unsigned)replayed, (unsigned)failed, (unsigned)kept, (unsigned long)droppedReadings);
+    }
+
+    // While the CSE fails, summaries wait for the next replay with the readings
+    if (kept == 0) publishSummaries();
+    return replayed;
+}
+
+bool readingsPending() {
+    portENTER_CRITICAL(&bufferMux);
+    bool pending = !live;
+    portEXIT_CRITICAL(&bufferMux);
+    return pending;
+}
+
+uint32_t getDroppedReadingCount() {
+    return droppedReadings;
+}
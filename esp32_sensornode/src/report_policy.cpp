@@ -0,0 +1,75 @@
+/**
+ * report_policy.cpp
+ */
+
+#include "report_policy.h"
+#include "config.h"
+
+void OccupancyTracker::begin(unsigned long now) {
+    windowStart = now;
+    lastSampleTime = now;
+}
+
+// Time between two samples is attributed to the state of the earlier sample
+void OccupancyTracker::sample(bool occupied, unsigned long now) {
+    if (sessionActive) {
+        occupiedMs += now - lastSampleTime;
+        uint32_t sessionMs = now - sessionStart;
+        if (sessionMs > longestSessionMs) longestSessionMs = sessionMs;
+    }
+
+    if (occupied && !sessionActive) {
+        sessionActive = true;
+        sessionStart = now;
+        sessionCount++;
+    } else if (!occupied) {
+        sessionActive = false;
+    }
+
+    if (occupied) {
+        lastPresenceTime = now;
+        presenceSeen = true;
+    }
+    lastSampleTime = now;
+}
+
+bool OccupancyTracker::windowDue(unsigned long now) const {
+    return now - windowStart >= OCCUPANCY_STATS_INTERVAL;
+}
+
+OccupancyStats OccupancyTracker::peek(unsigned long now) const {
+    OccupancyStats stats;
+    stats.intervalSeconds = (now - windowStart) / 1000;
+    stats.occupiedSeconds = occupiedMs / 1000;
+    stats.sessions = sessionCount;
+    stats.longestSessionSeconds = longestSessionMs / 1000;
+    stats.presenceSeen = presenceSeen;
+    if (sessionActive || !presenceSeen) {
+        stats.secondsSinceLastPresence = 0;
+    } else {
+        stats.secondsSinceLastPresence = (now - lastPresenceTime) / 1000;
+    }
+    return stats;
+}
+
+void OccupancyTracker::restart(unsigned long now) {
+    // An ongoing session carries over into the next window
+    windowStart = now;
+    occupiedMs = 0;
+    sessionCount = sessionActive ? 1 : 0;
+    longestSessionMs = sessionActive ? (now - sessionStart) : 0;
+}
+
+void OccupancyTracker::append(const OccupancyTracker& later) {
+    // A session ongoing at the restart is counted in both windows
+    uint16_t carried = sessionActive && later.sessionCount > 0 ? 1 : 0;
+    occupiedMs += later.occupiedMs;
+    sessionCount += later.sessionCount - carried;
+    if (later.longestSessionMs > longestSessionMs) longestSessionMs = later.longestSessionMs;
+
+    lastSampleTime = later.lastSampleTime;
+    sessionStart = later.sessionStart;
+    lastPresenceTime = later.lastPresenceTime;
+    sessionActive = later.sessionActive;
+    presenceSeen = later.presenceSeen;
+}
@@ -0,0 +1,39 @@
+/**
+ * request_arena.cpp
+ */
+
+#include "request_arena.h"
+#include <stdarg.h>
+
+char* RequestArena::allocate(size_t size) {
+    size_t start = (offset + 3) & ~(size_t)3;
+    if (start > capacity || size > capacity - start) {
+        overflowCount++;
+        return nullptr;
+    }
+    offset = start + size;
+    if (offset > peak) peak = offset;
+    return buffer + start;
+}
+
+const char* RequestArena::format(const char* format, ...) {
+    size_t start = (offset + 3) & ~(size_t)3;
+    size_t space = start < capacity ? capacity - start : 0;
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(space ? buffer + start : nullptr, space, format, args);
+    va_end(args);
+
+    if (length < 0 || (size_t)length >= space) {
+        overflowCount++;
+        return nullptr;
+    }
+    offset = start + length + 1;
+    if (offset > peak) peak = offset;
+    return buffer + start;
+}
+
+void RequestArena::reset() {
+    offset = 0;
+}
@@ -0,0 +1,212 @@
+/**
+ * sensor_scheduler.cpp
+ *
+ * Timer wheel scheduler for sensor jobs. Jobs run to completion on the
+ * scheduler task; a job that overruns delays the others but due times do
+ * not drift, late periods are skipped and counted as deadline misses.
+ */
+
+#include "sensor_scheduler.h"
+#include "config.h"
+#include "task_plan.h"
+#include "power_manager.h"
+#include "trace.h"
+#include <esp_timer.h>
+
+struct SensorJob {
+    SensorJobFunction function;
+    uint32_t periodTicks;
+    uint32_t deadlineMs;
+    uint32_t dueTick;
+    SensorJob* next;
+    SensorJobStats stats;
+};
+
+static SensorJob jobs[SCHEDULER_MAX_JOBS];
+static size_t jobCount = 0;
+static SensorJob* wheel[SCHEDULER_WHEEL_SLOTS] = {};
+static SemaphoreHandle_t statsMutex = NULL;
+static TaskHandle_t schedulerTaskHandle = NULL;
+static int64_t startUs = 0;
+
+// 64-bit time base so the wheel does not stall when millis() wraps
+static uint32_t currentWheelTick() {
+    return (uint32_t)((esp_timer_get_time() - startUs) / (SCHEDULER_TICK_MS * 1000LL));
+}
+
+static uint32_t elapsedMs() {
+    return (uint32_t)((esp_timer_get_time() - startUs) / 1000);
+}
+
+static uint32_t msToTicks(uint32_t ms) {
+    uint32_t ticks = (ms + SCHEDULER_TICK_MS / 2) / SCHEDULER_TICK_MS;
+    return ticks > 0 ? ticks : 1;
+}
+
+static void insertJob(SensorJob* job) {
+    SensorJob** slot = &wheel[job->dueTick % SCHEDULER_WHEEL_SLOTS];
+    job->next = *slot;
+    *slot = job;
+}
+
+bool addSensorJob(const char* name, SensorJobFunction job, uint32_t periodMs,
+                  uint32_t deadlineMs, uint32_t initialDelayMs) {
+    if (schedulerTaskHandle || jobCount >= SCHEDULER_MAX_JOBS || !job) {
+        return false;
+    }
+
+    SensorJob& entry = jobs[jobCount++];
+    entry.function = job;
+    entry.periodTicks = msToTicks(periodMs);
+    entry.deadlineMs = deadlineMs;
+#if LOW_POWER_PROFILE
+    // Snap the first run onto the shared grid so jobs wake together
+    initialDelayMs = (initialDelayMs + PM_SAMPLE_ALIGN_MS - 1) / PM_SAMPLE_ALIGN_MS * PM_SAMPLE_ALIGN_MS;
+#endif
+    entry.dueTick = initialDelayMs / SCHEDULER_TICK_MS;
+    entry.next = nullptr;
+    entry.stats = SensorJobStats{};
+    entry.stats.name = name;
+    entry.stats.periodMs = entry.periodTicks * SCHEDULER_TICK_MS;
+    insertJob(&entry);
+    return true;
+}
+
+static void runJob(SensorJob* job, uint32_t tick) {
+    uint32_t dueMs = job->dueTick * SCHEDULER_TICK_MS;
+    uint32_t begin = elapsedMs();
+    TRACE(TRACE_JOB_BEGIN, job - jobs);
+    job->function();
+    TRACE(TRACE_JOB_END, job - jobs);
+    uint32_t end = elapsedMs();
+
+    // Skip periods that were missed entirely while this or another job ran
+    uint32_t skipped = 0;
+    job->dueTick += job->periodTicks;
+    while (job->dueTick <= tick) {
+        job->dueTick += job->periodTicks;
+        skipped++;
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    SensorJobStats& stats = job->stats;
+    stats.runs++;
+    stats.lastLatencyMs = begin - dueMs;
+    stats.lastRunMs = end - begin;
+    if (stats.lastLatencyMs > stats.maxLatencyMs) stats.maxLatencyMs = stats.lastLatencyMs;
+    if (stats.lastRunMs > stats.maxRunMs) stats.maxRunMs = stats.lastRunMs;
+    if (end - dueMs > job->deadlineMs) stats.deadlineMisses++;
+    stats.deadlineMisses += skipped;
+    xSemaphoreGive(statsMutex);
+}
+
+static void processSlot(uint32_t tick) {
+    SensorJob** link = &wheel[tick % SCHEDULER_WHEEL_SLOTS];
+    SensorJob* due = nullptr;
+
+    // Detach due jobs first so rescheduling into the same slot is safe
+    while (*link) {
+        SensorJob* job = *link;
+        if (job->dueTick <= tick) {
+            *link = job->next;
+            job->next = due;
+            due = job;
+        } else {
+            link = &job->next;
+        }
+    }
+
+    while (due) {
+        SensorJob* job = due;
+        due = due->next;
+        runJob(job, tick);
+        insertJob(job);
+    }
+}
+
+#if LOW_POWER_PROFILE
+static uint32_t earliestDueTick() {
+    uint32_t earliest = UINT32_MAX;
+    for (size_t i = 0; i < jobCount; i++) {
+        if (jobs[i].dueTick < earliest) earliest = jobs[i].dueTick;
+    }
+    return earliest;
+}
+#endif
+
+void SensorSchedulerTask(void* pvParameters) {
+    Serial.printf("SensorScheduler started with %u jobs\n", (unsigned)jobCount);
+
+#if !LOW_POWER_PROFILE
+    TickType_t lastWake = xTaskGetTickCount();
+#endif
+    uint32_t nextTick = 0;
+
+    while (true) {
+        // Catch up on every wheel tick that elapsed while jobs were running
+        beginActiveWork();
+        uint32_t currentTick = currentWheelTick();
+        while (nextTick <= currentTick) {
+            processSlot(nextTick);
+            nextTick++;
+            currentTick = currentWheelTick();
+        }
+        endActiveWork();
+
+#if LOW_POWER_PROFILE
+        // Skip empty wheel ticks so the CPU can stay asleep until the next job
+        uint32_t due = earliestDueTick();
+        if (due > nextTick) nextTick = due;
+        int64_t wakeUs = startUs + (int64_t)nextTick * SCHEDULER_TICK_MS * 1000LL;
+        int64_t sleepUs = wakeUs - esp_timer_get_time();
+        TRACE(TRACE_TASK_SLEEP, TASK_SENSOR_SCHEDULER);
+        vTaskDelay(sleepUs > 0 ? pdMS_TO_TICKS(sleepUs / 1000) + 1 : 1);
+        TRACE(TRACE_TASK_WAKE, TASK_SENSOR_SCHEDULER);
+#else
+        waitForNextPeriod(TASK_SENSOR_SCHEDULER, lastWake);
+#endif
+    }
+}
+
+bool startSensorScheduler() {
+    statsMutex = xSemaphoreCreateMutex();
+    if (!statsMutex) {
+        Serial.println("ERROR: Failed to create scheduler mutex");
+        return false;
+    }
+
+    startUs = esp_timer_get_time();
+    return startPlannedTask(TASK_SENSOR_SCHEDULER, SensorSchedulerTask, &schedulerTaskHandle);
+}
+
+size_t getSensorJobStats(SensorJobStats* stats, size_t maxJobs) {
+    if (!statsMutex) return 0;
+    size_t count = jobCount < maxJobs ? jobCount : maxJobs;
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    for (size_t i = 0; i < count; i++) {
+        stats[i] = jobs[i].stats;
+    }
+    xSemaphoreGive(statsMutex);
+    return count;
+}
+
+uint32_t getSensorSchedulerStackHighWaterMark() {
+    if (!schedulerTaskHandle) return 0;
+    return uxTaskGetStackHighWaterMark(schedulerTaskHandle);
+}
+
+void logSensorSchedulerStats() {
+    SensorJobStats stats[SCHEDULER_MAX_JOBS];
+    size_t count = getSensorJobStats(stats, SCHEDULER_MAX_JOBS);
+
+    Serial.printf("Scheduler stack: %lu of %u bytes free\n",
+                  (unsigned long)getSensorSchedulerStackHighWaterMark(),
+                  (unsigned)TASK_PLAN[TASK_SENSOR_SCHEDULER].stackSize);
+    for (size_t i = 0; i < count; i++) {
+        Serial.printf("  %-10s runs %lu, latency %lu/%lu ms, run %lu/%lu ms, misses %lu\n",
+                      stats[i].name, (unsigned long)stats[i].runs,
+                      (unsigned long)stats[i].lastLatencyMs, (unsigned long)stats[i].maxLatencyMs,
+                      (unsigned long)stats[i].lastRunMs, (unsigned long)stats[i].maxRunMs,
+                      (unsigned long)stats[i].deadlineMisses);
+    }
+}
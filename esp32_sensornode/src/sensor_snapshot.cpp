@@ -0,0 +1,62 @@
+/**
+ * sensor_snapshot.cpp
+ *
+ * Seqlock-backed sensor snapshot
+ */
+
+#include "sensor_snapshot.h"
+#include "seqlock.h"
+
+struct SnapshotValues {
+    float lux;
+    float audioLevel;
+    bool occupied;
+    bool lampOn;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+static SeqLock<SnapshotValues> snapshot;
+
+SensorSnapshot getSensorSnapshot() {
+    uint32_t version;
+    SnapshotValues values = snapshot.read(&version);
+    return SensorSnapshot{
+        version, values.lux, values.audioLevel, values.occupied,
+        values.lampOn, values.red, values.green, values.blue
+    };
+}
+
+void setSnapshotLux(float lux) {
+    snapshot.write([lux](SnapshotValues& v) { v.lux = lux; });
+}
+
+void setSnapshotAudioLevel(float level) {
+    snapshot.write([level](SnapshotValues& v) { v.audioLevel = level; });
+}
+
+void setSnapshotOccupied(bool occupied) {
+    snapshot.write([occupied](SnapshotValues& v) { v.occupied = occupied; });
+}
+
+void setSnapshotLamp(bool on, uint8_t red, uint8_t green, uint8_t blue) {
+    snapshot.write([=](SnapshotValues& v) {
+        v.lampOn = on;
+        v.red = red;
+        v.green = green;
+        v.blue = blue;
+    });
+}
+
+void setSnapshotLampPower(bool on) {
+    snapshot.write([on](SnapshotValues& v) { v.lampOn = on; });
+}
+
+void setSnapshotLampColor(uint8_t red, uint8_t green, uint8_t blue) {
+    snapshot.write([=](SnapshotValues& v) {
+        v.red = red;
+        v.green = green;
+        v.blue = blue;
+    });
+}
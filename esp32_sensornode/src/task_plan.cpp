@@ -0,0 +1,74 @@
+/**
+ * task_plan.cpp
+ *
+ * Task table and wake latency tracking
+ */
+
+#include "task_plan.h"
+#include "sensor_scheduler.h"
+#include "config.h"
+#include "trace.h"
+
+const TaskPlanEntry TASK_PLAN[TASK_COUNT] = {
+    //  name                  core  prio  stack  period (ms)                low-power period
+    { "SensorScheduler",      1,    3,    6144,  SCHEDULER_TICK_MS,         0     },  // Sleeps to next due job
+    { "NeoPixelUpdate",       1,    2,    3072,  100,                       1000  },
+    { "NotificationServer",   0,    1,    8192,  10,                        100   },
+    { "TaskProfiler",         0,    1,    4096,  TASK_PROFILE_INTERVAL,     0     },
+    { "Provisioner",          0,    1,    6144,  0,                         0     },  // Boot only, one per pooled connection
+    { "Connectivity",         0,    1,    8192,  0,                         0     },  // WiFi/CSE bring-up, then replays readings buffered in CSE outages
+    { "WiFiManager",          0,    2,    6144,  WIFI_RSSI_SAMPLE_INTERVAL, 0     },
+};
+
+uint32_t taskPeriodMs(TaskId id) {
+    #if LOW_POWER_PROFILE
+    if (TASK_PLAN[id].lowPowerPeriodMs) return TASK_PLAN[id].lowPowerPeriodMs;
+    #endif
+    return TASK_PLAN[id].periodMs;
+}
+
+static TaskLatencyStats latency[TASK_COUNT] = {};
+static portMUX_TYPE latencyMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool startPlannedTask(TaskId id, TaskFunction_t function, TaskHandle_t* handle) {
+    const TaskPlanEntry& plan = TASK_PLAN[id];
+    TaskHandle_t created = NULL;
+    BaseType_t result = xTaskCreatePinnedToCore(
+        function, plan.name, plan.stackSize, NULL, plan.priority, &created, plan.core);
+
+    if (result != pdPASS) {
+        Serial.printf("ERROR: Failed to create %s\n", plan.name);
+        return false;
+    }
+    if (handle) *handle = created;
+    #if TRACE_ENABLED
+    traceRegisterTask(created, plan.name);
+    #endif
+
+    Serial.printf("%s created on core %d, priority %u\n", plan.name, (int)plan.core, (unsigned)plan.priority);
+    return true;
+}
+
+void waitForNextPeriod(TaskId id, TickType_t& lastWake) {
+    TRACE(TRACE_TASK_SLEEP, id);
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(taskPeriodMs(id)));
+    TRACE(TRACE_TASK_WAKE, id);
+
+    // lastWake now holds the intended wake time
+    uint32_t lateMs = (xTaskGetTickCount() - lastWake) * portTICK_PERIOD_MS;
+
+    portENTER_CRITICAL(&latencyMux);
+    TaskLatencyStats& stats = latency[id];
+    stats.wakeups++;
+    stats.totalLatencyMs += lateMs;
+    if (lateMs > stats.maxLatencyMs) stats.maxLatencyMs = lateMs;
+    portEXIT_CRITICAL(&latencyMux);
+}
+
+TaskLatencyStats takeTaskLatencyStats(TaskId id) {
+    portENTER_CRITICAL(&latencyMux);
+    TaskLatencyStats stats = latency[id];
+    latency[id] = TaskLatencyStats{};
+    portEXIT_CRITICAL(&latencyMux);
+    return stats;
+}
@@ -0,0 +1,116 @@
+/**
+ * task_profiler.cpp
+ *
+ * CPU share needs configGENERATE_RUN_TIME_STATS; without it the report
+ * still carries stack high-water marks and wake latency.
+ */
+
+#include "task_profiler.h"
+#include "task_plan.h"
+#include "diagnostics.h"
+#include "power_manager.h"
+#include "metrics.h"
+#include "config.h"
+
+#if configUSE_TRACE_FACILITY
+
+static TaskStatus_t taskStatus[PROFILER_MAX_TASKS];
+static UBaseType_t previousTaskNumber[PROFILER_MAX_TASKS];
+static uint32_t previousRunTime[PROFILER_MAX_TASKS];
+static UBaseType_t previousCount = 0;
+static uint32_t previousTotalRunTime = 0;
+
+static int findPlannedTask(const char* name) {
+    for (int i = 0; i < TASK_COUNT; i++) {
+        if (strcmp(TASK_PLAN[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+#if configGENERATE_RUN_TIME_STATS
+static uint32_t previousRunTimeOf(UBaseType_t taskNumber, bool& found) {
+    for (UBaseType_t i = 0; i < previousCount; i++) {
+        if (previousTaskNumber[i] == taskNumber) {
+            found = true;
+            return previousRunTime[i];
+        }
+    }
+    found = false;
+    return 0;
+}
+#endif
+
+static void profileTasks() {
+    uint32_t totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(taskStatus, PROFILER_MAX_TASKS, &totalRunTime);
+    if (count == 0) {
+        Serial.println("Profiler: more than PROFILER_MAX_TASKS tasks");
+        return;
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    // Run time counters accumulate per core
+    uint32_t elapsed = (totalRunTime - previousTotalRunTime) * portNUM_PROCESSORS;
+#endif
+
+    DynamicJsonDocument doc(4096);
+    doc["up"] = millis() / 1000;
+    doc["heap"] = ESP.getFreeHeap();
+    JsonArray tasks = doc.createNestedArray("tasks");
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t& status = taskStatus[i];
+        JsonObject task = tasks.createNestedObject();
+        task["n"] = status.pcTaskName;
+        task["p"] = status.uxCurrentPriority;
+        task["stk"] = status.usStackHighWaterMark;
+
+#if configGENERATE_RUN_TIME_STATS
+        bool found;
+        uint32_t before = previousRunTimeOf(status.xTaskNumber, found);
+        if (found && previousTotalRunTime != 0 && elapsed > 0) {
+            // Per-mille of total CPU time across both cores
+            task["cpu"] = (uint32_t)(((uint64_t)(status.ulRunTimeCounter - before) * 1000) / elapsed);
+        }
+#endif
+
+        int planned = findPlannedTask(status.pcTaskName);
+        if (planned >= 0) {
+            TaskLatencyStats latency = takeTaskLatencyStats((TaskId)planned);
+            task["c"] = TASK_PLAN[planned].core;
+            task["lat"] = latency.wakeups ? latency.totalLatencyMs / latency.wakeups : 0;
+            task["latMax"] = latency.maxLatencyMs;
+        }
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        previousTaskNumber[i] = taskStatus[i].xTaskNumber;
+        previousRunTime[i] = taskStatus[i].ulRunTimeCounter;
+    }
+    previousCount = count;
+    previousTotalRunTime = totalRunTime;
+
+    publishDiagnostics("tasks", doc);
+}
+
+#else
+
+static void profileTasks() {
+    Serial.println("Profiler: uxTaskGetSystemState unavailable (configUSE_TRACE_FACILITY=0)");
+}
+
+#endif
+
+void TaskProfilerTask(void* pvParameters) {
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        waitForNextPeriod(TASK_PROFILER, lastWake);
+        profileTasks();
+        publishPowerResidency();
+        publishMetrics();
+    }
+}
+
+bool startTaskProfiler() {
+    return startPlannedTask(TASK_PROFILER, TaskProfilerTask);
+}
@@ -0,0 +1,265 @@
+/**
+ * tls_client.cpp
+ *
+ * mbedTLS runs over the WiFiClient socket through blocking BIO callbacks
+ * with the context's timeout. Reads stay non-blocking like WiFiClient's:
+ * a record is only decrypted once its first bytes have arrived.
+ */
+
+#include "tls_client.h"
+#include "metrics.h"
+
+// ==================== CONTEXT ====================
+
+TlsContext::~TlsContext() {
+    if (!sessionLock) return;
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_config_free(&config);
+    mbedtls_x509_crt_free(&caChain);
+    mbedtls_x509_crt_free(&clientChain);
+    mbedtls_pk_free(&clientKey);
+    mbedtls_ctr_drbg_free(&random);
+    mbedtls_entropy_free(&entropy);
+    vSemaphoreDelete(sessionLock);
+}
+
+bool TlsContext::begin(const TlsCredentials& credentials) {
+    if (ready) return true;
+    if (!sessionLock) {
+        sessionLock = xSemaphoreCreateMutex();
+        if (!sessionLock) return false;
+        mbedtls_ssl_config_init(&config);
+        mbedtls_x509_crt_init(&caChain);
+        mbedtls_x509_crt_init(&clientChain);
+        mbedtls_pk_init(&clientKey);
+        mbedtls_entropy_init(&entropy);
+        mbedtls_ctr_drbg_init(&random);
+        mbedtls_ssl_session_init(&session);
+    }
+    serverName = credentials.serverName;
+
+    static const unsigned char PERSONALIZATION[] = "onem2m-tls";
+    const char* step = "random";
+    int error = mbedtls_ctr_drbg_seed(&random, mbedtls_entropy_func, &entropy, PERSONALIZATION,
+                                      sizeof(PERSONALIZATION) - 1);
+    if (!error) {
+        step = "CA certificate";
+        error = mbedtls_x509_crt_parse(&caChain, (const unsigned char*)credentials.caCert,
+                                       strlen(credentials.caCert) + 1);  // PEM length includes the NUL
+    }
+    if (!error && credentials.clientCert) {
+        step = "client certificate";
+        error = mbedtls_x509_crt_parse(&clientChain, (const unsigned char*)credentials.clientCert,
+                                       strlen(credentials.clientCert) + 1);
+        if (!error) {
+            step = "client key";
+            error = mbedtls_pk_parse_key(&clientKey, (const unsigned char*)credentials.clientKey,
+                                         strlen(credentials.clientKey) + 1, nullptr, 0);
+        }
+    }
+    if (!error) {
+        step = "configuration";
+        error = mbedtls_ssl_config_defaults(&config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                            MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (!error && credentials.clientCert) {
+        error = mbedtls_ssl_conf_own_cert(&config, &clientChain, &clientKey);
+    }
+    if (error) {
+        Serial.printf("TLS %s failed: -0x%04x\n", step, (unsigned)-error);
+        return false;
+    }
+
+    mbedtls_ssl_conf_authmode(&config, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&config, &caChain, nullptr);
+    mbedtls_ssl_conf_rng(&config, mbedtls_ctr_drbg_random, &random);
+    ready = true;
+    return true;
+}
+
+void TlsContext::forgetSession() {
+    xSemaphoreTake(sessionLock, portMAX_DELAY);
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    haveSession = false;
+    xSemaphoreGive(sessionLock);
+}
+
+bool TlsContext::restoreSession(mbedtls_ssl_context* ssl) {
+    xSemaphoreTake(sessionLock, portMAX_DELAY);
+    bool offered = haveSession && mbedtls_ssl_set_session(ssl, &session) == 0;
+    xSemaphoreGive(sessionLock);
+    return offered;
+}
+
+void TlsContext::recordHandshake(mbedtls_ssl_context* ssl, bool offered, uint32_t elapsedMs) {
+    const mbedtls_ssl_session* current = mbedtls_ssl_get_session_pointer(ssl);
+
+    xSemaphoreTake(sessionLock, portMAX_DELAY);
+    // A resumed session keeps its master secret; a full handshake derives a new one
+    bool resumed = offered && haveSession && current &&
+                   memcmp(current->master, session.master, sizeof(session.master)) == 0;
+    // Keep the newest session: a resumption may come with a fresh ticket
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    haveSession = (mbedtls_ssl_get_session(ssl, &session) == 0);
+    xSemaphoreGive(sessionLock);
+
+    metricIncrement(resumed ? METRIC_TLS_RESUMED_HANDSHAKES : METRIC_TLS_FULL_HANDSHAKES);
+    metricObserve(METRIC_TLS_HANDSHAKE_MS, elapsedMs);
+    Serial.printf("TLS %s handshake %lu ms\n", resumed ? "resumed" : "full", (unsigned long)elapsedMs);
+}
+
+// ==================== CLIENT ====================
+
+TlsClient::~TlsClient() {
+    stop();
+    if (sslReady) mbedtls_ssl_free(&ssl);
+}
+
+int TlsClient::sendRaw(void* client, const unsigned char* buffer, size_t length) {
+    TlsClient* tls = static_cast<TlsClient*>(client);
+    size_t sent = tls->WiFiClient::write(buffer, length);
+    return sent > 0 ? (int)sent : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsClient::receiveRaw(void* client, unsigned char* buffer, size_t length) {
+    TlsClient* tls = static_cast<TlsClient*>(client);
+    unsigned long start = millis();
+    while (tls->WiFiClient::available() <= 0) {
+        if (!tls->WiFiClient::connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+        if (millis() - start >= tls->context->timeoutMs) return MBEDTLS_ERR_SSL_TIMEOUT;
+        delay(1);
+    }
+    int received = tls->WiFiClient::read(buffer, length);
+    return received > 0 ? received : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+int TlsClient::fail(const char* step, int error) {
+    Serial.printf("TLS %s failed: -0x%04x\n", step, (unsigned)-error);
+    WiFiClient::stop();
+    return 0;
+}
+
+void TlsClient::drop() {
+    established = false;
+    WiFiClient::stop();
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    if (!context) return WiFiClient::connect(host, port);
+    return connect(host, port, (int32_t)context->timeoutMs);
+}
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    if (!WiFiClient::connect(host, port, timeoutMs)) return 0;
+    if (!context) return 1;
+
+    // The context (about 20 KB of record buffers) is set up once and reset per connection
+    int error;
+    if (!sslReady) {
+        mbedtls_ssl_init(&ssl);
+        error = mbedtls_ssl_setup(&ssl, &context->config);
+        if (error) {
+            mbedtls_ssl_free(&ssl);
+            return fail("setup", error);
+        }
+        sslReady = true;
+    } else {
+        error = mbedtls_ssl_session_reset(&ssl);
+    }
+    if (!error) error = mbedtls_ssl_set_hostname(&ssl, context->serverName ? context->serverName : host);
+    if (error) return fail("setup", error);
+    mbedtls_ssl_set_bio(&ssl, this, sendRaw, receiveRaw, nullptr);
+
+    bool offered = context->restoreSession(&ssl);
+    unsigned long start = millis();
+    error = mbedtls_ssl_handshake(&ssl);
+    if (error) {
+        if (offered) context->forgetSession();
+        metricIncrement(METRIC_TLS_HANDSHAKE_FAILURES);
+        return fail("handshake", error);
+    }
+    context->recordHandshake(&ssl, offered, millis() - start);
+    established = true;
+    return 1;
+}
+
+uint8_t TlsClient::connected() {
+    if (!context) return WiFiClient::connected();
+    if (!established) return 0;
+    if (peeked >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0) return 1;
+    return WiFiClient::connected();
+}
+
+void TlsClient::stop() {
+    if (established) {
+        mbedtls_ssl_close_notify(&ssl);  // Best effort: the CSE may be gone already
+        established = false;
+    }
+    peeked = -1;
+    WiFiClient::stop();
+}
+
+int TlsClient::available() {
+    if (!context) return WiFiClient::available();
+    if (!established) return 0;
+
+    // Decrypt the next record once it starts arriving; its first byte waits in peeked
+    if (peeked < 0 && mbedtls_ssl_get_bytes_avail(&ssl) == 0 && WiFiClient::available() > 0) {
+        unsigned char c;
+        int result = mbedtls_ssl_read(&ssl, &c, 1);
+        if (result == 1) peeked = c;
+        else if (result != MBEDTLS_ERR_SSL_WANT_READ) drop();  // Close notify, EOF or error
+    }
+    if (!established) return 0;
+    return (int)mbedtls_ssl_get_bytes_avail(&ssl) + (peeked >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int TlsClient::read(uint8_t* buffer, size_t size) {
+    if (!context) return WiFiClient::read(buffer, size);
+    if (size == 0 || available() <= 0) return -1;
+
+    size_t count = 0;
+    if (peeked >= 0) {
+        buffer[count++] = (uint8_t)peeked;
+        peeked = -1;
+    }
+    size_t buffered = min(size - count, mbedtls_ssl_get_bytes_avail(&ssl));
+    if (buffered > 0) {
+        int result = mbedtls_ssl_read(&ssl, buffer + count, buffered);
+        if (result > 0) count += result;
+    }
+    return (int)count;
+}
+
+int TlsClient::peek() {
+    if (!context) return WiFiClient::peek();
+    if (peeked >= 0 || available() <= 0) return peeked;  // available() may have decrypted one
+
+    unsigned char c;
+    if (mbedtls_ssl_read(&ssl, &c, 1) == 1) peeked = c;
+    return peeked;
+}
+
+size_t TlsClient::write(const uint8_t* buffer, size_t size) {
+    if (!context) return WiFiClient::write(buffer, size);
+    if (!established) return 0;
+
+    size_t sent = 0;
+    while (sent < size) {
+        int result = mbedtls_ssl_write(&ssl, buffer + sent, size - sent);
+        if (result <= 0) {
+            drop();
+            break;
+        }
+        sent += result;
+    }
+    return sent;
+}
@@ -0,0 +1,126 @@
+/**
+ * trace.cpp
+ *
+ * Dump layout (little endian):
+ *   "TRC1", u16 record size, u16 capacity, u32 records written, u32 now (us)
+ *   u8 task count, NUL-terminated task names (slot order)
+ *   u8 job count, NUL-terminated sensor job names (scheduler order)
+ *   records, oldest first
+ */
+
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include "sensor_scheduler.h"
+#include <WebServer.h>
+#include <esp_timer.h>
+#include <atomic>
+
+static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0, "TRACE_BUFFER_EVENTS must be a power of two");
+static_assert(TRACE_BUFFER_EVENTS <= 65535, "capacity is sent as u16");
+
+static TraceRecord ring[TRACE_BUFFER_EVENTS];
+static std::atomic<uint32_t> written(0);
+static std::atomic<bool> frozen(false);  // Writers skip while a dump streams the ring
+
+static TaskHandle_t taskHandles[TRACE_MAX_TASKS];
+static const char* taskNames[TRACE_MAX_TASKS];
+static std::atomic<uint8_t> taskCount(0);
+
+// ==================== RECORDING ====================
+
+static uint8_t currentTaskSlot() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint8_t count = taskCount.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        if (taskHandles[i] == self) return i + 1;
+    }
+    return 0;
+}
+
+void traceRecord(TraceEvent event, uint16_t arg) {
+    if (frozen.load(std::memory_order_relaxed)) return;
+
+    uint32_t index = written.fetch_add(1, std::memory_order_relaxed) & (TRACE_BUFFER_EVENTS - 1);
+    TraceRecord& record = ring[index];
+    record.timestampUs = (uint32_t)esp_timer_get_time();
+    record.event = event;
+    record.task = currentTaskSlot() | (xPortGetCoreID() ? 0x80 : 0);
+    record.arg = arg;
+}
+
+void traceRegisterTask(TaskHandle_t handle, const char* name) {
+    static portMUX_TYPE registerMux = portMUX_INITIALIZER_UNLOCKED;
+
+    portENTER_CRITICAL(&registerMux);
+    uint8_t slot = taskCount.load(std::memory_order_relaxed);
+    if (slot < TRACE_MAX_TASKS) {
+        taskHandles[slot] = handle;
+        taskNames[slot] = name;
+        taskCount.store(slot + 1, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&registerMux);
+}
+
+// ==================== DUMP ====================
+
+template <typename T>
+static void append(uint8_t*& out, T value) {
+    memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+static void appendName(uint8_t*& out, const uint8_t* end, const char* name) {
+    size_t length = min(strlen(name), (size_t)(end - out - 1));
+    memcpy(out, name, length);
+    out += length;
+    *out++ = 0;
+}
+
+void sendTraceDump(WebServer& server) {
+    frozen.store(true);
+    vTaskDelay(1);  // Let a writer on the other core finish its record
+
+    SensorJobStats jobs[SCHEDULER_MAX_JOBS];
+    size_t jobCount = getSensorJobStats(jobs, SCHEDULER_MAX_JOBS);
+    uint8_t tasks = taskCount.load();
+
+    // Header plus name tables; FreeRTOS names are at most 16 bytes
+    uint8_t header[16 + 2 + (TRACE_MAX_TASKS + SCHEDULER_MAX_JOBS) * 17];
+    const uint8_t* end = header + sizeof(header);
+    uint8_t* out = header;
+    memcpy(out, TRACE_MAGIC, 4);
+    out += 4;
+    append<uint16_t>(out, sizeof(TraceRecord));
+    append<uint16_t>(out, TRACE_BUFFER_EVENTS);
+    uint32_t total = written.load();
+    append<uint32_t>(out, total);
+    append<uint32_t>(out, (uint32_t)esp_timer_get_time());
+
+    *out++ = tasks;
+    for (uint8_t i = 0; i < tasks; i++) {
+        appendName(out, end, taskNames[i]);
+    }
+    *out++ = (uint8_t)jobCount;
+    for (size_t i = 0; i < jobCount; i++) {
+        appendName(out, end, jobs[i].name);
+    }
+
+    uint32_t count = min(total, (uint32_t)TRACE_BUFFER_EVENTS);
+    uint32_t first = (total - count) & (TRACE_BUFFER_EVENTS - 1);
+    uint32_t headCount = min(count, (uint32_t)TRACE_BUFFER_EVENTS - first);
+
+    server.setContentLength((out - header) + count * sizeof(TraceRecord));
+    server.send(200, "application/octet-stream", "");
+    server.sendContent((const char*)header, out - header);
+    server.sendContent((const char*)&ring[first], headCount * sizeof(TraceRecord));
+    if (count > headCount) {
+        server.sendContent((const char*)&ring[0], (count - headCount) * sizeof(TraceRecord));
+    }
+
+    frozen.store(false);
+    Serial.printf("Trace dump: %lu records (%lu written)\n", (unsigned long)count, (unsigned long)total);
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,269 @@
+/**
+ * wifi_manager.cpp
+ *
+ * Cached fast associate, event-driven reconnect and link statistics
+ */
+
+#include "wifi_manager.h"
+#include "config.h"
+#include "diagnostics.h"
+#include "task_plan.h"
+#include "power_manager.h"
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_wifi.h>
+#include <freertos/event_groups.h>
+
+#define WIFI_CACHE_MAGIC 0x57494649u
+#define WIFI_CONNECTED_BIT BIT0
+
+struct WiFiCache {
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;        // Last DHCP lease, reused when WIFI_REUSE_DHCP_LEASE
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+// Survives deep sleep and soft resets; NVS covers power cycles
+RTC_DATA_ATTR static WiFiCache rtcCache;
+
+static EventGroupHandle_t wifiEvents = NULL;
+static TaskHandle_t managerTask = NULL;
+static volatile uint32_t outageStart = 0;
+
+static WiFiStats stats = {};
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ==================== CACHE ====================
+
+static bool loadCache(WiFiCache& cache) {
+    if (rtcCache.magic == WIFI_CACHE_MAGIC) {
+        cache = rtcCache;
+        return true;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, true)) return false;
+    size_t read = prefs.getBytes("cache", &cache, sizeof(cache));
+    prefs.end();
+
+    if (read != sizeof(cache) || cache.magic != WIFI_CACHE_MAGIC) return false;
+    rtcCache = cache;
+    return true;
+}
+
+static void saveCache() {
+    WiFiCache cache = {};
+    cache.magic = WIFI_CACHE_MAGIC;
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.subnet = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP();
+
+    // Only touch flash when the AP or lease changed
+    if (memcmp(&cache, &rtcCache, sizeof(cache)) == 0) return;
+    rtcCache = cache;
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_NVS_NAMESPACE, false)) {
+        prefs.putBytes("cache", &cache, sizeof(cache));
+        prefs.end();
+    }
+}
+
+void clearWiFiCache() {
+    rtcCache.magic = 0;
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_NVS_NAMESPACE, false)) {
+        prefs.clear();
+        prefs.end();
+    }
+}
+
+// ==================== EVENTS ====================
+
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            xEventGroupSetBits(wifiEvents, WIFI_CONNECTED_BIT);
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            // Failed attempts while connecting also report a disconnect
+            if (xEventGroupGetBits(wifiEvents) & WIFI_CONNECTED_BIT) {
+                xEventGroupClearBits(wifiEvents, WIFI_CONNECTED_BIT);
+                outageStart = millis();
+                if (managerTask) xTaskNotifyGive(managerTask);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// ==================== CONNECT ====================
+
+// begin() copies the scan and sort method into the station config. The
+// default fast scan joins the first matching AP on the lowest channel,
+// so the fallback scans every channel and picks the strongest signal.
+static bool associate(const WiFiCache* cache, uint32_t timeoutMs) {
+    if (cache) {
+        WiFi.setScanMethod(WIFI_FAST_SCAN);  // Channel and BSSID are known
+        #if WIFI_REUSE_DHCP_LEASE
+        WiFi.config(IPAddress(cache->ip), IPAddress(cache->gateway),
+                    IPAddress(cache->subnet), IPAddress(cache->dns));
+        #endif
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cache->channel, cache->bssid, false);
+    } else {
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));  // DHCP
+        WiFi.setScanMethod(WIFI_ALL_CHANNEL_SCAN);
+        WiFi.setSortMethod(WIFI_CONNECT_AP_BY_SIGNAL);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, 0, nullptr, false);
+    }
+    applyWiFiPowerSave();
+    esp_wifi_connect();
+
+    EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeoutMs));
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
+static void connectWithBackoff() {
+    uint32_t backoffMs = CONNECT_BACKOFF_MIN_MS;
+
+    while (true) {
+        portENTER_CRITICAL(&statsMux);
+        stats.connectAttempts++;
+        portEXIT_CRITICAL(&statsMux);
+
+        WiFiCache cache;
+        if (loadCache(cache)) {
+            if (associate(&cache, WIFI_FAST_CONNECT_TIMEOUT)) {
+                portENTER_CRITICAL(&statsMux);
+                stats.fastConnects++;
+                portEXIT_CRITICAL(&statsMux);
+                break;
+            }
+            WiFi.disconnect();
+        }
+
+        // AP moved or first boot: full scan picks the strongest BSSID
+        bool connected = associate(nullptr, WIFI_CONNECT_TIMEOUT);
+        portENTER_CRITICAL(&statsMux);
+        stats.fullScans++;
+        portEXIT_CRITICAL(&statsMux);
+        if (connected) break;
+
+        WiFi.disconnect();
+        vTaskDelay(pdMS_TO_TICKS(backoffMs));
+        backoffMs = min((uint32_t)CONNECT_BACKOFF_MAX_MS, backoffMs * 2);
+    }
+
+    saveCache();
+    Serial.printf("WiFi connected to %s ch %ld, IP: %s, RSSI %d dBm\n",
+                  WIFI_SSID, (long)WiFi.channel(), WiFi.localIP().toString().c_str(), WiFi.RSSI());
+}
+
+// ==================== STATISTICS ====================
+
+static void recordReconnect(uint32_t durationMs) {
+    portENTER_CRITICAL(&statsMux);
+    stats.reconnects++;
+    stats.lastReconnectMs = durationMs;
+    stats.totalReconnectMs += durationMs;
+    if (durationMs > stats.maxReconnectMs) stats.maxReconnectMs = durationMs;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+static void recordRssi(int8_t rssi) {
+    portENTER_CRITICAL(&statsMux);
+    if (stats.rssiCount == WIFI_RSSI_HISTORY) {
+        memmove(stats.rssi, stats.rssi + 1, WIFI_RSSI_HISTORY - 1);
+        stats.rssiCount--;
+    }
+    stats.rssi[stats.rssiCount++] = rssi;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+WiFiStats getWiFiStats() {
+    portENTER_CRITICAL(&statsMux);
+    WiFiStats copy = stats;
+    portEXIT_CRITICAL(&statsMux);
+    return copy;
+}
+
+static void publishWiFiReport() {
+    WiFiStats current = getWiFiStats();
+
+    StaticJsonDocument<512> doc;
+    doc["channel"] = WiFi.channel();
+    doc["attempts"] = current.connectAttempts;
+    doc["fastConnects"] = current.fastConnects;
+    doc["fullScans"] = current.fullScans;
+    doc["reconnects"] = current.reconnects;
+    doc["lastReconnectMs"] = current.lastReconnectMs;
+    doc["maxReconnectMs"] = current.maxReconnectMs;
+    doc["avgReconnectMs"] = current.reconnects ? current.totalReconnectMs / current.reconnects : 0;
+    JsonArray rssi = doc.createNestedArray("rssi");
+    for (uint8_t i = 0; i < current.rssiCount; i++) {
+        rssi.add(current.rssi[i]);
+    }
+
+    publishDiagnostics("wifi", doc);
+}
+
+// ==================== MANAGER TASK ====================
+
+static void WiFiManagerTask(void* pvParameters) {
+    connectWithBackoff();
+    unsigned long lastReport = millis();
+
+    while (true) {
+        // Woken early by a disconnect event
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WIFI_RSSI_SAMPLE_INTERVAL));
+
+        if (!(xEventGroupGetBits(wifiEvents) & WIFI_CONNECTED_BIT)) {
+            Serial.println("WiFi lost - reconnecting");
+            connectWithBackoff();
+            uint32_t durationMs = millis() - outageStart;
+            recordReconnect(durationMs);
+            Serial.printf("WiFi reconnected in %lu ms\n", (unsigned long)durationMs);
+        } else {
+            recordRssi(WiFi.RSSI());
+        }
+
+        if (millis() - lastReport >= WIFI_REPORT_INTERVAL) {
+            lastReport = millis();
+            publishWiFiReport();
+        }
+    }
+}
+
+// ==================== PUBLIC API ====================
+
+bool startWiFiManager() {
+    wifiEvents = xEventGroupCreate();
+    if (!wifiEvents) return false;
+
+    WiFi.persistent(false);        // Credentials come from config.h, not flash
+    WiFi.setAutoReconnect(false);  // Reconnects go through the cached BSSID
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent(onWiFiEvent);
+
+    return startPlannedTask(TASK_WIFI_MANAGER, WiFiManagerTask, &managerTask);
+}
+
+bool waitForWiFi(uint32_t timeoutMs) {
+    if (!wifiEvents) return false;
+    EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE,
+                                           timeoutMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
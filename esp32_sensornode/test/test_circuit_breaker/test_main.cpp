@@ -0,0 +1,175 @@
+/**
+ * test_circuit_breaker
+ *
+ * Jittered backoff, the CircuitBreaker state machine and the RetryBudget
+ * window (circuit_breaker.h), on the native clock with open times of tens
+ * of ms. pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "circuit_breaker.h"
+#include "metrics.h"
+
+#define BASE_MS 40
+#define MAX_MS 160
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Open the breaker from closed with a run of failures
+static void trip(CircuitBreaker& breaker, uint8_t threshold) {
+    for (uint8_t i = 0; i < threshold; i++) {
+        TEST_ASSERT_TRUE(breaker.allowRequest());
+        breaker.recordFailure();
+    }
+}
+
+// ==================== BACKOFF ====================
+
+void test_jittered_delay_between_half_and_full(void) {
+    for (int i = 0; i < 1000; i++) {
+        uint32_t ms = jitteredDelay(1000);
+        TEST_ASSERT_GREATER_OR_EQUAL(500, ms);
+        TEST_ASSERT_LESS_OR_EQUAL(1000, ms);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, jitteredDelay(0));
+}
+
+void test_backoff_doubles_up_to_the_cap(void) {
+    for (uint8_t attempt = 0; attempt < 8; attempt++) {
+        uint32_t ceiling = min((uint32_t)(100u << attempt), (uint32_t)3000);
+        for (int i = 0; i < 100; i++) {
+            uint32_t ms = backoffDelay(100, 3000, attempt);
+            TEST_ASSERT_GREATER_OR_EQUAL(ceiling / 2, ms);
+            TEST_ASSERT_LESS_OR_EQUAL(ceiling, ms);
+        }
+    }
+}
+
+// The shift is bounded, so a large attempt count cannot wrap to a short delay
+void test_backoff_large_attempt_stays_capped(void) {
+    for (int i = 0; i < 100; i++) {
+        uint32_t ms = backoffDelay(1000, 60000, 255);
+        TEST_ASSERT_GREATER_OR_EQUAL(30000, ms);
+        TEST_ASSERT_LESS_OR_EQUAL(60000, ms);
+    }
+}
+
+// ==================== CIRCUIT BREAKER ====================
+
+void test_breaker_needs_consecutive_failures(void) {
+    CircuitBreaker breaker(3, BASE_MS, MAX_MS);
+    breaker.recordFailure();
+    breaker.recordFailure();
+    breaker.recordSuccess();
+    breaker.recordFailure();
+    breaker.recordFailure();
+    TEST_ASSERT_EQUAL_UINT8(BREAKER_CLOSED, breaker.state());
+    TEST_ASSERT_EQUAL_UINT32(0, breaker.msUntilProbe());
+    breaker.recordFailure();
+    TEST_ASSERT_EQUAL_UINT8(BREAKER_OPEN, breaker.state());
+}
+
+void test_open_breaker_fails_fast(void) {
+    CircuitBreaker breaker(3, BASE_MS, MAX_MS);
+    uint32_t opens = metricValue(METRIC_BREAKER_OPENS);
+    trip(breaker, 3);
+    TEST_ASSERT_EQUAL_UINT32(opens + 1, metricValue(METRIC_BREAKER_OPENS));
+
+    uint32_t fastFails = metricValue(METRIC_FAST_FAILS);
+    TEST_ASSERT_FALSE(breaker.allowRequest());
+    TEST_ASSERT_FALSE(breaker.allowRequest());
+    TEST_ASSERT_EQUAL_UINT32(fastFails + 2, metricValue(METRIC_FAST_FAILS));
+    uint32_t wait = breaker.msUntilProbe();
+    TEST_ASSERT_GREATER_THAN(0, wait);
+    TEST_ASSERT_LESS_OR_EQUAL(BASE_MS, wait);
+}
+
+void test_one_probe_then_close(void) {
+    CircuitBreaker breaker(3, BASE_MS, MAX_MS);
+    trip(breaker, 3);
+    delay(BASE_MS + 5);
+
+    TEST_ASSERT_TRUE(breaker.allowRequest());
+    TEST_ASSERT_EQUAL_UINT8(BREAKER_HALF_OPEN, breaker.state());
+    TEST_ASSERT_FALSE(breaker.allowRequest());  // The probe is out
+
+    uint32_t closes = metricValue(METRIC_BREAKER_CLOSES);
+    breaker.recordSuccess();
+    TEST_ASSERT_EQUAL_UINT8(BREAKER_CLOSED, breaker.state());
+    TEST_ASSERT_EQUAL_UINT32(closes + 1, metricValue(METRIC_BREAKER_CLOSES));
+    TEST_ASSERT_TRUE(breaker.allowRequest());
+}
+
+void test_failed_probe_doubles_open_time(void) {
+    CircuitBreaker breaker(3, BASE_MS, MAX_MS);
+    trip(breaker, 3);
+    delay(BASE_MS + 5);
+    TEST_ASSERT_TRUE(breaker.allowRequest());
+    breaker.recordFailure();
+    TEST_ASSERT_EQUAL_UINT8(BREAKER_OPEN, breaker.state());
+    uint32_t wait = breaker.msUntilProbe();
+    TEST_ASSERT_GREATER_OR_EQUAL(BASE_MS - 5, wait);  // Jittered from 2 * BASE_MS
+    TEST_ASSERT_LESS_OR_EQUAL(2 * BASE_MS, wait);
+
+    // A success closes it and the next trip starts from BASE_MS again
+    delay(2 * BASE_MS + 5);
+    TEST_ASSERT_TRUE(breaker.allowRequest());
+    breaker.recordSuccess();
+    trip(breaker, 3);
+    TEST_ASSERT_LESS_OR_EQUAL(BASE_MS, breaker.msUntilProbe());
+}
+
+void test_open_time_capped(void) {
+    CircuitBreaker breaker(1, BASE_MS, MAX_MS);
+    trip(breaker, 1);
+    for (int probe = 0; probe < 4; probe++) {
+        delay(breaker.msUntilProbe() + 5);
+        TEST_ASSERT_TRUE(breaker.allowRequest());
+        breaker.recordFailure();
+        TEST_ASSERT_LESS_OR_EQUAL(MAX_MS, breaker.msUntilProbe());
+    }
+}
+
+// Requests sent before the breaker opened fail later; they must not
+// restart the open time
+void test_late_failures_do_not_extend(void) {
+    CircuitBreaker breaker(3, BASE_MS, MAX_MS);
+    trip(breaker, 3);
+    delay(BASE_MS / 2);
+    uint32_t wait = breaker.msUntilProbe();
+    breaker.recordFailure();
+    breaker.recordFailure();
+    TEST_ASSERT_LESS_OR_EQUAL(wait, breaker.msUntilProbe());
+}
+
+// ==================== RETRY BUDGET ====================
+
+void test_retry_budget_per_window(void) {
+    RetryBudget budget(3, 50);
+    uint32_t denied = metricValue(METRIC_RETRIES_DENIED);
+    TEST_ASSERT_TRUE(budget.tryAcquire());
+    TEST_ASSERT_TRUE(budget.tryAcquire());
+    TEST_ASSERT_TRUE(budget.tryAcquire());
+    TEST_ASSERT_FALSE(budget.tryAcquire());
+    TEST_ASSERT_EQUAL_UINT32(denied + 1, metricValue(METRIC_RETRIES_DENIED));
+
+    delay(60);
+    TEST_ASSERT_TRUE(budget.tryAcquire());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_jittered_delay_between_half_and_full);
+    RUN_TEST(test_backoff_doubles_up_to_the_cap);
+    RUN_TEST(test_backoff_large_attempt_stays_capped);
+    RUN_TEST(test_breaker_needs_consecutive_failures);
+    RUN_TEST(test_open_breaker_fails_fast);
+    RUN_TEST(test_one_probe_then_close);
+    RUN_TEST(test_failed_probe_doubles_open_time);
+    RUN_TEST(test_open_time_capped);
+    RUN_TEST(test_late_failures_do_not_extend);
+    RUN_TEST(test_retry_budget_per_window);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+/**
+ * test_metrics
+ *
+ * The metrics registry (metrics.h): counters, max gauges, histogram
+ * buckets and quantiles, and lock-free updates from several threads.
+ * pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+
+// METRIC_LUX_READ_US bounds: 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000 us
+static const uint32_t READ_BOUNDS_US[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000};
+
+void setUp(void) {
+    takeHistogram(METRIC_LUX_READ_US);
+    takeMetricMax(METRIC_POOL_WAIT_MS);
+}
+
+void tearDown(void) {}
+
+// ==================== COUNTERS AND GAUGES ====================
+
+void test_counter_accumulates(void) {
+    uint32_t before = metricValue(METRIC_HTTP_REQUESTS);
+    metricIncrement(METRIC_HTTP_REQUESTS);
+    metricIncrement(METRIC_HTTP_REQUESTS, 4);
+    TEST_ASSERT_EQUAL_UINT32(before + 5, metricValue(METRIC_HTTP_REQUESTS));
+}
+
+void test_max_gauge_keeps_highest_until_taken(void) {
+    metricRaise(METRIC_POOL_WAIT_MS, 40);
+    metricRaise(METRIC_POOL_WAIT_MS, 120);
+    metricRaise(METRIC_POOL_WAIT_MS, 80);
+    TEST_ASSERT_EQUAL_UINT32(120, metricValue(METRIC_POOL_WAIT_MS));
+    TEST_ASSERT_EQUAL_UINT32(120, takeMetricMax(METRIC_POOL_WAIT_MS));
+    TEST_ASSERT_EQUAL_UINT32(0, metricValue(METRIC_POOL_WAIT_MS));
+}
+
+// ==================== HISTOGRAMS ====================
+
+// A value equal to a bound belongs to that bound's bucket
+void test_histogram_buckets(void) {
+    metricObserve(METRIC_LUX_READ_US, 0);
+    metricObserve(METRIC_LUX_READ_US, 100);
+    metricObserve(METRIC_LUX_READ_US, 101);
+    metricObserve(METRIC_LUX_READ_US, 100000);
+    metricObserve(METRIC_LUX_READ_US, 100001);
+
+    HistogramSnapshot snapshot = takeHistogram(METRIC_LUX_READ_US);
+    TEST_ASSERT_EQUAL_UINT8(10, snapshot.bucketCount);
+    TEST_ASSERT_EQUAL_UINT32(5, snapshot.count);
+    TEST_ASSERT_EQUAL_UINT32(100001, snapshot.max);
+    TEST_ASSERT_EQUAL_UINT32(2, snapshot.buckets[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, snapshot.buckets[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, snapshot.buckets[8]);
+    TEST_ASSERT_EQUAL_UINT32(1, snapshot.buckets[9]);  // Overflow
+}
+
+void test_histogram_take_starts_a_new_window(void) {
+    metricObserve(METRIC_LUX_READ_US, 300);
+    takeHistogram(METRIC_LUX_READ_US);
+    HistogramSnapshot snapshot = takeHistogram(METRIC_LUX_READ_US);
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.count);
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.max);
+    TEST_ASSERT_EQUAL_UINT32(0, histogramQuantile(snapshot, READ_BOUNDS_US, 0.9f));
+}
+
+// Quantiles are bucket upper bounds, never above the largest observation
+void test_histogram_quantiles(void) {
+    for (int i = 0; i < 8; i++) metricObserve(METRIC_LUX_READ_US, 80);
+    metricObserve(METRIC_LUX_READ_US, 700);
+    metricObserve(METRIC_LUX_READ_US, 3000);
+
+    HistogramSnapshot snapshot = takeHistogram(METRIC_LUX_READ_US);
+    TEST_ASSERT_EQUAL_UINT32(100, histogramQuantile(snapshot, READ_BOUNDS_US, 0.5f));
+    TEST_ASSERT_EQUAL_UINT32(1000, histogramQuantile(snapshot, READ_BOUNDS_US, 0.9f));
+    TEST_ASSERT_EQUAL_UINT32(3000, histogramQuantile(snapshot, READ_BOUNDS_US, 1.0f));  // max < 5000
+    TEST_ASSERT_EQUAL_UINT32(100, histogramQuantile(snapshot, READ_BOUNDS_US, 0.0f));
+}
+
+void test_histogram_overflow_quantile_is_max(void) {
+    metricObserve(METRIC_LUX_READ_US, 250000);
+    HistogramSnapshot snapshot = takeHistogram(METRIC_LUX_READ_US);
+    TEST_ASSERT_EQUAL_UINT32(250000, histogramQuantile(snapshot, READ_BOUNDS_US, 0.5f));
+}
+
+// ==================== CONCURRENCY ====================
+
+// Updates from tasks on both cores must not be lost
+void test_concurrent_updates(void) {
+    const int threads = 4;
+    const int perThread = 100000;
+    uint32_t before = metricValue(METRIC_HTTP_REQUESTS);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([t] {
+            for (int i = 0; i < perThread; i++) {
+                metricIncrement(METRIC_HTTP_REQUESTS);
+                metricObserve(METRIC_LUX_READ_US, (uint32_t)(t * perThread + i) % 200000);
+                metricRaise(METRIC_POOL_WAIT_MS, (uint32_t)(t * perThread + i));
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    TEST_ASSERT_EQUAL_UINT32(before + threads * perThread, metricValue(METRIC_HTTP_REQUESTS));
+    HistogramSnapshot snapshot = takeHistogram(METRIC_LUX_READ_US);
+    TEST_ASSERT_EQUAL_UINT32(threads * perThread, snapshot.count);
+    TEST_ASSERT_EQUAL_UINT32(199999, snapshot.max);
+    TEST_ASSERT_EQUAL_UINT32(threads * perThread - 1, takeMetricMax(METRIC_POOL_WAIT_MS));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_accumulates);
+    RUN_TEST(test_max_gauge_keeps_highest_until_taken);
+    RUN_TEST(test_histogram_buckets);
+    RUN_TEST(test_histogram_take_starts_a_new_window);
+    RUN_TEST(test_histogram_quantiles);
+    RUN_TEST(test_histogram_overflow_quantile_is_max);
+    RUN_TEST(test_concurrent_updates);
+    return UNITY_END();
+}
@@ -0,0 +1,260 @@
+/**
+ * test_onem2m_framing
+ *
+ * Where a CSE reply ends: replyHasBody(), and OneM2MClient::request() and
+ * pipeline() against a loopback server that answers without a body. A
+ * reply that has none must come back at once, on a connection that stays
+ * usable, without eating the replies behind it. A reply that runs to
+ * connection close ends when the CSE closes. pio test -e native
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "onem2m.h"
+
+// ==================== LOOPBACK CSE ====================
+
+/**
+ * Answers every request on every connection with the same reply and
+ * keeps the connection open until the client closes it, or closes it
+ * after the first reply
+ */
+class LoopbackCse {
+public:
+    explicit LoopbackCse(const char* reply, bool closeAfterReply = false)
+        : reply(reply), closeAfterReply(closeAfterReply) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listenFd, (sockaddr*)&addr, sizeof(addr));
+        socklen_t length = sizeof(addr);
+        getsockname(listenFd, (sockaddr*)&addr, &length);
+        port = ntohs(addr.sin_port);
+        listen(listenFd, 4);
+        acceptor = std::thread([this] { run(); });
+    }
+
+    ~LoopbackCse() {
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        acceptor.join();
+        // OneM2MClient keeps its connections for good; end them here
+        for (int fd : connections) shutdown(fd, SHUT_RDWR);
+        for (auto& worker : workers) worker.join();
+        for (int fd : connections) close(fd);
+    }
+
+    String baseUrl() const { return String("http://127.0.0.1:") + String((int)port); }
+
+    std::atomic<int> accepts{0};
+    std::atomic<int> requests{0};
+
+private:
+    void run() {
+        int fd;
+        while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+            accepts++;
+            connections.push_back(fd);
+            workers.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    // Requests from OneM2MClient carry Content-Length when they have a body
+    void serve(int fd) {
+        std::string in;
+        char buffer[512];
+        for (;;) {
+            size_t headerEnd;
+            while ((headerEnd = in.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) return;
+                in.append(buffer, n);
+            }
+            size_t bodyLength = 0;
+            size_t at = in.find("Content-Length:");
+            if (at != std::string::npos && at < headerEnd) bodyLength = strtoul(in.c_str() + at + 15, nullptr, 10);
+            while (in.size() < headerEnd + 4 + bodyLength) {
+                ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) return;
+                in.append(buffer, n);
+            }
+            in.erase(0, headerEnd + 4 + bodyLength);
+            requests++;
+            send(fd, reply, strlen(reply), MSG_NOSIGNAL);
+            if (closeAfterReply) {
+                shutdown(fd, SHUT_WR);
+                return;
+            }
+        }
+    }
+
+    const char* reply;
+    bool closeAfterReply;
+    int listenFd;
+    uint16_t port = 0;
+    std::thread acceptor;
+    std::vector<int> connections;
+    std::vector<std::thread> workers;
+};
+
+// Two requests on a one-connection pool; returns the slower round trip
+static unsigned long requestTwice(LoopbackCse& cse, const char* method, int expectedStatus) {
+    OneM2MClient client(1);
+    TEST_ASSERT_TRUE(client.begin());
+    String path("/cse-in/node");
+    unsigned long slowest = 0;
+    for (int i = 0; i < 2; i++) {
+        int status = 0;
+        unsigned long start = millis();
+        TEST_ASSERT_TRUE(client.request(method, cse.baseUrl(), path, nullptr, 0, nullptr, status));
+        unsigned long elapsed = millis() - start;
+        if (elapsed > slowest) slowest = elapsed;
+        TEST_ASSERT_EQUAL_INT(expectedStatus, status);
+    }
+    return slowest;
+}
+
+// Four entries pipelined on a one-connection pool; returns the elapsed time
+static unsigned long pipelineFour(LoopbackCse& cse, const char* method, int expectedStatus) {
+    OneM2MClient client(1);
+    TEST_ASSERT_TRUE(client.begin());
+    client.setPipelineDepth(4);
+    String paths[4] = {"/cse-in/a", "/cse-in/b", "/cse-in/c", "/cse-in/d"};
+    OneM2MBatchEntry entries[4];
+    for (int i = 0; i < 4; i++) entries[i] = {method, &paths[i], nullptr, 0, nullptr, -1, 0};
+    unsigned long start = millis();
+    TEST_ASSERT_TRUE(client.pipeline(cse.baseUrl(), entries, 4));
+    unsigned long elapsed = millis() - start;
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL_INT(expectedStatus, entries[i].statusCode);
+    TEST_ASSERT_TRUE(client.pipeliningEnabled());
+    return elapsed;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ==================== replyHasBody ====================
+
+void test_empty_statuses_have_no_body(void) {
+    TEST_ASSERT_FALSE(replyHasBody("GET", 100));
+    TEST_ASSERT_FALSE(replyHasBody("POST", 103));
+    TEST_ASSERT_FALSE(replyHasBody("DELETE", 204));
+    TEST_ASSERT_FALSE(replyHasBody("GET", 304));
+}
+
+void test_head_reply_has_no_body(void) {
+    TEST_ASSERT_FALSE(replyHasBody("HEAD", 200));
+    TEST_ASSERT_FALSE(replyHasBody("HEAD", 404));
+}
+
+void test_other_replies_have_a_body(void) {
+    TEST_ASSERT_TRUE(replyHasBody("GET", 200));
+    TEST_ASSERT_TRUE(replyHasBody("POST", 201));
+    TEST_ASSERT_TRUE(replyHasBody("PUT", 404));
+    TEST_ASSERT_TRUE(replyHasBody("DELETE", 500));
+}
+
+// ==================== request() ====================
+
+void test_204_without_length_returns_at_once(void) {
+    LoopbackCse cse("HTTP/1.1 204 No Content\r\n\r\n");
+    unsigned long slowest = requestTwice(cse, "DELETE", 204);
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, slowest);
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+    TEST_ASSERT_EQUAL_INT(2, cse.requests.load());
+}
+
+void test_304_without_length_returns_at_once(void) {
+    LoopbackCse cse("HTTP/1.1 304 Not Modified\r\nX-M2M-RSC: 2000\r\n\r\n");
+    unsigned long slowest = requestTwice(cse, "GET", 304);
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, slowest);
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+}
+
+// The length of a HEAD reply describes the GET body, which is not sent
+void test_head_ignores_content_length(void) {
+    LoopbackCse cse("HTTP/1.1 200 OK\r\nContent-Length: 42\r\n\r\n");
+    unsigned long slowest = requestTwice(cse, "HEAD", 200);
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, slowest);
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+}
+
+// Without a sink the body is read and dropped, leaving the connection clean
+void test_discarded_body_keeps_connection(void) {
+    LoopbackCse cse("HTTP/1.1 200 OK\r\nContent-Length: 16\r\n\r\n{\"m2m:cin\":{}}  ");
+    requestTwice(cse, "GET", 200);
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+}
+
+void test_discarded_chunked_body_keeps_connection(void) {
+    LoopbackCse cse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "5\r\n{\"a\":\r\n2\r\n1}\r\n0\r\n\r\n");
+    requestTwice(cse, "GET", 200);
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+}
+
+// Without Content-Length the body ends when the CSE closes; the client
+// must see the close instead of waiting out ONEM2M_TIMEOUT_MS
+void test_body_to_close_returns_at_once(void) {
+    LoopbackCse cse("HTTP/1.1 200 OK\r\n\r\n{\"m2m:cin\":{}}", true);
+    OneM2MClient client(1);
+    TEST_ASSERT_TRUE(client.begin());
+    String path("/cse-in/node");
+    int status = 0;
+    unsigned long start = millis();
+    client.request("GET", cse.baseUrl(), path, nullptr, 0, nullptr, status);
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, millis() - start);
+    TEST_ASSERT_EQUAL_INT(200, status);
+}
+
+// ==================== pipeline() ====================
+
+void test_pipelined_204s_stay_pipelined(void) {
+    LoopbackCse cse("HTTP/1.1 204 No Content\r\n\r\n");
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, pipelineFour(cse, "DELETE", 204));
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+    TEST_ASSERT_EQUAL_INT(4, cse.requests.load());
+}
+
+// Read as a body, the declared 42 bytes would be the replies behind it
+void test_pipelined_head_ignores_content_length(void) {
+    LoopbackCse cse("HTTP/1.1 200 OK\r\nContent-Length: 42\r\n\r\n");
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, pipelineFour(cse, "HEAD", 200));
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+}
+
+void test_pipeline_skips_interim_replies(void) {
+    LoopbackCse cse("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 204 No Content\r\n\r\n");
+    TEST_ASSERT_LESS_THAN_UINT32(ONEM2M_TIMEOUT_MS / 5, pipelineFour(cse, "DELETE", 204));
+    TEST_ASSERT_EQUAL_INT(1, cse.accepts.load());
+    TEST_ASSERT_EQUAL_INT(4, cse.requests.load());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_statuses_have_no_body);
+    RUN_TEST(test_head_reply_has_no_body);
+    RUN_TEST(test_other_replies_have_a_body);
+    RUN_TEST(test_204_without_length_returns_at_once);
+    RUN_TEST(test_304_without_length_returns_at_once);
+    RUN_TEST(test_head_ignores_content_length);
+    RUN_TEST(test_discarded_body_keeps_connection);
+    RUN_TEST(test_discarded_chunked_body_keeps_connection);
+    RUN_TEST(test_body_to_close_returns_at_once);
+    RUN_TEST(test_pipelined_204s_stay_pipelined);
+    RUN_TEST(test_pipelined_head_ignores_content_length);
+    RUN_TEST(test_pipeline_skips_interim_replies);
+    return UNITY_END();
+}
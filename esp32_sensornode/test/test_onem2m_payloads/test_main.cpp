@@ -0,0 +1,194 @@
+/**
+ * test_onem2m_payloads
+ *
+ * Update bodies from the build*Payload() functions in onem2m.h, byte for
+ * byte as the CSE receives them, and notification parsing
+ * (parseNotification() in led_actuator.h). pio test -e native
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include "led_actuator.h"
+#include "onem2m.h"
+#include "report_policy.h"
+
+static String serialize(const JsonDocument& doc) {
+    String body;
+    serializeJson(doc, body);
+    return body;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ==================== UPDATE PAYLOADS ====================
+
+void test_lux_payload_is_quantized(void) {
+    StaticJsonDocument<256> doc;
+    buildLuxPayload(doc, 412.3f);
+    TEST_ASSERT_EQUAL_STRING("{\"mio:luxSr\":{\"lux\":412}}", serialize(doc).c_str());
+}
+
+void test_lux_payload_with_generation_time(void) {
+    StaticJsonDocument<256> doc;
+    buildLuxPayload(doc, 0.4f, "20261016T101500");
+    TEST_ASSERT_EQUAL_STRING("{\"mio:luxSr\":{\"lux\":0,\"dgt\":\"20261016T101500\"}}", serialize(doc).c_str());
+}
+
+void test_audio_payload_keeps_one_decimal(void) {
+    StaticJsonDocument<256> doc;
+    buildAudioPayload(doc, 52.34f);
+    TEST_ASSERT_EQUAL_STRING("{\"cod:acoSr\":{\"louds\":52.3}}", serialize(doc).c_str());
+}
+
+void test_occupancy_payload(void) {
+    StaticJsonDocument<256> doc;
+    buildOccupancyPayload(doc, true);
+    TEST_ASSERT_EQUAL_STRING("{\"mio:occSr\":{\"occ\":true}}", serialize(doc).c_str());
+
+    doc.clear();
+    buildOccupancyPayload(doc, false, "20261016T101500");
+    TEST_ASSERT_EQUAL_STRING("{\"mio:occSr\":{\"occ\":false,\"dgt\":\"20261016T101500\"}}", serialize(doc).c_str());
+}
+
+void test_occupancy_stats_payload(void) {
+    OccupancyStats stats;
+    stats.intervalSeconds = 300;
+    stats.occupiedSeconds = 120;
+    stats.sessions = 2;
+    stats.longestSessionSeconds = 90;
+    stats.secondsSinceLastPresence = 40;
+    stats.presenceSeen = true;
+
+    StaticJsonDocument<256> doc;
+    buildOccupancyStatsPayload(doc, stats);
+    TEST_ASSERT_EQUAL_STRING("{\"mio:occSr\":{\"ocs\":120,\"ses\":2,\"lgs\":90,\"tlp\":40,\"ivl\":300}}",
+                             serialize(doc).c_str());
+}
+
+void test_occupancy_stats_payload_before_first_presence(void) {
+    OccupancyStats stats = {300, 0, 0, 0, 0, false};
+
+    StaticJsonDocument<256> doc;
+    buildOccupancyStatsPayload(doc, stats);
+    TEST_ASSERT_EQUAL_STRING("{\"mio:occSr\":{\"ocs\":0,\"ses\":0,\"lgs\":0,\"ivl\":300}}",
+                             serialize(doc).c_str());
+}
+
+void test_summary_payloads(void) {
+    WindowSummary summary;
+    summary.intervalSeconds = 300;
+    summary.count = 30;
+    summary.minimum = 398.2f;
+    summary.maximum = 1201.2f;
+    summary.mean = 640.56f;
+    summary.stddev = 12.349f;
+
+    StaticJsonDocument<256> doc;
+    buildLuxSummaryPayload(doc, summary);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"mio:luxSr\":{\"smc\":30,\"smn\":398,\"smx\":1201,\"sav\":641,\"ssd\":12,\"siv\":300}}",
+        serialize(doc).c_str());
+
+    doc.clear();
+    buildAudioSummaryPayload(doc, summary);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"mio:acoSm\":{\"smc\":30,\"smn\":398.2,\"smx\":1201.2,\"sav\":640.6,\"ssd\":12.3,\"siv\":300}}",
+        serialize(doc).c_str());
+}
+
+void test_occupancy_summary_payload(void) {
+    WindowSummary summary;
+    summary.intervalSeconds = 300;
+    summary.count = 4;
+    summary.minimum = 0;
+    summary.maximum = 1;
+    summary.mean = 0.75f;
+    summary.stddev = 0.5f;
+
+    StaticJsonDocument<256> doc;
+    buildOccupancySummaryPayload(doc, summary);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"mio:occSr\":{\"smc\":4,\"smn\":0,\"smx\":1,\"sav\":0.75,\"ssd\":0.5,\"siv\":300}}",
+        serialize(doc).c_str());
+}
+
+void test_lamp_switch_payload(void) {
+    StaticJsonDocument<256> doc;
+    buildLampSwitchPayload(doc, true);
+    TEST_ASSERT_EQUAL_STRING("{\"cod:binSh\":{\"state\":true}}", serialize(doc).c_str());
+}
+
+// ==================== NOTIFICATIONS ====================
+
+void test_notification_verification(void) {
+    StaticJsonDocument<1024> doc;
+    LampNotification notification;
+    TEST_ASSERT_TRUE(parseNotification("{\"m2m:sgn\":{\"vrq\":true,\"sur\":\"/sub\"}}", doc, notification));
+    TEST_ASSERT_TRUE(notification.verification);
+    TEST_ASSERT_FALSE(notification.hasPower);
+    TEST_ASSERT_FALSE(notification.hasColor);
+}
+
+void test_notification_power_and_colour(void) {
+    StaticJsonDocument<1024> doc;
+    LampNotification notification;
+    TEST_ASSERT_TRUE(parseNotification(
+        "{\"m2m:sgn\":{\"nev\":{\"rep\":{\"cod:binSh\":{\"state\":true},"
+        "\"cod:color\":{\"red\":255,\"green\":128,\"blue\":0}},\"net\":1}}}",
+        doc, notification));
+    TEST_ASSERT_FALSE(notification.verification);
+    TEST_ASSERT_TRUE(notification.hasPower);
+    TEST_ASSERT_TRUE(notification.power);
+    TEST_ASSERT_TRUE(notification.hasColor);
+    TEST_ASSERT_EQUAL_UINT8(255, notification.red);
+    TEST_ASSERT_EQUAL_UINT8(128, notification.green);
+    TEST_ASSERT_EQUAL_UINT8(0, notification.blue);
+    TEST_ASSERT_TRUE(notification.radar.isNull());
+}
+
+void test_notification_radar_configuration(void) {
+    StaticJsonDocument<1024> doc;
+    LampNotification notification;
+    TEST_ASSERT_TRUE(parseNotification(
+        "{\"m2m:sgn\":{\"nev\":{\"rep\":{\"mio:occSr\":{\"mxg\":8,\"udr\":60}}}}}", doc, notification));
+    TEST_ASSERT_FALSE(notification.hasPower);
+    TEST_ASSERT_FALSE(notification.radar.isNull());
+    TEST_ASSERT_EQUAL_INT(8, (int)notification.radar["mxg"]);
+    TEST_ASSERT_EQUAL_INT(60, (int)notification.radar["udr"]);
+}
+
+void test_notification_without_signal(void) {
+    StaticJsonDocument<1024> doc;
+    LampNotification notification;
+    TEST_ASSERT_TRUE(parseNotification("{\"m2m:cin\":{\"con\":\"x\"}}", doc, notification));
+    TEST_ASSERT_FALSE(notification.verification);
+    TEST_ASSERT_FALSE(notification.hasPower);
+    TEST_ASSERT_FALSE(notification.hasColor);
+}
+
+void test_notification_invalid_json(void) {
+    StaticJsonDocument<1024> doc;
+    LampNotification notification;
+    TEST_ASSERT_FALSE(parseNotification("{\"m2m:sgn\":", doc, notification));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lux_payload_is_quantized);
+    RUN_TEST(test_lux_payload_with_generation_time);
+    RUN_TEST(test_audio_payload_keeps_one_decimal);
+    RUN_TEST(test_occupancy_payload);
+    RUN_TEST(test_occupancy_stats_payload);
+    RUN_TEST(test_occupancy_stats_payload_before_first_presence);
+    RUN_TEST(test_summary_payloads);
+    RUN_TEST(test_occupancy_summary_payload);
+    RUN_TEST(test_lamp_switch_payload);
+    RUN_TEST(test_notification_verification);
+    RUN_TEST(test_notification_power_and_colour);
+    RUN_TEST(test_notification_radar_configuration);
+    RUN_TEST(test_notification_without_signal);
+    RUN_TEST(test_notification_invalid_json);
+    return UNITY_END();
+}
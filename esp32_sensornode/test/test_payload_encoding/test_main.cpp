@@ -0,0 +1,133 @@
+/**
+ * test_payload_encoding
+ *
+ * Value quantization (flexQuantize() in flex_descriptor.h) and the battery
+ * mode delta batch (delta_batch.h), whose bytes must match
+ * tools/delta_batch.py. pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "delta_batch.h"
+#include "flex_descriptor.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ==================== QUANTIZATION ====================
+
+static void assertQuantized(int32_t scaled, uint8_t decimals, FlexQuantized actual) {
+    TEST_ASSERT_EQUAL_INT32(scaled, actual.scaled);
+    TEST_ASSERT_EQUAL_UINT8(decimals, actual.decimals);
+}
+
+void test_quantize_to_quantum_decimals(void) {
+    assertQuantized(412, 0, flexQuantize(412.3f, 1.0f));
+    assertQuantized(523, 1, flexQuantize(52.34f, 0.1f));
+    assertQuantized(5225, 2, flexQuantize(52.36f, 0.25f));  // 209.44 steps of 25
+    assertQuantized(0, 0, flexQuantize(0.4f, 1.0f));
+}
+
+void test_quantize_rounds_half_away_from_zero(void) {
+    assertQuantized(413, 0, flexQuantize(412.5f, 1.0f));
+    assertQuantized(-413, 0, flexQuantize(-412.5f, 1.0f));
+    assertQuantized(-35, 1, flexQuantize(-3.46f, 0.1f));
+}
+
+void test_quantize_nan_gives_zero(void) {
+    assertQuantized(0, 0, flexQuantize(NAN, 1.0f));
+    assertQuantized(0, 1, flexQuantize(NAN, 0.1f));
+}
+
+// Clamped to the largest multiple of the step that fits an int32
+void test_quantize_clamps_out_of_range(void) {
+    assertQuantized(INT32_MAX, 0, flexQuantize(1e12f, 1.0f));
+    assertQuantized(-INT32_MAX, 0, flexQuantize(-1e12f, 1.0f));
+    assertQuantized(2147483625, 2, flexQuantize(INFINITY, 0.25f));
+    assertQuantized(-2147483625, 2, flexQuantize(-INFINITY, 0.25f));
+}
+
+void test_quantize_degenerate_quantum(void) {
+    assertQuantized(412, 0, flexQuantize(412.3f, 0.0f));
+    assertQuantized(412, 0, flexQuantize(412.3f, NAN));
+}
+
+// ==================== DELTA BATCH ====================
+
+#define SAMPLE_COUNT 8
+
+static const uint32_t GAPS[SAMPLE_COUNT] = {0, 60, 60, 61, 60, 120, 60, 60};
+static const float LUX[SAMPLE_COUNT] = {412.3f, 415.7f, NAN, 398.2f, 0.4f, 1200.9f, 1201.2f, 1190.0f};
+static const bool OCCUPIED[SAMPLE_COUNT] = {true, true, false, false, true, true, false, true};
+
+static size_t encodeSamples(DeltaBatchEncoder& encoder, const float* lux) {
+    uint32_t time = 1760000000;
+    size_t added = 0;
+    for (size_t i = 0; i < SAMPLE_COUNT; i++) {
+        time += GAPS[i];
+        if (encoder.add(time, lux[i], OCCUPIED[i])) added++;
+    }
+    return added;
+}
+
+// Reference bytes from tools/delta_batch.py encode() on the same samples
+void test_batch_matches_python_encoder(void) {
+    uint8_t buffer[64];
+    DeltaBatchEncoder encoder(buffer, sizeof(buffer), 1.0f);
+    TEST_ASSERT_EQUAL_size_t(SAMPLE_COUNT, encodeSamples(encoder, LUX));
+    TEST_ASSERT_EQUAL_size_t(SAMPLE_COUNT, encoder.count());
+    TEST_ASSERT_EQUAL_size_t(29, encoder.length());
+
+    char text[base64Capacity(29)];
+    TEST_ASSERT_EQUAL_size_t(40, base64Encode(buffer, encoder.length(), text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("AegHgPCdxwYDuAbjAwgACSMHmwbjA+IS3QMAAxU=", text);
+}
+
+// Version and quantum take 3 bytes; the first sample needs 8 more
+void test_batch_full_keeps_previous_bytes(void) {
+    uint8_t buffer[9];
+    DeltaBatchEncoder encoder(buffer, sizeof(buffer), 1.0f);
+    TEST_ASSERT_FALSE(encoder.add(1760000000, 412.3f, true));
+    TEST_ASSERT_EQUAL_size_t(0, encoder.count());
+    TEST_ASSERT_EQUAL_size_t(3, encoder.length());
+}
+
+void test_batch_non_finite_lux_is_no_reading(void) {
+    float lux[SAMPLE_COUNT];
+    memcpy(lux, LUX, sizeof(lux));
+    uint8_t expected[64];
+    DeltaBatchEncoder reference(expected, sizeof(expected), 1.0f);
+    encodeSamples(reference, lux);
+
+    lux[2] = INFINITY;
+    uint8_t buffer[64];
+    DeltaBatchEncoder encoder(buffer, sizeof(buffer), 1.0f);
+    TEST_ASSERT_EQUAL_size_t(SAMPLE_COUNT, encodeSamples(encoder, lux));
+    TEST_ASSERT_EQUAL_size_t(reference.length(), encoder.length());
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, encoder.length());
+}
+
+void test_base64_padding(void) {
+    char text[9];
+    TEST_ASSERT_EQUAL_size_t(4, base64Encode((const uint8_t*)"f", 1, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("Zg==", text);
+    TEST_ASSERT_EQUAL_size_t(4, base64Encode((const uint8_t*)"fo", 2, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("Zm8=", text);
+    TEST_ASSERT_EQUAL_size_t(8, base64Encode((const uint8_t*)"foobar", 6, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("Zm9vYmFy", text);
+    TEST_ASSERT_EQUAL_size_t(0, base64Encode((const uint8_t*)"foobar", 6, text, 8));  // No room for the NUL
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_quantize_to_quantum_decimals);
+    RUN_TEST(test_quantize_rounds_half_away_from_zero);
+    RUN_TEST(test_quantize_nan_gives_zero);
+    RUN_TEST(test_quantize_clamps_out_of_range);
+    RUN_TEST(test_quantize_degenerate_quantum);
+    RUN_TEST(test_batch_matches_python_encoder);
+    RUN_TEST(test_batch_full_keeps_previous_bytes);
+    RUN_TEST(test_batch_non_finite_lux_is_no_reading);
+    RUN_TEST(test_base64_padding);
+    return UNITY_END();
+}
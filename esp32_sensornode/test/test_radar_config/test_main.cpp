@@ -0,0 +1,206 @@
+/**
+ * test_radar_config
+ *
+ * S3KM1110 configuration writes (occupancy_sensor.h) against a simulated
+ * radar on UART1 that ACKs, drops or rejects commands. Notification
+ * attributes are queued and written by applyQueuedRadarConfig(), as the
+ * occupancy job does. pio test -e native
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <native_hal.h>
+#include <unity.h>
+#include <vector>
+#include "occupancy_sensor.h"
+
+// ==================== SIMULATED RADAR ====================
+
+struct RadarWrite {
+    uint16_t command;
+    uint16_t param;   // First parameter of a WRITE_PARAMS frame
+    uint32_t value;
+};
+
+static std::vector<RadarWrite> written;
+static int dropEnableAcks = 0;     // Enable commands left unanswered, -1 for all
+static bool rejectParams = false;  // Non-zero status for WRITE_PARAMS
+
+static void respond(HardwareSerial& port, const uint8_t* data, size_t length) {
+    if (length < 12) return;
+    RadarWrite write = {(uint16_t)(data[6] | (data[7] << 8)), 0, 0};
+    if (write.command == RADAR_CMD_WRITE_PARAMS && length >= 18) {
+        write.param = data[8] | (data[9] << 8);
+        write.value = data[10] | (data[11] << 8) | (data[12] << 16) | ((uint32_t)data[13] << 24);
+    }
+    written.push_back(write);
+
+    if (write.command == RADAR_CMD_ENABLE_CONFIG && dropEnableAcks != 0) {
+        if (dropEnableAcks > 0) dropEnableAcks--;
+        return;
+    }
+    uint16_t ack = write.command | 0x0100;
+    uint8_t status = (write.command == RADAR_CMD_WRITE_PARAMS && rejectParams) ? 1 : 0;
+    const uint8_t frame[] = {0xFD, 0xFC, 0xFB, 0xFA, 0x04, 0x00, (uint8_t)(ack & 0xFF), (uint8_t)(ack >> 8),
+                             status, 0x00, 0x04, 0x03, 0x02, 0x01};
+    port.inject(frame, sizeof(frame));
+}
+
+static std::vector<uint16_t> writtenCommands() {
+    std::vector<uint16_t> commands;
+    for (const RadarWrite& write : written) commands.push_back(write.command);
+    return commands;
+}
+
+static size_t paramWrites() {
+    size_t count = 0;
+    for (const RadarWrite& write : written) {
+        if (write.command == RADAR_CMD_WRITE_PARAMS) count++;
+    }
+    return count;
+}
+
+static bool queueJson(const char* occSensor) {
+    StaticJsonDocument<1024> doc;
+    String body = String("{\"mio:occSr\":") + occSensor + "}";
+    if (deserializeJson(doc, body)) return false;
+    JsonObject representation = doc["mio:occSr"];
+    return queueRadarConfigFromJson(representation);
+}
+
+static bool applyJson(const char* occSensor) {
+    return queueJson(occSensor) && applyQueuedRadarConfig();
+}
+
+void setUp(void) {
+    written.clear();
+    dropEnableAcks = 0;
+    rejectParams = false;
+    nativeSerialPort(1).setResponder(respond);
+}
+
+void tearDown(void) {}
+
+// ==================== TESTS ====================
+
+void test_power_on_writes_no_stored_parameters(void) {
+    TEST_ASSERT_TRUE(initOccupancySensor());
+
+    std::vector<uint16_t> expected = {RADAR_CMD_ENABLE_CONFIG, RADAR_CMD_WRITE_SYSTEM, RADAR_CMD_DISABLE_CONFIG};
+    TEST_ASSERT_TRUE(writtenCommands() == expected);
+    RadarConfig config = getRadarConfig();
+    TEST_ASSERT_FALSE(config.hasMaxDistanceGate);
+    TEST_ASSERT_FALSE(config.hasUnmannedDuration);
+    TEST_ASSERT_FALSE(config.hasGateSensitivity);
+}
+
+void test_only_set_parameters_are_written(void) {
+    TEST_ASSERT_TRUE(applyJson("{\"udr\":60}"));
+
+    TEST_ASSERT_EQUAL_UINT(1, paramWrites());
+    TEST_ASSERT_EQUAL_UINT16(RADAR_CMD_WRITE_PARAMS, written[1].command);
+    TEST_ASSERT_EQUAL_UINT16(RADAR_PARAM_UNMANNED_DURATION, written[1].param);
+    TEST_ASSERT_EQUAL_UINT32(60, written[1].value);
+
+    RadarConfig config = getRadarConfig();
+    TEST_ASSERT_TRUE(config.hasUnmannedDuration);
+    TEST_ASSERT_EQUAL_UINT16(60, config.unmannedDurationSeconds);
+    TEST_ASSERT_FALSE(config.hasMaxDistanceGate);
+}
+
+void test_unchanged_configuration_is_not_written(void) {
+    TEST_ASSERT_TRUE(applyJson("{\"udr\":60}"));
+    TEST_ASSERT_TRUE(written.empty());
+}
+
+void test_enable_config_is_retried(void) {
+    dropEnableAcks = 1;
+    TEST_ASSERT_TRUE(applyRadarConfig(getRadarConfig()));
+
+    // The unmanned duration set above is written again
+    std::vector<uint16_t> expected = {RADAR_CMD_ENABLE_CONFIG, RADAR_CMD_ENABLE_CONFIG, RADAR_CMD_WRITE_PARAMS,
+                                      RADAR_CMD_WRITE_SYSTEM, RADAR_CMD_DISABLE_CONFIG};
+    TEST_ASSERT_TRUE(writtenCommands() == expected);
+}
+
+void test_failed_enable_still_leaves_config_mode(void) {
+    dropEnableAcks = -1;
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":8}"));
+
+    std::vector<uint16_t> expected;
+    for (int i = 0; i < MMWAVE_ENABLE_ATTEMPTS; i++) expected.push_back(RADAR_CMD_ENABLE_CONFIG);
+    expected.push_back(RADAR_CMD_DISABLE_CONFIG);
+    TEST_ASSERT_TRUE(writtenCommands() == expected);
+    TEST_ASSERT_FALSE(getRadarConfig().hasMaxDistanceGate);
+}
+
+void test_rejected_parameter_still_sends_mode(void) {
+    rejectParams = true;
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":8}"));
+
+    std::vector<uint16_t> expected = {RADAR_CMD_ENABLE_CONFIG, RADAR_CMD_WRITE_PARAMS, RADAR_CMD_WRITE_SYSTEM,
+                                      RADAR_CMD_DISABLE_CONFIG};
+    TEST_ASSERT_TRUE(writtenCommands() == expected);
+    TEST_ASSERT_FALSE(getRadarConfig().hasMaxDistanceGate);
+}
+
+void test_out_of_range_values_are_rejected(void) {
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":16}"));
+    TEST_ASSERT_FALSE(applyJson("{\"udr\":-1}"));
+    TEST_ASSERT_FALSE(applyJson("{\"udr\":70000}"));
+    TEST_ASSERT_FALSE(applyJson("{\"sen\":[50,50,50,50,50,50,50,50,50,50,50,50,50,50,50,101]}"));
+    TEST_ASSERT_FALSE(applyJson("{\"sen\":[-1,50,50,50,50,50,50,50,50,50,50,50,50,50,50,50]}"));
+    TEST_ASSERT_FALSE(applyJson("{\"sen\":[50,50]}"));
+    // A valid attribute next to an invalid one is not applied either
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":8,\"udr\":70000}"));
+    // Wrong types are not read as 0
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":\"8\"}"));
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":null}"));
+    TEST_ASSERT_FALSE(applyJson("{\"mxg\":2.5}"));
+    TEST_ASSERT_FALSE(applyJson("{\"eng\":\"yes\"}"));
+
+    TEST_ASSERT_TRUE(written.empty());
+    TEST_ASSERT_EQUAL_UINT16(60, getRadarConfig().unmannedDurationSeconds);
+}
+
+// Nothing reaches the UART until the occupancy job runs
+void test_queued_config_waits_for_the_job(void) {
+    TEST_ASSERT_TRUE(queueJson("{\"mxg\":6}"));
+    TEST_ASSERT_TRUE(queueJson("{\"udr\":90}"));
+    TEST_ASSERT_TRUE(written.empty());
+
+    // Both notifications go out in one exchange
+    TEST_ASSERT_TRUE(applyQueuedRadarConfig());
+    TEST_ASSERT_EQUAL_UINT(2, paramWrites());
+    RadarConfig config = getRadarConfig();
+    TEST_ASSERT_EQUAL_UINT8(6, config.maxDistanceGate);
+    TEST_ASSERT_EQUAL_UINT16(90, config.unmannedDurationSeconds);
+
+    written.clear();
+    TEST_ASSERT_TRUE(applyQueuedRadarConfig());
+    TEST_ASSERT_TRUE(written.empty());
+}
+
+void test_gate_sensitivity_is_written_per_gate(void) {
+    TEST_ASSERT_TRUE(applyJson("{\"sen\":[0,10,20,30,40,50,60,70,80,90,100,100,100,100,100,100]}"));
+
+    // The max gate and unmanned duration set above, then one frame per gate
+    TEST_ASSERT_EQUAL_UINT(2 + MMWAVE_GATE_COUNT, paramWrites());
+    RadarConfig config = getRadarConfig();
+    TEST_ASSERT_TRUE(config.hasGateSensitivity);
+    TEST_ASSERT_EQUAL_UINT16(100, config.gateSensitivity[MMWAVE_GATE_COUNT - 1]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_power_on_writes_no_stored_parameters);
+    RUN_TEST(test_only_set_parameters_are_written);
+    RUN_TEST(test_unchanged_configuration_is_not_written);
+    RUN_TEST(test_enable_config_is_retried);
+    RUN_TEST(test_failed_enable_still_leaves_config_mode);
+    RUN_TEST(test_rejected_parameter_still_sends_mode);
+    RUN_TEST(test_out_of_range_values_are_rejected);
+    RUN_TEST(test_queued_config_waits_for_the_job);
+    RUN_TEST(test_gate_sensitivity_is_written_per_gate);
+    return UNITY_END();
+}
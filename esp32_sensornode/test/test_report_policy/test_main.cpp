@@ -0,0 +1,284 @@
+/**
+ * test_report_policy
+ *
+ * Report decisions, dwell-time statistics and window summaries from
+ * report_policy.h. pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "config.h"
+#include "report_policy.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ==================== CHANGE THRESHOLD ====================
+
+void test_first_reading_is_reportable(void) {
+    TEST_ASSERT_TRUE(changeReportable(0.0, -1.0, LUX_THRESHOLD));
+}
+
+void test_change_below_threshold_is_not_reportable(void) {
+    TEST_ASSERT_FALSE(changeReportable(100.0, 100.0 + LUX_THRESHOLD / 2, LUX_THRESHOLD));
+    TEST_ASSERT_TRUE(changeReportable(100.0, 100.0 + LUX_THRESHOLD, LUX_THRESHOLD));
+    TEST_ASSERT_TRUE(changeReportable(100.0 + LUX_THRESHOLD, 100.0, LUX_THRESHOLD));
+}
+
+// ==================== PRESENCE STATISTICS ====================
+
+void test_occupancy_window_due(void) {
+    OccupancyTracker tracker;
+    tracker.begin(1000);
+    TEST_ASSERT_FALSE(tracker.windowDue(1000 + OCCUPANCY_STATS_INTERVAL - 1));
+    TEST_ASSERT_TRUE(tracker.windowDue(1000 + OCCUPANCY_STATS_INTERVAL));
+}
+
+void test_occupancy_sessions_and_dwell_time(void) {
+    // Samples every 10 s: absent, present, present, absent, present, absent
+    const bool states[] = {false, true, true, false, true, false};
+    OccupancyTracker tracker;
+    tracker.begin(0);
+    for (int i = 0; i < 6; i++) {
+        tracker.sample(states[i], i * 10000UL);
+    }
+
+    OccupancyStats stats = tracker.peek(60000);
+    TEST_ASSERT_EQUAL_UINT32(60, stats.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(30, stats.occupiedSeconds);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.sessions);
+    TEST_ASSERT_EQUAL_UINT32(20, stats.longestSessionSeconds);
+    TEST_ASSERT_EQUAL_UINT32(20, stats.secondsSinceLastPresence);
+    TEST_ASSERT_TRUE(stats.presenceSeen);
+}
+
+void test_occupancy_no_presence_since_boot(void) {
+    OccupancyTracker tracker;
+    tracker.begin(3600000);
+    tracker.sample(false, 3600000);
+    tracker.sample(false, 3610000);
+
+    OccupancyStats stats = tracker.peek(3610000);
+    TEST_ASSERT_FALSE(stats.presenceSeen);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.secondsSinceLastPresence);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.sessions);
+    tracker.restart(3610000);
+
+    tracker.sample(true, 3620000);
+    tracker.sample(false, 3630000);
+    stats = tracker.peek(3640000);
+    TEST_ASSERT_TRUE(stats.presenceSeen);
+    TEST_ASSERT_EQUAL_UINT32(20, stats.secondsSinceLastPresence);
+}
+
+void test_occupancy_session_carries_over(void) {
+    OccupancyTracker tracker;
+    tracker.begin(0);
+    tracker.sample(true, 0);
+    tracker.sample(true, 10000);
+
+    OccupancyStats first = tracker.peek(10000);
+    TEST_ASSERT_EQUAL_UINT32(10, first.occupiedSeconds);
+    TEST_ASSERT_EQUAL_UINT16(1, first.sessions);
+    TEST_ASSERT_EQUAL_UINT32(0, first.secondsSinceLastPresence);
+    tracker.restart(10000);
+
+    tracker.sample(true, 20000);
+    OccupancyStats second = tracker.peek(20000);
+    TEST_ASSERT_EQUAL_UINT32(10, second.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(10, second.occupiedSeconds);
+    TEST_ASSERT_EQUAL_UINT16(1, second.sessions);
+    TEST_ASSERT_EQUAL_UINT32(20, second.longestSessionSeconds);
+}
+
+// Stats the CSE did not take stay in the window until restart()
+void test_occupancy_stats_kept_until_restart(void) {
+    OccupancyTracker tracker;
+    tracker.begin(0);
+    tracker.sample(true, 0);
+    tracker.sample(false, 10000);
+    OccupancyStats failed = tracker.peek(OCCUPANCY_STATS_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(10, failed.occupiedSeconds);
+
+    tracker.sample(true, OCCUPANCY_STATS_INTERVAL + 5000);
+    tracker.sample(false, OCCUPANCY_STATS_INTERVAL + 10000);
+    OccupancyStats retried = tracker.peek(OCCUPANCY_STATS_INTERVAL + 10000);
+    TEST_ASSERT_EQUAL_UINT32(OCCUPANCY_STATS_INTERVAL / 1000 + 10, retried.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(15, retried.occupiedSeconds);
+    TEST_ASSERT_EQUAL_UINT16(2, retried.sessions);
+
+    tracker.restart(OCCUPANCY_STATS_INTERVAL + 10000);
+    OccupancyStats next = tracker.peek(OCCUPANCY_STATS_INTERVAL + 20000);
+    TEST_ASSERT_EQUAL_UINT32(10, next.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(0, next.occupiedSeconds);
+    TEST_ASSERT_EQUAL_UINT16(0, next.sessions);
+}
+
+// A window folded back after a failed PUT counts an ongoing session once
+void test_occupancy_append_after_restart(void) {
+    OccupancyTracker tracker;
+    tracker.begin(0);
+    tracker.sample(false, 0);
+    tracker.sample(true, 10000);
+    tracker.sample(false, 20000);
+    tracker.sample(true, 30000);
+
+    OccupancyTracker posted = tracker;
+    tracker.restart(40000);
+    tracker.sample(true, 40000);
+    tracker.sample(true, 50000);
+    tracker.sample(false, 60000);
+    tracker.sample(true, 70000);
+    tracker.sample(false, 80000);
+
+    posted.append(tracker);
+    OccupancyStats stats = posted.peek(80000);
+    TEST_ASSERT_EQUAL_UINT32(80, stats.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(50, stats.occupiedSeconds);
+    TEST_ASSERT_EQUAL_UINT16(3, stats.sessions);
+    TEST_ASSERT_EQUAL_UINT32(30, stats.longestSessionSeconds);
+    TEST_ASSERT_EQUAL_UINT32(10, stats.secondsSinceLastPresence);
+}
+
+// ==================== WINDOW SUMMARIES ====================
+
+void test_summary_of_empty_window(void) {
+    WindowAggregator<float> lux;
+    lux.begin(0);
+    WindowSummary summary = lux.peek(SENSOR_SUMMARY_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_SUMMARY_INTERVAL / 1000, summary.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(0, summary.count);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, summary.mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, summary.stddev);
+}
+
+void test_summary_statistics(void) {
+    // Large offset: a sum of squares in float would lose the spread
+    WindowAggregator<float> lux;
+    lux.begin(0);
+    TEST_ASSERT_FALSE(lux.windowDue(SENSOR_SUMMARY_INTERVAL - 1));
+    const float offsets[] = {4, 7, 13, 16};
+    for (float offset : offsets) {
+        lux.sample(1e6f + offset);
+    }
+    TEST_ASSERT_TRUE(lux.windowDue(SENSOR_SUMMARY_INTERVAL));
+
+    WindowSummary summary = lux.peek(SENSOR_SUMMARY_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(4, summary.count);
+    TEST_ASSERT_EQUAL_FLOAT(1e6f + 4, summary.minimum);
+    TEST_ASSERT_EQUAL_FLOAT(1e6f + 16, summary.maximum);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1e6f + 10, summary.mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 5.4772f, summary.stddev);
+}
+
+void test_summary_of_single_sample(void) {
+    WindowAggregator<float> audio;
+    audio.begin(0);
+    audio.sample(48.5f);
+    WindowSummary summary = audio.peek(1000);
+    TEST_ASSERT_EQUAL_UINT32(1, summary.count);
+    TEST_ASSERT_EQUAL_FLOAT(48.5f, summary.minimum);
+    TEST_ASSERT_EQUAL_FLOAT(48.5f, summary.maximum);
+    TEST_ASSERT_EQUAL_FLOAT(48.5f, summary.mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, summary.stddev);
+}
+
+void test_summary_of_occupancy_share(void) {
+    WindowAggregator<bool> occupancy;
+    occupancy.begin(0);
+    occupancy.sample(true);
+    occupancy.sample(false);
+    occupancy.sample(true);
+    occupancy.sample(true);
+
+    WindowSummary summary = occupancy.peek(40000);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, summary.minimum);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, summary.maximum);
+    TEST_ASSERT_EQUAL_FLOAT(0.75f, summary.mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, summary.stddev);
+}
+
+void test_summary_window_restarts(void) {
+    WindowAggregator<float> lux;
+    lux.begin(0);
+    lux.sample(10.0f);
+    lux.restart(SENSOR_SUMMARY_INTERVAL);
+
+    TEST_ASSERT_FALSE(lux.windowDue(SENSOR_SUMMARY_INTERVAL + 1));
+    lux.sample(20.0f);
+    WindowSummary summary = lux.peek(2 * SENSOR_SUMMARY_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(1, summary.count);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, summary.minimum);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, summary.mean);
+}
+
+// A summary the CSE did not take is sent again with the samples since
+void test_summary_kept_until_restart(void) {
+    WindowAggregator<float> lux;
+    lux.begin(0);
+    lux.sample(10.0f);
+    lux.sample(30.0f);
+    WindowSummary failed = lux.peek(SENSOR_SUMMARY_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(2, failed.count);
+
+    lux.sample(50.0f);
+    TEST_ASSERT_TRUE(lux.windowDue(SENSOR_SUMMARY_INTERVAL + 10000));
+    WindowSummary retried = lux.peek(SENSOR_SUMMARY_INTERVAL + 10000);
+    TEST_ASSERT_EQUAL_UINT32((SENSOR_SUMMARY_INTERVAL + 10000) / 1000, retried.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(3, retried.count);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, retried.minimum);
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, retried.maximum);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, retried.mean);
+}
+
+// Two windows folded together summarize exactly like one
+void test_summary_append_matches_one_window(void) {
+    const float values[] = {1e6f + 4, 1e6f + 7, 1e6f + 13, 1e6f + 16, 1e6f + 2};
+    WindowAggregator<float> whole;
+    whole.begin(0);
+    for (float value : values) whole.sample(value);
+
+    WindowAggregator<float> first;
+    first.begin(0);
+    first.sample(values[0]);
+    first.sample(values[1]);
+    WindowAggregator<float> second = first;
+    second.restart(20000);
+    for (int i = 2; i < 5; i++) second.sample(values[i]);
+    first.append(second);
+
+    WindowSummary expected = whole.peek(SENSOR_SUMMARY_INTERVAL);
+    WindowSummary folded = first.peek(SENSOR_SUMMARY_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(expected.intervalSeconds, folded.intervalSeconds);
+    TEST_ASSERT_EQUAL_UINT32(5, folded.count);
+    TEST_ASSERT_EQUAL_FLOAT(expected.minimum, folded.minimum);
+    TEST_ASSERT_EQUAL_FLOAT(expected.maximum, folded.maximum);
+    TEST_ASSERT_EQUAL_FLOAT(expected.mean, folded.mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.stddev, folded.stddev);
+
+    // Folding in an empty window changes nothing
+    WindowAggregator<float> empty = second;
+    empty.restart(30000);
+    first.append(empty);
+    TEST_ASSERT_EQUAL_UINT32(5, first.peek(SENSOR_SUMMARY_INTERVAL).count);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_reading_is_reportable);
+    RUN_TEST(test_change_below_threshold_is_not_reportable);
+    RUN_TEST(test_occupancy_window_due);
+    RUN_TEST(test_occupancy_sessions_and_dwell_time);
+    RUN_TEST(test_occupancy_no_presence_since_boot);
+    RUN_TEST(test_occupancy_session_carries_over);
+    RUN_TEST(test_occupancy_stats_kept_until_restart);
+    RUN_TEST(test_occupancy_append_after_restart);
+    RUN_TEST(test_summary_of_empty_window);
+    RUN_TEST(test_summary_statistics);
+    RUN_TEST(test_summary_of_single_sample);
+    RUN_TEST(test_summary_of_occupancy_share);
+    RUN_TEST(test_summary_window_restarts);
+    RUN_TEST(test_summary_kept_until_restart);
+    RUN_TEST(test_summary_append_matches_one_window);
+    return UNITY_END();
+}
@@ -0,0 +1,76 @@
+/**
+ * test_request_arena
+ *
+ * The per-request bump allocator (request_arena.h): alignment, printf
+ * staging, overflow without partial allocations, and the high-water
+ * mark that survives reset(). pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "request_arena.h"
+
+static char block[64];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_allocations_are_aligned(void) {
+    RequestArena arena(block, sizeof(block));
+    char* first = arena.allocate(3);
+    char* second = arena.allocate(5);
+    TEST_ASSERT_EQUAL_PTR(block, first);
+    TEST_ASSERT_EQUAL_PTR(block + 4, second);
+    TEST_ASSERT_EQUAL_size_t(9, arena.used());
+}
+
+void test_format_stages_a_string(void) {
+    RequestArena arena(block, sizeof(block));
+    arena.allocate(1);
+    const char* url = arena.format("/cse-in/%s/%d", "desk", 7);
+    TEST_ASSERT_EQUAL_PTR(block + 4, url);
+    TEST_ASSERT_EQUAL_STRING("/cse-in/desk/7", url);
+    TEST_ASSERT_EQUAL_size_t(4 + 15, arena.used());
+}
+
+// A request that does not fit falls back to the heap; the arena is unchanged
+void test_overflow_allocates_nothing(void) {
+    RequestArena arena(block, sizeof(block));
+    TEST_ASSERT_NOT_NULL(arena.allocate(61));  // The next aligned start is the end
+    TEST_ASSERT_NULL(arena.allocate(1));
+    TEST_ASSERT_NULL(arena.format("%s", "x"));
+    TEST_ASSERT_EQUAL_size_t(61, arena.used());
+    TEST_ASSERT_EQUAL_UINT32(2, arena.overflows());
+
+    // Exactly the remaining space still fits
+    RequestArena exact(block, sizeof(block));
+    TEST_ASSERT_NOT_NULL(exact.allocate(sizeof(block)));
+    TEST_ASSERT_NULL(exact.allocate(1));
+}
+
+// The terminating NUL needs room too
+void test_format_needs_room_for_the_nul(void) {
+    RequestArena arena(block, 8);
+    TEST_ASSERT_NULL(arena.format("%s", "12345678"));
+    TEST_ASSERT_EQUAL_STRING("1234567", arena.format("%s", "1234567"));
+    TEST_ASSERT_EQUAL_UINT32(1, arena.overflows());
+}
+
+void test_reset_keeps_the_high_water_mark(void) {
+    RequestArena arena(block, sizeof(block));
+    arena.allocate(40);
+    arena.reset();
+    TEST_ASSERT_EQUAL_size_t(0, arena.used());
+    TEST_ASSERT_EQUAL_PTR(block, arena.allocate(10));
+    TEST_ASSERT_EQUAL_size_t(40, arena.highWater());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_allocations_are_aligned);
+    RUN_TEST(test_format_stages_a_string);
+    RUN_TEST(test_overflow_allocates_nothing);
+    RUN_TEST(test_format_needs_room_for_the_nul);
+    RUN_TEST(test_reset_keeps_the_high_water_mark);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/**
+ * test_seqlock
+ *
+ * SeqLock (seqlock.h) and the sensor snapshot built on it. The stress
+ * tests run writers and readers on host threads and check that no reader
+ * ever sees a torn value or a version going backwards. pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "sensor_snapshot.h"
+#include "seqlock.h"
+
+#define STRESS_WRITERS 2
+#define STRESS_READERS 4
+#define STRESS_WRITES_PER_WRITER 100000
+
+// Every word holds the same counter, so a mix of two writes is visible
+struct Stamped {
+    uint32_t words[8];
+};
+
+// Size not a multiple of the lock's 32-bit words
+struct Odd {
+    uint8_t bytes[5];
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ==================== SINGLE THREAD ====================
+
+void test_initial_value_is_zero(void) {
+    SeqLock<Stamped> lock;
+    uint32_t version = 1;
+    Stamped value = lock.read(&version);
+    TEST_ASSERT_EQUAL_UINT32(0, version);
+    for (uint32_t word : value.words) TEST_ASSERT_EQUAL_UINT32(0, word);
+}
+
+void test_write_publishes_value_and_version(void) {
+    SeqLock<Odd> lock;
+    lock.write([](Odd& v) { v.bytes[4] = 7; });
+    lock.write([](Odd& v) { v.bytes[0] = 3; });
+
+    uint32_t version;
+    Odd value = lock.read(&version);
+    TEST_ASSERT_EQUAL_UINT32(2, version);
+    TEST_ASSERT_EQUAL_UINT8(3, value.bytes[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, value.bytes[1]);
+    TEST_ASSERT_EQUAL_UINT8(7, value.bytes[4]);
+}
+
+void test_snapshot_fields_update_independently(void) {
+    SensorSnapshot before = getSensorSnapshot();
+    setSnapshotLux(412.0f);
+    setSnapshotLamp(true, 10, 20, 30);
+    setSnapshotLampPower(false);
+
+    SensorSnapshot after = getSensorSnapshot();
+    TEST_ASSERT_EQUAL_UINT32(before.sequence + 3, after.sequence);
+    TEST_ASSERT_EQUAL_FLOAT(412.0f, after.lux);
+    TEST_ASSERT_FALSE(after.lampOn);
+    TEST_ASSERT_EQUAL_UINT8(10, after.red);
+    TEST_ASSERT_EQUAL_UINT8(30, after.blue);
+}
+
+// ==================== STRESS ====================
+
+void test_concurrent_readers_never_see_torn_values(void) {
+    SeqLock<Stamped> lock;
+    std::atomic<bool> writing(true);
+    std::atomic<uint32_t> torn(0), backwards(0), reads(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < STRESS_READERS; r++) {
+        readers.emplace_back([&] {
+            uint32_t lastVersion = 0;
+            uint32_t count = 0;
+            do {
+                uint32_t version;
+                Stamped value = lock.read(&version);
+                for (uint32_t word : value.words) {
+                    if (word != value.words[0]) {
+                        torn++;
+                        break;
+                    }
+                }
+                if (version < lastVersion) backwards++;
+                lastVersion = version;
+                count++;
+            } while (writing.load(std::memory_order_relaxed));
+            reads += count;
+        });
+    }
+
+    // Writers increment the shared counter, so lost updates show up too
+    std::vector<std::thread> writers;
+    for (int w = 0; w < STRESS_WRITERS; w++) {
+        writers.emplace_back([&] {
+            for (int i = 0; i < STRESS_WRITES_PER_WRITER; i++) {
+                lock.write([](Stamped& v) {
+                    uint32_t next = v.words[0] + 1;
+                    for (uint32_t& word : v.words) word = next;
+                });
+            }
+        });
+    }
+    for (std::thread& writer : writers) writer.join();
+    writing = false;
+    for (std::thread& reader : readers) reader.join();
+
+    uint32_t version;
+    Stamped last = lock.read(&version);
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, backwards.load());
+    TEST_ASSERT_EQUAL_UINT32(STRESS_WRITERS * STRESS_WRITES_PER_WRITER, version);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_WRITERS * STRESS_WRITES_PER_WRITER, last.words[7]);
+    TEST_ASSERT_GREATER_THAN(0, reads.load());
+}
+
+void test_snapshot_lamp_colour_is_never_mixed(void) {
+    // The NeoPixel task must never show red from one colour and blue from another
+    setSnapshotLampColor(0, 0, 0);
+    std::atomic<bool> writing(true);
+    std::atomic<uint32_t> mixed(0);
+
+    std::thread reader([&] {
+        do {
+            SensorSnapshot snapshot = getSensorSnapshot();
+            if (snapshot.red != snapshot.green || snapshot.green != snapshot.blue) mixed++;
+        } while (writing.load(std::memory_order_relaxed));
+    });
+    std::thread luxWriter([&] {
+        for (int i = 0; i < STRESS_WRITES_PER_WRITER; i++) setSnapshotLux((float)i);
+    });
+
+    for (int i = 0; i < STRESS_WRITES_PER_WRITER; i++) {
+        uint8_t level = i & 0xFF;
+        setSnapshotLampColor(level, level, level);
+    }
+    luxWriter.join();
+    writing = false;
+    reader.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, mixed.load());
+    TEST_ASSERT_EQUAL_FLOAT((float)(STRESS_WRITES_PER_WRITER - 1), getSensorSnapshot().lux);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_initial_value_is_zero);
+    RUN_TEST(test_write_publishes_value_and_version);
+    RUN_TEST(test_snapshot_fields_update_independently);
+    RUN_TEST(test_concurrent_readers_never_see_torn_values);
+    RUN_TEST(test_snapshot_lamp_colour_is_never_mixed);
+    return UNITY_END();
+}
@@ -0,0 +1,98 @@
+"""
+bench_compare.py
+
+Compares two benchmark reports from [env:bench] or [env:bench-esp32] (see
+bench/bench_main.cpp) and fails when a benchmark got slower or allocates
+more than the threshold allows:
+
+    .pio/build/bench/program > bench.json
+    python tools/bench_compare.py baseline.json bench.json --threshold 10
+    python tools/bench_compare.py baseline.json monitor.log    # Serial log
+
+A report is the line starting with {"target" in the file, so a captured
+serial monitor log works as is. Only compare reports from the same target:
+the native String is std::string, whose small-string buffer hides
+allocations the S3 makes.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith('{"target"'):
+                return json.loads(line)
+    raise ValueError("%s: no benchmark report found" % path)
+
+
+def change(before, after):
+    if before == 0:
+        return 0.0 if after == 0 else float("inf")
+    return 100.0 * (after - before) / before
+
+
+def compare(baseline, current, threshold, min_ns):
+    """Print a table of changes; returns the names that regressed"""
+    before = {b["name"]: b for b in baseline["benchmarks"]}
+    regressions = []
+
+    print("%-28s %10s %10s %8s %9s %9s %8s" % (
+        "benchmark", "ns/op", "was", "change", "bytes/op", "was", "change"))
+    for bench in current["benchmarks"]:
+        name = bench["name"]
+        old = before.pop(name, None)
+        if old is None:
+            print("%-28s %10.1f %10s %8s %9.1f %9s %8s" % (
+                name, bench["ns_per_op"], "-", "new", bench["bytes_per_op"], "-", "new"))
+            continue
+
+        time_change = change(old["ns_per_op"], bench["ns_per_op"])
+        bytes_change = change(old["bytes_per_op"], bench["bytes_per_op"])
+        # Sub-min_ns benchmarks are mostly timer and loop noise
+        slower = time_change > threshold and bench["ns_per_op"] >= min_ns
+        heavier = bytes_change > threshold
+        flag = " <" if slower or heavier else ""
+        if flag:
+            regressions.append(name)
+        print("%-28s %10.1f %10.1f %+7.1f%% %9.1f %9.1f %+7.1f%%%s" % (
+            name, bench["ns_per_op"], old["ns_per_op"], time_change,
+            bench["bytes_per_op"], old["bytes_per_op"], bytes_change, flag))
+
+    for name in before:
+        print("%-28s %10s" % (name, "removed"))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two sensor node benchmark reports")
+    parser.add_argument("baseline", help="Report or serial log from the reference build")
+    parser.add_argument("current", help="Report or serial log from the build under test")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="Allowed increase in ns/op or bytes/op, percent (default 10)")
+    parser.add_argument("--min-ns", type=float, default=50.0,
+                        help="Ignore timing changes below this many ns/op (default 50)")
+    args = parser.parse_args()
+
+    try:
+        baseline = load(args.baseline)
+        current = load(args.current)
+    except (OSError, ValueError) as error:
+        print(error, file=sys.stderr)
+        sys.exit(2)
+
+    if baseline["target"] != current["target"] or baseline["cpu_mhz"] != current["cpu_mhz"]:
+        print("warning: comparing %s @ %d MHz with %s @ %d MHz" % (
+            baseline["target"], baseline["cpu_mhz"], current["target"], current["cpu_mhz"]), file=sys.stderr)
+
+    regressions = compare(baseline, current, args.threshold, args.min_ns)
+    if regressions:
+        print("%d regression(s) over %.0f%%: %s" % (len(regressions), args.threshold, ", ".join(regressions)))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,148 @@
+"""
+delta_batch.py
+
+Decodes the delta-encoded battery batches (BATTERY_DELTA_BATCH, see
+include/delta_batch.h) back into samples, from a contentInstance's base64
+con or from a fake CSE log recorded with --log-bodies:
+
+    python tools/delta_batch.py AQPoB6bm...
+    python tools/delta_batch.py --log cse.jsonl
+
+encode() mirrors DeltaBatchEncoder and is used by tools/payload_size.py.
+"""
+
+import argparse
+import base64
+import json
+import math
+import sys
+
+VERSION = 1
+CONTENT_FORMAT = "application/x-mio-delta:1"
+
+
+def zigzag(value):
+    return (value << 1) ^ (value >> 63)
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def round_half_away(value):
+    """lround(): halves go away from zero, unlike round()"""
+    return int(math.copysign(math.floor(abs(value) + 0.5), value))
+
+
+def put_varint(out, value):
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        out.append(byte | (0x80 if value else 0))
+        if not value:
+            return
+
+
+def get_varint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        if offset >= len(data):
+            raise ValueError("batch truncated")
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+
+def encode(samples, lux_quantum=1.0):
+    """samples: (time, lux or None, occupied) in time order"""
+    out = bytearray([VERSION])
+    put_varint(out, round_half_away(lux_quantum * 1000))
+    last_time = last_interval = last_steps = 0
+    for i, (time, lux, occupied) in enumerate(samples):
+        interval = 0 if i == 0 else time - last_time
+        # Like the firmware: non-finite or out-of-range lux goes as no reading
+        has_lux = lux is not None and math.isfinite(lux) and abs(lux / lux_quantum) < 2 ** 31 - 1
+        steps = round_half_away(lux / lux_quantum) if has_lux else last_steps
+        if i == 0:
+            put_varint(out, time)
+        put_varint(out, zigzag(interval - last_interval) << 2 | (2 if occupied else 0) | (1 if has_lux else 0))
+        if has_lux:
+            put_varint(out, zigzag(steps - last_steps))
+        last_time, last_interval, last_steps = time, interval, steps
+    return bytes(out)
+
+
+def decode(data):
+    """@return list of {"time", "lux" (None if missing), "occupied"}"""
+    if not data:
+        return []
+    if data[0] != VERSION:
+        raise ValueError("unsupported batch version %d" % data[0])
+    milli_lux, offset = get_varint(data, 1)
+    quantum = milli_lux / 1000.0
+    samples = []
+    if offset == len(data):
+        return samples
+    time, offset = get_varint(data, offset)
+    interval = steps = 0
+    while offset < len(data):
+        head, offset = get_varint(data, offset)
+        if samples:
+            interval += unzigzag(head >> 2)
+            time += interval
+        lux = None
+        if head & 1:
+            delta, offset = get_varint(data, offset)
+            steps += unzigzag(delta)
+            lux = round(steps * quantum, 3)
+        samples.append({"time": time, "lux": lux, "occupied": bool(head & 2)})
+    return samples
+
+
+def decode_content(con):
+    return decode(base64.b64decode(con))
+
+
+def batches_in_log(path):
+    """Yield (path, con) for every batch contentInstance in a fake CSE log"""
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            record = json.loads(line)
+            body = record.get("body")
+            if record.get("method") != "POST" or not body:
+                continue
+            try:
+                cin = json.loads(body).get("m2m:cin", {})
+            except ValueError:
+                continue
+            if cin.get("cnf") == CONTENT_FORMAT:
+                yield record.get("path", ""), cin["con"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode delta-encoded battery batches")
+    parser.add_argument("con", nargs="?", help="Base64 content of one batch contentInstance")
+    parser.add_argument("--log", help="Decode every batch in a fake CSE log (--log-bodies)")
+    args = parser.parse_args()
+
+    if args.log:
+        batches = list(batches_in_log(args.log))
+    elif args.con:
+        batches = [("", args.con)]
+    else:
+        parser.error("give a base64 batch or --log")
+
+    for path, con in batches:
+        samples = decode_content(con)
+        print("%s%d samples, %d bytes" % (path + ": " if path else "", len(samples), len(base64.b64decode(con))))
+        for sample in samples:
+            lux = "-" if sample["lux"] is None else "%g" % sample["lux"]
+            print("  %d  lux %-8s occupied %d" % (sample["time"], lux, sample["occupied"]))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,769 @@
+"""
+fake_cse.py
+
+Lightweight stand-in for the ACME MN-CSE with the subset of oneM2M the
+firmware uses: create/retrieve/update/delete of AE, CNT, CIN, FCNT and
+SUB over HTTP with structured paths, discovery (fu=1), subscription
+verification and notifications to the node's /notify. Every request is
+recorded with its timing, and latency, 409s, 5xx and connection resets
+can be injected:
+
+    python tools/fake_cse.py --port 8081
+    python tools/fake_cse.py --latency 80 --jitter 40 --error-rate 0.05 --log run.jsonl
+    python tools/fake_cse.py --reset-rate 0.02 --match "PUT .*/luxSensor"
+    python tools/fake_cse.py --rtt 50
+    python tools/fake_cse.py --tls-cert cse.crt --tls-key cse.key --client-ca ca.crt
+    python tools/fake_cse.py --log run.jsonl --log-bodies
+
+--latency is spent by the server on each request. --rtt instead puts a
+relay in front of the server that holds every TCP segment for half the
+round trip in each direction, so pipelined requests overlap their round
+trips as they would on a real link.
+
+--tls-cert serves HTTPS instead of HTTP; --client-ca also requires a
+client certificate signed by that CA (mTLS). Every handshake is recorded
+as "tls full", "tls resumed" or "tls failed" with its server-side time,
+so session resumption shows up in the summary next to the requests.
+
+--log-bodies keeps each request body in its record, for
+tools/payload_size.py and tools/delta_batch.py --log.
+
+Point CSE_HOST in include/config.h at this machine (127.0.0.1 for the
+native build). Ctrl-C or SIGTERM prints a per-method/status summary. Everything
+under /__fake/ is a control API that is neither faulted nor recorded:
+
+    GET  /__fake/requests?since=N   Recorded requests (JSON list)
+    GET  /__fake/stats              Summary as JSON
+    GET  /__fake/tree               Resource paths and types
+    POST /__fake/faults             Replace fault settings (JSON, same names as the flags)
+    POST /__fake/reset              Drop all resources below the AEs and the request log
+
+Other tools import FakeCSE and run it in-process (start()/stop()).
+"""
+
+import argparse
+import http.client
+import json
+import queue
+import random
+import re
+import signal
+import socket
+import ssl
+import struct
+import sys
+import threading
+import time
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+RT_AE = 2
+RT_CNT = 3
+RT_CIN = 4
+RT_CSE = 5
+RT_SUB = 23
+RT_FCNT = 28
+
+TYPE_KEYS = {RT_AE: "m2m:ae", RT_CNT: "m2m:cnt", RT_CIN: "m2m:cin", RT_CSE: "m2m:cb", RT_SUB: "m2m:sub"}
+RI_PREFIX = {RT_AE: "C", RT_CNT: "cnt", RT_CIN: "cin", RT_SUB: "sub", RT_FCNT: "fcnt"}
+
+# Notification event types (enc/net)
+NET_UPDATE = 1
+NET_DELETE = 2
+NET_CREATE_CHILD = 3
+NET_DELETE_CHILD = 4
+
+# HTTP status -> oneM2M response status code
+RSC = {200: 2000, 201: 2001, 400: 4000, 403: 4103, 404: 4004, 405: 4005, 409: 4105, 500: 5000, 503: 5103}
+
+NOTIFY_WORKERS = 4
+
+
+def timestamp():
+    now = time.time()
+    return time.strftime("%Y%m%dT%H%M%S", time.gmtime(now)) + ",%06d" % int((now % 1) * 1e6)
+
+
+class OneM2MError(Exception):
+    def __init__(self, status, message):
+        super().__init__(message)
+        self.status = status
+
+
+# ==================== RESOURCES ====================
+
+class Resource:
+    def __init__(self, ty, key, attrs, parent):
+        self.ty = ty
+        self.key = key          # Representation key: m2m:cnt, mio:luxSr, ...
+        self.attrs = attrs
+        self.parent = parent
+        self.children = {}      # rn -> Resource, in creation order
+
+    @property
+    def rn(self):
+        return self.attrs["rn"]
+
+    @property
+    def path(self):
+        return (self.parent.path if self.parent else "") + "/" + self.rn
+
+    def representation(self):
+        return {self.key: dict(self.attrs)}
+
+    def descendants(self):
+        for child in self.children.values():
+            yield child
+            yield from child.descendants()
+
+
+# ==================== FAULTS ====================
+
+class Faults:
+    """Injected behavior; applies to requests whose "METHOD /path" matches"""
+
+    FIELDS = {
+        "latency": 0.0,       # ms added before every response
+        "jitter": 0.0,        # ms, uniform 0..jitter on top
+        "error_rate": 0.0,    # share answered with error_status
+        "error_status": 503,
+        "conflict_rate": 0.0, # share of creates answered 409 without creating
+        "reset_rate": 0.0,    # share of connections reset instead of answered
+        "rtt": 0.0,           # ms round trip on every connection (needs the relay, --rtt)
+        "match": "",          # regex on "METHOD /path?query"
+    }
+
+    def __init__(self, **settings):
+        for name, default in self.FIELDS.items():
+            setattr(self, name, settings.get(name, default))
+        self.pattern = re.compile(self.match) if self.match else None
+
+    def to_dict(self):
+        return {name: getattr(self, name) for name in self.FIELDS}
+
+    def applies(self, method, target):
+        return self.pattern is None or self.pattern.search("%s %s" % (method, target)) is not None
+
+    def delay_seconds(self, rng):
+        return (self.latency + rng.uniform(0, self.jitter)) / 1000.0
+
+    def outcome(self, method, rng):
+        """None to serve normally, "reset", or an HTTP status to answer with"""
+        if self.reset_rate and rng.random() < self.reset_rate:
+            return "reset"
+        if self.error_rate and rng.random() < self.error_rate:
+            return int(self.error_status)
+        if method == "POST" and self.conflict_rate and rng.random() < self.conflict_rate:
+            return 409
+        return None
+
+
+# ==================== RTT RELAY ====================
+
+class RttRelay:
+    """Accepts on the public port and relays to the HTTP server, holding
+    each segment for faults.rtt / 2 in either direction"""
+
+    def __init__(self, cse, host, port, backend_port):
+        self.cse = cse
+        self.listener = socket.create_server((host, port), backlog=CSEServer.request_queue_size)
+        self.port = self.listener.getsockname()[1]
+        self.backend = ("127.0.0.1", backend_port)
+
+    def start(self):
+        threading.Thread(target=self._accept, name="rtt-relay", daemon=True).start()
+        return self
+
+    def stop(self):
+        self.listener.close()
+
+    def _accept(self):
+        while True:
+            try:
+                client, _ = self.listener.accept()
+                backend = socket.create_connection(self.backend)
+            except OSError:
+                if self.listener.fileno() < 0:
+                    return
+                continue
+            for sock in (client, backend):
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            open_directions = [2]
+            lock = threading.Lock()
+            self._delay_line(client, backend, open_directions, lock)
+            self._delay_line(backend, client, open_directions, lock)
+
+    def _delay_line(self, source, sink, open_directions, lock):
+        segments = queue.Queue()
+
+        def receive():
+            while True:
+                try:
+                    data = source.recv(65536)
+                except OSError:
+                    data = None  # Reset: passed on as a reset
+                segments.put((time.monotonic() + self.cse.faults.rtt / 2000.0, data))
+                if not data:
+                    return
+
+        def deliver():
+            while True:
+                due, data = segments.get()
+                wait = due - time.monotonic()
+                if wait > 0:
+                    time.sleep(wait)
+                try:
+                    if data:
+                        sink.sendall(data)
+                        continue
+                    if data is None:
+                        sink.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+                        sink.close()
+                    else:
+                        sink.shutdown(socket.SHUT_WR)
+                except OSError:
+                    pass
+                break
+            with lock:
+                open_directions[0] -= 1
+                finished = open_directions[0] == 0
+            if finished:
+                source.close()
+                sink.close()
+
+        threading.Thread(target=receive, name="relay-rx", daemon=True).start()
+        threading.Thread(target=deliver, name="relay-tx", daemon=True).start()
+
+
+# ==================== REQUEST LOG ====================
+
+class RequestLog:
+    def __init__(self, path=None):
+        self.lock = threading.Lock()
+        self.records = []
+        self.file = open(path, "a", encoding="utf-8") if path else None
+        self.started = time.time()
+
+    def add(self, record):
+        with self.lock:
+            record["seq"] = len(self.records)
+            self.records.append(record)
+            if self.file:
+                self.file.write(json.dumps(record) + "\n")
+                self.file.flush()
+
+    def since(self, seq):
+        with self.lock:
+            return self.records[seq:]
+
+    def clear(self):
+        with self.lock:
+            self.records = []
+            self.started = time.time()
+
+    def summary(self):
+        with self.lock:
+            records = list(self.records)
+            window = max(time.time() - self.started, 1e-9)
+
+        groups = {}
+        for record in records:
+            key = "%s %s" % (record["kind"] if record["kind"] != "request" else record["method"], record["status"])
+            groups.setdefault(key, []).append(record["ms"])
+
+        requests = [r for r in records if r["kind"] == "request"]
+        reused = sum(1 for r in requests if r.get("connection_request", 1) > 1)
+        return {
+            "window_s": round(window, 3),
+            "requests": len(requests),
+            "requests_per_s": round(len(requests) / window, 2),
+            "keepalive_reuse": round(reused / len(requests), 3) if requests else 0.0,
+            "groups": {key: latency_stats(values) for key, values in sorted(groups.items())},
+        }
+
+
+def server_tls_context(cert, key, client_ca=None):
+    """HTTPS with session IDs and tickets on; client_ca requires client certificates"""
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(cert, key)
+    if client_ca:
+        context.load_verify_locations(client_ca)
+        context.verify_mode = ssl.CERT_REQUIRED
+    return context
+
+
+def latency_stats(values):
+    ordered = sorted(values)
+
+    def quantile(q):
+        return round(ordered[min(len(ordered) - 1, int(q * len(ordered)))], 2)
+
+    return {"count": len(ordered), "p50_ms": quantile(0.50), "p90_ms": quantile(0.90),
+            "p99_ms": quantile(0.99), "max_ms": round(ordered[-1], 2)}
+
+
+def print_summary(summary, out=sys.stderr):
+    print("%d requests in %.1f s (%.1f/s), %.0f%% on reused connections"
+          % (summary["requests"], summary["window_s"], summary["requests_per_s"],
+             100 * summary["keepalive_reuse"]), file=out)
+    print("%-16s %7s %9s %9s %9s %9s" % ("method status", "count", "p50 ms", "p90 ms", "p99 ms", "max ms"), file=out)
+    for key, stats in summary["groups"].items():
+        print("%-16s %7d %9.1f %9.1f %9.1f %9.1f" % (key, stats["count"], stats["p50_ms"], stats["p90_ms"],
+                                                    stats["p99_ms"], stats["max_ms"]), file=out)
+
+
+# ==================== CSE ====================
+
+class FakeCSE:
+    def __init__(self, host="0.0.0.0", port=8081, cse_name="room-mn-cse", aes=("moodMonitorAE",),
+                 faults=None, verify_subscriptions=True, log_path=None, seed=None, quiet=True, rtt_relay=False,
+                 tls=None, log_bodies=False):
+        self.host = host
+        self.port = port
+        self.cse_name = cse_name
+        self.aes = list(aes)
+        self.faults = faults or Faults()
+        self.verify_subscriptions = verify_subscriptions
+        self.quiet = quiet
+        self.log = RequestLog(log_path)
+        self.rng = random.Random(seed)
+        self.lock = threading.RLock()
+        self.server = None
+        self.rtt_relay = rtt_relay
+        self.relay = None
+        self.tls = tls  # ssl.SSLContext from server_tls_context(), None for plain HTTP
+        self.log_bodies = log_bodies
+        self.notify_queues = [queue.Queue() for _ in range(NOTIFY_WORKERS)]
+        self._build_base()
+
+    # ---------- lifecycle ----------
+
+    def _build_base(self):
+        with self.lock:
+            self.base = Resource(RT_CSE, TYPE_KEYS[RT_CSE], {
+                "rn": self.cse_name, "ri": "id-" + self.cse_name, "ty": RT_CSE, "csi": "/id-" + self.cse_name,
+                "cst": 2, "srt": [RT_AE, RT_CNT, RT_CIN, RT_CSE, RT_SUB, RT_FCNT], "ct": timestamp(),
+            }, None)
+            self.by_ri = {self.base.attrs["ri"]: self.base}
+            for ae in self.aes:
+                self._add(self.base, RT_AE, TYPE_KEYS[RT_AE], {"rn": ae, "api": "N" + ae, "rr": True})
+
+    def start(self):
+        address = ("127.0.0.1", 0) if self.rtt_relay else (self.host, self.port)
+        self.server = CSEServer(address, CSEHandler)
+        self.server.cse = self
+        if self.rtt_relay:
+            # Requests are logged with the relay's address as the client
+            self.relay = RttRelay(self, self.host, self.port, self.server.server_address[1]).start()
+            self.port = self.relay.port
+        else:
+            self.port = self.server.server_address[1]  # For port 0
+        threading.Thread(target=self.server.serve_forever, name="fake-cse", daemon=True).start()
+        for index, work in enumerate(self.notify_queues):
+            threading.Thread(target=self._notify_worker, args=(work,), name="notify%d" % index, daemon=True).start()
+        return self
+
+    def stop(self):
+        if self.relay:
+            self.relay.stop()
+            self.relay = None
+        if self.server:
+            self.server.shutdown()
+            self.server.server_close()
+            self.server = None
+
+    @property
+    def url(self):
+        return "%s://127.0.0.1:%d" % ("https" if self.tls else "http", self.port)
+
+    def reset(self):
+        self._build_base()
+        self.log.clear()
+
+    # ---------- tree ----------
+
+    def _add(self, parent, ty, key, attrs):
+        ri = "%s%010d" % (RI_PREFIX.get(ty, "r"), self.rng.getrandbits(32))
+        now = timestamp()
+        attrs.update({"ri": ri, "pi": parent.attrs["ri"], "ty": ty, "ct": now, "lt": now})
+        resource = Resource(ty, key, attrs, parent)
+        parent.children[attrs["rn"]] = resource
+        self.by_ri[ri] = resource
+        return resource
+
+    def _remove(self, resource):
+        for descendant in list(resource.descendants()):
+            self.by_ri.pop(descendant.attrs["ri"], None)
+        self.by_ri.pop(resource.attrs["ri"], None)
+        del resource.parent.children[resource.rn]
+
+    def resolve(self, path):
+        parts = [part for part in path.split("/") if part]
+        if not parts or parts[0] != self.cse_name:
+            # Unstructured: /<ri>
+            if len(parts) == 1 and parts[0] in self.by_ri:
+                return self.by_ri[parts[0]]
+            raise OneM2MError(404, "resource not found: " + path)
+
+        resource = self.base
+        for index, part in enumerate(parts[1:]):
+            if part == "la" and index == len(parts) - 2 and resource.ty == RT_CNT:
+                instances = [c for c in resource.children.values() if c.ty == RT_CIN]
+                if not instances:
+                    raise OneM2MError(404, "container is empty")
+                return instances[-1]
+            if part not in resource.children:
+                raise OneM2MError(404, "resource not found: " + path)
+            resource = resource.children[part]
+        return resource
+
+    # ---------- operations ----------
+
+    def retrieve(self, path, query):
+        resource = self.resolve(path)
+        if query.get("fu") == ["1"]:
+            types = {int(ty) for ty in query.get("ty", [])}
+            structured = query.get("drt", ["1"]) == ["1"]
+            found = [d for d in resource.descendants() if not types or d.ty in types]
+            uris = [d.path.lstrip("/") if structured else d.attrs["ri"] for d in found]
+            return 200, {"m2m:uril": uris}
+        return 200, resource.representation()
+
+    def create(self, path, ty, body):
+        parent = self.resolve(path)
+        if ty is None or len(body) != 1:
+            raise OneM2MError(400, "create needs ty and one resource representation")
+        key, attrs = next(iter(body.items()))
+        if ty in TYPE_KEYS and key != TYPE_KEYS[ty]:
+            raise OneM2MError(400, "%s does not match ty=%d" % (key, ty))
+        if ty == RT_FCNT and "cnd" not in attrs:
+            raise OneM2MError(400, "FlexContainer without cnd")
+
+        attrs = dict(attrs)
+        if ty == RT_CIN:
+            if "rn" not in attrs:
+                number = len(parent.children) + self.rng.getrandbits(16)
+                while "cin_%d" % number in parent.children:
+                    number += 1
+                attrs["rn"] = "cin_%d" % number
+            attrs["cs"] = len(json.dumps(attrs.get("con", "")))
+        if "rn" not in attrs:
+            attrs["rn"] = "%s%d" % (RI_PREFIX.get(ty, "r"), self.rng.getrandbits(24))
+        if attrs["rn"] in parent.children:
+            raise OneM2MError(409, "resource already exists: %s/%s" % (path, attrs["rn"]))
+
+        resource = self._add(parent, ty, key, attrs)
+        if ty == RT_CIN:
+            self._trim_container(parent)
+        self._notify(parent, NET_CREATE_CHILD, resource.representation())
+        return 201, resource.representation()
+
+    def _trim_container(self, container):
+        mni = container.attrs.get("mni")
+        instances = [c for c in container.children.values() if c.ty == RT_CIN]
+        while mni is not None and len(instances) > mni:
+            self._remove(instances.pop(0))
+        container.attrs["cni"] = len(instances)
+        container.attrs["cbs"] = sum(c.attrs.get("cs", 0) for c in instances)
+
+    def verify_subscription(self, path, body):
+        """Send vrq to every nu; done outside the tree lock since it waits on the node"""
+        attrs = body.get(TYPE_KEYS[RT_SUB], {})
+        for target in attrs.get("nu", []):
+            status = self._send_notification(target, {"m2m:sgn": {"vrq": True, "sur": path + "/" + attrs.get("rn", ""),
+                                                                  "cr": attrs.get("cr", "")}})
+            if status is None or not 200 <= status < 300:
+                raise OneM2MError(403, "subscription verification failed for " + target)
+
+    def update(self, path, body):
+        resource = self.resolve(path)
+        if len(body) != 1 or next(iter(body)) != resource.key:
+            raise OneM2MError(400, "update must use the resource's own key " + resource.key)
+        changes = next(iter(body.values()))
+        for name in ("ri", "pi", "ty", "ct", "rn"):
+            if name in changes:
+                raise OneM2MError(400, "attribute %s is not updatable" % name)
+
+        resource.attrs.update(changes)
+        resource.attrs["lt"] = timestamp()
+        self._notify(resource, NET_UPDATE, resource.representation(), set(changes))
+        return 200, resource.representation()
+
+    def delete(self, path):
+        resource = self.resolve(path)
+        if resource is self.base:
+            raise OneM2MError(405, "cannot delete the CSE base")
+        representation = resource.representation()
+        self._notify(resource, NET_DELETE, representation)
+        parent = resource.parent
+        self._remove(resource)
+        if resource.ty == RT_CIN:
+            self._trim_container(parent)
+        self._notify(parent, NET_DELETE_CHILD, representation)
+        return 200, representation
+
+    # ---------- notifications ----------
+
+    def _notify(self, resource, event, representation, changed=None):
+        for sub in [c for c in resource.children.values() if c.ty == RT_SUB]:
+            enc = sub.attrs.get("enc", {})
+            if event not in enc.get("net", [NET_UPDATE]):
+                continue
+            attributes = enc.get("atr")
+            if event == NET_UPDATE and attributes and changed is not None and not changed & set(attributes):
+                continue
+            body = {"m2m:sgn": {"nev": {"rep": representation, "net": event}, "sur": sub.path.lstrip("/")}}
+            for target in sub.attrs.get("nu", []):
+                # Hash by target so each node sees its notifications in order
+                self.notify_queues[hash(target) % NOTIFY_WORKERS].put((target, body))
+
+    def _notify_worker(self, work):
+        while True:
+            target, body = work.get()
+            self._send_notification(target, body)
+
+    def _send_notification(self, target, body):
+        url = urllib.parse.urlsplit(target)
+        start = time.perf_counter()
+        status = None
+        try:
+            connection = http.client.HTTPConnection(url.hostname, url.port or 80, timeout=3)
+            payload = json.dumps(body)
+            connection.request("POST", url.path or "/", payload, {
+                "Content-Type": "application/json;ty=" + str(RT_SUB), "X-M2M-Origin": "/id-" + self.cse_name,
+                "X-M2M-RI": "notif_%d" % self.rng.getrandbits(32), "X-M2M-RVI": "3"})
+            response = connection.getresponse()
+            response.read()
+            status = response.status
+            connection.close()
+        except OSError:
+            pass
+
+        self.log.add({"kind": "notify", "t": time.time(), "method": "POST", "path": target,
+                      "status": status or 0, "ms": (time.perf_counter() - start) * 1000,
+                      "vrq": "vrq" in body["m2m:sgn"]})
+        if not self.quiet:
+            print("notify %s -> %s" % (target, status), file=sys.stderr)
+        return status
+
+    # ---------- dispatch ----------
+
+    def handle(self, method, target, headers, body):
+        """(status, JSON body or None) for one oneM2M request"""
+        url = urllib.parse.urlsplit(target)
+        query = urllib.parse.parse_qs(url.query)
+        ty = None
+        match = re.search(r"ty=(\d+)", headers.get("Content-Type", ""))
+        if match:
+            ty = int(match.group(1))
+
+        try:
+            document = json.loads(body) if body else {}
+        except ValueError:
+            return 400, {"m2m:dbg": "invalid JSON"}
+
+        try:
+            if method == "POST" and ty == RT_SUB and self.verify_subscriptions:
+                self.verify_subscription(url.path, document)
+            with self.lock:
+                if method == "GET":
+                    return self.retrieve(url.path, query)
+                if method == "POST":
+                    return self.create(url.path, ty, document)
+                if method == "PUT":
+                    return self.update(url.path, document)
+                if method == "DELETE":
+                    return self.delete(url.path)
+            return 405, {"m2m:dbg": "unsupported method " + method}
+        except OneM2MError as error:
+            return error.status, {"m2m:dbg": str(error)}
+
+    def handle_control(self, method, target, body):
+        url = urllib.parse.urlsplit(target)
+        query = urllib.parse.parse_qs(url.query)
+        command = url.path[len("/__fake/"):]
+
+        if method == "GET" and command == "requests":
+            return 200, self.log.since(int(query.get("since", ["0"])[0]))
+        if method == "GET" and command == "stats":
+            return 200, self.log.summary()
+        if method == "GET" and command == "tree":
+            with self.lock:
+                return 200, [{"path": r.path, "ty": r.ty, "ri": r.attrs["ri"]} for r in self.base.descendants()]
+        if method == "POST" and command == "faults":
+            self.faults = Faults(**json.loads(body or b"{}"))
+            return 200, self.faults.to_dict()
+        if method == "POST" and command == "reset":
+            self.reset()
+            return 200, {"reset": True}
+        return 404, {"error": "unknown control " + command}
+
+
+class CSEServer(ThreadingHTTPServer):
+    daemon_threads = True
+    request_queue_size = 512  # Listen backlog; fleets open hundreds of connections at once
+
+    def handle_error(self, request, client_address):
+        # Failed handshakes are already recorded
+        if not isinstance(sys.exc_info()[1], (ssl.SSLError, OSError)):
+            super().handle_error(request, client_address)
+
+
+class CSEHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # Keep-alive like ACME
+    server_version = "fake-cse"
+
+    def setup(self):
+        # Pipelined replies go out back to back; Nagle would hold each one
+        # until the client ACKs the last
+        self.request.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        if self.server.cse.tls:
+            self.handshake()
+        super().setup()
+        self.connection_requests = 0
+
+    def handshake(self):
+        cse = self.server.cse
+        start = time.perf_counter()
+        self.request = cse.tls.wrap_socket(self.request, server_side=True, do_handshake_on_connect=False)
+        try:
+            self.request.do_handshake()
+            status = "resumed" if self.request.session_reused else "full"
+        except (ssl.SSLError, OSError):
+            status = "failed"
+            raise
+        finally:
+            cse.log.add({"kind": "tls", "t": time.time(), "status": status,
+                         "ms": (time.perf_counter() - start) * 1000, "client": "%s:%d" % self.client_address})
+            if not cse.quiet:
+                print("TLS %s" % status, file=sys.stderr)
+
+    def do_GET(self):
+        self.serve("GET")
+
+    def do_POST(self):
+        self.serve("POST")
+
+    def do_PUT(self):
+        self.serve("PUT")
+
+    def do_DELETE(self):
+        self.serve("DELETE")
+
+    def serve(self, method):
+        cse = self.server.cse
+        start = time.perf_counter()
+        self.connection_requests += 1
+        length = int(self.headers.get("Content-Length") or 0)
+        body = self.rfile.read(length) if length else b""
+
+        if self.path.startswith("/__fake/"):
+            status, document = cse.handle_control(method, self.path, body)
+            self.respond(status, document, {})
+            return
+
+        faults = cse.faults
+        outcome = None
+        if faults.applies(method, self.path):
+            delay = faults.delay_seconds(cse.rng)
+            if delay > 0:
+                time.sleep(delay)
+            outcome = faults.outcome(method, cse.rng)
+
+        if outcome == "reset":
+            # RST instead of FIN: linger 0 and close before the handler finishes
+            self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+            self.connection.close()
+            self.close_connection = True
+            status, sent = 0, 0
+        elif outcome is not None:
+            status, document = outcome, {"m2m:dbg": "injected %d" % outcome}
+            sent = self.respond(status, document, {"X-M2M-RI": self.headers.get("X-M2M-RI", "")})
+        else:
+            status, document = cse.handle(method, self.path, self.headers, body)
+            sent = self.respond(status, document, {"X-M2M-RI": self.headers.get("X-M2M-RI", "")})
+
+        record = {
+            "kind": "request", "t": time.time(), "method": method, "path": self.path,
+            "ty": self.headers.get("Content-Type", "").partition("ty=")[2] or None,
+            "status": status, "ms": (time.perf_counter() - start) * 1000,
+            "origin": self.headers.get("X-M2M-Origin"), "ri": self.headers.get("X-M2M-RI"),
+            "client": "%s:%d" % self.client_address, "connection_request": self.connection_requests,
+            "bytes_in": len(body), "bytes_out": sent, "injected": outcome is not None,
+        }
+        if cse.log_bodies:
+            record["body"] = body.decode("utf-8", "replace")
+        cse.log.add(record)
+        if not cse.quiet:
+            print("%s %s -> %s" % (method, self.path, status or "reset"), file=sys.stderr)
+
+    def respond(self, status, document, extra):
+        payload = json.dumps(document).encode() if document is not None else b""
+        reason = self.responses.get(status, ("",))[0]
+        headers = ["HTTP/1.1 %d %s" % (status, reason), "Server: fake-cse",
+                   "Content-Type: application/json", "Content-Length: %d" % len(payload),
+                   "X-M2M-RSC: %d" % RSC.get(status, 5000), "X-M2M-RVI: 3"]
+        headers += ["%s: %s" % item for item in extra.items() if item[1]]
+        if self.headers.get("Connection", "").lower() == "close":
+            headers.append("Connection: close")
+            self.close_connection = True
+        # One write: split header/body segments stall on Nagle + delayed ACK
+        self.wfile.write(("\r\n".join(headers) + "\r\n\r\n").encode() + payload)
+        return len(payload)
+
+    def log_message(self, format, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fake oneM2M CSE for firmware integration and load tests")
+    parser.add_argument("--host", default="0.0.0.0", help="Listen address (default all)")
+    parser.add_argument("--port", type=int, default=8081, help="Listen port (default 8081, as CSE_PORT)")
+    parser.add_argument("--cse-name", default="room-mn-cse", help="CSE resource name (CSE_NAME)")
+    parser.add_argument("--ae", action="append", help="AE created at start (repeatable, default moodMonitorAE)")
+    parser.add_argument("--latency", type=float, default=0.0, help="Added response latency in ms")
+    parser.add_argument("--jitter", type=float, default=0.0, help="Uniform extra latency 0..N ms")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="Share of requests answered with --error-status")
+    parser.add_argument("--error-status", type=int, default=503, help="Status for injected errors (default 503)")
+    parser.add_argument("--conflict-rate", type=float, default=0.0, help="Share of creates answered 409")
+    parser.add_argument("--reset-rate", type=float, default=0.0, help="Share of requests answered with a TCP reset")
+    parser.add_argument("--rtt", type=float, help="Round trip in ms added by a relay on every connection")
+    parser.add_argument("--match", default="", help='Only fault requests matching this regex on "METHOD /path"')
+    parser.add_argument("--no-verify", action="store_true", help="Skip subscription verification requests")
+    parser.add_argument("--tls-cert", help="Serve HTTPS with this PEM certificate (chain)")
+    parser.add_argument("--tls-key", help="PEM private key of --tls-cert")
+    parser.add_argument("--client-ca", help="Require client certificates signed by this PEM CA (mTLS)")
+    parser.add_argument("--log", help="Append every request as a JSON line to this file")
+    parser.add_argument("--log-bodies", action="store_true", help="Keep request bodies in the log records")
+    parser.add_argument("--seed", type=int, help="Seed for injected faults and resource IDs")
+    parser.add_argument("-v", "--verbose", action="store_true", help="Print each request to stderr")
+    args = parser.parse_args()
+    if bool(args.tls_cert) != bool(args.tls_key) or (args.client_ca and not args.tls_cert):
+        parser.error("--tls-cert and --tls-key go together; --client-ca needs them")
+
+    faults = Faults(latency=args.latency, jitter=args.jitter, error_rate=args.error_rate,
+                    error_status=args.error_status, conflict_rate=args.conflict_rate,
+                    reset_rate=args.reset_rate, rtt=args.rtt or 0.0, match=args.match)
+    cse = FakeCSE(host=args.host, port=args.port, cse_name=args.cse_name, aes=args.ae or ["moodMonitorAE"],
+                  faults=faults, verify_subscriptions=not args.no_verify, log_path=args.log,
+                  seed=args.seed, quiet=not args.verbose, rtt_relay=args.rtt is not None,
+                  tls=server_tls_context(args.tls_cert, args.tls_key, args.client_ca) if args.tls_cert else None,
+                  log_bodies=args.log_bodies)
+    cse.start()
+
+    def interrupt(signum, frame):
+        raise KeyboardInterrupt
+
+    signal.signal(signal.SIGTERM, interrupt)  # kill from a test script also prints the summary
+    print("Fake CSE /%s on port %d%s" % (args.cse_name, cse.port, " (TLS)" if cse.tls else ""), file=sys.stderr)
+
+    try:
+        while True:
+            time.sleep(3600)
+    except KeyboardInterrupt:
+        pass
+    print_summary(cse.log.summary())  # Server threads are daemons and end with the process
+
+
+if __name__ == "__main__":
+    main()
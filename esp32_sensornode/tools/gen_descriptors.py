@@ -0,0 +1,158 @@
+"""
+gen_descriptors.py
+
+Generates include/mio_descriptors.h from the FlexContainer module class
+definitions (.fcp). Runs as a PlatformIO pre-build script and can also be
+run by hand:
+
+    python tools/gen_descriptors.py
+
+The header is only rewritten when its content changes, so unchanged .fcp
+files do not trigger a rebuild.
+"""
+
+import json
+import os
+import re
+import sys
+import zlib
+
+# Module classes used by the firmware, in output order
+FCP_FILES = ["mio_sensors.fcp", "cod_subset.fcp"]
+OUTPUT = os.path.join("include", "mio_descriptors.h")
+
+FLEX_TYPES = {
+    "boolean": "Boolean",
+    "integer": "Integer",
+    "nonNegInteger": "NonNegInteger",
+    "positiveInteger": "NonNegInteger",
+    "float": "Float",
+    "string": "String",
+    "timestamp": "Timestamp",
+    "list": "List",
+}
+
+CPP_KEYWORDS = {"and", "or", "not", "xor", "int", "bool", "float", "char",
+                "long", "short", "class", "struct", "enum", "new", "delete",
+                "default", "case", "switch", "if", "else", "for", "while", "do",
+                "return", "this", "true", "false", "type", "union"}
+
+
+def load_fcp(path):
+    # .fcp is JSON with // line comments
+    with open(path, encoding="utf-8") as f:
+        text = re.sub(r"^\s*//.*$", "", f.read(), flags=re.MULTILINE)
+    return json.loads(text)
+
+
+def struct_name(lname):
+    return lname[0].upper() + lname[1:]
+
+
+def enumerator(sname):
+    return sname + "_" if sname in CPP_KEYWORDS else sname
+
+
+def flex_type(attribute, key="type"):
+    name = attribute.get(key)
+    if name is None:
+        return "None"
+    if name not in FLEX_TYPES:
+        raise ValueError("unsupported datatype '%s' for %s" % (name, attribute["sname"]))
+    return FLEX_TYPES[name]
+
+
+def emit_class(module, announced):
+    attributes = module.get("attributes", [])
+    lines = []
+    lines.append("// %s (%s)" % (module["lname"], module["type"]))
+    lines.append("struct %s {" % struct_name(module["lname"]))
+    lines.append('    static constexpr const char* TYPE = "%s";' % module["type"])
+    lines.append('    static constexpr const char* CND = "%s";' % module["cnd"])
+
+    names = [enumerator(a["sname"]) for a in attributes]
+    lines.append("    enum Attribute : uint8_t { %s };" % ", ".join(names + ["ATTRIBUTE_COUNT"]))
+
+    if attributes:
+        lines.append("    static constexpr FlexAttribute ATTRIBUTES[ATTRIBUTE_COUNT] = {")
+        for a in attributes:
+            mandatory = "true" if a.get("car", "01") == "1" else "false"
+            lines.append('        { "%s", FlexType::%s, FlexType::%s, %s },'
+                         % (a["sname"], flex_type(a), flex_type(a, "ltype"), mandatory))
+        lines.append("    };")
+
+    if announced is not None:
+        known = [a["sname"] for a in attributes]
+        missing = [s for s in announced if s not in known]
+        if missing:
+            raise ValueError("%sAnnc announces unknown attributes %s" % (module["type"], missing))
+        lines.append("    static constexpr uint8_t ANNOUNCED[] = { %s };"
+                     % ", ".join(enumerator(s) for s in announced))
+        lines.append("    static constexpr size_t ANNOUNCED_COUNT = %d;" % len(announced))
+
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def generate(project_dir):
+    modules = []
+    for name in FCP_FILES:
+        modules.extend(load_fcp(os.path.join(project_dir, name)))
+
+    announced = {}
+    for module in modules:
+        if module["type"].endswith("Annc"):
+            base = module["type"][:-len("Annc")]
+            announced[base] = [a["sname"] for a in module.get("attributes", [])]
+
+    blocks = [emit_class(m, announced.get(m["type"]))
+              for m in modules if not m["type"].endswith("Annc")]
+    schema_hash = zlib.crc32("\n\n".join(blocks).encode("utf-8"))
+
+    return "\n".join([
+        "/**",
+        " * mio_descriptors.h",
+        " *",
+        " * GENERATED by tools/gen_descriptors.py from %s - do not edit." % ", ".join(FCP_FILES),
+        " * One descriptor per FlexContainer module class; announced attribute",
+        " * lists come from the matching ...Annc class.",
+        " */",
+        "",
+        "#ifndef MIO_DESCRIPTORS_H",
+        "#define MIO_DESCRIPTORS_H",
+        "",
+        '#include "flex_descriptor.h"',
+        "",
+        "// CRC-32 of the descriptors below; part of the provisioning manifest hash,",
+        "// so a changed attribute or announced list reprovisions the node",
+        "#define MIO_DESCRIPTORS_HASH 0x%08Xu" % schema_hash,
+        "",
+        "\n\n".join(blocks),
+        "",
+        "#endif // MIO_DESCRIPTORS_H",
+        "",
+    ])
+
+
+def write_if_changed(project_dir):
+    path = os.path.join(project_dir, OUTPUT)
+    content = generate(project_dir)
+    try:
+        with open(path, encoding="utf-8") as f:
+            if f.read() == content:
+                return False
+    except FileNotFoundError:
+        pass
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(content)
+    print("Generated %s" % OUTPUT)
+    return True
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    write_if_changed(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        write_if_changed(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+        sys.exit(0)
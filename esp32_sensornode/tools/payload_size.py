@@ -0,0 +1,189 @@
+"""
+payload_size.py
+
+Compares uplink body sizes of the sensor encodings on a recorded run: the
+lux, loudness and occupancy updates in a fake CSE log (--log-bodies), for
+example from the fleet simulator (sim/fleet, which uses the firmware's
+payload builders):
+
+    python tools/fake_cse.py --no-verify --log run.jsonl --log-bodies &
+    .pio/build/fleet/program --nodes 10 --speed 60 --duration 60
+    python tools/payload_size.py run.jsonl --speed 60
+
+Rows:
+  recorded        The update bodies as sent
+  quantized JSON  The same updates with lux and loudness rounded to their
+                  quanta (LUX_QUANTUM, AUDIO_QUANTUM) and printed compactly
+  delta batches   Lux and occupancy sampled every --wake seconds of
+                  virtual time, as battery mode does, and posted --batch
+                  samples per contentInstance (BATTERY_DELTA_BATCH); the
+                  loudness updates stay quantized JSON
+
+Record with firmware that does not quantize yet to see what quantizing
+saves; on a quantized recording the first two rows match.
+"""
+
+import argparse
+import base64
+import json
+import sys
+from collections import defaultdict
+
+import delta_batch
+
+# Module class short name -> (attribute, reading)
+MODULES = {
+    "mio:luxSr": ("lux", "lux"),
+    "cod:acoSr": ("louds", "louds"),
+    "mio:occSr": ("occ", "occ"),
+}
+
+
+def quantum_decimals(quantum):
+    """Mirrors flexQuantize() in include/flex_descriptor.h"""
+    decimals, scale = 0, 1
+    while decimals < 6 and abs(quantum * scale - round(quantum * scale)) > 1e-3:
+        decimals += 1
+        scale *= 10
+    return decimals, scale
+
+
+def format_quantized(value, quantum):
+    decimals, scale = quantum_decimals(quantum)
+    step = max(1, delta_batch.round_half_away(quantum * scale))
+    scaled = delta_batch.round_half_away(value * scale / step) * step
+    if decimals == 0:
+        return str(scaled)
+    text = "%.*f" % (decimals, scaled / scale)
+    return text.rstrip("0").rstrip(".")
+
+
+def quantized_body(document, module, attribute, quantum):
+    """Re-serialize like ArduinoJson (compact), with the value quantized"""
+    marker = "\0quantized"
+    value = document[module][attribute]
+    document = dict(document, **{module: dict(document[module], **{attribute: marker})})
+    text = json.dumps(document, separators=(",", ":"), ensure_ascii=False)
+    return text.replace(json.dumps(marker), format_quantized(value, quantum))
+
+
+def load_readings(path, speed):
+    """@return {desk path: [(virtual s, reading, document, body bytes)]}"""
+    desks = defaultdict(list)
+    start = None
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            record = json.loads(line)
+            if record.get("kind") != "request" or record.get("method") != "PUT" or record.get("injected"):
+                continue
+            if "body" not in record:
+                raise ValueError("%s: no request bodies, record with fake_cse.py --log-bodies" % path)
+            try:
+                document = json.loads(record["body"])
+            except ValueError:
+                continue
+            for module, (attribute, reading) in MODULES.items():
+                if attribute not in document.get(module, {}):
+                    continue
+                start = record["t"] if start is None else start
+                desk = record["path"].rsplit("/", 1)[0]
+                desks[desk].append(((record["t"] - start) * speed, reading, document, len(record["body"].encode())))
+    return desks
+
+
+def sample_series(readings, wake):
+    """Lux and occupancy at every wake, carried forward from the last update"""
+    lux, occupied = None, False
+    samples = []
+    updates = iter(sorted((r for r in readings if r[1] != "louds"), key=lambda r: r[0]))
+    pending = next(updates, None)
+    if pending is None:
+        return samples
+    t = pending[0]
+    end = max(r[0] for r in readings)
+    while t <= end:
+        while pending is not None and pending[0] <= t:
+            module = next(m for m, (_, reading) in MODULES.items() if reading == pending[1])
+            value = pending[2][module][MODULES[module][0]]
+            if pending[1] == "lux":
+                lux = value
+            else:
+                occupied = bool(value)
+            pending = next(updates, None)
+        samples.append((int(t), lux, occupied))
+        t += wake
+    return samples
+
+
+def batch_bodies(samples, batch, lux_quantum):
+    for i in range(0, len(samples), batch):
+        con = base64.b64encode(delta_batch.encode(samples[i:i + batch], lux_quantum)).decode()
+        cin = {"m2m:cin": {"cnf": delta_batch.CONTENT_FORMAT, "con": con}}
+        yield len(json.dumps(cin, separators=(",", ":")))
+
+
+def measure(desks, args):
+    """@return {encoding: {"desk" or "louds": [requests, bytes]}}, battery samples"""
+    rows = defaultdict(lambda: defaultdict(lambda: [0, 0]))
+    samples_total = 0
+
+    def count(encoding, group, size):
+        rows[encoding][group][0] += 1
+        rows[encoding][group][1] += size
+
+    for readings in desks.values():
+        for _, reading, document, size in readings:
+            group = "louds" if reading == "louds" else "desk"
+            module = next(m for m, (_, r) in MODULES.items() if r == reading)
+            quantized = size
+            if reading != "occ":
+                quantum = args.lux_quantum if reading == "lux" else args.audio_quantum
+                quantized = len(quantized_body(document, module, MODULES[module][0], quantum).encode())
+            count("recorded", group, size)
+            count("quantized JSON", group, quantized)
+            if reading == "louds":
+                count("delta batches", group, quantized)
+
+        samples = sample_series(readings, args.wake)
+        samples_total += len(samples)
+        for size in batch_bodies(samples, args.batch, args.lux_quantum):
+            count("delta batches", "desk", size)
+    return rows, samples_total
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare sensor payload encodings on a recorded run")
+    parser.add_argument("log", help="fake_cse.py --log file recorded with --log-bodies")
+    parser.add_argument("--speed", type=float, default=10.0, help="Fleet --speed of the run (default 10)")
+    parser.add_argument("--wake", type=float, default=60.0, help="Battery wake interval in s (default 60)")
+    parser.add_argument("--batch", type=int, default=15, help="Samples per batch (BATTERY_UPLINK_EVERY, default 15)")
+    parser.add_argument("--lux-quantum", type=float, default=1.0, help="LUX_QUANTUM (default 1)")
+    parser.add_argument("--audio-quantum", type=float, default=0.1, help="AUDIO_QUANTUM (default 0.1)")
+    args = parser.parse_args()
+
+    try:
+        desks = load_readings(args.log, args.speed)
+    except (OSError, ValueError) as error:
+        print(error, file=sys.stderr)
+        return 1
+    if not desks:
+        print("%s: no sensor updates" % args.log, file=sys.stderr)
+        return 1
+
+    rows, samples = measure(desks, args)
+    readings = sum(len(r) for r in desks.values())
+    print("%d desks, %d updates, %d battery samples" % (len(desks), readings, samples))
+    print("%-16s %21s %21s %11s %8s" % ("", "lux + occupancy", "loudness", "total", ""))
+    print("%-16s %9s %11s %9s %11s %11s %8s" % ("encoding", "requests", "bytes", "requests", "bytes", "bytes",
+                                                "vs rec."))
+    recorded = sum(group[1] for group in rows["recorded"].values())
+    for name in ("recorded", "quantized JSON", "delta batches"):
+        desk, louds = rows[name]["desk"], rows[name]["louds"]
+        total = desk[1] + louds[1]
+        print("%-16s %9d %11d %9d %11d %11d %+7.1f%%" % (name, desk[0], desk[1], louds[0], louds[1], total,
+                                                         100.0 * (total - recorded) / recorded))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
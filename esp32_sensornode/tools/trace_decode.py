@@ -0,0 +1,217 @@
+"""
+trace_decode.py
+
+Converts a binary trace dump (GET /trace on the notification server, see
+include/trace.h) into Chrome trace event JSON, which loads in
+chrome://tracing and https://ui.perfetto.dev:
+
+    curl -o node.trc http://<node-ip>:8888/trace
+    python tools/trace_decode.py node.trc -o node.json
+    python tools/trace_decode.py --url http://<node-ip>:8888/trace --summary
+
+Each core is a process and each registered task a thread. Spans whose
+begin was overwritten in the ring are dropped.
+"""
+
+import argparse
+import json
+import struct
+import sys
+import urllib.request
+from collections import defaultdict
+
+# Order matches TraceEvent in include/trace.h
+EVENTS = [
+    "TASK_WAKE",
+    "TASK_SLEEP",
+    "JOB_BEGIN",
+    "JOB_END",
+    "I2S_READ_BEGIN",
+    "I2S_READ_END",
+    "HTTP_BEGIN",
+    "HTTP_END",
+    "NOTIFICATION",
+    "LED_SHOW",
+    "BREAKER",
+]
+
+RECORD = struct.Struct("<IBBH")
+HEADER = struct.Struct("<4sHHII")
+
+
+def read_names(data, offset):
+    count = data[offset]
+    offset += 1
+    names = []
+    for _ in range(count):
+        end = data.index(b"\0", offset)
+        names.append(data[offset:end].decode("utf-8", "replace"))
+        offset = end + 1
+    return names, offset
+
+
+def parse(data):
+    magic, record_size, capacity, written, now_us = HEADER.unpack_from(data, 0)
+    if magic != b"TRC1":
+        raise ValueError("not a trace dump (magic %r)" % magic)
+    if record_size != RECORD.size:
+        raise ValueError("unsupported record size %d" % record_size)
+
+    tasks, offset = read_names(data, HEADER.size)
+    jobs, offset = read_names(data, offset)
+
+    records = []
+    wraps = 0
+    previous = None
+    for start in range(offset, len(data) - RECORD.size + 1, RECORD.size):
+        timestamp, event, task, arg = RECORD.unpack_from(data, start)
+        # esp_timer low 32 bits wrap every ~71 minutes
+        if previous is not None and timestamp < previous and previous - timestamp > 1 << 31:
+            wraps += 1
+        previous = timestamp
+        records.append({
+            "us": timestamp + (wraps << 32),
+            "event": EVENTS[event] if event < len(EVENTS) else "EVENT_%d" % event,
+            "core": task >> 7,
+            "task": task & 0x7F,
+            "arg": arg,
+        })
+
+    return {
+        "capacity": capacity,
+        "written": written,
+        "lost": max(0, written - capacity),
+        "tasks": tasks,
+        "jobs": jobs,
+        "records": records,
+    }
+
+
+def task_name(trace, slot):
+    if 0 < slot <= len(trace["tasks"]):
+        return trace["tasks"][slot - 1]
+    return "other"
+
+
+def job_name(trace, index):
+    return trace["jobs"][index] if index < len(trace["jobs"]) else "job%d" % index
+
+
+def span_of(trace, record):
+    """(key, name, phase, args) for span events, None for instants"""
+    event, arg = record["event"], record["arg"]
+    if event == "TASK_WAKE":
+        return "run", "run", "B", {}
+    if event == "TASK_SLEEP":
+        return "run", "run", "E", {}
+    if event == "JOB_BEGIN":
+        return "job", job_name(trace, arg), "B", {}
+    if event == "JOB_END":
+        return "job", job_name(trace, arg), "E", {}
+    if event == "I2S_READ_BEGIN":
+        return "i2s", "i2s_read", "B", {}
+    if event == "I2S_READ_END":
+        return "i2s", "i2s_read", "E", {"bytes": arg}
+    if event == "HTTP_BEGIN":
+        return "http", "http", "B", {"slot": arg}
+    if event == "HTTP_END":
+        return "http", "http", "E", {"status": arg}
+    return None
+
+
+def to_chrome(trace):
+    records = trace["records"]
+    origin = records[0]["us"] if records else 0
+    events = []
+    threads = set()
+    open_spans = defaultdict(list)
+    durations = defaultdict(lambda: [0, 0])  # name -> [count, total us]
+
+    for record in records:
+        pid, tid = record["core"], record["task"]
+        threads.add((pid, tid))
+        ts = record["us"] - origin
+        span = span_of(trace, record)
+
+        if span is None:
+            args = {"arg": record["arg"]}
+            if record["event"] == "LED_SHOW":
+                rgb565 = record["arg"]
+                args = {"rgb": "#%02x%02x%02x" % ((rgb565 >> 11) << 3, ((rgb565 >> 5) & 0x3F) << 2,
+                                                 (rgb565 & 0x1F) << 3)}
+            events.append({"name": record["event"].lower(), "ph": "i", "s": "t",
+                           "pid": pid, "tid": tid, "ts": ts, "args": args})
+            continue
+
+        key, name, phase, args = span
+        stack = open_spans[(pid, tid, key)]
+        if phase == "B":
+            stack.append((ts, name))
+            events.append({"name": name, "ph": "B", "pid": pid, "tid": tid, "ts": ts, "args": args})
+        elif stack:
+            begin, begin_name = stack.pop()
+            events.append({"name": begin_name, "ph": "E", "pid": pid, "tid": tid, "ts": ts, "args": args})
+            label = begin_name if key != "run" else task_name(trace, tid)
+            durations[label][0] += 1
+            durations[label][1] += ts - begin
+
+    metadata = []
+    for pid in sorted({pid for pid, _ in threads}):
+        metadata.append({"name": "process_name", "ph": "M", "pid": pid, "args": {"name": "core %d" % pid}})
+    for pid, tid in sorted(threads):
+        metadata.append({"name": "thread_name", "ph": "M", "pid": pid, "tid": tid,
+                         "args": {"name": task_name(trace, tid)}})
+
+    chrome = {
+        "traceEvents": metadata + events,
+        "displayTimeUnit": "ms",
+        "otherData": {"written": trace["written"], "lost": trace["lost"]},
+    }
+    return chrome, durations
+
+
+def print_summary(trace, durations):
+    records = trace["records"]
+    window = (records[-1]["us"] - records[0]["us"]) if len(records) > 1 else 0
+    print("%d records over %.1f ms (%d overwritten)" % (len(records), window / 1000.0, trace["lost"]),
+          file=sys.stderr)
+    print("%-24s %6s %10s %9s %6s" % ("span", "count", "total ms", "avg ms", "share"), file=sys.stderr)
+    for name, (count, total) in sorted(durations.items(), key=lambda item: -item[1][1]):
+        share = 100.0 * total / window if window else 0.0
+        print("%-24s %6d %10.1f %9.2f %5.1f%%" % (name, count, total / 1000.0, total / 1000.0 / count, share),
+              file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a sensor node trace dump to Chrome trace JSON")
+    parser.add_argument("dump", nargs="?", help="Binary dump file (omit with --url)")
+    parser.add_argument("--url", help="Fetch the dump from http://<node>:8888/trace")
+    parser.add_argument("-o", "--output", help="Output JSON file (default stdout)")
+    parser.add_argument("--summary", action="store_true", help="Print time per span to stderr")
+    args = parser.parse_args()
+
+    if args.url:
+        with urllib.request.urlopen(args.url, timeout=10) as response:
+            data = response.read()
+    elif args.dump:
+        with open(args.dump, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("give a dump file or --url")
+
+    trace = parse(data)
+    chrome, durations = to_chrome(trace)
+
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump(chrome, f)
+    elif not args.summary:
+        json.dump(chrome, sys.stdout)
+        print()
+
+    if args.summary:
+        print_summary(trace, durations)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+"""
+wake_cycle_sim.py
+
+Host-side model of the BATTERY_MODE duty cycle (src/battery_mode.cpp):
+timer and occupancy wakes, a sample per wake, an uplink every N wakes with
+retry backoff, and only changed readings sent. Reports radio-on time per
+hour and average current, so wake interval and batch size can be tuned
+before flashing:
+
+    python tools/wake_cycle_sim.py --wake-interval 60 --uplink-every 15
+    python tools/wake_cycle_sim.py --sweep 1,5,15,30,60 --json
+
+Timings and currents default to ESP32-S3 datasheet / bench figures and can
+be overridden on the command line.
+"""
+
+import argparse
+import json
+import random
+import sys
+
+
+def simulate(args, uplink_every):
+    rng = random.Random(args.seed)
+    horizon_s = args.hours * 3600.0
+
+    # Occupancy edges as a Poisson process; each edge is one ext0 wake
+    edges = []
+    t = 0.0
+    while args.occupancy_events > 0:
+        t += rng.expovariate(args.occupancy_events / 3600.0)
+        if t >= horizon_s:
+            break
+        edges.append(t)
+
+    next_timer = args.wake_interval
+    edge_index = 0
+    now = 0.0
+
+    wakes = timer_wakes = edge_wakes = 0
+    uplinks = failed_uplinks = fast_connects = 0
+    next_uplink_wake = 1
+    failures_in_row = 0
+    batch = []
+    dropped = 0
+    puts = 0
+    lux = 200.0
+    last_sent_lux = None
+    occupied = False
+    last_sent_occ = None
+
+    radio_s = 0.0
+    awake_s = 0.0
+    charge_mas = 0.0  # mA*s
+    first = True
+
+    while True:
+        if edge_index < len(edges) and edges[edge_index] < next_timer:
+            now = edges[edge_index]
+            edge_index += 1
+            occupied = not occupied
+            edge_wakes += 1
+        else:
+            now = next_timer
+            next_timer += args.wake_interval
+            timer_wakes += 1
+        if now >= horizon_s:
+            break
+
+        wakes += 1
+        lux = max(0.0, lux + rng.gauss(0.0, args.lux_drift))
+
+        sample_s = (args.boot_ms + args.sample_ms) / 1000.0
+        awake_s += sample_s
+        charge_mas += sample_s * args.active_ma
+
+        if len(batch) == args.batch_capacity:
+            batch.pop(0)
+            dropped += 1
+        batch.append((lux, occupied))
+
+        if first or wakes >= next_uplink_wake:
+            first = False
+            fast = uplinks > 0 or args.cold_fast
+            connect_ms = args.fast_connect_ms if fast else args.scan_connect_ms
+            ok = rng.random() >= args.uplink_failure
+            if ok:
+                fast_connects += 1 if fast else 0
+                sends = 1  # diag:battery
+                for sample_lux, sample_occ in batch:
+                    if last_sent_lux is None or abs(sample_lux - last_sent_lux) >= args.lux_threshold:
+                        sends += 1
+                        last_sent_lux = sample_lux
+                    if last_sent_occ is None or sample_occ != last_sent_occ:
+                        sends += 1
+                        last_sent_occ = sample_occ
+                puts += sends
+                on_ms = connect_ms + args.ntp_ms + sends * args.put_ms
+                batch = []
+                uplinks += 1
+                failures_in_row = 0
+            else:
+                on_ms = args.uplink_timeout_ms
+                failed_uplinks += 1
+                failures_in_row = min(4, failures_in_row + 1)
+            next_uplink_wake = wakes + uplink_every * max(1, failures_in_row)
+
+            on_s = on_ms / 1000.0
+            radio_s += on_s
+            awake_s += on_s
+            charge_mas += on_s * args.radio_ma
+
+    sleep_s = max(0.0, horizon_s - awake_s)
+    charge_mas += sleep_s * args.sleep_ua / 1000.0
+    charge_mas += horizon_s * args.radar_ma
+    hours = args.hours
+
+    return {
+        "wakeIntervalS": args.wake_interval,
+        "uplinkEvery": uplink_every,
+        "hours": hours,
+        "wakes": wakes,
+        "timerWakes": timer_wakes,
+        "occupancyWakes": edge_wakes,
+        "uplinks": uplinks,
+        "failedUplinks": failed_uplinks,
+        "fastConnects": fast_connects,
+        "puts": puts,
+        "dropped": dropped,
+        "radioSecondsPerHour": round(radio_s / hours, 2),
+        "awakeSecondsPerHour": round(awake_s / hours, 2),
+        "avgCurrentMa": round(charge_mas / 3600.0 / hours, 3),
+        "mAhPerDay": round(charge_mas / 3600.0 / hours * 24, 2),
+        "batteryDays": round(args.battery_mah / (charge_mas / 3600.0 / hours * 24), 1),
+        "maxLatencyS": args.wake_interval * uplink_every,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulate BATTERY_MODE wake cycles")
+    parser.add_argument("--hours", type=float, default=24.0)
+    parser.add_argument("--wake-interval", type=float, default=60.0, help="BATTERY_WAKE_INTERVAL (s)")
+    parser.add_argument("--uplink-every", type=int, default=15, help="BATTERY_UPLINK_EVERY (wakes)")
+    parser.add_argument("--sweep", help="Comma-separated uplink-every values to compare")
+    parser.add_argument("--batch-capacity", type=int, default=64, help="BATTERY_BATCH_CAPACITY")
+    parser.add_argument("--occupancy-events", type=float, default=4.0, help="OT2 edges per hour")
+    parser.add_argument("--lux-drift", type=float, default=5.0, help="Lux std dev per wake")
+    parser.add_argument("--lux-threshold", type=float, default=1.0, help="LUX_THRESHOLD")
+    parser.add_argument("--uplink-failure", type=float, default=0.02, help="Probability an uplink fails")
+    parser.add_argument("--cold-fast", action="store_true", help="BSSID cache already in NVS at power-on")
+    parser.add_argument("--boot-ms", type=float, default=60.0, help="ROM + bootloader + setup() to first read")
+    parser.add_argument("--sample-ms", type=float, default=130.0, help="VEML settle + reads")
+    parser.add_argument("--fast-connect-ms", type=float, default=350.0, help="Cached BSSID/channel + DHCP")
+    parser.add_argument("--scan-connect-ms", type=float, default=2500.0, help="Full scan + DHCP")
+    parser.add_argument("--ntp-ms", type=float, default=80.0)
+    parser.add_argument("--put-ms", type=float, default=25.0, help="Per PUT on a keep-alive connection")
+    parser.add_argument("--uplink-timeout-ms", type=float, default=10000.0, help="BATTERY_UPLINK_TIMEOUT")
+    parser.add_argument("--active-ma", type=float, default=30.0, help="CPU awake, radio off")
+    parser.add_argument("--radio-ma", type=float, default=110.0, help="WiFi on, average TX/RX")
+    parser.add_argument("--sleep-ua", type=float, default=25.0, help="Deep sleep incl. VEML shutdown and regulator")
+    parser.add_argument("--radar-ma", type=float, default=0.0, help="Radar supply if it shares the battery (always on)")
+    parser.add_argument("--battery-mah", type=float, default=2000.0)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--json", action="store_true", help="Print results as JSON")
+    args = parser.parse_args()
+
+    values = [int(v) for v in args.sweep.split(",")] if args.sweep else [args.uplink_every]
+    results = [simulate(args, n) for n in values]
+
+    if args.json:
+        json.dump(results if args.sweep else results[0], sys.stdout, indent=2)
+        print()
+        return
+
+    print(f"{'N':>4} {'wakes':>6} {'uplinks':>7} {'radio s/h':>9} {'awake s/h':>9} "
+          f"{'avg mA':>7} {'mAh/day':>8} {'days':>6} {'latency s':>9}")
+    for r in results:
+        print(f"{r['uplinkEvery']:>4} {r['wakes']:>6} {r['uplinks']:>7} {r['radioSecondsPerHour']:>9} "
+              f"{r['awakeSecondsPerHour']:>9} {r['avgCurrentMa']:>7} {r['mAhPerDay']:>8} "
+              f"{r['batteryDays']:>6} {r['maxLatencyS']:>9.0f}")
+
+
+if __name__ == "__main__":
+    main()
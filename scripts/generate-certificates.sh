@@ -5,6 +5,8 @@
 # This script generates:
 # 1. A Certificate Authority (CA) for signing certificates
 # 2. Server certificates for both IN-CSE (cloud) and MN-CSE (raspberry pi)
+# 3. A client certificate for the sensor node (mTLS) and the firmware's
+#    esp32_sensornode/include/cse_credentials.h
 #
 
 set -e
@@ -23,6 +25,7 @@ PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
 CERTS_DIR="$PROJECT_ROOT/certs"
 CLOUD_CERT_DIR="$PROJECT_ROOT/cloud/cse/cert"
 RASPBERRY_CERT_DIR="$PROJECT_ROOT/raspberry_mn-cse/cse/cert"
+NODE_CREDENTIALS="$PROJECT_ROOT/esp32_sensornode/include/cse_credentials.h"
 
 echo -e "${GREEN}=== ACME CSE Certificate Generation ===${NC}"
 
@@ -178,8 +181,61 @@ else
     echo -e "${YELLOW}! Raspberry CSE certificate already exists: raspberry-cse.crt${NC}"
 fi
 
-# Step 5: Copy certificates to appropriate locations
-echo -e "\n${YELLOW}Step 5: Copying certificates to service directories...${NC}"
+# Step 5: Generate the sensor node client certificate
+echo -e "\n${YELLOW}Step 5: Generating sensor node client certificate...${NC}"
+
+# P-256: a far cheaper signature on the ESP32 than RSA-4096
+if [ ! -f node.key ]; then
+    openssl ecparam -name prime256v1 -genkey -noout -out node.key
+    echo -e "${GREEN}✓ Node private key generated: node.key${NC}"
+else
+    echo -e "${YELLOW}! Node private key already exists: node.key${NC}"
+fi
+
+cat > node.ext <<EOF
+basicConstraints = CA:FALSE
+keyUsage = digitalSignature
+extendedKeyUsage = clientAuth
+EOF
+
+if [ ! -f node.crt ]; then
+    openssl req -new -key node.key -out node.csr \
+        -subj "/C=US/ST=State/L=City/O=VibeTribe/OU=Sensors/CN=CMoodMonitor"
+    openssl x509 -req -in node.csr -CA ca.crt -CAkey ca.key \
+        -CAcreateserial -out node.crt -days 3650 \
+        -extfile node.ext
+    echo -e "${GREEN}✓ Node certificate generated: node.crt${NC}"
+else
+    echo -e "${YELLOW}! Node certificate already exists: node.crt${NC}"
+fi
+
+# PEM as C string literals for the firmware (CSE_USE_TLS in config.h)
+pem_literal() {
+    sed 's/.*/    "&\\n"/' "$1"
+}
+{
+    echo "// Generated by scripts/generate-certificates.sh - do not commit"
+    echo "#ifndef CSE_CREDENTIALS_H"
+    echo "#define CSE_CREDENTIALS_H"
+    echo ""
+    echo "static const char CSE_CA_CERT[] ="
+    pem_literal ca.crt
+    echo "    ;"
+    echo ""
+    echo "static const char NODE_CLIENT_CERT[] ="
+    pem_literal node.crt
+    echo "    ;"
+    echo ""
+    echo "static const char NODE_CLIENT_KEY[] ="
+    pem_literal node.key
+    echo "    ;"
+    echo ""
+    echo "#endif // CSE_CREDENTIALS_H"
+} > "$NODE_CREDENTIALS"
+echo -e "${GREEN}✓ Node credentials written to: $NODE_CREDENTIALS${NC}"
+
+# Step 6: Copy certificates to appropriate locations
+echo -e "\n${YELLOW}Step 6: Copying certificates to service directories...${NC}"
 
 # Copy to cloud directory
 cp ca.crt ca.key cloud-cse.crt cloud-cse.key "$CLOUD_CERT_DIR/"
@@ -189,8 +245,8 @@ echo -e "${GREEN}✓ Cloud certificates copied to: $CLOUD_CERT_DIR/${NC}"
 cp ca.crt ca.key raspberry-cse.crt raspberry-cse.key "$RASPBERRY_CERT_DIR/"
 echo -e "${GREEN}✓ Raspberry certificates copied to: $RASPBERRY_CERT_DIR/${NC}"
 
-# Step 6: Verify certificates
-echo -e "\n${YELLOW}Step 6: Verifying certificates...${NC}"
+# Step 7: Verify certificates
+echo -e "\n${YELLOW}Step 7: Verifying certificates...${NC}"
 
 echo -e "\n${GREEN}Cloud IN-CSE Certificate:${NC}"
 openssl x509 -in cloud-cse.crt -text -noout | grep -A 3 "Subject Alternative Name"
@@ -198,6 +254,9 @@ openssl x509 -in cloud-cse.crt -text -noout | grep -A 3 "Subject Alternative Nam
 echo -e "\n${GREEN}Raspberry MN-CSE Certificate:${NC}"
 openssl x509 -in raspberry-cse.crt -text -noout | grep -A 3 "Subject Alternative Name"
 
+echo -e "\n${GREEN}Sensor Node Client Certificate:${NC}"
+openssl x509 -in node.crt -text -noout | grep -A 1 "Extended Key Usage"
+
 # Clean up temporary files
 rm -f *.csr *.conf *.ext *.srl
 
@@ -209,6 +268,8 @@ echo -e "  Cloud CSE Certificate: ${GREEN}cloud-cse.crt${NC}"
 echo -e "  Cloud CSE Private Key: ${GREEN}cloud-cse.key${NC}"
 echo -e "  Raspberry CSE Certificate: ${GREEN}raspberry-cse.crt${NC}"
 echo -e "  Raspberry CSE Private Key: ${GREEN}raspberry-cse.key${NC}"
+echo -e "  Node Client Certificate: ${GREEN}node.crt${NC}"
+echo -e "  Node Private Key: ${GREEN}node.key${NC} (also in esp32_sensornode/include/cse_credentials.h)"
 echo -e "\n${YELLOW}Next steps:${NC}"
 echo -e "  1. Review the updated acme.ini files in cloud/cse/ and raspberry_mn-cse/cse/"
 echo -e "  2. Update docker-compose.yml files if needed"